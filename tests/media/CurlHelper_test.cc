@@ -0,0 +1,73 @@
+#include <thread>
+#include <boost/test/unit_test.hpp>
+
+#include <zypp/media/CurlHelper.h>
+
+#include "WebServer.h"
+
+using namespace zypp;
+using namespace internal;
+
+namespace
+{
+  size_t discard( char *, size_t size, size_t nmemb, void * )
+  { return size * nmemb; }
+
+  CURLcode perform( CURL * easy_r, CURLSH * share_r )
+  {
+    curl_easy_setopt( easy_r, CURLOPT_SHARE, share_r );
+    return curl_easy_perform( easy_r );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(thread_share)
+{
+  CURLSH * mainShare = curlThreadShare();
+  BOOST_REQUIRE( mainShare );
+  BOOST_CHECK_EQUAL( curlThreadShare(), mainShare );
+
+  CURLSH * otherShare = nullptr;
+  std::thread( [&]() { otherShare = curlThreadShare(); } ).join();
+  BOOST_CHECK( otherShare );
+  BOOST_CHECK( otherShare != mainShare );
+}
+
+BOOST_AUTO_TEST_CASE(thread_share_outlives_thread)
+{
+  WebServer web( Pathname(TESTS_SRC_DIR) / "repo/yum/data", 10001 );
+  BOOST_REQUIRE( web.start() );
+  std::string url( web.url().asString() + "/10.2-updates-subset/repodata/repomd.xml" );
+
+  CURL * easy = curl_easy_init();
+  BOOST_REQUIRE( easy );
+  curl_easy_setopt( easy, CURLOPT_URL, url.c_str() );
+  curl_easy_setopt( easy, CURLOPT_WRITEFUNCTION, discard );
+  curl_easy_setopt( easy, CURLOPT_FAILONERROR, 1L );
+  curl_easy_setopt( easy, CURLOPT_NOSIGNAL, 1L );
+
+  // set up and used in another thread, which exits while the handle still uses its share
+  CURLcode res = CURLE_FAILED_INIT;
+  std::thread( [&]() { res = perform( easy, curlThreadShare() ); } ).join();
+  BOOST_CHECK_EQUAL( res, CURLE_OK );
+
+  // the leaked share of the exited thread is still usable
+  BOOST_CHECK_EQUAL( curl_easy_perform( easy ), CURLE_OK );
+
+  // concurrent transfers in two threads, each using its own share
+  CURL * other = curl_easy_duphandle( easy );
+  BOOST_REQUIRE( other );
+  CURLcode otherRes = CURLE_FAILED_INIT;
+  std::thread worker( [&]() {
+    for ( unsigned i = 0; i < 5; ++i )
+      otherRes = perform( other, curlThreadShare() );
+  } );
+  for ( unsigned i = 0; i < 5; ++i )
+    res = perform( easy, curlThreadShare() );
+  worker.join();
+  BOOST_CHECK_EQUAL( res, CURLE_OK );
+  BOOST_CHECK_EQUAL( otherRes, CURLE_OK );
+
+  curl_easy_cleanup( other );
+  curl_easy_cleanup( easy );
+  web.stop();
+}
@@ -0,0 +1,101 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <netdb.h>
+#include <boost/test/unit_test.hpp>
+
+#include <zypp/media/DnsLookup_p.h>
+
+using namespace zypp;
+using namespace zypp::media;
+
+namespace
+{
+  /** Resolver blocking until released, counting the concurrent calls. */
+  struct BlockingResolver
+  {
+    int resolve( const std::string & )
+    {
+      unsigned now = ++_running;
+      unsigned max = _maxRunning;
+      while ( now > max && ! _maxRunning.compare_exchange_weak( max, now ) )
+        ;
+      ++_called;
+      std::unique_lock<std::mutex> lock( _mutex );
+      _cv.wait( lock, [this]() { return _released; } );
+      --_running;
+      return 0;
+    }
+
+    void release()
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _released = true;
+      _cv.notify_all();
+    }
+
+    /** The lookups keep it alive while they run. */
+    static DnsLookup::ResolveFnc fnc( std::shared_ptr<BlockingResolver> self_r )
+    { return [self_r]( const std::string & host_r ) { return self_r->resolve( host_r ); }; }
+
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _released = false;
+    std::atomic<unsigned> _running { 0 };
+    std::atomic<unsigned> _maxRunning { 0 };
+    std::atomic<unsigned> _called { 0 };
+  };
+}
+
+BOOST_AUTO_TEST_CASE(dns_lookup)
+{
+  std::shared_ptr<DnsLookup> good( DnsLookup::start( "good", []( const std::string & ) { return 0; } ) );
+  std::shared_ptr<DnsLookup> bad( DnsLookup::start( "bad", []( const std::string & ) { return EAI_NONAME; } ) );
+  BOOST_REQUIRE( good->wait( 5000 ) );
+  BOOST_REQUIRE( bad->wait( 5000 ) );
+  BOOST_CHECK( good->ok() );
+  BOOST_CHECK( ! bad->ok() );
+}
+
+BOOST_AUTO_TEST_CASE(dns_lookup_timeout)
+{
+  std::shared_ptr<BlockingResolver> blocking( new BlockingResolver );
+  std::vector<std::shared_ptr<DnsLookup>> lookups;
+  for ( unsigned i = 0; i < DnsLookup::maxThreads; ++i )
+    lookups.push_back( DnsLookup::start( "blocking", BlockingResolver::fnc( blocking ) ) );
+
+  // timed out, the lookups are dropped while still running
+  BOOST_CHECK( ! lookups[0]->wait( 100 ) );
+  lookups.clear();
+
+  // all threads are busy: the lookup waits, a dropped one is skipped
+  std::atomic<unsigned> skippedCalled { 0 };
+  std::shared_ptr<DnsLookup> skipped( DnsLookup::start( "skipped", [&]( const std::string & ) { ++skippedCalled; return 0; } ) );
+  std::shared_ptr<DnsLookup> waiting( DnsLookup::start( "waiting", []( const std::string & ) { return 0; } ) );
+  skipped.reset();
+  BOOST_CHECK( ! waiting->wait( 100 ) );
+  BOOST_CHECK_EQUAL( blocking->_called.load(), DnsLookup::maxThreads );
+
+  blocking->release();
+  BOOST_REQUIRE( waiting->wait( 5000 ) );
+  BOOST_CHECK( waiting->ok() );
+  BOOST_CHECK_EQUAL( skippedCalled.load(), 0U );
+  BOOST_CHECK( blocking->_maxRunning.load() <= DnsLookup::maxThreads );
+}
+
+BOOST_AUTO_TEST_CASE(dns_cache)
+{
+  DnsCache cache;
+  BOOST_CHECK_EQUAL( cache.ttl(), DnsCache::defaultTtl );
+  BOOST_CHECK( ! cache.ok( "host" ) );
+  cache.setOk( "host" );
+  BOOST_CHECK( cache.ok( "host" ) );
+  BOOST_CHECK( ! cache.ok( "other" ) );
+
+  // expired entries are looked up again
+  DnsCache expired( 0 );
+  expired.setOk( "host" );
+  BOOST_CHECK( ! expired.ok( "host" ) );
+}
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <zypp/Digest.h>
+#include <zypp/TmpPath.h>
+#include <zypp/media/MediaBlockList.h>
+
+using namespace zypp;
+using namespace zypp::media;
+
+static unsigned int bytewiseRsum( unsigned int rs, const char * bytes, size_t len )
+{
+  unsigned short s = ( rs >> 16 ) & 65535;
+  unsigned short m = rs & 65535;
+  for ( ; len > 0; len-- )
+  {
+    s += (unsigned char)*bytes++;
+    m += s;
+  }
+  return ( s & 65535 ) << 16 | ( m & 65535 );
+}
+
+static std::string randomData( size_t len_r )
+{
+  std::string ret( len_r, '\0' );
+  for ( char & c : ret )
+    c = ::random();
+  return ret;
+}
+
+BOOST_AUTO_TEST_CASE(rsum)
+{
+  MediaBlockList bl;
+  std::string data( randomData( 4096 ) );
+  for ( size_t off = 0; off < 16; ++off )
+  {
+    for ( size_t len = 0; len + off < data.size(); len += ( len < 64 ? 1 : 61 ) )
+    {
+      unsigned int rs = ::random();
+      BOOST_REQUIRE_EQUAL( bl.updateRsum( rs, data.data() + off, len ), bytewiseRsum( rs, data.data() + off, len ) );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(reuse_shifted_blocks)
+{
+  const size_t blksize = 1024;
+  std::string olddata( randomData( 64 * blksize ) );
+  // the same data with some bytes inserted in front and in the middle
+  std::string newdata( "inserted" + olddata.substr( 0, 32 * blksize ) + "inserted" + olddata.substr( 32 * blksize ) );
+
+  MediaBlockList bl( newdata.size() );
+  for ( size_t off = 0, blkno = 0; off < newdata.size(); off += blksize, ++blkno )
+  {
+    size_t len = std::min( newdata.size() - off, blksize );
+    bl.addBlock( off, len );
+    Digest dig;
+    dig.create( Digest::sha1() );
+    dig.update( newdata.data() + off, len );
+    std::vector<unsigned char> sum( dig.digestVector() );
+    bl.setChecksum( blkno, Digest::sha1(), sum.size(), sum.data() );
+    bl.setRsum( blkno, 4, bl.updateRsum( 0, newdata.data() + off, len ) );
+  }
+  size_t nblks = bl.numBlocks();
+
+  filesystem::TmpDir tmp;
+  Pathname oldfile( tmp.path() / "old" );
+  FILE * fp = ::fopen( oldfile.c_str(), "w" );
+  BOOST_REQUIRE( fp );
+  BOOST_REQUIRE_EQUAL( ::fwrite( olddata.data(), olddata.size(), 1, fp ), 1U );
+  ::fclose( fp );
+
+  Pathname newfile( tmp.path() / "new" );
+  FILE * wfp = ::fopen( newfile.c_str(), "w+" );
+  BOOST_REQUIRE( wfp );
+  bl.reuseBlocks( wfp, oldfile.asString() );
+
+  // only the blocks containing an insertion or the end of the file are left
+  BOOST_CHECK_LT( bl.numBlocks(), 4U );
+  BOOST_CHECK_GT( nblks - bl.numBlocks(), 60U );
+
+  // and all blocks written are at their new offset
+  std::string written( newdata.size(), '\0' );
+  ::rewind( wfp );
+  BOOST_CHECK_GT( ::fread( &written[0], 1, written.size(), wfp ), 0U );
+  ::fclose( wfp );
+  for ( size_t blkno = 0; blkno < bl.numBlocks(); ++blkno )
+  {
+    MediaBlock blk( bl.getBlock( blkno ) );
+    written.replace( blk.off, blk.size, newdata, blk.off, blk.size );
+  }
+  BOOST_CHECK( written == newdata );
+}
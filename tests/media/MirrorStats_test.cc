@@ -0,0 +1,63 @@
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <zypp/TmpPath.h>
+#include <zypp/media/MirrorStats_p.h>
+
+using namespace zypp;
+using namespace zypp::media;
+
+static std::vector<Url> mirrors( std::initializer_list<const char *> hosts_r )
+{
+  std::vector<Url> ret;
+  for ( const char * host : hosts_r )
+    ret.push_back( Url( std::string("http://") + host + "/repo/file.rpm" ) );
+  return ret;
+}
+
+BOOST_AUTO_TEST_CASE(sort_mirrors)
+{
+  MirrorStats stats;
+  stats.addTransfer( "fast", 10000000, 0.01 );
+  stats.addTransfer( "faster", 20000000, 0.02 );
+  stats.addTransfer( "slow", 100000 );
+  stats.addFailure( "broken" );
+
+  std::vector<Url> urls( mirrors( { "broken", "unknown1", "slow", "fast", "unknown2", "faster" } ) );
+  stats.sort( urls );
+  BOOST_REQUIRE_EQUAL( urls.size(), 6 );
+  BOOST_CHECK_EQUAL( urls[0].getHost(), "faster" );
+  BOOST_CHECK_EQUAL( urls[1].getHost(), "fast" );
+  BOOST_CHECK_EQUAL( urls[2].getHost(), "unknown1" );
+  BOOST_CHECK_EQUAL( urls[3].getHost(), "unknown2" );
+  BOOST_CHECK_EQUAL( urls[4].getHost(), "slow" );
+  BOOST_CHECK_EQUAL( urls[5].getHost(), "broken" );
+
+  // a mirror recovering from a failure
+  stats.addTransfer( "broken", 60000000 );
+  BOOST_CHECK( stats.get( "broken" ).failureRate() < 0.5 );
+  stats.sort( urls );
+  BOOST_CHECK_EQUAL( urls[0].getHost(), "broken" );
+}
+
+BOOST_AUTO_TEST_CASE(store_stats)
+{
+  filesystem::TmpDir tmp;
+  Pathname file( tmp.path() / "cache" / "mirrorstats" );
+  {
+    MirrorStats stats( file );
+    BOOST_CHECK( ! stats.get( "mirror" ).known() );
+    stats.addTransfer( "mirror", 1000, 0.5 );
+    stats.addTransfer( "mirror", 2000 );
+    stats.addFailure( "other" );
+    stats.save();
+  }
+  MirrorStats stats( file );
+  MirrorStats::Entry entry( stats.get( "mirror" ) );
+  BOOST_CHECK( entry.known() );
+  BOOST_CHECK_CLOSE( entry.throughput, 1300, 0.1 );
+  BOOST_CHECK_CLOSE( entry.rtt, 0.5, 0.1 );
+  BOOST_CHECK_EQUAL( entry.failureRate(), 0 );
+  BOOST_CHECK_EQUAL( stats.get( "other" ).failureRate(), 1 );
+  BOOST_CHECK( ! stats.get( "unknown" ).known() );
+}
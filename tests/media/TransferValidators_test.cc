@@ -0,0 +1,108 @@
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+
+#include <zypp/TmpPath.h>
+#include <zypp/media/TransferValidators_p.h>
+#include <zypp/media/CurlHelper.h>
+
+using namespace zypp;
+using namespace zypp::media;
+
+static Pathname writeFile( const Pathname & file_r, const std::string & content_r )
+{
+  std::ofstream( file_r.c_str() ) << content_r;
+  return file_r;
+}
+
+BOOST_AUTO_TEST_CASE(lookup_validators)
+{
+  filesystem::TmpDir tmp;
+  Pathname file( writeFile( tmp.path() / "repomd.xml", "content" ) );
+  Url url( "http://host/repo/repodata/repomd.xml" );
+
+  TransferValidators validators;
+  BOOST_CHECK( validators.lookup( url, file ).empty() );
+
+  validators.remember( url, "\"abc\"", Date( 1000 ), file );
+  TransferValidators::Entry entry( validators.lookup( url, file ) );
+  BOOST_CHECK_EQUAL( entry.etag, "\"abc\"" );
+  BOOST_CHECK_EQUAL( entry.lastModified, Date( 1000 ) );
+  BOOST_CHECK( validators.lookup( Url( "http://other/repo/repodata/repomd.xml" ), file ).empty() );
+
+  // only valid for the content they were sent with
+  writeFile( file, "changed" );
+  BOOST_CHECK( validators.lookup( url, file ).empty() );
+  BOOST_CHECK( validators.lookup( url, tmp.path() / "missing" ).empty() );
+}
+
+BOOST_AUTO_TEST_CASE(remember_not_modified)
+{
+  filesystem::TmpDir tmp;
+  Pathname file( writeFile( tmp.path() / "repomd.xml", "content" ) );
+  Url url( "http://host/repo/repodata/repomd.xml" );
+
+  TransferValidators validators;
+  validators.remember( url, "\"abc\"", Date( 1000 ), file );
+
+  // a 304 response does not need to repeat the validators
+  validators.remember( url, "", Date(), file );
+  BOOST_CHECK_EQUAL( validators.lookup( url, file ).etag, "\"abc\"" );
+
+  // new content without validators: forget them
+  writeFile( file, "changed" );
+  validators.remember( url, "", Date(), file );
+  writeFile( file, "content" );
+  BOOST_CHECK( validators.lookup( url, file ).empty() );
+
+  // an ETag we can't store
+  validators.remember( url, "\"a b\"", Date(), file );
+  BOOST_CHECK( validators.lookup( url, file ).empty() );
+}
+
+BOOST_AUTO_TEST_CASE(store_validators)
+{
+  filesystem::TmpDir tmp;
+  Pathname file( writeFile( tmp.path() / "repomd.xml", "content" ) );
+  Pathname store( tmp.path() / "cache" / "validators" );
+  Url url( "http://host/repo/repodata/repomd.xml" );
+  Url url2( "http://host/repo/media.1/media" );
+  {
+    TransferValidators validators( store );
+    validators.remember( url, "\"abc\"", Date( 1000 ), file );
+    validators.remember( url2, "", Date( 2000 ), file );
+    validators.save();
+  }
+  TransferValidators validators( store );
+  BOOST_CHECK_EQUAL( validators.lookup( url, file ).etag, "\"abc\"" );
+  BOOST_CHECK_EQUAL( validators.lookup( url, file ).lastModified, Date( 1000 ) );
+  BOOST_CHECK( validators.lookup( url2, file ).etag.empty() );
+  BOOST_CHECK_EQUAL( validators.lookup( url2, file ).lastModified, Date( 2000 ) );
+}
+
+BOOST_AUTO_TEST_CASE(track_validators_per_response)
+{
+  std::string lastRedirect;
+  internal::CurlConditionalRequest request;
+  request.lastRedirect = &lastRedirect;
+  auto header = [&request]( std::string line_r ) {
+    return internal::conditional_request_header_curl( &line_r[0], 1, line_r.size(), &request );
+  };
+
+  BOOST_CHECK_EQUAL( header( "HTTP/1.1 302 Found\r\n" ), 20 );
+  header( "ETag: \"redirect\"\r\n" );
+  header( "Last-Modified: Thu, 01 Jan 1970 00:16:40 GMT\r\n" );
+  header( "Location: http://mirror/repo/repodata/repomd.xml\r\n" );
+  header( "\r\n" );
+  BOOST_CHECK_EQUAL( request.etag, "\"redirect\"" );
+  BOOST_CHECK_EQUAL( request.lastModified, 1000 );
+  BOOST_CHECK_EQUAL( lastRedirect, "Location: http://mirror/repo/repodata/repomd.xml" );
+
+  // the validators of the redirect must not stick to the final response
+  header( "HTTP/1.1 200 OK\r\n" );
+  BOOST_CHECK( request.etag.empty() );
+  BOOST_CHECK_EQUAL( request.lastModified, 0 );
+  header( "ETag: \"abc\"\r\n" );
+  header( "\r\n" );
+  BOOST_CHECK_EQUAL( request.etag, "\"abc\"" );
+  BOOST_CHECK_EQUAL( request.lastModified, 0 );
+}
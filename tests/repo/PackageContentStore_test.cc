@@ -0,0 +1,113 @@
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+
+#include <zypp/TmpPath.h>
+#include <zypp/PathInfo.h>
+#include <zypp/repo/PackageContentStore_p.h>
+
+using namespace zypp;
+using namespace zypp::repo;
+
+static Pathname writeFile( const Pathname & file_r, const std::string & content_r )
+{
+  filesystem::assert_dir( file_r.dirname() );
+  std::ofstream( file_r.c_str() ) << content_r;
+  return file_r;
+}
+
+static std::string contentOf( const Pathname & file_r )
+{
+  std::ifstream str( file_r.c_str() );
+  return std::string( std::istreambuf_iterator<char>( str ), std::istreambuf_iterator<char>() );
+}
+
+BOOST_AUTO_TEST_CASE(store_entry)
+{
+  PackageContentStore store( "/var/cache/zypp/packages" );
+  BOOST_CHECK_EQUAL( store.root(), Pathname( "/var/cache/zypp/packages/.content" ) );
+
+  CheckSum sum( CheckSum::sha256FromString( "package" ) );
+  BOOST_CHECK_EQUAL( store.entry( sum ),
+                     store.root() / "sha256" / sum.checksum().substr( 0, 2 ) / sum.checksum() );
+  BOOST_CHECK( store.entry( CheckSum() ).empty() );
+  BOOST_CHECK( ! store.has( CheckSum() ) );
+}
+
+BOOST_AUTO_TEST_CASE(store_add_provide)
+{
+  filesystem::TmpDir tmp;
+  PackageContentStore store( tmp.path() );
+  CheckSum sum( CheckSum::sha256FromString( "package" ) );
+  Pathname cached( writeFile( tmp.path() / "repo1" / "x86_64" / "a.rpm", "package" ) );
+
+  BOOST_CHECK( ! store.has( sum ) );
+  BOOST_CHECK( ! store.provide( sum, tmp.path() / "repo2" / "x86_64" / "a.rpm" ) );
+  BOOST_CHECK( ! store.add( sum, tmp.path() / "missing.rpm" ) );
+
+  BOOST_REQUIRE( store.add( sum, cached ) );
+  BOOST_CHECK( store.has( sum ) );
+  BOOST_CHECK_EQUAL( PathInfo( cached ).nlink(), 2U );
+  BOOST_CHECK( store.add( sum, cached ) );	// already stored
+
+  // a stale file at dest is replaced
+  Pathname dest( writeFile( tmp.path() / "repo2" / "x86_64" / "a.rpm", "stale" ) );
+  BOOST_REQUIRE( store.provide( sum, dest ) );
+  BOOST_CHECK_EQUAL( contentOf( dest ), "package" );
+  BOOST_CHECK_EQUAL( PathInfo( dest ).nlink(), 3U );	// repo1, repo2 and the store share the file
+}
+
+BOOST_AUTO_TEST_CASE(store_provide_corrupted)
+{
+  filesystem::TmpDir tmp;
+  PackageContentStore store( tmp.path() );
+  CheckSum sum( CheckSum::sha256FromString( "package" ) );
+  writeFile( store.entry( sum ), "corrupted" );
+  BOOST_REQUIRE( store.has( sum ) );
+
+  Pathname dest( tmp.path() / "repo" / "a.rpm" );
+  BOOST_CHECK( ! store.provide( sum, dest ) );
+  BOOST_CHECK( ! PathInfo( dest ).isExist() );
+  BOOST_CHECK( ! store.has( sum ) );	// removed
+}
+
+BOOST_AUTO_TEST_CASE(store_provide_copy)
+{
+  // hardlinkCopy falls back to a copy if the entry can't be hardlinked (here: a symlink)
+  filesystem::TmpDir tmp;
+  PackageContentStore store( tmp.path() );
+  CheckSum sum( CheckSum::sha256FromString( "package" ) );
+  Pathname orig( writeFile( tmp.path() / "orig.rpm", "package" ) );
+  filesystem::assert_dir( store.entry( sum ).dirname() );
+  BOOST_REQUIRE_EQUAL( filesystem::symlink( orig, store.entry( sum ) ), 0 );
+
+  Pathname dest( tmp.path() / "repo" / "a.rpm" );
+  BOOST_REQUIRE( store.provide( sum, dest ) );
+  BOOST_CHECK( PathInfo( dest, PathInfo::LSTAT ).isFile() );
+  BOOST_CHECK_EQUAL( PathInfo( dest ).nlink(), 1U );
+  BOOST_CHECK_EQUAL( contentOf( dest ), "package" );
+}
+
+BOOST_AUTO_TEST_CASE(store_gc)
+{
+  filesystem::TmpDir tmp;
+  PackageContentStore store( tmp.path() );
+  BOOST_CHECK_EQUAL( store.gc(), 0U );	// no store yet
+
+  CheckSum sum1( CheckSum::sha256FromString( "package1" ) );
+  CheckSum sum2( CheckSum::sha256FromString( "package2" ) );
+  Pathname cached1( writeFile( tmp.path() / "repo" / "a.rpm", "package1" ) );
+  Pathname cached2( writeFile( tmp.path() / "repo" / "b.rpm", "package2" ) );
+  BOOST_REQUIRE( store.add( sum1, cached1 ) );
+  BOOST_REQUIRE( store.add( sum2, cached2 ) );
+
+  BOOST_CHECK_EQUAL( store.gc(), 0U );	// all in use
+  filesystem::unlink( cached2 );
+  BOOST_CHECK_EQUAL( store.gc(), 1U );
+  BOOST_CHECK( store.has( sum1 ) );
+  BOOST_CHECK( ! store.has( sum2 ) );
+  BOOST_CHECK( ! PathInfo( store.entry( sum2 ).dirname() ).isExist() );
+
+  filesystem::unlink( cached1 );
+  BOOST_CHECK_EQUAL( store.gc(), 1U );
+  BOOST_CHECK( ! PathInfo( store.root() / "sha256" ).isExist() );
+}
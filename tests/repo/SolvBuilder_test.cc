@@ -0,0 +1,73 @@
+extern "C"
+{
+#include <solv/pool.h>
+#include <solv/repo.h>
+#include <solv/repo_solv.h>
+}
+#include <cstdio>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <zypp/AutoDispose.h>
+#include <zypp/TmpPath.h>
+#include <zypp/repo/SolvBuilder_p.h>
+
+using namespace zypp;
+using namespace zypp::repo;
+
+#define DATADIR (Pathname(TESTS_SRC_DIR) + "/repo/yum/data")
+
+namespace
+{
+  /** The package names in \a solvfile_r, sorted. */
+  std::vector<std::string> packages( const Pathname & solvfile_r )
+  {
+    std::vector<std::string> ret;
+    ::Pool * pool = ::pool_create();
+    AutoDispose< ::Pool *> guard( pool, ::pool_free );
+    ::Repo * repo = ::repo_create( pool, "test" );
+
+    FILE * fp = ::fopen( solvfile_r.c_str(), "re" );
+    BOOST_REQUIRE( fp );
+    BOOST_CHECK_EQUAL( ::repo_add_solv( repo, fp, 0 ), 0 );
+    ::fclose( fp );
+
+    ::Id p;
+    ::Solvable * s;
+    FOR_REPO_SOLVABLES( repo, p, s )
+      ret.push_back( ::pool_id2str( pool, s->name ) );
+    std::sort( ret.begin(), ret.end() );
+    return ret;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(builder_invalid)
+{
+  BOOST_CHECK( ! SolvBuilder().valid() );
+  BOOST_CHECK( ! SolvBuilder( RepoType::YAST2, DATADIR / "extensions" ).valid() );
+  BOOST_CHECK( ! SolvBuilder( RepoType::RPMMD, DATADIR / "does-not-exist" ).valid() );
+}
+
+BOOST_AUTO_TEST_CASE(builder_ignores_unparsed_types)
+{
+  // repomd.xml also lists 'suseinfo' (and 'patches' in 10.2-updates-subset),
+  // which are ignored like repo2solv does.
+  filesystem::TmpDir tmp;
+  {
+    SolvBuilder builder( RepoType::RPMMD, DATADIR / "extensions" );
+    BOOST_REQUIRE( builder.valid() );
+    BOOST_REQUIRE_EQUAL( builder.build( tmp.path() / "extensions.solv" ), "" );
+    std::vector<std::string> got { packages( tmp.path() / "extensions.solv" ) };
+    BOOST_REQUIRE_EQUAL( got.size(), 1U );
+    BOOST_CHECK_EQUAL( got[0], "wt" );
+  }
+  {
+    SolvBuilder builder( RepoType::RPMMD, DATADIR / "10.2-updates-subset" );
+    BOOST_REQUIRE( builder.valid() );
+    BOOST_REQUIRE_EQUAL( builder.build( tmp.path() / "updates.solv" ), "" );
+    BOOST_CHECK( ! packages( tmp.path() / "updates.solv" ).empty() );
+  }
+}
@@ -116,3 +116,80 @@ BOOST_AUTO_TEST_CASE( locks_empty )
   locks.removeEmpty();
   BOOST_CHECK( locks.size() == 0 );
 }
+
+BOOST_AUTO_TEST_CASE( locks_apply )
+{
+  cout << "****apply many locks at once****"  << endl;
+  std::vector<PoolQuery> queries;
+  {
+    PoolQuery q;	// Locks::addLock( kind, name )
+    q.addAttribute( sat::SolvAttr::name, "zypper" );
+    q.addKind( ResKind::package );
+    q.setMatchExact();
+    q.setCaseSensitive( true );
+    queries.push_back( q );
+  }
+  {
+    PoolQuery q;	// zypper addlock
+    q.addAttribute( sat::SolvAttr::name, "kde*-zh*" );
+    q.setMatchGlob();
+    queries.push_back( q );
+  }
+  {
+    PoolQuery q;
+    q.addAttribute( sat::SolvAttr::name, "LIBZYPP" );
+    q.setMatchExact();
+    q.setInstalledOnly();
+    queries.push_back( q );
+  }
+  {
+    PoolQuery q;
+    q.addAttribute( sat::SolvAttr::name, "*office*" );
+    q.setMatchGlob();
+    q.addRepo( "opensuse" );
+    q.setEdition( Edition( "3" ), Rel::GE );
+    queries.push_back( q );
+  }
+  {
+    PoolQuery q;	// a patterns name includes its kind
+    q.addAttribute( sat::SolvAttr::name, "pattern:kde*" );
+    q.setMatchGlob();
+    q.setFlags( q.flags() - Match::SKIP_KIND );
+    queries.push_back( q );
+  }
+  {
+    PoolQuery q;	// run as query
+    q.addDependency( sat::SolvAttr::name, "glibc", Rel::LT, Edition( "3" ) );
+    queries.push_back( q );
+  }
+  {
+    PoolQuery q;
+    q.addAttribute( sat::SolvAttr::name, "foo-bar-nonexist" );
+    q.setMatchExact();
+    queries.push_back( q );
+  }
+
+  Locks& locks = Locks::instance();
+  std::set<sat::Solvable> expected;
+  for ( const PoolQuery & q : queries )
+  {
+    locks.addLock( q );
+    expected.insert( q.begin(), q.end() );
+  }
+  locks.merge();
+  BOOST_CHECK_EQUAL( locks.size(), queries.size() );
+  BOOST_CHECK( ! expected.empty() );
+
+  for ( const PoolItem & pi : ResPool::instance() )
+    pi.status().setLock( false, ResStatus::USER );
+  locks.apply();
+  for ( const PoolItem & pi : ResPool::instance() )
+    BOOST_CHECK_EQUAL( pi.status().isLocked(), expected.count( pi.satSolvable() ) != 0 );
+
+  BOOST_CHECK( locks.existEmpty() );
+
+  for ( const PoolQuery & q : queries )
+    locks.removeLock( q );
+  locks.merge();
+  BOOST_CHECK( locks.size() == 0 );
+}
@@ -211,3 +211,57 @@ BOOST_AUTO_TEST_CASE(test_exchange)
   BOOST_CHECK( PathInfo(a).isFile() );
   BOOST_CHECK( PathInfo(b).isDir() );
 }
+
+BOOST_AUTO_TEST_CASE(test_copy_and_remove)
+{
+  TmpDir root;
+  Pathname src( root/"src" );
+  Pathname dst( root/"dst" );
+  BOOST_CHECK_EQUAL( filesystem::assert_dir( src/"sub" ), 0 );
+  BOOST_CHECK_EQUAL( filesystem::assert_dir( dst ), 0 );
+  {
+    std::ofstream str( (src/"file").c_str() );
+    str << "foo bar" << endl;
+  }
+  BOOST_CHECK_EQUAL( filesystem::hardlink( src/"file", src/"sub/hardlink" ), 0 );
+  BOOST_CHECK_EQUAL( filesystem::symlink( "../file", src/"sub/symlink" ), 0 );
+
+  // copy
+  BOOST_CHECK_EQUAL( filesystem::copy( src/"sub", dst/"file" ), EINVAL );
+  BOOST_CHECK_EQUAL( filesystem::copy( src/"file", dst ), EISDIR );
+  BOOST_CHECK_EQUAL( filesystem::copy( src/"file", src/"sub/hardlink" ), EEXIST );
+  BOOST_CHECK_EQUAL( filesystem::copy( src/"file", dst/"file" ), 0 );
+  BOOST_CHECK_EQUAL( filesystem::checksum( dst/"file", "md5" ), filesystem::checksum( src/"file", "md5" ) );
+  BOOST_CHECK_EQUAL( filesystem::copy_file2dir( src/"file", dst/"file" ), ENOTDIR );
+  BOOST_CHECK_EQUAL( filesystem::copy_file2dir( src/"file", src/"sub" ), 0 );
+  BOOST_CHECK( PathInfo(src/"sub/file").isFile() );
+  BOOST_CHECK_EQUAL( filesystem::unlink( src/"sub/file" ), 0 );
+
+  // copy_dir: like 'cp -dR'
+  BOOST_CHECK_EQUAL( filesystem::copy_dir( src, dst/"file" ), ENOTDIR );
+  BOOST_CHECK_EQUAL( filesystem::copy_dir( src, dst ), 0 );
+  BOOST_CHECK_EQUAL( filesystem::copy_dir( src, dst ), EEXIST );
+  BOOST_CHECK( PathInfo(dst/"src/file").isFile() );
+  BOOST_CHECK_EQUAL( PathInfo(dst/"src/file").nlink(), nlink_t(2) );
+  BOOST_CHECK_EQUAL( PathInfo(dst/"src/file").ino(), PathInfo(dst/"src/sub/hardlink").ino() );
+  BOOST_CHECK( PathInfo(dst/"src/sub/symlink",PathInfo::LSTAT).isLink() );
+  BOOST_CHECK_EQUAL( filesystem::readlink( dst/"src/sub/symlink" ), Pathname("../file") );
+
+  // copy_dir_content: like 'cp -dR src/. dst'
+  BOOST_CHECK_EQUAL( filesystem::copy_dir_content( src, src ), EEXIST );
+  BOOST_CHECK_EQUAL( filesystem::copy_dir_content( src, dst ), 0 );
+  BOOST_CHECK( PathInfo(dst/"sub/hardlink").isFile() );
+  BOOST_CHECK( PathInfo(dst/"src/sub/hardlink").isFile() );
+
+  // clean_dir and recursive_rmdir
+  BOOST_CHECK_EQUAL( filesystem::recursive_rmdir( dst/"file" ), ENOTDIR );
+  BOOST_CHECK_EQUAL( filesystem::clean_dir( dst, true ), 0 );
+  BOOST_CHECK( PathInfo(dst).isDir() );
+  BOOST_CHECK_EQUAL( filesystem::is_empty_dir( dst ), 0 );
+  BOOST_CHECK_EQUAL( filesystem::copy_dir( src, dst ), 0 );
+  BOOST_CHECK_EQUAL( filesystem::recursive_rmdir( dst, true ), 0 );
+  BOOST_CHECK( ! PathInfo(dst).isExist() );
+  BOOST_CHECK_EQUAL( filesystem::recursive_rmdir( src ), 0 );
+  BOOST_CHECK( ! PathInfo(src).isExist() );
+  BOOST_CHECK_EQUAL( filesystem::recursive_rmdir( src ), 0 );
+}
@@ -589,6 +589,178 @@ BOOST_AUTO_TEST_CASE(pool_query_X2)
   BOOST_CHECK_EQUAL(std::for_each(q.begin(), q.end(), PrintAndCount())._count, 5);
 }
 
+// Queries preselecting candidates from the search index must find
+// the same as the equivalent regex (which can't use the index).
+BOOST_AUTO_TEST_CASE(pool_query_searchindex)
+{
+  cout << "****searchindex****"  << endl;
+  auto matches = []( const PoolQuery & q_r ) {
+    std::vector<sat::Solvable> ret( q_r.begin(), q_r.end() );
+    BOOST_CHECK( ! ret.empty() );
+    return ret;
+  };
+
+  PoolQuery q;
+  q.addAttribute(sat::SolvAttr::name, "zypper");
+  PoolQuery r;
+  r.setMatchRegex();
+  r.addAttribute(sat::SolvAttr::name, "zypper");
+  BOOST_CHECK( matches( q ) == matches( r ) );
+
+  q = PoolQuery();
+  q.setMatchGlob();
+  q.addAttribute(sat::SolvAttr::name, "kde*-z[gh]");
+  r = PoolQuery();
+  r.setMatchRegex();
+  r.addAttribute(sat::SolvAttr::name, "^kde.*-z[gh]$");
+  BOOST_CHECK( matches( q ) == matches( r ) );
+
+  q = PoolQuery();
+  q.addAttribute(sat::SolvAttr::summary, "PACKAGE MANAGEMENT");
+  q.addAttribute(sat::SolvAttr::description, "Virtualbox");
+  q.setUninstalledOnly();
+  r = PoolQuery();
+  r.setMatchRegex();
+  r.addAttribute(sat::SolvAttr::summary, "PACKAGE MANAGEMENT");
+  r.addAttribute(sat::SolvAttr::description, "Virtualbox");
+  r.setUninstalledOnly();
+  BOOST_CHECK( matches( q ) == matches( r ) );
+}
+
+
+namespace
+{
+  /** Remember the log lines, to tell whether a query searched in parallel. */
+  struct LogLines : public log::LineWriter
+  {
+    virtual void writeOut( const std::string & formated_r )
+    { _lines.push_back( formated_r ); }
+
+    unsigned count( const std::string & text_r ) const
+    { return std::count_if( _lines.begin(), _lines.end(), [&]( const std::string & line_r ) { return line_r.find( text_r ) != std::string::npos; } ); }
+
+    std::vector<std::string> _lines;
+  };
+}
+
+// Searching the repos in parallel finds the same, ordered by solvable id.
+BOOST_AUTO_TEST_CASE(pool_query_parallel)
+{
+  cout << "****parallel****"  << endl;
+  std::vector<PoolQuery> queries;
+  {
+    PoolQuery q;
+    q.addAttribute(sat::SolvAttr::description, "zypp");
+    queries.push_back( q );
+  }
+  {
+    PoolQuery q;
+    q.addAttribute(sat::SolvAttr::name, "kde");
+    q.addAttribute(sat::SolvAttr::summary, "KDE");
+    q.addKind(ResKind::package);
+    queries.push_back( q );
+  }
+  {
+    PoolQuery q;
+    q.setMatchRegex();
+    q.addAttribute(sat::SolvAttr::filelist, "^(package-manager|.*2solv)");
+    q.setUninstalledOnly();
+    queries.push_back( q );
+  }
+  {
+    PoolQuery q;	// runs sequential
+    q.addDependency(sat::SolvAttr::requires, "libzypp");
+    queries.push_back( q );
+  }
+
+  for ( unsigned i = 0; i < queries.size(); ++i )
+  {
+    PoolQuery & q( queries[i] );
+    std::set<sat::Solvable> expected( q.begin(), q.end() );
+    BOOST_CHECK( ! expected.empty() );
+    q.setParallel();
+    shared_ptr<LogLines> log( new LogLines );
+    std::vector<sat::Solvable> result;
+    {
+      base::LogControl::TmpLineWriter guard( log );
+      result.assign( q.begin(), q.end() );
+    }
+    BOOST_CHECK( std::set<sat::Solvable>( result.begin(), result.end() ) == expected );
+    BOOST_CHECK_EQUAL( result.size(), expected.size() );
+    if ( i == 2 )	// the regex is not indexed: one job per repo
+      BOOST_CHECK_EQUAL( log->count( "Parallel search in 2 repos" ), 1U );
+    else if ( i == 3 )	// sequential
+      BOOST_CHECK_EQUAL( log->count( "Parallel search in" ), 0U );
+  }
+  // matches are provided as usual
+  PoolQuery q( queries.front() );
+  for_( it, q.begin(), q.end() )
+    BOOST_CHECK( ! it.matchesEmpty() && it.matchesSize() > 0 );
+}
+
+BOOST_AUTO_TEST_CASE(pool_query_cache)
+{
+  cout << "****cache****"  << endl;
+  PoolQuery q;
+  q.addAttribute(sat::SolvAttr::name, "kde");
+  q.addAttribute(sat::SolvAttr::summary, "KDE");
+  std::vector<sat::Solvable> expected( q.begin(), q.end() );
+  BOOST_CHECK( ! expected.empty() );
+
+  // 2nd run remembers the result, 3rd run uses it
+  for ( unsigned i = 0; i < 2; ++i )
+  {
+    PoolQuery same( q );
+    BOOST_CHECK( std::vector<sat::Solvable>( same.begin(), same.end() ) == expected );
+    for_( it, same.begin(), same.end() )
+      BOOST_CHECK( ! it.matchesEmpty() );
+  }
+
+  // a query not iterated to the end remembers no partial result
+  {
+    PoolQuery other;
+    other.addAttribute(sat::SolvAttr::name, "kde");
+    other.addAttribute(sat::SolvAttr::summary, "KDE");
+    other.setCaseSensitive();
+    std::vector<sat::Solvable> otherExpected( other.begin(), other.end() );
+    for ( unsigned i = 0; i < 2; ++i )
+      BOOST_CHECK( ! other.empty() );
+    BOOST_CHECK( std::vector<sat::Solvable>( other.begin(), other.end() ) == otherExpected );
+    BOOST_CHECK( std::vector<sat::Solvable>( other.begin(), other.end() ) == otherExpected );
+  }
+
+  // a changed pool invalidates the remembered result
+  test.loadRepo( TESTS_SRC_DIR "/data/openSUSE-11.1", "opensuse2" );
+  Repository added( sat::Pool::instance().reposFind( "opensuse2" ) );
+  BOOST_REQUIRE( added );
+  {
+    std::vector<sat::Solvable> result( q.begin(), q.end() );
+    BOOST_CHECK_GT( result.size(), expected.size() );
+    BOOST_CHECK( std::find_if( result.begin(), result.end(), [&]( sat::Solvable s ) { return s.repository() == added; } ) != result.end() );
+    BOOST_CHECK( std::vector<sat::Solvable>( q.begin(), q.end() ) == result );
+    BOOST_CHECK( std::vector<sat::Solvable>( q.begin(), q.end() ) == result );
+  }
+  sat::Pool::instance().reposErase( "opensuse2" );
+  BOOST_CHECK( std::vector<sat::Solvable>( q.begin(), q.end() ) == expected );
+  BOOST_CHECK( std::vector<sat::Solvable>( q.begin(), q.end() ) == expected );
+
+  // options not serialized are part of the key
+  PoolQuery substr;
+  substr.addAttribute(sat::SolvAttr::name, "zypp");
+  std::vector<sat::Solvable> substrResult( substr.begin(), substr.end() );
+  PoolQuery word( substr );
+  word.setMatchWord();
+  BOOST_CHECK( std::vector<sat::Solvable>( word.begin(), word.end() ) != substrResult );
+  BOOST_CHECK( std::vector<sat::Solvable>( substr.begin(), substr.end() ) == substrResult );
+
+  // invalid regex throws each time
+  PoolQuery rx;
+  rx.addAttribute(sat::SolvAttr::name, "[");
+  rx.setMatchRegex();
+  BOOST_CHECK_THROW( rx.begin(), MatchException );
+  BOOST_CHECK_THROW( rx.begin(), MatchException );
+}
+
 
 BOOST_AUTO_TEST_CASE(pool_query_recovery)
 {
@@ -13,8 +13,10 @@
 #include <zypp/ServiceInfo.h>
 
 #include <zypp/RepoManager.h>
+#include <zypp/sat/Pool.h>
 
 #include "TestSetup.h"
+#include "WebServer.h"
 
 #include <boost/test/unit_test.hpp>
 
@@ -271,6 +273,209 @@ BOOST_AUTO_TEST_CASE(repomanager_test)
 
 }
 
+BOOST_AUTO_TEST_CASE(refresh_batch_test)
+{
+  TmpDir tmpCachePath;
+  RepoManagerOptions opts( RepoManagerOptions::makeTestSetup( tmpCachePath ) ) ;
+  RepoManager manager(opts);
+
+  KeyRingTestReceiver keyring_callbacks;
+  KeyRingTestSignalReceiver receiver;
+
+  // disable sgnature checking
+  keyring_callbacks.answerAcceptKey(KeyRingReport::KEY_TRUST_TEMPORARILY);
+  keyring_callbacks.answerAcceptVerFailed(true);
+  keyring_callbacks.answerAcceptUnknownKey(true);
+
+  RepoInfo good;
+  good.setAlias("good");
+  good.setBaseUrl( (Pathname(TESTS_SRC_DIR) / "/repo/yum/data/10.2-updates-subset").asDirUrl() );
+
+  RepoInfo bad;
+  bad.setAlias("bad");
+  bad.setBaseUrl( (Pathname(TESTS_SRC_DIR) / "/repo/yum/data/does-not-exist").asDirUrl() );
+
+  // A failing repo must not prevent the others from being refreshed
+  RepoManager::RefreshErrors errors = manager.refreshMetadata( std::list<RepoInfo>{ bad, good } );
+  BOOST_CHECK_EQUAL( errors.size(), 1 );
+  BOOST_CHECK_EQUAL( errors.count( "bad" ), 1 );
+  BOOST_CHECK( ! manager.metadataStatus( good ).empty() );
+
+  // Refreshing again finds the repo up to date
+  errors = manager.refreshMetadata( std::list<RepoInfo>{ good } );
+  BOOST_CHECK( errors.empty() );
+  BOOST_CHECK_EQUAL( manager.checkIfToRefreshMetadata( good, good.url(), RepoManager::RefreshIfNeededIgnoreDelay ), RepoManager::REPO_UP_TO_DATE );
+}
+
+namespace
+{
+  /** Remember the log lines, to tell whether prefetched files were used. */
+  struct LogLines : public log::LineWriter
+  {
+    virtual void writeOut( const std::string & formated_r )
+    { _lines.push_back( formated_r ); }
+
+    unsigned count( const std::string & text_r ) const
+    { return std::count_if( _lines.begin(), _lines.end(), [&]( const std::string & line_r ) { return line_r.find( text_r ) != std::string::npos; } ); }
+
+    /** The number of files the Fetcher took from the prefetched ones. */
+    unsigned prefetchedUsed() const
+    {
+      return std::count_if( _lines.begin(), _lines.end(), []( const std::string & line_r ) {
+	return line_r.find( "found in cache" ) != std::string::npos && line_r.find( "/prefetch" ) != std::string::npos;
+      } );
+    }
+
+    std::vector<std::string> _lines;
+  };
+}
+
+BOOST_AUTO_TEST_CASE(refresh_batch_http_test)
+{
+  WebServer web( (Pathname(TESTS_SRC_DIR) / "/repo/yum/data").c_str(), 10001 );
+  BOOST_REQUIRE( web.start() );
+
+  TmpDir tmpCachePath;
+  RepoManagerOptions opts( RepoManagerOptions::makeTestSetup( tmpCachePath ) ) ;
+  RepoManager manager(opts);
+
+  KeyRingTestReceiver keyring_callbacks;
+  KeyRingTestSignalReceiver receiver;
+
+  // disable sgnature checking
+  keyring_callbacks.answerAcceptKey(KeyRingReport::KEY_TRUST_TEMPORARILY);
+  keyring_callbacks.answerAcceptVerFailed(true);
+  keyring_callbacks.answerAcceptUnknownKey(true);
+
+  // The concurrent status check needs a known type and a http/https/ftp url
+  std::list<RepoInfo> repos;
+  for ( const std::string & alias : { "good1", "good2" } )
+  {
+    RepoInfo good;
+    good.setAlias( alias );
+    good.setType( RepoType::RPMMD );
+    Url url( web.url() );
+    url.setPathName( "/10.2-updates-subset" );
+    good.setBaseUrl( url );
+    repos.push_back( good );
+  }
+  RepoInfo bad;
+  bad.setAlias("bad");
+  bad.setType( RepoType::RPMMD );
+  Url url( web.url() );
+  url.setPathName( "/does-not-exist" );
+  bad.setBaseUrl( url );
+  repos.push_front( bad );
+
+  // Nothing cached yet: the concurrent check fails for all of them,
+  // the conventional refresh downloads the good ones and reports the bad one.
+  RepoManager::RefreshErrors errors = manager.refreshMetadata( repos );
+  BOOST_CHECK_EQUAL( errors.size(), 1 );
+  BOOST_CHECK_EQUAL( errors.count( "bad" ), 1 );
+  for ( const RepoInfo & info : repos )
+  {
+    if ( info.alias() != "bad" )
+      BOOST_CHECK( ! manager.metadataStatus( info ).empty() );
+  }
+
+  // Now the concurrent check finds the good repos up to date
+  // (conditional requests against the raw cache) and leaves the
+  // bad one to the conventional refresh.
+  std::map<std::string,RepoStatus> cached;
+  for ( const RepoInfo & info : repos )
+    cached[info.alias()] = manager.metadataStatus( info );
+  errors = manager.refreshMetadata( repos, RepoManager::RefreshIfNeededIgnoreDelay );
+  BOOST_CHECK_EQUAL( errors.size(), 1 );
+  BOOST_CHECK_EQUAL( errors.count( "bad" ), 1 );
+  for ( const RepoInfo & info : repos )
+  {
+    if ( info.alias() != "bad" )
+      BOOST_CHECK_EQUAL( manager.metadataStatus( info ), cached[info.alias()] );
+  }
+
+  // Forced: all downloaded again without the concurrent check,
+  // but the metadata files are prefetched concurrently.
+  {
+    shared_ptr<LogLines> log( new LogLines );
+    base::LogControl::TmpLineWriter guard( log );
+    errors = manager.refreshMetadata( repos, RepoManager::RefreshForced );
+    BOOST_CHECK_EQUAL( errors.size(), 1 );
+    BOOST_CHECK_EQUAL( log->count( "Concurrently prefetching" ), 1U );
+  }
+
+  // A changed repo: its metadata files are prefetched and taken from there
+  // once the master index is verified.
+  for ( RepoInfo & info : repos )
+  {
+    if ( info.alias() == "good1" )
+    {
+      Url url( web.url() );
+      url.setPathName( "/extensions" );
+      info.setBaseUrl( url );
+    }
+  }
+  {
+    shared_ptr<LogLines> log( new LogLines );
+    base::LogControl::TmpLineWriter guard( log );
+    errors = manager.refreshMetadata( repos, RepoManager::RefreshIfNeededIgnoreDelay );
+    BOOST_CHECK_EQUAL( errors.size(), 1 );
+    BOOST_CHECK_GT( log->prefetchedUsed(), 0U );
+  }
+  for ( const RepoInfo & info : repos )
+  {
+    if ( info.alias() == "good1" )
+    {
+      BOOST_CHECK( ! manager.metadataStatus( info ).empty() );
+      BOOST_CHECK( manager.metadataStatus( info ) != cached[info.alias()] );
+      BOOST_CHECK_EQUAL( manager.checkIfToRefreshMetadata( info, info.url(), RepoManager::RefreshIfNeededIgnoreDelay ), RepoManager::REPO_UP_TO_DATE );
+    }
+    else if ( info.alias() != "bad" )
+      BOOST_CHECK_EQUAL( manager.metadataStatus( info ), cached[info.alias()] );
+  }
+  web.stop();
+}
+
+BOOST_AUTO_TEST_CASE(build_cache_batch_test)
+{
+  TmpDir tmpCachePath;
+  RepoManagerOptions opts( RepoManagerOptions::makeTestSetup( tmpCachePath ) ) ;
+  RepoManager manager(opts);
+
+  KeyRingTestReceiver keyring_callbacks;
+  KeyRingTestSignalReceiver receiver;
+
+  // disable sgnature checking
+  keyring_callbacks.answerAcceptKey(KeyRingReport::KEY_TRUST_TEMPORARILY);
+  keyring_callbacks.answerAcceptVerFailed(true);
+  keyring_callbacks.answerAcceptUnknownKey(true);
+
+  RepoInfo good;
+  good.setAlias("good");
+  good.setBaseUrl( (Pathname(TESTS_SRC_DIR) / "/repo/yum/data/10.2-updates-subset").asDirUrl() );
+
+  RepoInfo bad;
+  bad.setAlias("bad");
+  bad.setBaseUrl( (Pathname(TESTS_SRC_DIR) / "/repo/yum/data/does-not-exist").asDirUrl() );
+
+  // in-process
+  RepoManager::RefreshErrors errors = manager.buildCache( std::list<RepoInfo>{ bad, good } );
+  BOOST_CHECK_EQUAL( errors.size(), 1 );
+  BOOST_CHECK_EQUAL( errors.count( "bad" ), 1 );
+  BOOST_REQUIRE( manager.isCached( good ) );
+  manager.loadFromCache( good );
+  unsigned inprocess = sat::Pool::instance().reposFind( "good" ).solvablesSize();
+  BOOST_CHECK( inprocess > 0 );
+
+  // same result as repo2solv
+  ::setenv( "ZYPP_USE_REPO2SOLV", "1", 1 );
+  errors = manager.buildCache( std::list<RepoInfo>{ good }, RepoManager::BuildForced );
+  ::unsetenv( "ZYPP_USE_REPO2SOLV" );
+  BOOST_CHECK( errors.empty() );
+  manager.loadFromCache( good );
+  BOOST_CHECK_EQUAL( sat::Pool::instance().reposFind( "good" ).solvablesSize(), inprocess );
+  sat::Pool::instance().reposErase( "good" );
+}
+
 BOOST_AUTO_TEST_CASE(repo_seting_test)
 {
   RepoInfo repo;
@@ -241,3 +241,60 @@ BOOST_AUTO_TEST_CASE(savestate)
 
 
 
+
+BOOST_AUTO_TEST_CASE(bulk)
+{
+  // All supported states, installed and uninstalled, with some details set
+  std::vector<ResStatus> statuses;
+  for ( bool installed : transactTo )
+  {
+    for ( ResStatus::TransactByValue * fromBy = begin( transactByValues ); fromBy != end( transactByValues ); ++fromBy )
+    {
+      for ( ResStatus::TransactValue * fromState = begin( transactValues ); fromState != end( transactValues ); ++fromState )
+      {
+        ResStatus status( installed );
+        if ( *fromState == ResStatus::KEEP_STATE )
+          status.setSoftLock( *fromBy );
+        else if ( ! status.setTransactValue( *fromState, *fromBy ) || status.getTransactValue() != *fromState )
+          continue; // Unsupported ResStatus
+        if ( status.transacts() )	// some details
+        {
+          if ( installed )
+            status.setToBeUninstalledDueToUpgrade( *fromBy );
+          else
+            status.setSoftInstall( true );
+        }
+        status.setRecommended();
+        statuses.push_back( status );
+      }
+    }
+  }
+
+  for ( ResStatus::TransactByValue * causer = begin( transactByValues ); causer != end( transactByValues ); ++causer )
+  {
+    for ( bool transactingOnly : transactTo )
+    {
+      std::vector<ResStatus> result( statuses );
+      ResStatus::resetTransactAll( result.data(), result.data() + result.size(), *causer, transactingOnly );
+      for ( unsigned i = 0; i < statuses.size(); ++i )
+      {
+        ResStatus expected( statuses[i] );
+        if ( expected.getTransactByValue() <= *causer && ( ! transactingOnly || expected.transacts() ) )
+          expected.resetTransact( *causer );
+        BOOST_CHECK_EQUAL( result[i], expected );
+      }
+    }
+  }
+
+  size_t toInstall = 0, toUninstall = 0, locked = 0;
+  for ( const ResStatus & status : statuses )
+  {
+    toInstall += status.isToBeInstalled();
+    toUninstall += status.isToBeUninstalled();
+    locked += status.isLocked();
+  }
+  BOOST_CHECK( toInstall && toUninstall && locked );
+  BOOST_CHECK_EQUAL( ResStatus::countToBeInstalled( statuses.data(), statuses.data() + statuses.size() ), toInstall );
+  BOOST_CHECK_EQUAL( ResStatus::countToBeUninstalled( statuses.data(), statuses.data() + statuses.size() ), toUninstall );
+  BOOST_CHECK_EQUAL( ResStatus::countLocked( statuses.data(), statuses.data() + statuses.size() ), locked );
+}
@@ -1,5 +1,6 @@
 #include "TestSetup.h"
 
+#include <thread>
 #include <zypp/target/rpm/RpmDb.h>
 using target::rpm::RpmDb;
 
@@ -287,3 +288,30 @@ BOOST_AUTO_TEST_CASE(signed_broken_header_pkg_withkey)
   } };
   BOOST_CHECK_EQUAL( xpct, cs );
 }
+
+BOOST_AUTO_TEST_CASE(precheck_parallel)
+{
+  // Results prechecked in parallel threads must be the ones checkPackageSignature computes.
+  std::vector<Pathname> rpms;
+  for ( const char * name : { "unsigned.rpm", "unsigned_broken.rpm", "unsigned_broken_header.rpm",
+			      "signed.rpm", "signed_broken.rpm", "signed_broken_header.rpm" } )
+    rpms.push_back( DATADIR/name );
+
+  std::vector<CheckResult> xpct;
+  for ( const Pathname & rpm : rpms )
+    xpct.push_back( gcheckPackageSignature( rpm ) );
+
+  std::vector<std::thread> threads;
+  for ( const Pathname & rpm : rpms )
+    threads.push_back( std::thread( [&rpm]() { test.target().rpmDb().precheckPackageSignature( rpm ); } ) );
+  for ( std::thread & t : threads )
+    t.join();
+
+  for ( unsigned i = 0; i < rpms.size(); ++i )
+    BOOST_CHECK_EQUAL( xpct[i], gcheckPackageSignature( rpms[i] ) );
+
+  // A result is used once: the next check is done again
+  test.target().rpmDb().precheckPackageSignature( rpms[0] );
+  RpmDb::discardPrecheckedPackageSignatures();
+  BOOST_CHECK_EQUAL( xpct[0], gcheckPackageSignature( rpms[0] ) );
+}
@@ -0,0 +1,147 @@
+#include <boost/test/unit_test.hpp>
+
+#include <zypp/TmpPath.h>
+#include <zypp/HistoryLog.h>
+#include <zypp/target/rpm/RpmCallbacks.h>
+#include <zypp/target/rpm/RpmTransactionReport_p.h>
+
+using namespace zypp;
+using namespace zypp::target::rpm;
+
+namespace
+{
+  struct InstallReceiver : public callback::ReceiveReport<RpmInstallReport>
+  {
+    Action problem( Exception & excpt_r ) override
+    { ++_problems; return _action; }
+
+    void finish() override
+    { ++_finished; }
+
+    void finish( Exception & excpt_r ) override
+    { ++_failed; }
+
+    Action _action = ABORT;
+    unsigned _problems = 0;
+    unsigned _finished = 0;
+    unsigned _failed = 0;
+  };
+
+  struct RemoveReceiver : public callback::ReceiveReport<RpmRemoveReport>
+  {
+    Action problem( Exception & excpt_r ) override
+    { ++_problems; return _action; }
+
+    void finish() override
+    { ++_finished; }
+
+    void finish( Exception & excpt_r ) override
+    { ++_failed; }
+
+    Action _action = ABORT;
+    unsigned _problems = 0;
+    unsigned _finished = 0;
+    unsigned _failed = 0;
+  };
+
+  struct ReportFixture
+  {
+    ReportFixture()
+    {
+      HistoryLog::setRoot( _root.path() );
+      _install.connect();
+      _remove.connect();
+      _elements.push_back( RpmDb::TransactionElement( Pathname( "/tmp/a-1-1.x86_64.rpm" ) ) );
+      _elements.push_back( RpmDb::TransactionElement( Pathname( "/tmp/b-1-1.x86_64.rpm" ) ) );
+      _elements.push_back( RpmDb::TransactionElement( std::string( "c-1-1.x86_64" ) ) );
+      _elements.push_back( RpmDb::TransactionElement( Pathname( "/tmp/d-1-1.x86_64.rpm" ) ) );
+    }
+
+    ~ReportFixture()
+    { HistoryLog::setRoot( "/" ); }
+
+    filesystem::TmpDir _root;
+    InstallReceiver _install;
+    RemoveReceiver _remove;
+    std::vector<RpmDb::TransactionElement> _elements;
+  };
+}
+
+BOOST_FIXTURE_TEST_CASE(report_success, ReportFixture)
+{
+  RpmTransactionReport result( _elements );
+  for ( size_t idx = 0; idx < _elements.size(); ++idx )
+    result.done( idx, false, idx == 0 ? "warning: /etc/a.conf created as /etc/a.conf.rpmnew\n" : "" );
+  // finished as rpm is done with them
+  BOOST_CHECK_EQUAL( _install._finished, 3U );
+  BOOST_CHECK_EQUAL( _remove._finished, 1U );
+
+  std::vector<size_t> started;
+  std::vector<std::string> warnings;
+  BOOST_CHECK( result.send( [&]( size_t idx_r ) { started.push_back( idx_r ); },
+                            [&]( const Pathname & file_r, const std::string & line_r ) { warnings.push_back( line_r ); } ) );
+
+  BOOST_CHECK( started.empty() );	// just the failed ones
+  BOOST_CHECK_EQUAL( warnings.size(), 1U );
+  BOOST_CHECK_EQUAL( _install._finished, 3U );
+  BOOST_CHECK_EQUAL( _remove._finished, 1U );
+  BOOST_CHECK_EQUAL( _install._problems + _remove._problems, 0U );
+  BOOST_CHECK( result.retries().empty() );
+}
+
+BOOST_FIXTURE_TEST_CASE(report_failure_ignore, ReportFixture)
+{
+  RpmTransactionReport result( _elements );
+  for ( size_t idx = 0; idx < _elements.size(); ++idx )
+    result.done( idx, idx == 1, "" );
+
+  _install._action = RpmInstallReport::IGNORE;
+  BOOST_CHECK( result.send( RpmTransactionReport::StartFnc(), RpmTransactionReport::ConfigWarningFnc() ) );
+  BOOST_CHECK_EQUAL( _install._problems, 1U );
+  BOOST_CHECK_EQUAL( _install._failed, 0U );
+  BOOST_CHECK( ! _elements[1].failed );
+  BOOST_CHECK( result.retries().empty() );
+}
+
+BOOST_FIXTURE_TEST_CASE(report_failure_retry, ReportFixture)
+{
+  RpmTransactionReport result( _elements );
+  for ( size_t idx = 0; idx < _elements.size(); ++idx )
+    result.done( idx, idx == 1 || idx == 2, "error: something failed\n" );
+  BOOST_CHECK_EQUAL( _install._finished, 2U );
+  BOOST_CHECK_EQUAL( _install._failed + _remove._failed, 0U );	// not before send
+
+  std::vector<size_t> started;
+  _install._action = RpmInstallReport::RETRY;
+  _remove._action = RpmRemoveReport::RETRY;
+  BOOST_CHECK( result.send( [&]( size_t idx_r ) { started.push_back( idx_r ); }, RpmTransactionReport::ConfigWarningFnc() ) );
+  BOOST_CHECK_EQUAL( started.size(), 2U );
+  BOOST_CHECK_EQUAL( _install._problems, 1U );
+  BOOST_CHECK_EQUAL( _remove._problems, 1U );
+  BOOST_CHECK_EQUAL( _install._failed, 1U );
+  BOOST_CHECK_EQUAL( _remove._failed, 1U );
+  BOOST_CHECK_EQUAL( _install._finished, 2U );
+  BOOST_CHECK( _elements[1].failed );
+  BOOST_CHECK( _elements[2].failed );
+  BOOST_REQUIRE_EQUAL( result.retries().size(), 2U );
+  BOOST_CHECK_EQUAL( result.retries()[0], 1U );
+  BOOST_CHECK_EQUAL( result.retries()[1], 2U );
+}
+
+BOOST_FIXTURE_TEST_CASE(report_failure_abort, ReportFixture)
+{
+  RpmTransactionReport result( _elements );
+  for ( size_t idx = 0; idx < _elements.size(); ++idx )
+    result.done( idx, idx != 0, "" );
+
+  _install._action = RpmInstallReport::ABORT;
+  BOOST_CHECK( ! result.send( RpmTransactionReport::StartFnc(), RpmTransactionReport::ConfigWarningFnc() ) );
+  // not asked again once aborted, but all elements are finished
+  BOOST_CHECK_EQUAL( _install._problems, 1U );
+  BOOST_CHECK_EQUAL( _remove._problems, 0U );
+  BOOST_CHECK_EQUAL( _install._finished, 1U );
+  BOOST_CHECK_EQUAL( _install._failed, 2U );
+  BOOST_CHECK_EQUAL( _remove._failed, 1U );
+  BOOST_CHECK( _elements[1].failed && _elements[2].failed && _elements[3].failed );
+  BOOST_CHECK( result.retries().empty() );
+}
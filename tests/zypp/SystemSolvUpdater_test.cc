@@ -0,0 +1,117 @@
+extern "C"
+{
+#include <solv/pool.h>
+#include <solv/repo.h>
+#include <solv/repo_solv.h>
+#include <solv/repo_write.h>
+#include <solv/repo_rpmdb.h>
+}
+#include <cstdio>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <zypp/base/String.h>
+#include <zypp/AutoDispose.h>
+#include <zypp/TmpPath.h>
+#include <zypp/PathInfo.h>
+#include <zypp/HistoryLog.h>
+#include <zypp/target/rpm/RpmDb.h>
+#include <zypp/target/SystemSolvUpdater_p.h>
+
+using namespace zypp;
+using namespace zypp::target;
+
+#define DATADIR (Pathname(TESTS_SRC_DIR) + "/zypp/data/RpmPkgSigCheck")
+
+namespace
+{
+  /** Write the solv file for the rpmdb below \a root_r, like a full rebuild does. */
+  void rebuild( const Pathname & root_r, const Pathname & solvfile_r )
+  {
+    ::Pool * pool = ::pool_create();
+    AutoDispose< ::Pool *> guard( pool, ::pool_free );
+    ::pool_set_rootdir( pool, root_r.c_str() );
+    ::Repo * repo = ::repo_create( pool, "@System" );
+    BOOST_REQUIRE_EQUAL( ::repo_add_rpmdb( repo, nullptr, 0 ), 0 );
+
+    FILE * fp = ::fopen( solvfile_r.c_str(), "we" );
+    BOOST_REQUIRE( fp );
+    BOOST_CHECK_EQUAL( ::repo_write( repo, fp ), 0 );
+    BOOST_REQUIRE_EQUAL( ::fclose( fp ), 0 );
+  }
+
+  /** The packages in \a solvfile_r as <tt>rpmdbid:N-V-R.A</tt>, sorted. */
+  std::vector<std::string> packages( const Pathname & solvfile_r )
+  {
+    std::vector<std::string> ret;
+    ::Pool * pool = ::pool_create();
+    AutoDispose< ::Pool *> guard( pool, ::pool_free );
+    ::Repo * repo = ::repo_create( pool, "@System" );
+
+    FILE * fp = ::fopen( solvfile_r.c_str(), "re" );
+    BOOST_REQUIRE( fp );
+    BOOST_CHECK_EQUAL( ::repo_add_solv( repo, fp, 0 ), 0 );
+    ::fclose( fp );
+    BOOST_REQUIRE( repo->rpmdbid );
+
+    ::Id p;
+    ::Solvable * s;
+    FOR_REPO_SOLVABLES( repo, p, s )
+      ret.push_back( str::numstring( repo->rpmdbid[p - repo->start] ) + ":" + ::pool_solvable2str( pool, s ) );
+    std::sort( ret.begin(), ret.end() );
+    return ret;
+  }
+
+  /** Run \a elements_r as rpm transaction in the rpmdb below \a root_r. */
+  void commit( rpm::RpmDb & rpmdb_r, std::vector<rpm::RpmDb::TransactionElement> elements_r )
+  {
+    rpmdb_r.runTransaction( elements_r, rpm::RPMINST_JUSTDB|rpm::RPMINST_NODEPS|rpm::RPMINST_FORCE|rpm::RPMINST_NOSIGNATURE );
+    for ( const auto & el : elements_r )
+      BOOST_REQUIRE( ! el.failed );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(update_like_rebuild)
+{
+  filesystem::TmpDir root;
+  HistoryLog::setRoot( root.path() );
+  rpm::RpmDb rpmdb;
+  rpmdb.initDatabase( root.path() );
+
+  commit( rpmdb, { rpm::RpmDb::TransactionElement( DATADIR / "signed.rpm" ),
+                   rpm::RpmDb::TransactionElement( DATADIR / "unsigned.rpm" ) } );
+  Pathname solvfile( root.path() / "solv" );
+  rebuild( root.path(), solvfile );
+  BOOST_CHECK_EQUAL( packages( solvfile ).size(), 2U );
+
+  // reinstalled: the package gets a new rpmdb header id
+  commit( rpmdb, { rpm::RpmDb::TransactionElement( std::string( "kio-stash-lang" ) ),
+                   rpm::RpmDb::TransactionElement( DATADIR / "signed.rpm" ) } );
+
+  SystemSolvUpdater updater( root.path(), root.path() );
+  Pathname updated( root.path() / "solv.updated" );
+  BOOST_REQUIRE_EQUAL( updater.update( solvfile, updated ), "" );
+  Pathname rebuilt( root.path() / "solv.rebuilt" );
+  rebuild( root.path(), rebuilt );
+
+  std::vector<std::string> expected( packages( rebuilt ) );
+  BOOST_CHECK_EQUAL( expected.size(), 2U );
+  std::vector<std::string> got( packages( updated ) );
+  BOOST_CHECK_EQUAL_COLLECTIONS( got.begin(), got.end(), expected.begin(), expected.end() );
+  BOOST_CHECK( packages( solvfile ) != expected );	// the old header id is gone
+
+  // removed
+  commit( rpmdb, { rpm::RpmDb::TransactionElement( std::string( "pkg-test42" ) ) } );
+  BOOST_REQUIRE_EQUAL( updater.update( updated, solvfile ), "" );
+  rebuild( root.path(), rebuilt );
+  expected = packages( rebuilt );
+  BOOST_CHECK_EQUAL( expected.size(), 1U );
+  got = packages( solvfile );
+  BOOST_CHECK_EQUAL_COLLECTIONS( got.begin(), got.end(), expected.begin(), expected.end() );
+
+  rpmdb.closeDatabase();
+  HistoryLog::setRoot( "/" );
+}
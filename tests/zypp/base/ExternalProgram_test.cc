@@ -1,8 +1,10 @@
 #include "TestSetup.h"
 #include <zypp/ExternalProgram.h>
+#include <zypp/base/WorkerPool_p.h>
 
 #include <chrono>
 #include <thread>
+#include <vector>
 #include <sys/types.h>
 #include <sys/wait.h>
 
@@ -33,3 +35,47 @@ BOOST_AUTO_TEST_CASE( ReadTimeout )
   BOOST_CHECK_EQUAL( prog.receiveLine( 3000 ), "" );
   BOOST_CHECK_EQUAL( prog.close(), 0 );
 }
+
+BOOST_AUTO_TEST_CASE( SpawnEnvironmentAndChdir )
+{
+  // clone(CLONE_VM|CLONE_VFORK) and the fork fallback must behave the same
+  for ( const char * forkenv : { "0", "1" } )
+  {
+    ::setenv( "ZYPP_EXTERNALPROGRAM_FORK", forkenv, 1 );
+    static const char* argv[] = { "#/tmp", "sh", "-c", "echo $ZYPP_SPAWN_TEST; pwd", NULL };
+    ExternalProgram prog( argv, ExternalProgram::Environment{ { "ZYPP_SPAWN_TEST", "spawned" } }, ExternalProgram::Discard_Stderr );
+    BOOST_CHECK_EQUAL( prog.receiveLine(), "spawned\n" );
+    BOOST_CHECK_EQUAL( prog.receiveLine(), "/tmp\n" );
+    BOOST_CHECK_EQUAL( prog.close(), 0 );
+  }
+  ::unsetenv( "ZYPP_EXTERNALPROGRAM_FORK" );
+}
+
+BOOST_AUTO_TEST_CASE( SpawnExecFailure )
+{
+  static const char* argv[] = { "/no/such/program", NULL };
+  ExternalProgram prog( argv, ExternalProgram::Stderr_To_Stdout );
+  BOOST_CHECK_EQUAL( prog.execError(), "Can't exec '/no/such/program' (No such file or directory)." );
+  BOOST_CHECK_EQUAL( prog.receiveLine(), "Can't exec '/no/such/program' (No such file or directory).\n" );
+  BOOST_CHECK_EQUAL( prog.close(), 129 );
+}
+
+BOOST_AUTO_TEST_CASE( ConcurrentCloseDrainsOutput )
+{
+  // Like the CommitPackagePreloader running several applydeltarpm at once:
+  // each worker closes its program without reading, so close() drains the output.
+  std::vector<int> exitStatus( 16, -1 );
+  {
+    zypp::WorkerPool workers( 4 );
+    for ( unsigned i = 0; i < exitStatus.size(); ++i )
+    {
+      workers.add( [&exitStatus,i]() {
+        static const char* argv[] = { "sh", "-c", "for i in $(seq 1 2000); do echo \"line $i of some lengthy output\"; done; exit 3", NULL };
+        ExternalProgram prog( argv, ExternalProgram::Discard_Stderr );
+        exitStatus[i] = prog.close();
+      });
+    }
+  }
+  for ( int status : exitStatus )
+    BOOST_CHECK_EQUAL( status, 3 );
+}
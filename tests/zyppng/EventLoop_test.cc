@@ -1,13 +1,16 @@
 #include <boost/test/unit_test.hpp>
 #include <zypp/zyppng/base/EventDispatcher>
 #include <zypp/zyppng/base/Timer>
+#include <zypp/zyppng/base/SocketNotifier>
 #include <zypp/base/Exception.h>
 
 #include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
 
-BOOST_AUTO_TEST_CASE(eventloop)
+static void runEventLoopTest( zyppng::EventDispatcher::Backend backend )
 {
-  zyppng::EventDispatcher::Ptr loop = zyppng::EventDispatcher::createMain();
+  zyppng::EventDispatcher::Ptr loop = zyppng::EventDispatcher::createMain( backend );
 
   //we should hit that timer first
   zyppng::Timer::Ptr t1 = zyppng::Timer::create();
@@ -76,6 +79,109 @@ BOOST_AUTO_TEST_CASE(eventloop)
   BOOST_REQUIRE_EQUAL( loop->runningTimers(), 0 );
 }
 
+BOOST_AUTO_TEST_CASE(eventloop)
+{
+  runEventLoopTest( zyppng::EventDispatcher::Backend::Glib );
+}
+
+BOOST_AUTO_TEST_CASE(eventloop_epoll)
+{
+  runEventLoopTest( zyppng::EventDispatcher::Backend::Epoll );
+}
+
+BOOST_AUTO_TEST_CASE(socketnotifier_epoll)
+{
+  zyppng::EventDispatcher::Ptr loop = zyppng::EventDispatcher::createMain( zyppng::EventDispatcher::Backend::Epoll );
+  BOOST_REQUIRE( loop->backend() == zyppng::EventDispatcher::Backend::Epoll );
+
+  int sv[2];
+  BOOST_REQUIRE_EQUAL( ::socketpair( AF_UNIX, SOCK_STREAM, 0, sv ), 0 );
+
+  auto reader = zyppng::SocketNotifier::create( sv[0], zyppng::SocketNotifier::Read, true );
+  auto writer = zyppng::SocketNotifier::create( sv[1], zyppng::SocketNotifier::Write, true );
+  //a second notifier on the same fd
+  auto echo   = zyppng::SocketNotifier::create( sv[1], zyppng::SocketNotifier::Read, true );
+
+  int sent = 0;
+  int received = 0;
+  int echoed = 0;
+
+  //the writer sends one byte and waits for the reader to enable it again
+  writer->sigActivated().connect( [ & ]( const zyppng::SocketNotifier &, int ev ){
+    BOOST_REQUIRE( ev & zyppng::SocketNotifier::Write );
+    char c = 'x';
+    BOOST_REQUIRE_EQUAL( ::write( sv[1], &c, 1 ), 1 );
+    sent++;
+    writer->setEnabled( false );
+  });
+
+  reader->sigActivated().connect( [ & ]( const zyppng::SocketNotifier &, int ev ){
+    BOOST_REQUIRE( ev & zyppng::SocketNotifier::Read );
+    char c;
+    BOOST_REQUIRE_EQUAL( ::read( sv[0], &c, 1 ), 1 );
+    received++;
+    if ( received == 100 )
+      BOOST_REQUIRE_EQUAL( ::write( sv[0], &c, 1 ), 1 );
+    else
+      writer->setEnabled( true );
+  });
+
+  echo->sigActivated().connect( [ & ]( const zyppng::SocketNotifier &, int ){
+    char c;
+    BOOST_REQUIRE_EQUAL( ::read( sv[1], &c, 1 ), 1 );
+    echoed++;
+    loop->quit();
+  });
+
+  loop->run();
+
+  BOOST_REQUIRE_EQUAL( sent, 100 );
+  BOOST_REQUIRE_EQUAL( received, 100 );
+  BOOST_REQUIRE_EQUAL( echoed, 1 );
+
+  reader.reset();
+  writer.reset();
+  echo.reset();
+  ::close( sv[0] );
+  ::close( sv[1] );
+
+  //nothing left to dispatch
+  BOOST_REQUIRE( !loop->run_once() );
+}
+
+BOOST_AUTO_TEST_CASE(socketnotifier_epoll_hangup)
+{
+  zyppng::EventDispatcher::Ptr loop = zyppng::EventDispatcher::createMain( zyppng::EventDispatcher::Backend::Epoll );
+
+  int fds[2];
+  BOOST_REQUIRE_EQUAL( ::pipe( fds ), 0 );
+  ::close( fds[1] );
+
+  //the hangup is reported although the notifier did not ask for Read
+  auto notifier = zyppng::SocketNotifier::create( fds[0], zyppng::SocketNotifier::Exception, true );
+  int activated = 0;
+  int events = 0;
+  notifier->sigActivated().connect( [ & ]( const zyppng::SocketNotifier &, int ev ){
+    activated++;
+    events = ev;
+    notifier->setEnabled( false );
+  });
+
+  zyppng::Timer::Ptr timeout = zyppng::Timer::create();
+  timeout->sigExpired().connect( [ &loop ]( zyppng::Timer & ){
+    loop->quit();
+  });
+  timeout->start( 200 );
+
+  loop->run();
+
+  BOOST_REQUIRE_EQUAL( activated, 1 );
+  BOOST_REQUIRE( events & zyppng::SocketNotifier::Error );
+
+  notifier.reset();
+  ::close( fds[0] );
+}
+
 BOOST_AUTO_TEST_CASE(createTimerWithoutEV)
 {
   BOOST_CHECK_THROW( zyppng::Timer::create(), zypp::Exception);
@@ -10,6 +10,7 @@
 #include <zypp/PathInfo.h>
 
 #include <iostream>
+#include <map>
 #include <thread>
 #include <chrono>
 
@@ -331,3 +332,132 @@ BOOST_DATA_TEST_CASE(nwdispatcher_delay_download, bdata::make( withSSL ), withSS
   BOOST_TEST_REQ_ERR( reqDLFile, zyppng::NetworkRequestError::Timeout );
 }
 
+
+BOOST_DATA_TEST_CASE(nwdispatcher_priorities, bdata::make( withSSL ), withSSL )
+{
+  auto ev = zyppng::EventDispatcher::createMain();
+  zyppng::NetworkRequestDispatcher disp;
+  disp.setMaximumConcurrentConnections( 1 );
+  disp.sigQueueFinished().connect( [&ev]( const zyppng::NetworkRequestDispatcher& ){
+    ev->quit();
+  });
+
+  WebServer web((zypp::Pathname(TESTS_SRC_DIR)/"data"/"dummywebroot").c_str(), 10001, withSSL );
+  web.addRequestHandler("getData", WebServer::makeResponse("200 OK", "Hello" ) );
+  BOOST_REQUIRE( web.start() );
+
+  zyppng::Url weburl (web.url());
+  weburl.setPathName("/handler/getData");
+
+  std::vector<zyppng::NetworkRequest::Priority> started;
+  std::vector<zypp::filesystem::TmpFile> targetFiles( 3 );
+  std::vector<zyppng::NetworkRequest::Ptr> requests;
+  for ( auto prio : { zyppng::NetworkRequest::Low, zyppng::NetworkRequest::Normal, zyppng::NetworkRequest::High } ) {
+    zyppng::NetworkRequest::Ptr req = std::make_shared<zyppng::NetworkRequest>( weburl, targetFiles[requests.size()].path() );
+    req->transferSettings() = web.transferSettings();
+    req->setPriority( prio );
+    req->sigStarted().connect( [ &started ]( zyppng::NetworkRequest &r ){
+      started.push_back( r.priority() );
+    });
+    disp.enqueue( req );
+    requests.push_back( req );
+  }
+
+  disp.run();
+  ev->run();
+
+  for ( const auto &req : requests )
+    BOOST_TEST_REQ_SUCCESS( req );
+  BOOST_REQUIRE_EQUAL( started.size(), 3 );
+  BOOST_REQUIRE_EQUAL( started[0], zyppng::NetworkRequest::High );
+  BOOST_REQUIRE_EQUAL( started[1], zyppng::NetworkRequest::Normal );
+  BOOST_REQUIRE_EQUAL( started[2], zyppng::NetworkRequest::Low );
+}
+
+BOOST_DATA_TEST_CASE(nwdispatcher_max_download_speed, bdata::make( withSSL ), withSSL )
+{
+  const std::string content( 256 * 1024, 'x' );
+
+  auto ev = zyppng::EventDispatcher::createMain();
+  zyppng::NetworkRequestDispatcher disp;
+  disp.setMaximumDownloadSpeed( 256 * 1024 );
+  BOOST_REQUIRE_EQUAL( disp.maximumDownloadSpeed(), 256 * 1024 );
+  disp.sigQueueFinished().connect( [&ev]( const zyppng::NetworkRequestDispatcher& ){
+    ev->quit();
+  });
+  disp.run();
+
+  WebServer web((zypp::Pathname(TESTS_SRC_DIR)/"data"/"dummywebroot").c_str(), 10001, withSSL );
+  web.addRequestHandler("getData", WebServer::makeResponse("200 OK", content ) );
+  BOOST_REQUIRE( web.start() );
+
+  zyppng::Url weburl (web.url());
+  weburl.setPathName("/handler/getData");
+
+  zypp::filesystem::TmpFile targetFile;
+  zyppng::NetworkRequest::Ptr reqDLFile = std::make_shared<zyppng::NetworkRequest>( weburl, targetFile.path() );
+  reqDLFile->transferSettings() = web.transferSettings();
+
+  auto start = std::chrono::steady_clock::now();
+  disp.enqueue( reqDLFile );
+  ev->run();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  BOOST_TEST_REQ_SUCCESS( reqDLFile );
+  BOOST_REQUIRE_EQUAL( zypp::filesystem::PathInfo( targetFile.path() ).size(), content.size() );
+  //one second at the limit, minus what a single slice may overshoot
+  BOOST_REQUIRE_GE( std::chrono::duration_cast<std::chrono::milliseconds>( elapsed ).count(), 700 );
+}
+
+BOOST_AUTO_TEST_CASE(nwdispatcher_max_connections_per_host)
+{
+  auto ev = zyppng::EventDispatcher::createMain();
+  zyppng::NetworkRequestDispatcher disp;
+  disp.setMaximumConnectionsPerHost( 1 );
+  disp.sigQueueFinished().connect( [&ev]( const zyppng::NetworkRequestDispatcher& ){
+    ev->quit();
+  });
+
+  WebServer web((zypp::Pathname(TESTS_SRC_DIR)/"data"/"dummywebroot").c_str(), 10001, false );
+  web.addRequestHandler("getData", WebServer::makeResponse("200 OK", "Hello" ) );
+  BOOST_REQUIRE( web.start() );
+
+  //the same server, reached by two different host names
+  std::map<std::string, size_t> running;
+  std::map<std::string, size_t> maxRunning;
+  size_t runningTotal = 0;
+  size_t maxRunningTotal = 0;
+  disp.sigDownloadStarted().connect( [&]( zyppng::NetworkRequestDispatcher &, zyppng::NetworkRequest &r ){
+    size_t &cnt = running[ r.url().getHost() ];
+    maxRunning[ r.url().getHost() ] = std::max( maxRunning[ r.url().getHost() ], ++cnt );
+    maxRunningTotal = std::max( maxRunningTotal, ++runningTotal );
+  });
+  disp.sigDownloadFinished().connect( [&]( zyppng::NetworkRequestDispatcher &, zyppng::NetworkRequest &r ){
+    running[ r.url().getHost() ]--;
+    runningTotal--;
+  });
+
+  std::vector<zypp::filesystem::TmpFile> targetFiles( 4 );
+  std::vector<zyppng::NetworkRequest::Ptr> requests;
+  for ( const char *host : { "localhost", "localhost", "localhost", "127.0.0.1" } ) {
+    zyppng::Url weburl (web.url());
+    weburl.setHost( host );
+    weburl.setPathName("/handler/getData");
+
+    zyppng::NetworkRequest::Ptr req = std::make_shared<zyppng::NetworkRequest>( weburl, targetFiles[requests.size()].path() );
+    req->transferSettings() = web.transferSettings();
+    disp.enqueue( req );
+    requests.push_back( req );
+  }
+
+  disp.run();
+  ev->run();
+
+  for ( const auto &req : requests )
+    BOOST_TEST_REQ_SUCCESS( req );
+  BOOST_REQUIRE_EQUAL( maxRunning["localhost"], 1 );
+  BOOST_REQUIRE_EQUAL( maxRunning["127.0.0.1"], 1 );
+  //the limit of one host does not block the other one
+  BOOST_REQUIRE_LE( maxRunningTotal, 2 );
+  BOOST_REQUIRE_GT( maxRunningTotal, 1 );
+}
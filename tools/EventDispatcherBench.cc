@@ -0,0 +1,179 @@
+#define INCLUDE_TESTSETUP_WITHOUT_BOOST
+#include "../tests/lib/TestSetup.h"
+#undef  INCLUDE_TESTSETUP_WITHOUT_BOOST
+#include "argparse.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <zypp/zyppng/base/EventDispatcher>
+#include <zypp/zyppng/base/SocketNotifier>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using zyppng::EventDispatcher;
+using zyppng::SocketNotifier;
+using Clock = std::chrono::steady_clock;
+
+static std::string appname { "NO_NAME" };
+
+int errexit( const std::string & msg_r = std::string(), int exit_r = 100 )
+{
+  if ( ! msg_r.empty() )
+    cerr << endl << appname << ": ERR: " << msg_r << endl << endl;
+  return exit_r;
+}
+
+int usage( const argparse::Options & options_r, int return_r = 0 )
+{
+  cerr << "USAGE: " << appname << " [OPTION]... [ARGS]..." << endl;
+  cerr << "    Measure the zyppng::EventDispatcher dispatch latency of the glib and epoll backends" << endl;
+  cerr << "    with many concurrent transfers. Each transfer is a local socket pair sending messages" << endl;
+  cerr << "    back and forth, the latency is the time between writing a message and the receiving" << endl;
+  cerr << "    end being notified." << endl;
+  cerr << options_r << endl;
+  return return_r;
+}
+
+/** One simulated transfer. */
+struct Transfer
+{
+  int fds[2] = { -1, -1 };
+  SocketNotifier::Ptr sender;
+  SocketNotifier::Ptr receiver;
+  unsigned left = 0;
+  size_t pending = 0;
+  Clock::time_point sentAt;
+
+  ~Transfer()
+  {
+    sender.reset();
+    receiver.reset();
+    for ( int fd : fds )
+      if ( fd >= 0 ) ::close( fd );
+  }
+};
+
+/** Run \a transfers_r transfers of \a messages_r messages with \a size_r bytes each using \a backend_r. */
+int runBench( EventDispatcher::Backend backend_r, const char * name_r, unsigned transfers_r, unsigned messages_r, size_t size_r )
+{
+  EventDispatcher::Ptr ev = EventDispatcher::createMain( backend_r );
+
+  std::vector<double> latencies;
+  latencies.reserve( size_t(transfers_r) * messages_r );
+  std::vector<char> buffer( size_r, 'x' );
+  unsigned active = transfers_r;
+
+  std::vector<std::unique_ptr<Transfer>> transfers;
+  for ( unsigned i = 0; i < transfers_r; ++i )
+  {
+    std::unique_ptr<Transfer> t { new Transfer };
+    if ( ::socketpair( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, t->fds ) != 0 )
+      return errexit( "socketpair: " + str::strerror( errno ) );
+    t->left = messages_r;
+
+    Transfer * tp = t.get();
+    t->sender = SocketNotifier::create( t->fds[1], SocketNotifier::Write, true );
+    t->sender->sigActivated().connect( [ tp, &buffer ]( const SocketNotifier &, int ){
+      tp->sentAt = Clock::now();
+      ssize_t sent = ::write( tp->fds[1], buffer.data(), buffer.size() );
+      if ( sent <= 0 )
+        return;
+      tp->pending = sent;
+      tp->sender->setEnabled( false );
+    });
+
+    t->receiver = SocketNotifier::create( t->fds[0], SocketNotifier::Read, true );
+    t->receiver->sigActivated().connect( [ tp, &buffer, &latencies, &active, &ev ]( const SocketNotifier &, int ){
+      if ( latencies.size() < latencies.capacity() && tp->pending == buffer.size() )
+        latencies.push_back( std::chrono::duration<double,std::micro>( Clock::now() - tp->sentAt ).count() );
+      ssize_t got = 0;
+      while ( tp->pending && ( got = ::read( tp->fds[0], buffer.data(), buffer.size() ) ) > 0 )
+        tp->pending -= std::min( tp->pending, size_t(got) );
+      if ( tp->pending )
+        return;
+      if ( --tp->left )
+        tp->sender->setEnabled( true );
+      else if ( --active == 0 )
+        ev->quit();
+    });
+    transfers.push_back( std::move(t) );
+  }
+
+  auto start = Clock::now();
+  ev->run();
+  std::chrono::duration<double,std::milli> elapsed = Clock::now() - start;
+
+  transfers.clear();
+  ev.reset();
+
+  std::sort( latencies.begin(), latencies.end() );
+  double sum = 0;
+  for ( double l : latencies )
+    sum += l;
+  auto percentile = [&latencies]( double p ) {
+    return latencies.empty() ? 0.0 : latencies[ std::min( latencies.size()-1, size_t( latencies.size() * p ) ) ];
+  };
+
+  cout << "  " << name_r << ": "
+       << elapsed.count() << " ms, "
+       << size_t( latencies.size() / ( elapsed.count() / 1000 ) ) << " msg/s, latency us"
+       << " avg " << ( latencies.empty() ? 0.0 : sum / latencies.size() )
+       << " p50 " << percentile( 0.5 )
+       << " p99 " << percentile( 0.99 )
+       << endl;
+  return 0;
+}
+
+int main( int argc, char * argv[] )
+{
+  appname = Pathname::basename( argv[0] );
+
+  unsigned transfers = 500;
+  unsigned messages = 200;
+  size_t size = 4096;
+
+  argparse::Options options;
+  options.add()
+    ( "help,h",		"Print help and exit." )
+    ( "transfers",	"Number of concurrent transfers (default 500).", argparse::Option::Arg::required )
+    ( "messages",	"Messages sent per transfer (default 200).", argparse::Option::Arg::required )
+    ( "size",		"Bytes per message (default 4096).", argparse::Option::Arg::required )
+    ;
+  auto result = options.parse( argc, argv );
+
+  if ( result.count( "help" ) )
+    return usage( options );
+
+  if ( result.count( "transfers" ) )
+    transfers = str::strtonum<unsigned>( result["transfers"].arg() );
+  if ( result.count( "messages" ) )
+    messages = str::strtonum<unsigned>( result["messages"].arg() );
+  if ( result.count( "size" ) )
+    size = str::strtonum<size_t>( result["size"].arg() );
+  if ( ! transfers || ! messages || ! size )
+    return errexit( "--transfers, --messages and --size must be > 0" );
+
+  // each transfer needs two fds
+  struct rlimit lim;
+  if ( ::getrlimit( RLIMIT_NOFILE, &lim ) == 0 && lim.rlim_cur < lim.rlim_max )
+  {
+    lim.rlim_cur = lim.rlim_max;
+    ::setrlimit( RLIMIT_NOFILE, &lim );
+  }
+
+  // go...
+  cout << transfers << " transfers x " << messages << " messages of " << size << " bytes:" << endl;
+  if ( int ret = runBench( EventDispatcher::Backend::Glib, "glib ", transfers, messages, size ) )
+    return ret;
+  if ( int ret = runBench( EventDispatcher::Backend::Epoll, "epoll", transfers, messages, size ) )
+    return ret;
+  return 0;
+}
@@ -0,0 +1,95 @@
+#define INCLUDE_TESTSETUP_WITHOUT_BOOST
+#include "../tests/lib/TestSetup.h"
+#undef  INCLUDE_TESTSETUP_WITHOUT_BOOST
+#include "argparse.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <zypp/ExternalProgram.h>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+static std::string appname { "NO_NAME" };
+
+int errexit( const std::string & msg_r = std::string(), int exit_r = 100 )
+{
+  if ( ! msg_r.empty() )
+    cerr << endl << appname << ": ERR: " << msg_r << endl << endl;
+  return exit_r;
+}
+
+int usage( const argparse::Options & options_r, int return_r = 0 )
+{
+  cerr << "USAGE: " << appname << " [OPTION]... [ARGS]..." << endl;
+  cerr << "    Measure the ExternalProgram spawn latency of a process with a large resident memory" << endl;
+  cerr << "    (like one holding a big pool), using clone(CLONE_VM|CLONE_VFORK) and fork." << endl;
+  cerr << options_r << endl;
+  return return_r;
+}
+
+/** Average milliseconds to run \a cmd_r, \a runs_r times. */
+double spawnLatency( const char * cmd_r, unsigned runs_r, bool fork_r )
+{
+  if ( fork_r )
+    ::setenv( "ZYPP_EXTERNALPROGRAM_FORK", "1", 1 );
+  else
+    ::unsetenv( "ZYPP_EXTERNALPROGRAM_FORK" );
+
+  const char * argv[] = { cmd_r, nullptr };
+  auto start = std::chrono::steady_clock::now();
+  for ( unsigned i = 0; i < runs_r; ++i )
+  {
+    ExternalProgram prog( argv, ExternalProgram::Discard_Stderr );
+    prog.close();
+  }
+  std::chrono::duration<double,std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / runs_r;
+}
+
+int main( int argc, char * argv[] )
+{
+  appname = Pathname::basename( argv[0] );
+
+  unsigned mb = 1024;
+  unsigned runs = 100;
+  std::string cmd { "/bin/true" };
+
+  argparse::Options options;
+  options.add()
+    ( "help,h",	"Print help and exit." )
+    ( "mb",	"Resident memory in MiB to allocate (default 1024).", argparse::Option::Arg::required )
+    ( "runs",	"Number of programs to start per method (default 100).", argparse::Option::Arg::required )
+    ( "cmd",	"The program to start (default /bin/true).", argparse::Option::Arg::required )
+    ;
+  auto result = options.parse( argc, argv );
+
+  if ( result.count( "help" ) )
+    return usage( options );
+
+  if ( result.count( "mb" ) )
+    mb = str::strtonum<unsigned>( result["mb"].arg() );
+  if ( result.count( "runs" ) )
+    runs = str::strtonum<unsigned>( result["runs"].arg() );
+  if ( result.count( "cmd" ) )
+    cmd = result["cmd"].arg();
+  if ( ! runs )
+    return errexit( "--runs must be > 0" );
+
+  // go...
+  size_t size = size_t(mb) << 20;
+  char * resident = static_cast<char *>( ::malloc( size ) );
+  if ( ! resident )
+    return errexit( "Can't allocate memory" );
+  ::memset( resident, 1, size );	// touch all pages
+
+  cout << "Spawning " << runs << " x '" << cmd << "' with " << mb << " MiB resident:" << endl;
+  cout << "  clone: " << spawnLatency( cmd.c_str(), runs, false ) << " ms" << endl;
+  cout << "  fork:  " << spawnLatency( cmd.c_str(), runs, true ) << " ms" << endl;
+
+  ::free( resident );
+  return 0;
+}
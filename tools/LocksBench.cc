@@ -0,0 +1,172 @@
+#define INCLUDE_TESTSETUP_WITHOUT_BOOST
+#include "../tests/lib/TestSetup.h"
+#undef  INCLUDE_TESTSETUP_WITHOUT_BOOST
+#include "argparse.h"
+
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include <zypp/TmpPath.h>
+#include <zypp/Locks.h>
+#include <zypp/PoolQuery.h>
+#include <zypp/PoolQueryUtil.tcc>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using Clock = std::chrono::steady_clock;
+
+static std::string appname { "NO_NAME" };
+
+int errexit( const std::string & msg_r = std::string(), int exit_r = 100 )
+{
+  if ( ! msg_r.empty() )
+    cerr << endl << appname << ": ERR: " << msg_r << endl << endl;
+  return exit_r;
+}
+
+int usage( const argparse::Options & options_r, int return_r = 0 )
+{
+  cerr << "USAGE: " << appname << " --repo LOCATION [OPTION]..." << endl;
+  cerr << "    Measure applying many locks to a pool, one query after the other and by Locks::apply." << endl;
+  cerr << "    The locks are made up from the package names in the repo: mostly names as added by" << endl;
+  cerr << "    Locks::addLock, some zypper style globs and dependencies, some matching nothing." << endl;
+  cerr << options_r << endl;
+  return return_r;
+}
+
+double msec( Clock::duration elapsed_r )
+{ return std::chrono::duration<double,std::milli>( elapsed_r ).count(); }
+
+std::set<sat::Solvable> lockedSolvables()
+{
+  std::set<sat::Solvable> ret;
+  for ( const PoolItem & pi : ResPool::instance() )
+    if ( pi.status().isLocked() )
+      ret.insert( pi.satSolvable() );
+  return ret;
+}
+
+void unlockAll()
+{
+  for ( const PoolItem & pi : ResPool::instance() )
+    pi.status().setLock( false, ResStatus::USER );
+}
+
+int main( int argc, char * argv[] )
+{
+  appname = Pathname::basename( argv[0] );
+  std::string repo;
+  unsigned count = 1000;
+
+  argparse::Options options;
+  options.add()
+    ( "help,h",		"Print help and exit." )
+    ( "repo",		"Repo to load (metadata dir, solv file or URL).", argparse::Option::Arg::required )
+    ( "locks",		"Number of locks (default 1000).", argparse::Option::Arg::required )
+    ;
+  auto result = options.parse( argc, argv );
+
+  if ( result.count( "help" ) )
+    return usage( options );
+
+  if ( ! result.count( "repo" ) )
+    return usage( options, 100 );
+  repo = result["repo"].arg();
+  if ( result.count( "locks" ) )
+    count = str::strtonum<unsigned>( result["locks"].arg() );
+  if ( ! count )
+    return errexit( "--locks must be > 0" );
+
+  TestSetup test( Arch_x86_64 );
+  test.loadRepo( repo );
+  cout << "pool: " << sat::Pool::instance().solvablesSize() << " solvables" << endl;
+
+  std::vector<std::string> names;
+  {
+    std::set<std::string> seen;
+    for ( const sat::Solvable & solv : sat::Pool::instance().solvables() )
+      if ( solv.isKind<Package>() && seen.insert( solv.name() ).second )
+        names.push_back( solv.name() );
+  }
+  if ( names.empty() )
+    return errexit( "No packages in " + repo );
+
+  // make up the locks
+  std::set<PoolQuery> queries;
+  for ( unsigned i = 0; queries.size() < count; ++i )
+  {
+    const std::string & name( names[i % names.size()] );
+    std::string variant( i < names.size() ? "" : str::numstring( i / names.size() ) );
+    PoolQuery q;
+    switch ( i % 10 )
+    {
+      case 8:	// matches nothing
+        q.addAttribute( sat::SolvAttr::name, name + "-nonexist" + variant );
+        q.setMatchExact();
+        break;
+      case 9:	// needs the query
+        q.addDependency( sat::SolvAttr::name, name, Rel::LT, Edition( "1" + variant ) );
+        break;
+      case 6:
+      case 7:	// zypper style glob
+        q.addAttribute( sat::SolvAttr::name, name.substr( 0, 4 ) + "*" + variant );
+        q.setMatchGlob();
+        q.addKind( ResKind::package );
+        break;
+      default:	// Locks::addLock
+        q.addAttribute( sat::SolvAttr::name, name + variant );
+        q.addKind( ResKind::package );
+        q.setMatchExact();
+        q.setCaseSensitive( true );
+        break;
+    }
+    queries.insert( q );
+  }
+
+  // one query after the other
+  unlockAll();
+  auto start = Clock::now();
+  for ( const PoolQuery & q : queries )
+    for ( const PoolItem & pi : q.poolItem() )
+      pi.status().setLock( true, ResStatus::USER );
+  auto byQuery = Clock::now() - start;
+  std::set<sat::Solvable> expected( lockedSolvables() );
+
+  start = Clock::now();
+  unsigned emptyByQuery = 0;
+  for ( const PoolQuery & q : queries )
+    if ( q.empty() )
+      ++emptyByQuery;
+  auto existEmptyByQuery = Clock::now() - start;
+
+  // Locks::apply
+  filesystem::TmpFile locksfile;
+  writePoolQueriesToFile( locksfile.path(), queries.begin(), queries.end() );
+  Locks & locks( Locks::instance() );
+  locks.read( locksfile.path() );
+  if ( locks.size() != queries.size() )
+    return errexit( "Read " + str::numstring( locks.size() ) + " of " + str::numstring( queries.size() ) + " locks" );
+
+  unlockAll();
+  start = Clock::now();
+  locks.apply();
+  auto byLocks = Clock::now() - start;
+  if ( lockedSolvables() != expected )
+    return errexit( "Locks::apply locked something else" );
+
+  start = Clock::now();
+  bool existEmpty = locks.existEmpty();
+  auto existEmptyByLocks = Clock::now() - start;
+  if ( existEmpty != ( emptyByQuery != 0 ) )
+    return errexit( "Locks::existEmpty is wrong" );
+
+  cout << queries.size() << " locks, " << expected.size() << " solvables locked, " << emptyByQuery << " locks empty:" << endl;
+  cout << "  apply one query after the other: " << msec( byQuery ) << " ms" << endl;
+  cout << "  Locks::apply:                    " << msec( byLocks ) << " ms" << endl;
+  cout << "  empty check per query:           " << msec( existEmptyByQuery ) << " ms" << endl;
+  cout << "  Locks::existEmpty:               " << msec( existEmptyByLocks ) << " ms" << endl;
+  return 0;
+}
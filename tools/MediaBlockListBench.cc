@@ -0,0 +1,173 @@
+#define INCLUDE_TESTSETUP_WITHOUT_BOOST
+#include "../tests/lib/TestSetup.h"
+#undef  INCLUDE_TESTSETUP_WITHOUT_BOOST
+#include "argparse.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <stdio.h>
+
+#include <zypp/TmpPath.h>
+#include <zypp/Digest.h>
+#include <zypp/media/MediaBlockList.h>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using zypp::media::MediaBlockList;
+using Clock = std::chrono::steady_clock;
+
+static std::string appname { "NO_NAME" };
+
+int errexit( const std::string & msg_r = std::string(), int exit_r = 100 )
+{
+  if ( ! msg_r.empty() )
+    cerr << endl << appname << ": ERR: " << msg_r << endl << endl;
+  return exit_r;
+}
+
+int usage( const argparse::Options & options_r, int return_r = 0 )
+{
+  cerr << "USAGE: " << appname << " [OPTION]..." << endl;
+  cerr << "    Measure the MediaBlockList rolling checksum and block reuse on a synthetic file pair." << endl;
+  cerr << "    The new file is the old one with a few bytes inserted and changed every MiB, so most" << endl;
+  cerr << "    of its blocks can be reused, but not at their original offset." << endl;
+  cerr << options_r << endl;
+  return return_r;
+}
+
+/** Fast pseudo random bytes, good enough for test data. */
+struct Random
+{
+  uint64_t state = 0x9e3779b97f4a7c15ULL;
+  uint64_t next()
+  {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+  void fill( char * buf_r, size_t len_r )
+  {
+    for ( size_t i = 0; i < len_r; ++i )
+      buf_r[i] = next();
+  }
+};
+
+/** The byte by byte rsum MediaBlockList used to compute. */
+unsigned int scalarRsum( unsigned int rs, const char * bytes, size_t len )
+{
+  unsigned short s = ( rs >> 16 ) & 65535;
+  unsigned short m = rs & 65535;
+  for ( ; len > 0; len-- )
+  {
+    s += (unsigned char)*bytes++;
+    m += s;
+  }
+  return ( s & 65535 ) << 16 | ( m & 65535 );
+}
+
+double mibPerSec( size_t bytes_r, Clock::duration elapsed_r )
+{
+  return bytes_r / 1048576.0 / std::chrono::duration<double>( elapsed_r ).count();
+}
+
+int main( int argc, char * argv[] )
+{
+  appname = Pathname::basename( argv[0] );
+
+  size_t size = 200;
+  size_t blksize = 4096;
+
+  argparse::Options options;
+  options.add()
+    ( "help,h",		"Print help and exit." )
+    ( "size",		"Size of the files in MiB (default 200).", argparse::Option::Arg::required )
+    ( "blocksize",	"Block size in bytes (default 4096).", argparse::Option::Arg::required )
+    ;
+  auto result = options.parse( argc, argv );
+
+  if ( result.count( "help" ) )
+    return usage( options );
+
+  if ( result.count( "size" ) )
+    size = str::strtonum<size_t>( result["size"].arg() );
+  if ( result.count( "blocksize" ) )
+    blksize = str::strtonum<size_t>( result["blocksize"].arg() );
+  if ( ! size || ! blksize )
+    return errexit( "--size and --blocksize must be > 0" );
+  size *= 1048576;
+
+  // create the file pair
+  Random random;
+  std::vector<char> olddata( size );
+  random.fill( olddata.data(), olddata.size() );
+
+  std::vector<char> newdata;
+  newdata.reserve( size + size / 1024 );
+  for ( size_t off = 0; off < size; off += 1048576 )
+  {
+    size_t len = std::min( size - off, size_t(1048576) );
+    newdata.insert( newdata.end(), olddata.begin() + off, olddata.begin() + off + len );
+    char change[64];
+    random.fill( change, sizeof(change) );
+    newdata.insert( newdata.end() - len / 2, change, change + sizeof(change) );
+    newdata[newdata.size() - len / 4] ^= 0x55;
+  }
+
+  filesystem::TmpDir tmp;
+  Pathname oldfile( tmp.path() / "old" );
+  Pathname newfile( tmp.path() / "new" );
+  {
+    FILE * fp = ::fopen( oldfile.c_str(), "w" );
+    if ( ! fp || ::fwrite( olddata.data(), olddata.size(), 1, fp ) != 1 )
+      return errexit( "Can't write " + oldfile.asString() );
+    ::fclose( fp );
+  }
+
+  // rsum throughput
+  MediaBlockList bl( newdata.size() );
+  {
+    auto start = Clock::now();
+    unsigned int rs1 = scalarRsum( 0, newdata.data(), newdata.size() );
+    auto scalar = Clock::now() - start;
+    start = Clock::now();
+    unsigned int rs2 = bl.updateRsum( 0, newdata.data(), newdata.size() );
+    auto current = Clock::now() - start;
+    if ( rs1 != rs2 )
+      return errexit( "rsum mismatch" );
+    cout << "rsum over " << newdata.size() / 1048576 << " MiB:" << endl;
+    cout << "  byte by byte: " << mibPerSec( newdata.size(), scalar ) << " MiB/s" << endl;
+    cout << "  updateRsum:   " << mibPerSec( newdata.size(), current ) << " MiB/s" << endl;
+  }
+
+  // block list of the new file
+  for ( size_t off = 0, blkno = 0; off < newdata.size(); off += blksize, ++blkno )
+  {
+    size_t len = std::min( newdata.size() - off, blksize );
+    bl.addBlock( off, len );
+    Digest dig;
+    dig.create( Digest::sha1() );
+    dig.update( newdata.data() + off, len );
+    std::vector<unsigned char> sum( dig.digestVector() );
+    bl.setChecksum( blkno, Digest::sha1(), sum.size(), sum.data() );
+    bl.setRsum( blkno, 4, bl.updateRsum( 0, newdata.data() + off, len ) );
+  }
+  size_t nblks = bl.numBlocks();
+
+  FILE * wfp = ::fopen( newfile.c_str(), "w+" );
+  if ( ! wfp )
+    return errexit( "Can't write " + newfile.asString() );
+  auto start = Clock::now();
+  bl.reuseBlocks( wfp, oldfile.asString() );
+  auto elapsed = Clock::now() - start;
+  ::fclose( wfp );
+
+  cout << "reuseBlocks, " << nblks << " blocks of " << blksize << " bytes:" << endl;
+  cout << "  reused " << nblks - bl.numBlocks() << " blocks in "
+       << std::chrono::duration<double,std::milli>( elapsed ).count() << " ms, "
+       << mibPerSec( olddata.size(), elapsed ) << " MiB/s" << endl;
+  return 0;
+}
@@ -26,9 +26,14 @@ namespace zypp
 			//!< Do not install. Implies a dry-run.
     DownloadInAdvance,	//!< First download all packages to the local cache.
 			//!< Then start to install.
-    DownloadInHeaps,	//!< Similar to DownloadInAdvance, but try to split
-			//!< the transaction into heaps, where at the end of
-			//!< each heap a consistent system state is reached.
+    DownloadInHeaps,	//!< Download the packages in the background while
+			//!< installing. Each package is installed as soon as
+			//!< it is available. As not all packages are available
+			//!< in advance, the file conflicts check is incomplete:
+			//!< packages not yet downloaded are reported as not
+			//!< checked (no filelist). If a download fails, the
+			//!< packages installed so far stay installed. Never
+			//!< chosen by \ref DownloadDefault.
     DownloadAsNeeded	//!< Alternating download and install. Packages are
 			//!< cached just to avid CD/DVD hopping. This is the
 			//!< traditional behaviour.
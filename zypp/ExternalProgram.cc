@@ -19,10 +19,15 @@
 #include <pty.h> // openpty
 #include <stdlib.h> // setenv
 #include <sys/prctl.h> // prctl(), PR_SET_PDEATHSIG
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sched.h> // clone
+#include <limits.h>
 
 #include <cstring> // strsignal
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 #include <zypp/base/Logger.h>
 #include <zypp/base/String.h>
@@ -37,6 +42,243 @@ using std::endl;
 
 namespace zypp {
 
+    ///////////////////////////////////////////////////////////////////
+    namespace
+    {
+      /** To always fork the child process (rather than vfork-like clone) */
+      inline bool ZYPP_EXTERNALPROGRAM_FORK()
+      {
+        const char * env = getenv("ZYPP_EXTERNALPROGRAM_FORK");
+        return( env && str::strToBool( env, true ) );
+      }
+
+      /** What the child process failed to do (reported to the parent via \c ChildArgs::errpipe). */
+      enum ChildFailure { CF_CHROOT = 1, CF_CHDIR, CF_PPID, CF_EXEC };
+
+      /** Everything the child process needs, prepared by the parent.
+       * With \c CLONE_VM the child shares the parents memory, so it must not
+       * allocate, take locks or touch any global state. Only async-signal-safe
+       * syscalls are used and the environment is passed to \c execvpe.
+       */
+      struct ChildArgs
+      {
+        const char *const * argv = nullptr;
+        char *const * envp = nullptr;
+        const char * root = nullptr;
+        const char * chdirTo = nullptr;
+        const char * redirectStdin = nullptr;
+        const char * redirectStdout = nullptr;
+        ExternalProgram::Stderr_Disposition stderrDisp = ExternalProgram::Normal_Stderr;
+        int stderrFd = -1;
+        bool usePty = false;
+        int masterTty = -1;
+        int slaveTty = -1;
+        int toExternal[2] = { -1, -1 };
+        int fromExternal[2] = { -1, -1 };
+        bool switchPgid = false;
+        bool dieWithParent = false;
+        pid_t ppidBeforeFork = -1;
+        int errpipe = -1;		///< CLOEXEC pipe to report a ChildFailure and errno
+        bool restoreSignals = false;	///< clone: reset caught signals and restore \c sigmask
+        sigset_t sigmask;
+      };
+
+      /** Report \a failure_r to the parent and exit. */
+      [[noreturn]] void childFailed( const ChildArgs & args_r, ChildFailure failure_r, int exit_r )
+      {
+        int msg[2] = { failure_r, errno };
+        while ( args_r.errpipe != -1 && ::write( args_r.errpipe, msg, sizeof(msg) ) == -1 && errno == EINTR )
+          ;
+        ::_exit( exit_r );
+      }
+
+      /** Close all filedescriptors above stderr, except \a keep_r (if it is above stderr). */
+      void closeFdsAbove2( int keep_r )
+      {
+#ifdef SYS_close_range
+        if ( keep_r < 3 )
+        {
+          if ( ::syscall( SYS_close_range, 3U, ~0U, 0U ) == 0 )
+            return;
+        }
+        else if ( ( keep_r == 3 || ::syscall( SYS_close_range, 3U, unsigned(keep_r - 1), 0U ) == 0 )
+                  && ::syscall( SYS_close_range, unsigned(keep_r + 1), ~0U, 0U ) == 0 )
+          return;
+#endif
+        for ( int i = ::getdtablesize() - 1; i > 2; --i ) {
+          if ( i != keep_r )
+            ::close( i );
+        }
+      }
+
+      /** The child process, either forked or cloned. Execs \c argv or exits. */
+      int runChild( void * arg_r )
+      {
+        //////////////////////////////////////////////////////////////////////
+        // Don't write to the logfile after fork!
+        //////////////////////////////////////////////////////////////////////
+        const ChildArgs & args( *static_cast<const ChildArgs *>( arg_r ) );
+
+        if ( args.restoreSignals )
+        {
+          // Handlers must not run on our stack in the parents memory.
+          struct sigaction sa;
+          for ( int sig = 1; sig < _NSIG; ++sig )
+          {
+            if ( ::sigaction( sig, nullptr, &sa ) == 0 && sa.sa_handler != SIG_IGN && sa.sa_handler != SIG_DFL )
+            {
+              sa.sa_handler = SIG_DFL;
+              sa.sa_flags = 0;
+              ::sigemptyset( &sa.sa_mask );
+              ::sigaction( sig, &sa, nullptr );
+            }
+          }
+          ::sigprocmask( SIG_SETMASK, &args.sigmask, nullptr );
+        }
+
+        if ( args.usePty )
+        {
+          ::setsid();
+          if ( args.slaveTty != 1 )
+            ::dup2( args.slaveTty, 1 );	// set new stdout
+          ExternalProgram::renumber_fd( args.slaveTty, 0 );	// set new stdin
+          ::close( args.masterTty );	// Belongs to father process
+
+          // We currently have no controlling terminal (due to setsid).
+          // The first open call will also set the new ctty (due to historical
+          // unix guru knowledge ;-) )
+
+          char name[512];
+          ::ttyname_r( args.slaveTty, name, sizeof(name) );
+          ::close( ::open( name, O_RDONLY ) );
+        }
+        else
+        {
+          if ( args.switchPgid )
+            ::setpgid( 0, 0 );
+          ExternalProgram::renumber_fd( args.toExternal[0], 0 );	// set new stdin
+          ::close( args.fromExternal[0] );	// Belongs to father process
+
+          ExternalProgram::renumber_fd( args.fromExternal[1], 1 );	// set new stdout
+          ::close( args.toExternal[1] );	// Belongs to father process
+        }
+
+        if ( args.redirectStdin )
+        {
+          ::close( 0 );
+          int inp_fd = ::open( args.redirectStdin, O_RDONLY );
+          ::dup2( inp_fd, 0 );
+        }
+
+        if ( args.redirectStdout )
+        {
+          ::close( 1 );
+          int inp_fd = ::open( args.redirectStdout, O_WRONLY|O_CREAT|O_APPEND, 0600 );
+          ::dup2( inp_fd, 1 );
+        }
+
+        // Handle stderr
+        if ( args.stderrDisp == ExternalProgram::Discard_Stderr )
+        {
+          int null_fd = ::open( "/dev/null", O_WRONLY );
+          ::dup2( null_fd, 2 );
+          ::close( null_fd );
+        }
+        else if ( args.stderrDisp == ExternalProgram::Stderr_To_Stdout )
+        {
+          ::dup2( 1, 2 );
+        }
+        else if ( args.stderrDisp == ExternalProgram::Stderr_To_FileDesc )
+        {
+          // Note: We don't have to close anything regarding stderr_fd.
+          // Our caller is responsible for that.
+          ::dup2( args.stderrFd, 2 );
+        }
+
+        const char * chdirTo = args.chdirTo;
+        if ( args.root )
+        {
+          if ( ::chroot( args.root ) == -1 )
+            childFailed( args, CF_CHROOT, 128 );
+          if ( ! chdirTo )
+            chdirTo = "/";
+        }
+
+        if ( chdirTo && ::chdir( chdirTo ) == -1 )
+          childFailed( args, CF_CHDIR, 128 );
+
+        closeFdsAbove2( args.errpipe );
+
+        if ( args.dieWithParent )
+        {
+          // process dies with us
+          // ignore if it did not work, worst case the process lives on after the parent dies
+          ::prctl( PR_SET_PDEATHSIG, SIGTERM );
+
+          // test in case the original parent exited just
+          // before the prctl() call
+          if ( ::getppid() != args.ppidBeforeFork )
+            childFailed( args, CF_PPID, 128 );
+        }
+
+        ::execvpe( args.argv[0], const_cast<char *const *>( args.argv ), args.envp );
+        // don't want to get here
+        childFailed( args, CF_EXEC, 129 );
+      }
+
+      /** Start \ref runChild in a process sharing our memory until it execs (like \c vfork).
+       * Avoids copying the page tables of a large process (e.g. holding a big pool).
+       * Returns the pid, or \c -1 and errno if clone failed.
+       */
+      pid_t cloneChild( ChildArgs & args_r )
+      {
+        // execvpe may need some space for the script fallback and the PATH lookup
+        size_t stackSize = 64 * 1024 + 4 * PATH_MAX;
+        for ( const char *const * arg = args_r.argv; *arg; ++arg )
+          stackSize += sizeof(char *);
+        void * stack = ::mmap( nullptr, stackSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_STACK, -1, 0 );
+        if ( stack == MAP_FAILED )
+          return -1;
+
+        // Block all signals, so no handler runs in the child before it reset them.
+        sigset_t all;
+        ::sigfillset( &all );
+        ::pthread_sigmask( SIG_BLOCK, &all, &args_r.sigmask );
+        args_r.restoreSignals = true;
+
+        // The stack grows down on all platforms we support.
+        pid_t pid = ::clone( runChild, static_cast<char *>( stack ) + stackSize, CLONE_VM|CLONE_VFORK|SIGCHLD, &args_r );
+        int cloneErrno = errno;
+
+        ::pthread_sigmask( SIG_SETMASK, &args_r.sigmask, nullptr );
+        args_r.restoreSignals = false;
+        ::munmap( stack, stackSize );
+
+        errno = cloneErrno;
+        return pid;
+      }
+
+      /** Our environment updated by \a environment_r (and \c LC_ALL=C if \a defaultLocale_r). */
+      std::vector<std::string> childEnvironment( const ExternalProgram::Environment & environment_r, bool defaultLocale_r )
+      {
+        ExternalProgram::Environment overwrite( environment_r );
+        if ( defaultLocale_r )
+          overwrite["LC_ALL"] = "C";
+
+        std::vector<std::string> ret;
+        for ( char ** env = ::environ; *env; ++env )
+        {
+          const char * sep = ::strchr( *env, '=' );
+          if ( ! overwrite.count( sep ? std::string( *env, sep - *env ) : std::string( *env ) ) )
+            ret.push_back( *env );
+        }
+        for ( const auto & el : overwrite )
+          ret.push_back( el.first + "=" + el.second );
+        return ret;
+      }
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
+
     ExternalProgram::ExternalProgram()
       : use_pty (false)
       , pid( -1 )
@@ -284,131 +526,75 @@ namespace zypp {
     	}
       }
 
-      pid_t ppid_before_fork = ::getpid();
-
-      // Create module process
-      if ((pid = fork()) == 0)
+      // Prepare everything the child needs; it must not allocate.
+      std::vector<std::string> envstr( childEnvironment( environment, default_locale ) );
+      std::vector<char *> envp;
+      envp.reserve( envstr.size() + 1 );
+      for ( std::string & env : envstr )
+        envp.push_back( &env[0] );
+      envp.push_back( nullptr );
+
+      ChildArgs args;
+      args.argv = argv;
+      args.envp = envp.data();
+      args.root = root;
+      args.chdirTo = chdirTo;
+      args.redirectStdin = redirectStdin;
+      args.redirectStdout = redirectStdout;
+      args.stderrDisp = stderr_disp;
+      args.stderrFd = stderr_fd;
+      args.usePty = use_pty;
+      args.switchPgid = switch_pgid;
+      args.dieWithParent = die_with_parent;
+      args.ppidBeforeFork = ::getpid();
+      if ( use_pty )
       {
-        //////////////////////////////////////////////////////////////////////
-        // Don't write to the logfile after fork!
-        //////////////////////////////////////////////////////////////////////
-    	if (use_pty)
-    	{
-    	    setsid();
-    	    if(slave_tty != 1)
-    		dup2 (slave_tty, 1);	  // set new stdout
-    	    renumber_fd (slave_tty, 0);	  // set new stdin
-    	    ::close(master_tty);	  // Belongs to father process
-
-    	    // We currently have no controlling terminal (due to setsid).
-    	    // The first open call will also set the new ctty (due to historical
-    	    // unix guru knowledge ;-) )
-
-    	    char name[512];
-    	    ttyname_r(slave_tty, name, sizeof(name));
-    	    ::close(open(name, O_RDONLY));
-    	}
-    	else
-    	{
-            if ( switch_pgid )
-              setpgid( 0, 0);
-    	    renumber_fd (to_external[0], 0); // set new stdin
-    	    ::close(from_external[0]);	  // Belongs to father process
-
-    	    renumber_fd (from_external[1], 1); // set new stdout
-    	    ::close(to_external	 [1]);	  // Belongs to father process
-    	}
-
-        if ( redirectStdin )
-        {
-          ::close( 0 );
-          int inp_fd = open( redirectStdin, O_RDONLY );
-          dup2( inp_fd, 0 );
-        }
-
-        if ( redirectStdout )
-        {
-          ::close( 1 );
-          int inp_fd = open( redirectStdout, O_WRONLY|O_CREAT|O_APPEND, 0600 );
-          dup2( inp_fd, 1 );
-        }
-
-    	// Handle stderr
-    	if (stderr_disp == Discard_Stderr)
-    	{
-    	    int null_fd = open("/dev/null", O_WRONLY);
-    	    dup2(null_fd, 2);
-    	    ::close(null_fd);
-    	}
-    	else if (stderr_disp == Stderr_To_Stdout)
-    	{
-    	    dup2(1, 2);
-    	}
-    	else if (stderr_disp == Stderr_To_FileDesc)
-    	{
-    	    // Note: We don't have to close anything regarding stderr_fd.
-    	    // Our caller is responsible for that.
-    	    dup2 (stderr_fd, 2);
-    	}
-
-    	for ( Environment::const_iterator it = environment.begin(); it != environment.end(); ++it ) {
-    	  setenv( it->first.c_str(), it->second.c_str(), 1 );
-    	}
-
-    	if(default_locale)
-    		setenv("LC_ALL","C",1);
-
-    	if(root)
-    	{
-    	    if(chroot(root) == -1)
-    	    {
-                _execError = str::form( _("Can't chroot to '%s' (%s)."), root, strerror(errno) );
-                std::cerr << _execError << endl;// After fork log on stderr too
-    		_exit (128);			// No sense in returning! I am forked away!!
-    	    }
-	    if ( ! chdirTo )
-	      chdirTo = "/";
-    	}
-
-	if ( chdirTo && chdir( chdirTo ) == -1 )
-	{
-	  _execError = root ? str::form( _("Can't chdir to '%s' inside chroot '%s' (%s)."), chdirTo, root, strerror(errno) )
-			    : str::form( _("Can't chdir to '%s' (%s)."), chdirTo, strerror(errno) );
-	  std::cerr << _execError << endl;// After fork log on stderr too
-	  _exit (128);			// No sense in returning! I am forked away!!
-	}
-
-    	// close all filedesctiptors above stderr
-    	for ( int i = ::getdtablesize() - 1; i > 2; --i ) {
-    	  ::close( i );
-    	}
-
-        if ( die_with_parent ) {
-          // process dies with us
-          int r = prctl(PR_SET_PDEATHSIG, SIGTERM);
-          if (r == -1) {
-            //ignore if it did not work, worst case the process lives on after the parent dies
-            std::cerr << "Failed to set PR_SET_PDEATHSIG" << endl;// After fork log on stderr too
-          }
+        args.masterTty = master_tty;
+        args.slaveTty = slave_tty;
+      }
+      else
+      {
+        args.toExternal[0] = to_external[0];
+        args.toExternal[1] = to_external[1];
+        args.fromExternal[0] = from_external[0];
+        args.fromExternal[1] = from_external[1];
+      }
 
-          // test in case the original parent exited just
-          // before the prctl() call
-          pid_t ppidNow = getppid();
-          if (ppidNow != ppid_before_fork) {
-            std::cerr << "PPID changed from "<<ppid_before_fork<<" to "<< ppidNow << endl;// After fork log on stderr too
-            _exit(128);
-          }
-        }
+      int errpipe[2] = { -1, -1 };	// child reports a ChildFailure
+#ifdef HAVE_PIPE2
+      if ( ::pipe2( errpipe, O_CLOEXEC ) != 0 )
+#else
+      if ( ::pipe( errpipe ) == 0 )
+      {
+        ::fcntl( errpipe[0], F_SETFD, FD_CLOEXEC );
+        ::fcntl( errpipe[1], F_SETFD, FD_CLOEXEC );
+      }
+      else
+#endif
+      {
+        // Without the pipe a failing child is noticed by its exit status only.
+        WAR << "Can't create pipe (" << strerror(errno) << "), child failures are not reported." << endl;
+        errpipe[0] = errpipe[1] = -1;
+      }
+      args.errpipe = errpipe[1];
 
-    	execvp(argv[0], const_cast<char *const *>(argv));
-        // don't want to get here
-        _execError = str::form( _("Can't exec '%s' (%s)."), argv[0], strerror(errno) );
-        std::cerr << _execError << endl;// After fork log on stderr too
-        _exit (129);			// No sense in returning! I am forked away!!
-        //////////////////////////////////////////////////////////////////////
+      // Create module process
+      // The pty needs a forked child to acquire its controlling terminal.
+      // Otherwise the child shares our memory until it execs (no page table copy).
+      pid = -1;
+      if ( ! use_pty && ! ZYPP_EXTERNALPROGRAM_FORK() )
+      {
+        pid = cloneChild( args );
+        if ( pid == -1 )
+          WAR << "Can't clone (" << strerror(errno) << "), using fork." << endl;
+      }
+      if ( pid == -1 )
+      {
+        if ((pid = fork()) == 0)
+          runChild( &args );	// does not return
       }
 
-      else if (pid == -1)	 // Fork failed, close everything.
+      if (pid == -1)	 // Fork failed, close everything.
       {
         _execError = str::form( _("Can't fork (%s)."), strerror(errno) );
         _exitStatus = 127;
@@ -424,9 +610,62 @@ namespace zypp {
     	    ::close(from_external[0]);
     	    ::close(from_external[1]);
     	}
+        if ( errpipe[0] != -1 )
+        {
+          ::close( errpipe[0] );
+          ::close( errpipe[1] );
+        }
       }
 
       else {
+        // Read the childs failure report; EOF if exec succeeded.
+        int failure[2] = { 0, 0 };
+        ssize_t res = 0;
+        if ( errpipe[0] != -1 )
+        {
+          ::close( errpipe[1] );
+          while ( ( res = ::read( errpipe[0], failure, sizeof(failure) ) ) == -1 && errno == EINTR )
+            ;
+          ::close( errpipe[0] );
+        }
+
+        if ( res == sizeof(failure) )
+        {
+          const char * what = strerror( failure[1] );
+          switch ( failure[0] )
+          {
+            case CF_CHROOT:
+              _execError = str::form( _("Can't chroot to '%s' (%s)."), root, what );
+              break;
+            case CF_CHDIR:
+              _execError = root ? str::form( _("Can't chdir to '%s' inside chroot '%s' (%s)."), chdirTo ? chdirTo : "/", root, what )
+                                : str::form( _("Can't chdir to '%s' (%s)."), chdirTo, what );
+              break;
+            case CF_PPID:
+              _execError = str::form( "PPID changed from %d", args.ppidBeforeFork );
+              break;
+            default:
+              _execError = str::form( _("Can't exec '%s' (%s)."), argv[0], what );
+              break;
+          }
+          ERR << _execError << endl;
+
+          // The childs stderr gets the message too.
+          int errfd = -1;
+          if ( stderr_disp == Normal_Stderr )
+            errfd = 2;
+          else if ( stderr_disp == Stderr_To_FileDesc )
+            errfd = stderr_fd;
+          else if ( stderr_disp == Stderr_To_Stdout && ! redirectStdout )
+            errfd = use_pty ? slave_tty : from_external[1];
+          if ( errfd != -1 )
+          {
+            std::string msg( _execError + "\n" );
+            if ( ::write( errfd, msg.c_str(), msg.size() ) == -1 )
+              {;} // nothing we can do
+          }
+        }
+
     	if (use_pty)
     	{
     	    ::close(slave_tty);	       // belongs to child process
@@ -466,6 +705,8 @@ namespace zypp {
 	  FILE * inputfile = inputFile();
 	  int    inputfileFd = ::fileno( inputfile );
 	  long   delay = 0;
+	  size_t linebuffer_size = 0;	// getline allocs and reallocs
+	  char * linebuffer = 0;	// if the buffer is too small
 	  do
 	  {
 	    /* Watch inputFile to see when it has input. */
@@ -491,8 +732,6 @@ namespace zypp {
 	    else if ( retval )
 	    {
 	      // Data is available now.
-	      static size_t linebuffer_size = 0;      // static because getline allocs
-	      static char * linebuffer = 0;           // and reallocs if buffer is too small
 	      getline( &linebuffer, &linebuffer_size, inputfile );
 	      // ::feof check is important as select returns
 	      // positive if the file was closed.
@@ -507,6 +746,7 @@ namespace zypp {
 		break;
 	    }
 	  } while ( true );
+	  ::free( linebuffer );
 	}
 
 	if ( pid > 0 )	// bsc#1109877: must re-check! running() in the loop above may have already waited.
@@ -86,6 +86,9 @@ namespace zypp
         // check checksums even if there is no such
         // checksum (warns of no checksum)
         AlwaysVerifyChecksum = 0x0004,
+        // the locations checksum is verified after the checkers,
+        // unless the file was found in a cache by checksum
+        VerifyLocationChecksum = 0x0008,
     };
     ZYPP_DECLARE_FLAGS(Flags, Flag);
 
@@ -513,8 +516,10 @@ namespace zypp
 
       // get cached file (by checksum) or provide from media
       Pathname tmpFile = locateInCache( resource, destDir_r );
+      bool verifyChecksum = false;
       if ( tmpFile.empty() )
       {
+	verifyChecksum = jobp_r->flags.testFlag( FetcherJob::VerifyLocationChecksum );
 	MIL << "Not found in cache, retrieving..." << endl;
 	tmpFile = media_r.provideFile( resource, resource.optional() ? MediaSetAccess::PROVIDE_NON_INTERACTIVE : MediaSetAccess::PROVIDE_DEFAULT, jobp_r->deltafile );
 	releaseFileGuard.reset( new MediaSetAccess::ReleaseFileGuard( media_r, resource ) ); // release it when we leave the block
@@ -529,6 +534,8 @@ namespace zypp
 
       // validate the file (throws if not valid)
       validate( tmpFile, jobp_r->checkers );
+      if ( verifyChecksum )
+	ChecksumFileChecker( resource.checksum() )( tmpFile );
 
       // move it to the final destination
       if ( tmpFile == destFullPath )
@@ -787,9 +794,8 @@ namespace zypp
       }
       else
       {
-          // checksum is not empty, so add a checksum checker
-          ChecksumFileChecker digest_check(jobp->location.checksum());
-          jobp->checkers.push_back(digest_check);
+          // checksum is not empty, so verify it (unless a cache hit matched it already)
+          jobp->flags |= FetcherJob::VerifyLocationChecksum;
       }
 
       // Provide and validate the file. If the file was not transferred
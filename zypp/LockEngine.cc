@@ -0,0 +1,252 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/LockEngine.cc
+ *
+*/
+#include <iostream>
+#include <algorithm>
+
+#include <zypp/base/LogTools.h>
+#include <zypp/PoolItem.h>
+#include <zypp/RelCompare.h>
+#include <zypp/sat/Pool.h>
+
+#include <zypp/LockEngine_p.h>
+
+#undef ZYPP_BASE_LOGGER_LOGGROUP
+#define ZYPP_BASE_LOGGER_LOGGROUP "locks"
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  namespace
+  {
+    inline char lower( char ch_r )
+    { return ( ch_r >= 'A' && ch_r <= 'Z' ) ? ch_r + ( 'a' - 'A' ) : ch_r; }
+
+    /** The name without \c kind: prefix, as libsolv matches it if \ref Match::SKIP_KIND is set. */
+    inline const char * stripKind( const char * name_r )
+    {
+      const char * p = name_r;
+      while ( *p >= 'a' && *p <= 'z' )
+        ++p;
+      return ( *p == ':' && p != name_r ) ? p + 1 : name_r;
+    }
+
+    /** The literal beginning of \a str_r (up to the first glob special char). */
+    inline std::string literalPrefix( const std::string & str_r, bool glob_r )
+    {
+      if ( ! glob_r )
+        return str_r;
+      return str_r.substr( 0, str_r.find_first_of( "*?[\\" ) );
+    }
+  } // namespace
+
+  bool LockEngine::NameLock::matches( sat::Solvable solv_r, const char * name_r ) const
+  {
+    if ( neverMatchRepo )
+      return false;
+    if ( status && ( (status == PoolQuery::INSTALLED_ONLY) != solv_r.isSystem() ) )
+      return false;
+    if ( ! repos.empty() && repos.find( solv_r.repository() ) == repos.end() )
+      return false;
+    if ( ! kinds.empty() && ! solv_r.isKind( kinds.begin(), kinds.end() ) )
+      return false;
+    if ( op != Rel::ANY && ! compareByRel( op, solv_r.edition(), edition, Edition::Match() ) )
+      return false;
+    return matcher.doMatch( name_r );
+  }
+
+  LockEngine::LockEngine( const std::set<PoolQuery> & locks_r )
+  : _locks( locks_r.begin(), locks_r.end() )
+  {
+    for ( unsigned idx = 0; idx < _locks.size(); ++idx )
+    {
+      if ( ! compileNameLock( _locks[idx], idx ) )
+        _queryLocks.push_back( idx );
+    }
+
+    // _nameLocks is complete, so the keys stay where they are
+    for ( unsigned idx = 0; idx < _nameLocks.size(); ++idx )
+    {
+      const NameLock & nlock( _nameLocks[idx] );
+      Table & table( _tables[nlock.skipKind] );
+      table.byKey[nlock.key].push_back( idx );
+      if ( std::find( table.keySizes.begin(), table.keySizes.end(), nlock.key.size() ) == table.keySizes.end() )
+        table.keySizes.push_back( nlock.key.size() );
+    }
+    for ( Table & table : _tables )
+      std::sort( table.keySizes.begin(), table.keySizes.end() );
+    DBG << *this << endl;
+  }
+
+  bool LockEngine::compileNameLock( const PoolQuery & query_r, unsigned idx_r )
+  {
+    if ( ! ( query_r.matchExact() || query_r.matchGlob() ) )
+      return false;
+    const PoolQuery::AttrRawStrMap & attrs( query_r.attributes() );
+    if ( attrs.size() != 1 || attrs.begin()->first != sat::SolvAttr::name )
+      return false;
+
+    // Anything the accessors don't tell (like dependencies added
+    // with an edition range) requires running the query.
+    PoolQuery plain;
+    for ( const std::string & str : query_r.strings() )
+      plain.addString( str );
+    for ( const std::string & str : attrs.begin()->second )
+      plain.addAttribute( sat::SolvAttr::name, str );
+    for ( const ResKind & kind : query_r.kinds() )
+      plain.addKind( kind );
+    for ( const std::string & alias : query_r.repos() )
+      plain.addRepo( alias );
+    plain.setEdition( query_r.edition(), query_r.editionRel() );
+    plain.setStatusFilterFlags( query_r.statusFilterFlags() );
+    plain.setFlags( query_r.flags() );
+    if ( ! ( plain == query_r ) )
+      return false;
+
+    // Like PoolQuery, join the global and the attribute strings (empty ones are ignored).
+    std::set<std::string> strings;
+    for ( const std::string & str : query_r.strings() )
+      if ( ! str.empty() ) strings.insert( str );
+    for ( const std::string & str : attrs.begin()->second )
+      if ( ! str.empty() ) strings.insert( str );
+    if ( strings.empty() )
+      return false;	// matches always
+
+    NameLock proto;
+    proto.lock = idx_r;
+    proto.skipKind = query_r.flags().test( Match::SKIP_KIND );
+    proto.kinds.insert( query_r.kinds().begin(), query_r.kinds().end() );
+    proto.op = query_r.editionRel();
+    proto.edition = query_r.edition();
+    proto.status = query_r.statusFilterFlags();
+    for ( const std::string & alias : query_r.repos() )
+    {
+      Repository repo( sat::Pool::instance().reposFind( alias ) );
+      if ( repo )
+        proto.repos.insert( repo );
+    }
+    proto.neverMatchRepo = ( ! query_r.repos().empty() && proto.repos.empty() );
+
+    std::vector<NameLock> nlocks;
+    for ( const std::string & str : strings )
+    {
+      NameLock nlock( proto );
+      nlock.matcher = StrMatcher( str, query_r.flags() );
+      try
+      {
+        nlock.matcher.compile();
+      }
+      catch ( const MatchException & excpt )
+      {
+        ZYPP_CAUGHT( excpt );
+        return false;	// PoolQuery will report it
+      }
+      nlock.key = literalPrefix( str, query_r.matchGlob() );
+      std::transform( nlock.key.begin(), nlock.key.end(), nlock.key.begin(), lower );
+      nlock.exact = ( nlock.key.size() == str.size() );
+      nlocks.push_back( std::move(nlock) );
+    }
+    _nameLocks.insert( _nameLocks.end(), std::make_move_iterator( nlocks.begin() ), std::make_move_iterator( nlocks.end() ) );
+    return true;
+  }
+
+  void LockEngine::evaluate()
+  {
+    _locked = sat::Map( sat::Map::poolSize );
+    _matched.assign( _locks.size(), false );
+
+    for ( unsigned idx : _queryLocks )
+    {
+      for ( const sat::Solvable & solv : _locks[idx] )
+      {
+        _locked.set( solv.id() );
+        _matched[idx] = true;
+      }
+    }
+
+    if ( _nameLocks.empty() )
+      return;
+
+    std::string lname;
+    for ( const sat::Solvable & solv : sat::Pool::instance().solvables() )
+    {
+      const char * ident = solv.ident().c_str();
+      for ( bool skipKind : { false, true } )
+      {
+        const Table & table( _tables[skipKind] );
+        if ( table.keySizes.empty() )
+          continue;
+
+        const char * name = skipKind ? stripKind( ident ) : ident;
+        lname = name;
+        std::transform( lname.begin(), lname.end(), lname.begin(), lower );
+
+        for ( size_t size : table.keySizes )
+        {
+          if ( size > lname.size() )
+            break;
+          auto it = table.byKey.find( std::string_view( lname.data(), size ) );
+          if ( it == table.byKey.end() )
+            continue;
+          for ( unsigned idx : it->second )
+          {
+            const NameLock & nlock( _nameLocks[idx] );
+            if ( nlock.exact && size != lname.size() )
+              continue;
+            if ( _matched[nlock.lock] && _locked.test( solv.id() ) )
+              continue;	// nothing new to learn
+            if ( nlock.matches( solv, name ) )
+            {
+              _locked.set( solv.id() );
+              _matched[nlock.lock] = true;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  std::set<PoolQuery> LockEngine::emptyLocks() const
+  {
+    std::set<PoolQuery> ret;
+    for ( unsigned idx = 0; idx < _locks.size(); ++idx )
+    {
+      if ( idx >= _matched.size() || ! _matched[idx] )
+        ret.insert( ret.end(), _locks[idx] );
+    }
+    return ret;
+  }
+
+  void LockEngine::apply() const
+  {
+    unsigned cnt = 0;
+    for ( const sat::Solvable & solv : sat::Pool::instance().solvables() )
+    {
+      if ( _locked.size() > solv.id() && _locked.test( solv.id() ) )
+      {
+        PoolItem( solv ).status().setLock( true, ResStatus::USER );
+        ++cnt;
+      }
+    }
+    DBG << "locked " << cnt << " solvables" << endl;
+  }
+
+  std::ostream & operator<<( std::ostream & str, const LockEngine & obj )
+  {
+    return str << "LockEngine(" << obj._locks.size() << " locks, "
+               << obj._locks.size() - obj._queryLocks.size() << " by name in "
+               << obj._tables[0].byKey.size() + obj._tables[1].byKey.size() << " keys)";
+  }
+
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
@@ -0,0 +1,121 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/LockEngine_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_LOCKENGINE_P_H
+#define ZYPP_LOCKENGINE_P_H
+
+#include <iosfwd>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <zypp/APIConfig.h>
+#include <zypp/base/NonCopyable.h>
+#include <zypp/base/StrMatcher.h>
+#include <zypp/PoolQuery.h>
+#include <zypp/Repository.h>
+#include <zypp/sat/Map.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  /// \class LockEngine
+  /// \brief Evaluate many lock queries in a single pass over the pool.
+  ///
+  /// Running each \ref PoolQuery of the \ref Locks on its own visits
+  /// the whole pool once per lock. But almost all locks just match the
+  /// solvables name (exact or glob, as created by \ref Locks::addLock or
+  /// zypper), optionally restricted by kind, edition, repo or status.
+  /// Those are compiled into a table keyed by the literal (lowercased)
+  /// beginning of the search string. Evaluating the locks visits each
+  /// solvable once, looks up the beginnings of its name and runs the exact
+  /// \ref StrMatcher of the locks found there. Other locks (dependencies,
+  /// substrings, regex, ...) are still run as \ref PoolQuery.
+  ///
+  /// \code
+  ///   LockEngine engine( locks );
+  ///   engine.evaluate();
+  ///   engine.apply();		// lock what any lock matches
+  ///   engine.emptyLocks();	// the locks matching nothing
+  /// \endcode
+  ///////////////////////////////////////////////////////////////////
+  class ZYPP_LOCAL LockEngine : private base::NonCopyable
+  {
+    friend std::ostream & operator<<( std::ostream & str, const LockEngine & obj );
+
+  public:
+    /** Compile \a locks_r for the current pool content. */
+    explicit LockEngine( const std::set<PoolQuery> & locks_r );
+
+  public:
+    /** Compute the solvables matched by the locks. */
+    void evaluate();
+
+    /** The solvables matched by any lock (after \ref evaluate). */
+    const sat::Map & locked() const
+    { return _locked; }
+
+    /** The locks matching no solvable (after \ref evaluate). */
+    std::set<PoolQuery> emptyLocks() const;
+
+    /** Set a \ref ResStatus::USER lock on all \ref locked solvables. */
+    void apply() const;
+
+  private:
+    /** A lock (or one of its search strings) matching the solvable name. */
+    struct NameLock
+    {
+      unsigned lock = 0;		///< index in \ref _locks
+      StrMatcher matcher;
+      std::string key;			///< lowercased literal beginning of the search string
+      bool exact = false;		///< whether \ref key is the whole search string
+      bool skipKind = false;		///< match the name without \c kind: prefix
+      std::set<ResKind> kinds;
+      Rel op;
+      Edition edition;
+      std::set<Repository> repos;
+      bool neverMatchRepo = false;
+      PoolQuery::StatusFilter status = PoolQuery::ALL;
+
+      /** Whether the lock matches \a solv_r named \a name_r. */
+      bool matches( sat::Solvable solv_r, const char * name_r ) const;
+    };
+
+    /** The \ref NameLock s by \ref NameLock::key. */
+    struct Table
+    {
+      std::unordered_map<std::string_view, std::vector<unsigned>> byKey;
+      std::vector<size_t> keySizes;	///< ascending
+    };
+
+    /** Compile \a query_r into \ref _nameLocks if it just matches the name. */
+    bool compileNameLock( const PoolQuery & query_r, unsigned idx_r );
+
+  private:
+    std::vector<PoolQuery> _locks;
+    std::vector<NameLock> _nameLocks;
+    Table _tables[2];			///< by NameLock::skipKind
+    std::vector<unsigned> _queryLocks;	///< locks run as PoolQuery
+    sat::Map _locked;
+    std::vector<bool> _matched;		///< per lock
+  };
+  ///////////////////////////////////////////////////////////////////
+
+  /** \relates LockEngine Stream output */
+  std::ostream & operator<<( std::ostream & str, const LockEngine & obj );
+
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_LOCKENGINE_P_H
@@ -10,7 +10,6 @@
 #include <set>
 #include <fstream>
 #include <boost/function.hpp>
-#include <boost/iterator/function_output_iterator.hpp>
 #include <algorithm>
 
 #include <zypp/base/Regex.h>
@@ -28,6 +27,7 @@
 #define ZYPP_BASE_LOGGER_LOGGROUP "locks"
 
 #include <zypp/Locks.h>
+#include <zypp/LockEngine_p.h>
 
 using std::endl;
 
@@ -112,48 +112,14 @@ Locks::LockList::size_type Locks::size() const
 bool Locks::empty() const
 { return _pimpl->locks().empty(); }
 
-struct ApplyLock
-{
-  void operator()(const PoolQuery& query) const
-  {
-    for ( const PoolItem & item : query.poolItem() )
-    {
-      item.status().setLock(true,ResStatus::USER);
-      DBG << "lock "<< item.name();
-    }
-  }
-};
-
-/**
- * iterator that takes lock, lock all solvables from query 
- * and send query to output iterator
- */
-template <class OutputIterator>
-struct LockingOutputIterator
-{
-  LockingOutputIterator(OutputIterator& out_)
-    : out(out_)
-    {}
-
-  void operator()(const PoolQuery& query) const
-  {
-    ApplyLock a;a(query);
-    *out++ = query;
-  }
-  
-  private:
-  OutputIterator& out;
-};
-
 void Locks::readAndApply( const Pathname& file )
 {
   MIL << "read and apply locks from "<<file << endl;
   PathInfo pinfo(file);
   if ( pinfo.isExist() )
   {
-    std::insert_iterator<LockSet> ii( _pimpl->MANIPlocks(), _pimpl->MANIPlocks().end() );
-    LockingOutputIterator<std::insert_iterator<LockSet> > lout(ii);
-    readPoolQueriesFromFile( file, boost::make_function_output_iterator(lout) );
+    readPoolQueriesFromFile( file, std::insert_iterator<LockSet>(_pimpl->MANIPlocks(), _pimpl->MANIPlocks().end()) );
+    apply();
   }
   else
     MIL << "file does not exist(or cannot be stat), no lock added." << endl;
@@ -172,9 +138,12 @@ void Locks::read( const Pathname& file )
 
 
 void Locks::apply() const
-{ 
+{
   DBG << "apply locks" << endl;
-  for_each(_pimpl->locks().begin(), _pimpl->locks().end(), ApplyLock());
+  // all locks in a single pass over the pool
+  LockEngine engine( _pimpl->locks() );
+  engine.evaluate();
+  engine.apply();
 }
 
 
@@ -263,13 +232,12 @@ void Locks::removeLock( const ResKind &kind_r, const IdString &name_r )
 
 bool Locks::existEmpty() const
 {
-  for_( it, _pimpl->locks().begin(), _pimpl->locks().end() )
-  {
-    if( it->empty() )
-      return true;
-  }
+  if ( _pimpl->locks().empty() )
+    return false;
 
-  return false;
+  LockEngine engine( _pimpl->locks() );
+  engine.evaluate();
+  return ! engine.emptyLocks().empty();
 }
 
 //handle locks during removing
@@ -278,10 +246,11 @@ private:
   bool skip_rest;
   size_t searched;
   size_t all;
+  const std::set<PoolQuery> &emptyLocks;
   callback::SendReport<CleanEmptyLocksReport> &report;
 
 public:
-  LocksCleanPredicate(size_t count, callback::SendReport<CleanEmptyLocksReport> &_report): skip_rest(false),searched(0),all(count), report(_report){}
+  LocksCleanPredicate(size_t count, const std::set<PoolQuery> &_emptyLocks, callback::SendReport<CleanEmptyLocksReport> &_report): skip_rest(false),searched(0),all(count), emptyLocks(_emptyLocks), report(_report){}
 
   bool aborted(){ return skip_rest; }
 
@@ -290,7 +259,7 @@ public:
     if( skip_rest )
       return false;
     searched++;
-    if( !q.empty() )
+    if( !emptyLocks.count(q) )
       return false;
 
     if (!report->progress((100*searched)/all))
@@ -324,7 +293,10 @@ void Locks::removeEmpty()
   callback::SendReport<CleanEmptyLocksReport> report;
   report->start();
   size_t sum = _pimpl->locks().size();
-  LocksCleanPredicate p(sum, report);
+  LockEngine engine( _pimpl->locks() );
+  engine.evaluate();
+  const std::set<PoolQuery> emptyLocks( engine.emptyLocks() );
+  LocksCleanPredicate p(sum, emptyLocks, report);
 
   remove_if( _pimpl->MANIPlocks(), p );
 
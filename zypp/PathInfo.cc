@@ -11,18 +11,26 @@
 */
 
 #include <utime.h>     // for ::utime
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/ioctl.h>
 #include <sys/statvfs.h>
 #include <sys/sysmacros.h> // for ::minor, ::major macros
+#include <linux/fs.h>      // for FICLONE
 
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <map>
+#include <vector>
 
 #include <zypp/base/LogTools.h>
 #include <zypp/base/String.h>
 #include <zypp/base/IOStream.h>
 #include <zypp/base/StrMatcher.h>
 #include <zypp/base/Errno.h>
+#include <zypp/base/WorkerPool_p.h>
 
 #include <zypp/AutoDispose.h>
 #include <zypp/ExternalProgram.h>
@@ -374,45 +382,314 @@ namespace zypp
     }
 
     ///////////////////////////////////////////////////////////////////
-    //
-    //	METHOD NAME : recursive_rmdir
-    //	METHOD TYPE : int
-    //
-    static int recursive_rmdir_1( const Pathname & dir, bool removeDir = true )
+    namespace
     {
-      DIR * dp;
-      struct dirent * d;
+      /** Remember \a err_r in \a ret_r unless an error was already remembered. */
+      inline void keepFirstError( int & ret_r, int err_r )
+      { if ( err_r && ! ret_r ) ret_r = err_r; }
 
-      if ( ! (dp = opendir( dir.c_str() )) )
-        return logResult( errno );
+      inline bool isDotOrDotDot( const char * name_r )
+      { return( name_r[0] == '.' && ( name_r[1] == '\0' || ( name_r[1] == '.' && name_r[2] == '\0' ) ) ); }
 
-      while ( (d = readdir(dp)) )
+      /** Whether the entry \a name_r in \a dirfd_r is a directory (not following symlinks). */
+      inline bool isDirAt( int dirfd_r, const char * name_r, unsigned char dtype_r )
       {
-        std::string direntry = d->d_name;
-        if ( direntry == "." || direntry == ".." )
-          continue;
-        Pathname new_path( dir / d->d_name );
-
+        if ( dtype_r != DT_UNKNOWN )
+          return( dtype_r == DT_DIR );
         struct stat st;
-        if ( ! lstat( new_path.c_str(), &st ) )
+        return( ::fstatat( dirfd_r, name_r, &st, AT_SYMLINK_NOFOLLOW ) == 0 && S_ISDIR( st.st_mode ) );
+      }
+
+      int rmAt( int dirfd_r, const char * name_r, unsigned char dtype_r );
+
+      /** Remove the content of the directory open as \a dirfd_r, which is consumed.
+       * If \a subdirs_r is not \c NULL, subdirectories are not removed but collected.
+       * All entries are processed, the first error is returned.
+       */
+      int rmdirContentAt( int dirfd_r, std::vector<std::string> * subdirs_r = nullptr )
+      {
+        DIR * dp = ::fdopendir( dirfd_r );
+        if ( ! dp )
         {
-          if ( S_ISDIR( st.st_mode ) )
-            recursive_rmdir_1( new_path );
+          int ret = errno;
+          ::close( dirfd_r );
+          return ret;
+        }
+        AutoDispose<DIR *> guard( dp, ::closedir );
+
+        int ret = 0;
+        for ( struct dirent * d = ::readdir( dp ); d; d = ::readdir( dp ) )
+        {
+          if ( isDotOrDotDot( d->d_name ) )
+            continue;
+          if ( subdirs_r && isDirAt( ::dirfd( dp ), d->d_name, d->d_type ) )
+            subdirs_r->push_back( d->d_name );
           else
-            ::unlink( new_path.c_str() );
+            keepFirstError( ret, rmAt( ::dirfd( dp ), d->d_name, d->d_type ) );
         }
+        return ret;
       }
-      closedir( dp );
 
-      if ( removeDir && ::rmdir( dir.c_str() ) < 0 )
-        return errno;
+      /** Remove the entry \a name_r in \a dirfd_r, recursively if it is a directory. */
+      int rmAt( int dirfd_r, const char * name_r, unsigned char dtype_r )
+      {
+        if ( ! isDirAt( dirfd_r, name_r, dtype_r ) )
+        {
+          if ( ::unlinkat( dirfd_r, name_r, 0 ) == 0 )
+            return 0;
+          if ( errno != EISDIR )
+            return errno;
+        }
+
+        int ret = 0;
+        int fd = ::openat( dirfd_r, name_r, O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC );
+        if ( fd == -1 )
+          keepFirstError( ret, errno );
+        else
+          keepFirstError( ret, rmdirContentAt( fd ) );
+
+        if ( ::unlinkat( dirfd_r, name_r, AT_REMOVEDIR ) == -1 )
+          keepFirstError( ret, errno );
+        return ret;
+      }
+
+      /** Remove the content of \a dir and unless \a removeDir_r \a dir itself.
+       * If \a parallel_r, the subdirectories of \a dir are removed by a \ref WorkerPool.
+       */
+      int recursive_rmdir_1( const Pathname & dir, bool removeDir_r = true, bool parallel_r = false )
+      {
+        AutoFD dirfd( ::open( dir.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC ) );
+        if ( dirfd == -1 )
+          return errno;
+
+        int ret = 0;
+        if ( parallel_r )
+        {
+          std::vector<std::string> subdirs;
+          int fd = ::dup( dirfd );
+          keepFirstError( ret, fd == -1 ? errno : rmdirContentAt( fd, &subdirs ) );
+
+          std::vector<int> errors( subdirs.size(), 0 );
+          {
+            WorkerPool workers;
+            for ( unsigned i = 0; i < subdirs.size(); ++i )
+              workers.add( [&,i]() { errors[i] = rmAt( dirfd, subdirs[i].c_str(), DT_DIR ); } );
+          }
+          for ( int err : errors )
+            keepFirstError( ret, err );
+        }
+        else
+        {
+          keepFirstError( ret, rmdirContentAt( dirfd.value() ) );
+          dirfd.resetDispose();	// closed by rmdirContentAt
+        }
+
+        if ( removeDir_r && ::rmdir( dir.c_str() ) == -1 )
+          keepFirstError( ret, errno );
+        return ret;
+      }
+
+      /** Copy the data of \a srcfd_r into the empty file \a dstfd_r.
+       * A reflink is tried first, then \c copy_file_range, then read/write.
+       */
+      int copyData( int srcfd_r, int dstfd_r )
+      {
+#ifdef FICLONE
+        if ( ::ioctl( dstfd_r, FICLONE, srcfd_r ) == 0 )
+          return 0;
+#endif
+#ifdef HAVE_COPY_FILE_RANGE
+        for ( bool first = true; true; first = false )
+        {
+          ssize_t res = ::copy_file_range( srcfd_r, nullptr, dstfd_r, nullptr, 1 << 30, 0 );
+          if ( res == 0 )
+            return 0;
+          if ( res == -1 )
+          {
+            if ( errno == EINTR )
+              continue;
+            if ( first && ( errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP ) )
+              break;	// not supported here; nothing copied yet
+            return errno;
+          }
+        }
+#endif
+        char buf[65536];
+        while ( true )
+        {
+          ssize_t res = ::read( srcfd_r, buf, sizeof(buf) );
+          if ( res == 0 )
+            return 0;
+          if ( res == -1 )
+          {
+            if ( errno == EINTR )
+              continue;
+            return errno;
+          }
+          for ( ssize_t done = 0; done < res; )
+          {
+            ssize_t wres = ::write( dstfd_r, buf + done, res - done );
+            if ( wres == -1 )
+            {
+              if ( errno == EINTR )
+                continue;
+              return errno;
+            }
+            done += wres;
+          }
+        }
+      }
+
+      /** Copy the file open as \a srcfd_r to \a name_r in \a dirfd_r.
+       * An existing destination is overwritten, or removed first if \a removeDest_r.
+       * A new file is created with the permissions of the source (modified by the umask).
+       */
+      int copyFileAt( int srcfd_r, int dirfd_r, const char * name_r, bool removeDest_r )
+      {
+        struct stat sst;
+        if ( ::fstat( srcfd_r, &sst ) == -1 )
+          return errno;
+
+        struct stat dst;
+        if ( ::fstatat( dirfd_r, name_r, &dst, 0 ) == 0 )
+        {
+          if ( sst.st_dev == dst.st_dev && sst.st_ino == dst.st_ino )
+            return EEXIST;	// source and destination are the same file
+          if ( removeDest_r && ::unlinkat( dirfd_r, name_r, 0 ) == -1 && errno != ENOENT )
+            return errno;
+        }
+
+        AutoFD dstfd( ::openat( dirfd_r, name_r, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, sst.st_mode & 0777 ) );
+        if ( dstfd == -1 )
+          return errno;
+
+        int ret = copyData( srcfd_r, dstfd );
+        if ( ::close( dstfd.value() ) == -1 )
+          keepFirstError( ret, errno );
+        dstfd.resetDispose();
+        return ret;
+      }
+
+      ///////////////////////////////////////////////////////////////////
+      /// \class TreeCopy
+      /// \brief Copy directory trees like <tt>cp -dR</tt>.
+      ///
+      /// Symlinks are copied as symlinks, files hardlinked within the
+      /// source tree are hardlinked in the copy. Existing directories are
+      /// merged, existing files overwritten. All entries are processed,
+      /// the first error is returned.
+      ///////////////////////////////////////////////////////////////////
+      class TreeCopy
+      {
+      public:
+        /** Copy \a name_r in \a srcdirfd_r as \a dstname_r into \a dstdirfd_r (being \a dstdir_r). */
+        int copyAt( int srcdirfd_r, const char * name_r, int dstdirfd_r, const Pathname & dstdir_r, const char * dstname_r )
+        {
+          struct stat st;
+          if ( ::fstatat( srcdirfd_r, name_r, &st, AT_SYMLINK_NOFOLLOW ) == -1 )
+            return errno;
+
+          if ( S_ISDIR( st.st_mode ) )
+          {
+            // Keep the new directory writable until it is filled.
+            bool newdir = ( ::mkdirat( dstdirfd_r, dstname_r, ( st.st_mode & 07777 ) | S_IRWXU ) == 0 );
+            if ( ! newdir && errno != EEXIST )
+              return errno;
+
+            AutoFD srcfd( ::openat( srcdirfd_r, name_r, O_RDONLY|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC ) );
+            if ( srcfd == -1 )
+              return errno;
+            AutoFD dstfd( ::openat( dstdirfd_r, dstname_r, O_RDONLY|O_DIRECTORY|O_CLOEXEC ) );
+            if ( dstfd == -1 )
+              return errno;
+
+            int ret = copyContent( srcfd, dstfd, dstdir_r / dstname_r );
+            if ( newdir && ( st.st_mode & S_IRWXU ) != S_IRWXU && ::fchmod( dstfd, st.st_mode & 07777 ) == -1 )
+              keepFirstError( ret, errno );
+            return ret;
+          }
+
+          if ( S_ISLNK( st.st_mode ) )
+          {
+            std::string target( st.st_size ? st.st_size : PATH_MAX, '\0' );
+            ssize_t len = ::readlinkat( srcdirfd_r, name_r, &target[0], target.size() );
+            if ( len == -1 )
+              return errno;
+            target.resize( len );
+            if ( ::symlinkat( target.c_str(), dstdirfd_r, dstname_r ) == -1 )
+            {
+              if ( errno != EEXIST || ::unlinkat( dstdirfd_r, dstname_r, 0 ) == -1 || ::symlinkat( target.c_str(), dstdirfd_r, dstname_r ) == -1 )
+                return errno;
+            }
+            return 0;
+          }
+
+          if ( S_ISREG( st.st_mode ) )
+          {
+            if ( st.st_nlink > 1 )
+            {
+              auto res = _links.insert( { { st.st_dev, st.st_ino }, ( dstdir_r / dstname_r ).asString() } );
+              if ( ! res.second )	// hardlink to a file already copied
+              {
+                ::unlinkat( dstdirfd_r, dstname_r, 0 );
+                if ( ::linkat( AT_FDCWD, res.first->second.c_str(), dstdirfd_r, dstname_r, 0 ) == -1 )
+                  return errno;
+                return 0;
+              }
+            }
+            AutoFD srcfd( ::openat( srcdirfd_r, name_r, O_RDONLY|O_NOFOLLOW|O_CLOEXEC ) );
+            if ( srcfd == -1 )
+              return errno;
+            return copyFileAt( srcfd, dstdirfd_r, dstname_r, false );
+          }
+
+          // fifo, socket, device
+          if ( ::mknodat( dstdirfd_r, dstname_r, st.st_mode, st.st_rdev ) == -1 )
+            return errno;
+          return 0;
+        }
+
+        /** Copy the content of directory \a srcfd_r into directory \a dstfd_r (being \a dstdir_r). */
+        int copyContent( int srcfd_r, int dstfd_r, const Pathname & dstdir_r )
+        {
+          int fd = ::dup( srcfd_r );
+          if ( fd == -1 )
+            return errno;
+          DIR * dp = ::fdopendir( fd );
+          if ( ! dp )
+          {
+            int ret = errno;
+            ::close( fd );
+            return ret;
+          }
+          AutoDispose<DIR *> guard( dp, ::closedir );
+
+          int ret = 0;
+          for ( struct dirent * d = ::readdir( dp ); d; d = ::readdir( dp ) )
+          {
+            if ( ! isDotOrDotDot( d->d_name ) )
+              keepFirstError( ret, copyAt( srcfd_r, d->d_name, dstfd_r, dstdir_r, d->d_name ) );
+          }
+          return ret;
+        }
+
+      private:
+        std::map<std::pair<dev_t,ino_t>,std::string> _links;	///< copied files with more than one link
+      };
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
 
-      return 0;
-    }
     ///////////////////////////////////////////////////////////////////
+    //
+    //	METHOD NAME : recursive_rmdir
+    //	METHOD TYPE : int
+    //
     int recursive_rmdir( const Pathname & path )
+    { return recursive_rmdir( path, false ); }
+
+    int recursive_rmdir( const Pathname & path, bool parallel_r )
     {
-      MIL << "recursive_rmdir " << path << ' ';
+      MIL << "recursive_rmdir " << path << ( parallel_r ? " (parallel) " : " " );
       PathInfo p( path );
 
       if ( !p.isExist() ) {
@@ -432,7 +709,7 @@ namespace zypp
 	return logResult( 0 );
       }
 
-      return logResult( recursive_rmdir_1( path ) );
+      return logResult( recursive_rmdir_1( path, true, parallel_r ) );
     }
 
     ///////////////////////////////////////////////////////////////////
@@ -441,8 +718,11 @@ namespace zypp
     //	METHOD TYPE : int
     //
     int clean_dir( const Pathname & path )
+    { return clean_dir( path, false ); }
+
+    int clean_dir( const Pathname & path, bool parallel_r )
     {
-      MIL << "clean_dir " << path << ' ';
+      MIL << "clean_dir " << path << ( parallel_r ? " (parallel) " : " " );
       PathInfo p( path );
 
       if ( !p.isExist() ) {
@@ -453,7 +733,7 @@ namespace zypp
         return logResult( ENOTDIR );
       }
 
-      return logResult( recursive_rmdir_1( path, false/* don't remove path itself */ ) );
+      return logResult( recursive_rmdir_1( path, false/* don't remove path itself */, parallel_r ) );
     }
 
     ///////////////////////////////////////////////////////////////////
@@ -480,21 +760,11 @@ namespace zypp
         return logResult( EEXIST );
       }
 
-
-      const char *const argv[] = {
-        "/bin/cp",
-        "-dR",
-        "--",
-        srcpath.asString().c_str(),
-        destpath.asString().c_str(),
-        NULL
-      };
-      ExternalProgram prog( argv, ExternalProgram::Stderr_To_Stdout );
-      for ( string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
-        MIL << "  " << output;
+      AutoFD dstfd( ::open( destpath.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC ) );
+      if ( dstfd == -1 ) {
+        return logResult( errno );
       }
-      int ret = prog.close();
-      return logResult( ret, "returned" );
+      return logResult( TreeCopy().copyAt( AT_FDCWD, srcpath.c_str(), dstfd, destpath, srcpath.basename().c_str() ) );
     }
 
     ///////////////////////////////////////////////////////////////////
@@ -520,22 +790,15 @@ namespace zypp
         return logResult( EEXIST );
       }
 
-      std::string src( srcpath.asString());
-      src += "/.";
-      const char *const argv[] = {
-        "/bin/cp",
-        "-dR",
-        "--",
-        src.c_str(),
-        destpath.asString().c_str(),
-        NULL
-      };
-      ExternalProgram prog( argv, ExternalProgram::Stderr_To_Stdout );
-      for ( string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
-        MIL << "  " << output;
+      AutoFD srcfd( ::open( srcpath.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC ) );
+      if ( srcfd == -1 ) {
+        return logResult( errno );
+      }
+      AutoFD dstfd( ::open( destpath.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC ) );
+      if ( dstfd == -1 ) {
+        return logResult( errno );
       }
-      int ret = prog.close();
-      return logResult( ret, "returned" );
+      return logResult( TreeCopy().copyContent( srcfd, dstfd, destpath ) );
     }
 
     ///////////////////////////////////////////////////////////////////////
@@ -793,20 +1056,11 @@ namespace zypp
         return logResult( EISDIR );
       }
 
-      const char *const argv[] = {
-        "/bin/cp",
-        "--remove-destination",
-        "--",
-        file.asString().c_str(),
-        dest.asString().c_str(),
-        NULL
-      };
-      ExternalProgram prog( argv, ExternalProgram::Stderr_To_Stdout );
-      for ( string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
-        MIL << "  " << output;
+      AutoFD srcfd( ::open( file.c_str(), O_RDONLY|O_CLOEXEC ) );
+      if ( srcfd == -1 ) {
+        return logResult( errno );
       }
-      int ret = prog.close();
-      return logResult( ret, "returned" );
+      return logResult( copyFileAt( srcfd, AT_FDCWD, dest.c_str(), true/*remove destination*/ ) );
     }
 
     ///////////////////////////////////////////////////////////////////
@@ -963,19 +1217,15 @@ namespace zypp
         return logResult( ENOTDIR );
       }
 
-      const char *const argv[] = {
-        "/bin/cp",
-        "--",
-        file.asString().c_str(),
-        dest.asString().c_str(),
-        NULL
-      };
-      ExternalProgram prog( argv, ExternalProgram::Stderr_To_Stdout );
-      for ( string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
-        MIL << "  " << output;
+      AutoFD srcfd( ::open( file.c_str(), O_RDONLY|O_CLOEXEC ) );
+      if ( srcfd == -1 ) {
+        return logResult( errno );
+      }
+      AutoFD dstfd( ::open( dest.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC ) );
+      if ( dstfd == -1 ) {
+        return logResult( errno );
       }
-      int ret = prog.close();
-      return logResult( ret, "returned" );
+      return logResult( copyFileAt( srcfd, dstfd, file.basename().c_str(), false ) );
     }
 
     ///////////////////////////////////////////////////////////////////
@@ -422,34 +422,44 @@ namespace zypp
      * Like 'rm -r DIR'. Delete a directory, recursively removing its contents.
      *
      * @return 0 on success, ENOTDIR if path is not a directory, otherwise the
-     * commands return value.
+     * errno of the first failing operation.
      **/
     int recursive_rmdir( const Pathname & path );
+    /** \overload If \a parallel_r, the subdirectories of \a path are removed concurrently.
+     * Worth it for large trees like the package cache.
+     */
+    int recursive_rmdir( const Pathname & path, bool parallel_r );
 
     /**
      * Like 'rm -r DIR/ *'. Delete directory contents, but keep the directory itself.
      *
      * @return 0 on success, ENOTDIR if path is not a directory, otherwise the
-     * commands return value.
+     * errno of the first failing operation.
      **/
     int clean_dir( const Pathname & path );
+    /** \overload If \a parallel_r, the subdirectories of \a path are removed concurrently. */
+    int clean_dir( const Pathname & path, bool parallel_r );
 
     /**
-     * Like 'cp -a srcpath destpath'. Copy directory tree. srcpath/destpath must be
+     * Like 'cp -dR srcpath destpath'. Copy directory tree. srcpath/destpath must be
      * directories. 'basename srcpath' must not exist in destpath.
      *
+     * Symlinks are copied as symlinks, hardlinks within the tree are preserved.
+     * File data are reflinked if the filesystem supports it.
+     *
      * @return 0 on success, ENOTDIR if srcpath/destpath is not a directory, EEXIST if
-     * 'basename srcpath' exists in destpath, otherwise the commands return value.
+     * 'basename srcpath' exists in destpath, otherwise the errno of the first
+     * failing operation.
      **/
     int copy_dir( const Pathname & srcpath, const Pathname & destpath );
 
     /**
-     * Like 'cp -a srcpath/. destpath'. Copy the content of srcpath recursively
+     * Like 'cp -dR srcpath/. destpath'. Copy the content of srcpath recursively
      * into destpath. Both \p srcpath and \p destpath has to exists.
      *
      * @return 0 on success, ENOTDIR if srcpath/destpath is not a directory,
-     * EEXIST if srcpath and destpath are equal, otherwise the commands
-     * return value.
+     * EEXIST if srcpath and destpath are equal, otherwise the errno of the
+     * first failing operation.
      */
     int copy_dir_content( const Pathname & srcpath, const Pathname & destpath);
 
@@ -640,10 +650,11 @@ namespace zypp
     int exchange( const Pathname & lpath, const Pathname & rpath );
 
     /**
-     * Like 'cp file dest'. Copy file to destination file.
+     * Like 'cp --remove-destination file dest'. Copy file to destination file.
+     * File data are reflinked if the filesystem supports it.
      *
      * @return 0 on success, EINVAL if file is not a file, EISDIR if
-     * destiantion is a directory, otherwise the commands return value.
+     * destiantion is a directory, otherwise errno on failure.
      **/
     int copy( const Pathname & file, const Pathname & dest );
 
@@ -703,7 +714,7 @@ namespace zypp
      * Like 'cp file dest'. Copy file to dest dir.
      *
      * @return 0 on success, EINVAL if file is not a file, ENOTDIR if dest
-     * is no directory, otherwise the commands return value.
+     * is no directory, otherwise errno on failure.
      **/
     int copy_file2dir( const Pathname & file, const Pathname & dest );
     //@}
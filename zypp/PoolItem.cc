@@ -17,6 +17,7 @@
 #include <zypp/ResPool.h>
 #include <zypp/Package.h>
 #include <zypp/VendorAttr.h>
+#include <zypp/pool/StatusStore_p.h>
 
 using std::endl;
 
@@ -33,20 +34,30 @@ namespace zypp
    * \li \c ==0 no buddy
    * \li \c >0 this uses \c _buddy status
    * \li \c <0 this status used by \c -_buddy
+   *
+   * The status is kept in the \ref pool::StatusStore, until the
+   * item leaves the pool (\ref detachStatus).
    */
   struct PoolItem::Impl
   {
     public:
-      Impl() {}
+      Impl()
+      : _status( &_detachedStatus )
+      {}
 
       Impl( ResObject::constPtr res_r,
+            sat::detail::SolvableIdType id_r,
             const ResStatus & status_r )
-      : _status( status_r )
+      : _status( &pool::StatusStore::instance().assign( id_r, status_r ) )
       , _resolvable( res_r )
+      , _id( id_r )
       {}
 
+      Impl( const Impl & ) = delete;
+      Impl & operator=( const Impl & ) = delete;
+
       ResStatus & status() const
-      { return _buddy > 0 ? PoolItem(buddy()).status() : _status; }
+      { return _buddy > 0 ? PoolItem(buddy()).status() : *_status; }
 
       sat::Solvable buddy() const
       {
@@ -64,9 +75,19 @@ namespace zypp
 
       ResStatus & statusReset() const
       {
-        _status.setLock( false, zypp::ResStatus::USER );
-        _status.resetTransact( zypp::ResStatus::USER );
-        return _status;
+        _status->setLock( false, zypp::ResStatus::USER );
+        _status->resetTransact( zypp::ResStatus::USER );
+        return *_status;
+      }
+
+      /** Take a copy of the status, as our slot in the \ref pool::StatusStore will be reused. */
+      void detachStatus() const
+      {
+        if ( _status == &_detachedStatus )
+          return;
+        _detachedStatus = *_status;
+        _status = &_detachedStatus;
+        pool::StatusStore::instance().release( _id );
       }
 
     public:
@@ -101,8 +122,10 @@ namespace zypp
       }
 
     private:
-      mutable ResStatus     _status;
+      mutable ResStatus *   _status;
+      mutable ResStatus     _detachedStatus;
       ResObject::constPtr   _resolvable;
+      sat::detail::SolvableIdType _id = 0;	///< our slot in the pool::StatusStore
       DefaultIntegral<sat::detail::IdType,sat::detail::noId> _buddy;
 
     /** \name Poor man's save/restore state.
@@ -165,6 +188,7 @@ namespace zypp
       }
       myBuddy._pimpl->_buddy = -resolvable()->satSolvable().id();
       _buddy = myBuddy.satSolvable().id();
+      pool::StatusStore::instance().setBuddy( resolvable()->satSolvable().id(), _buddy );
       DBG << *this << " has buddy " << myBuddy << endl;
     }
   }
@@ -191,7 +215,7 @@ namespace zypp
 
   PoolItem PoolItem::makePoolItem( const sat::Solvable & solvable_r )
   {
-    return PoolItem( new Impl( makeResObject( solvable_r ), solvable_r.isSystem() ) );
+    return PoolItem( new Impl( makeResObject( solvable_r ), solvable_r.id(), solvable_r.isSystem() ) );
   }
 
   PoolItem::~PoolItem()
@@ -205,6 +229,7 @@ namespace zypp
   ResStatus & PoolItem::statusReset() const		{ return _pimpl->statusReset(); }
   sat::Solvable PoolItem::buddy() const			{ return _pimpl->buddy(); }
   void PoolItem::setBuddy( const sat::Solvable & solv_r )	{ _pimpl->setBuddy( solv_r ); }
+  void PoolItem::detachStatus() const			{ _pimpl->detachStatus(); }
   bool PoolItem::isUndetermined() const			{ return _pimpl->isUndetermined(); }
   bool PoolItem::isRelevant() const			{ return _pimpl->isRelevant(); }
   bool PoolItem::isSatisfied() const			{ return _pimpl->isSatisfied(); }
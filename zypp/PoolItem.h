@@ -142,6 +142,8 @@ namespace zypp
       static PoolItem makePoolItem( const sat::Solvable & solvable_r );
       /** Buddies are set by \ref pool::PoolImpl.*/
       void setBuddy( const sat::Solvable & solv_r );
+      /** Called by \ref pool::PoolImpl when the item leaves the pool. */
+      void detachStatus() const;
       /** internal ctor */
     public:
       struct Impl;	///< Expose type only
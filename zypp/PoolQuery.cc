@@ -11,17 +11,25 @@
 */
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
 
 #include <zypp/base/Gettext.h>
 #include <zypp/base/LogTools.h>
 #include <zypp/base/Algorithm.h>
 #include <zypp/base/String.h>
+#include <zypp/base/SerialNumber.h>
 #include <zypp/repo/RepoException.h>
 #include <zypp/RelCompare.h>
 
+#include <zypp/sat/detail/PoolImpl.h>
 #include <zypp/sat/Pool.h>
 #include <zypp/sat/Solvable.h>
+#include <zypp/sat/Map.h>
+#include <zypp/sat/SearchIndex_p.h>
 #include <zypp/base/StrMatcher.h>
+#include <zypp/base/WorkerPool_p.h>
 
 #include <zypp/PoolQuery.h>
 
@@ -61,6 +69,31 @@ namespace zypp
       return false;
     }
 
+    /** Whether matching \a attr_r never needs the pools temporary string space.
+     * Libsolv uses it to stringify dependencies, checksums, numbers or full file
+     * paths, so only queries for these attributes are run in parallel.
+     */
+    bool isParallelAttribute( sat::SolvAttr attr_r )
+    {
+      static sat::SolvAttr attrs[] = {
+        SolvAttr::name,
+        SolvAttr::summary,
+        SolvAttr::description,
+        SolvAttr::insnotify,
+        SolvAttr::delnotify,
+        SolvAttr::eula,
+        SolvAttr::license,
+        SolvAttr::group,
+        SolvAttr::keywords,
+        SolvAttr::vendor,
+        SolvAttr::filelist,	// basenames only
+      };
+      for_( it, arrayBegin(attrs), arrayEnd(attrs) )
+        if ( *it == attr_r )
+          return true;
+      return false;
+    }
+
     /** Whether the current capabilities edition range ovelaps and/or its solvables arch matches.
      * Query asserts \a iter_r points to a capability and we
      * have to check the range only.
@@ -454,6 +487,9 @@ namespace zypp
 
     /** Kinds to search */
     Kinds _kinds;
+
+    /** Search repos in parallel (not part of the query) */
+    DefaultIntegral<bool,false> _parallel;
     //@}
 
   public:
@@ -1018,6 +1054,11 @@ namespace zypp
   PoolQuery::StatusFilter PoolQuery::statusFilterFlags() const
   { return _pimpl->_status_flags; }
 
+  void PoolQuery::setParallel( bool value )
+  { _pimpl->_parallel = value; }
+  bool PoolQuery::parallel() const
+  { return _pimpl->_parallel; }
+
   bool PoolQuery::empty() const
   {
     try { return begin() == end(); }
@@ -1480,6 +1521,139 @@ namespace zypp
   bool PoolQuery::operator<( const PoolQuery & rhs ) const
   { return *_pimpl < *rhs._pimpl; }
 
+  ///////////////////////////////////////////////////////////////////
+  namespace
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class CompiledQueryCache
+    /// \brief Process wide cache of compiled queries and their results.
+    ///
+    /// Compiling a \ref PoolQuery builds the \ref StrMatcher (and regex)
+    /// of each attribute to match. Locks, patterns and UI filters run the
+    /// same queries over and over, so the compiled \ref AttrMatchList is
+    /// remembered by the queries \ref cacheKey. A query executed again
+    /// against an unchanged pool (\ref sat::Pool::serial) also remembers
+    /// the solvables it matched, if it is iterated to the end. The next
+    /// execution just visits those.
+    ///
+    /// The cache is used unless \c ZYPP_POOLQUERY_CACHE=0 is set.
+    ///////////////////////////////////////////////////////////////////
+    class CompiledQueryCache
+    {
+    public:
+      struct Entry
+      {
+	shared_ptr<const AttrMatchList> compiled;
+	shared_ptr<const sat::Map> result;	///< the matching solvables, if computed for \ref poolSerial
+	unsigned poolSerial = 0;
+	unsigned hits = 0;			///< lookups since \ref poolSerial
+	unsigned lastUse = 0;
+      };
+
+      /** Max. number of queries to remember. */
+      static constexpr size_t maxEntries = 256;
+
+      static bool enabled()
+      {
+	static bool _enabled = [](){
+	  const char *env = getenv( "ZYPP_POOLQUERY_CACHE" );
+	  if ( env && ! str::strToBool( env, true ) )
+	  {
+	    MIL << "ZYPP_POOLQUERY_CACHE=" << env << ": no query cache" << endl;
+	    return false;
+	  }
+	  return true;
+	}();
+	return _enabled;
+      }
+
+      static CompiledQueryCache & instance()
+      {
+	static CompiledQueryCache _instance;
+	return _instance;
+      }
+
+      /** The entry for \a key_r as it was before this lookup. Results
+       * computed for an outdated \a poolSerial_r are dropped.
+       */
+      Entry lookup( const std::string & key_r, unsigned poolSerial_r )
+      {
+	std::lock_guard<std::mutex> guard( _mutex );
+	Entry & entry( _entries[key_r] );
+	if ( entry.poolSerial != poolSerial_r )
+	{
+	  entry.result.reset();
+	  entry.poolSerial = poolSerial_r;
+	  entry.hits = 0;
+	}
+	Entry ret( entry );
+	++entry.hits;
+	entry.lastUse = ++_uses;
+	if ( _entries.size() > maxEntries )
+	  prune();
+	return ret;
+      }
+
+      /** Remember the compiled \ref AttrMatchList of \a key_r. */
+      void storeCompiled( const std::string & key_r, shared_ptr<const AttrMatchList> compiled_r )
+      {
+	std::lock_guard<std::mutex> guard( _mutex );
+	auto it( _entries.find( key_r ) );
+	if ( it != _entries.end() )
+	  it->second.compiled = compiled_r;
+      }
+
+      /** Remember the \a result_r of \a key_r in the pool \a poolSerial_r. */
+      void storeResult( const std::string & key_r, shared_ptr<const sat::Map> result_r, unsigned poolSerial_r )
+      {
+	std::lock_guard<std::mutex> guard( _mutex );
+	auto it( _entries.find( key_r ) );
+	if ( it != _entries.end() && it->second.poolSerial == poolSerial_r )
+	  it->second.result = result_r;
+      }
+
+    private:
+      /** Forget the least recently used half of the entries. */
+      void prune()
+      {
+	std::vector<unsigned> uses;
+	uses.reserve( _entries.size() );
+	for ( const auto & el : _entries )
+	  uses.push_back( el.second.lastUse );
+	std::nth_element( uses.begin(), uses.begin() + uses.size() / 2, uses.end() );
+	unsigned limit = uses[uses.size() / 2];
+	for ( auto it = _entries.begin(); it != _entries.end(); )
+	{
+	  if ( it->second.lastUse < limit )
+	    it = _entries.erase( it );
+	  else
+	    ++it;
+	}
+	DBG << "Query cache pruned to " << _entries.size() << " queries" << endl;
+      }
+
+    private:
+      std::mutex _mutex;
+      std::unordered_map<std::string, Entry> _entries;
+      unsigned _uses = 0;
+    };
+
+    /** The key of a query in the \ref CompiledQueryCache.
+     * The serialized query, plus the options \ref PoolQuery::serialize
+     * does not store.
+     */
+    std::string cacheKey( const PoolQuery & query_r, const PoolQuery::Impl & impl_r )
+    {
+      std::ostringstream str;
+      query_r.serialize( str );
+      str << "flags: " << impl_r._flags.get() << endl
+          << "word: " << impl_r._match_word << endl
+          << "op: " << impl_r._op.inSwitch() << endl;
+      return str.str();
+    }
+  } // namespace
+  ///////////////////////////////////////////////////////////////////
+
   ///////////////////////////////////////////////////////////////////
   namespace detail
   { /////////////////////////////////////////////////////////////////
@@ -1495,7 +1669,9 @@ namespace zypp
      * Query and fileter depend on the \ref PoolQuery settings.
      *
      * Matcher must be stateless, as it is shared between multiple
-     * \ref PoolQueryIterator instances.
+     * \ref PoolQueryIterator instances. The only exception is the
+     * result it records for the \ref CompiledQueryCache while the
+     * leading iterator advances.
      *
      * If \ref base_iterator is at the \ref end, \ref advance moves it
      * to the first match. Otherwise advance moves to the next match, or
@@ -1518,6 +1694,39 @@ namespace zypp
 
 	bool advance( base_iterator & base_r ) const
 	{
+	  if ( ! _record )
+	    return advanceMatch( base_r );
+
+	  // Only the iterator ahead of all others reveals new matches:
+	  bool leading = ( base_r == end() ? ! _recorded : base_r.inSolvable() == _recordedLast );
+	  bool ret = advanceMatch( base_r );
+	  if ( leading )
+	  {
+	    if ( ! _recorded )
+	      _recorded.reset( new sat::Map( sat::Map::poolSize ) );
+	    if ( ret )
+	    {
+	      _recordedLast = base_r.inSolvable();
+	      _recorded->set( _recordedLast.id() );
+	    }
+	    else
+	    {
+	      // iterated to the end: remember the result
+	      if ( sat::Pool::instance().serial().serial() == _poolSerial )
+		CompiledQueryCache::instance().storeResult( _cacheKey, _recorded, _poolSerial );
+	      _record = false;
+	      _recorded.reset();
+	    }
+	  }
+	  return ret;
+	}
+
+	/** \ref advance to the next match. */
+	bool advanceMatch( base_iterator & base_r ) const
+	{
+	  if ( _candidates )
+	    return advanceCandidates( base_r );
+
 	  if ( base_r == end() )
 	    base_r = startNewQyery(); // first candidate
 	  else
@@ -1590,9 +1799,21 @@ namespace zypp
 	/** Ctor stores the \ref PoolQuery settings.
          * \throw MatchException Any of the exceptions thrown by \ref PoolQuery::Impl::compile.
          */
-	PoolQueryMatcher( const shared_ptr<const PoolQuery::Impl> & query_r )
+	PoolQueryMatcher( const shared_ptr<const PoolQuery::Impl> & query_r, const std::string & cacheKey_r = std::string() )
 	{
-	  query_r->compile();
+	  CompiledQueryCache::Entry cached;
+	  unsigned poolSerial = sat::Pool::instance().serial().serial();
+	  if ( ! cacheKey_r.empty() )
+	    cached = CompiledQueryCache::instance().lookup( cacheKey_r, poolSerial );
+
+	  if ( cached.compiled )
+	    query_r->_attrMatchList = *cached.compiled;
+	  else
+	  {
+	    query_r->compile();
+	    if ( ! cacheKey_r.empty() )
+	      CompiledQueryCache::instance().storeCompiled( cacheKey_r, shared_ptr<const AttrMatchList>( new AttrMatchList( query_r->_attrMatchList ) ) );
+	  }
 
 	  // Repo restriction:
 	  sat::Pool satpool( sat::Pool::instance() );
@@ -1619,6 +1840,23 @@ namespace zypp
 	  _status_flags = query_r->_status_flags;
           // StrMatcher
           _attrMatchList = query_r->_attrMatchList;
+
+          if ( cached.result )
+          {
+            initCandidates( *cached.result );
+            return;
+          }
+          initCandidates();
+          if ( query_r->_parallel )
+            initParallel();
+          if ( cached.hits )
+          {
+            // executed again against the same pool: remember the result,
+            // if this iteration runs to the end.
+            _record = true;
+            _cacheKey = cacheKey_r;
+            _poolSerial = poolSerial;
+          }
 	}
 
 	~PoolQueryMatcher()
@@ -1655,6 +1893,241 @@ namespace zypp
 	  return q.begin();
 	}
 
+	/** Initialize a base query visiting the solvables of \a repo_r only. */
+	base_iterator startNewQyery( Repository repo_r ) const
+	{
+	  sat::LookupAttr q( sat::SolvAttr::allAttr, repo_r );
+	  if ( _attrMatchList.size() == 1 )
+	  {
+            const AttrMatchData & matchData( _attrMatchList.front() );
+	    q.setAttr( matchData.attr );
+            if ( matchData.strMatcher )
+              q.setStrMatcher( matchData.strMatcher );
+	  }
+	  return q.begin();
+	}
+
+	/** Initialize a base query visiting the attributes of \a solv_r only. */
+	base_iterator startNewQyery( sat::Solvable solv_r ) const
+	{
+	  if ( _attrMatchList.size() == 1 )
+	  {
+            const AttrMatchData & matchData( _attrMatchList.front() );
+	    sat::LookupAttr q( matchData.attr, solv_r );
+            if ( matchData.strMatcher )
+              q.setStrMatcher( matchData.strMatcher );
+	    return q.begin();
+	  }
+	  return sat::LookupAttr( sat::SolvAttr::allAttr, solv_r ).begin();
+	}
+
+	/** Preselect the candidates using the \ref sat::SearchIndex.
+	 *
+	 * Possible if all attributes to match are indexed and each search
+	 * string provides some trigrams to look up. Worth it if it rules
+	 * out most of the solvables to search.
+	 */
+	void initCandidates()
+	{
+	  if ( _neverMatchRepo || _attrMatchList.empty() || ! sat::SearchIndex::enabled() )
+	    return;
+
+	  std::vector<sat::SearchIndex::Signature> sigs;
+	  for ( const AttrMatchData & matchData : _attrMatchList )
+	  {
+	    sat::SearchIndex::Signature sig;
+	    if ( ! sat::SearchIndex::indexed( matchData.attr ) || ! sat::SearchIndex::querySignature( matchData.strMatcher, sig ) )
+	      return;
+	    sigs.push_back( sig );
+	  }
+
+	  shared_ptr<Candidates> candidates( new Candidates );
+	  size_t searched = 0;
+	  size_t found = 0;
+	  for ( const Repository & repo : sat::Pool::instance().repos() )
+	  {
+	    if ( ! _repos.empty() && _repos.find( repo ) == _repos.end() )
+	      continue;
+	    if ( _status_flags && ( (_status_flags == PoolQuery::INSTALLED_ONLY) != repo.isSystemRepo() ) )
+	      continue;
+
+	    std::vector<sat::detail::SolvableIdType> ids;
+	    sat::SearchIndex::get( repo )->candidates( repo, sigs, ids );
+	    searched += repo.solvablesSize();
+	    found += ids.size();
+	    if ( ! ids.empty() )
+	      candidates->push_back( std::make_pair( repo, std::move(ids) ) );
+	  }
+
+	  if ( found * 2 > searched )
+	    return;	// a plain query is faster
+	  DBG << "Search index: " << found << " of " << searched << " solvables to search" << endl;
+	  _candidates = candidates;
+	}
+
+	/** Search the repos in parallel and remember the matches as \ref _candidates.
+	 *
+	 * The repos (or the candidates the search index preselected in
+	 * them) are searched on a \ref WorkerPool. Libsolv lookups are
+	 * read-only, if nothing is stringified in the pools temporary
+	 * space (\ref isParallelAttribute) and no data are paged in on
+	 * demand. The matching solvables are ordered by id. Iterating
+	 * them matches them once more, to provide the \ref matchDetail.
+	 */
+	void initParallel()
+	{
+	  if ( _neverMatchRepo || _attrMatchList.empty() )
+	    return;
+	  for ( const AttrMatchData & matchData : _attrMatchList )
+	  {
+	    if ( matchData.predicate || ! isParallelAttribute( matchData.attr )
+	      || ( matchData.attr == sat::SolvAttr::filelist && matchData.strMatcher.flags().test( Match::FILES ) ) )
+	    {
+	      DBG << "Can't search in parallel: " << matchData << endl;
+	      return;
+	    }
+	  }
+
+	  Candidates jobs;
+	  if ( _candidates )
+	    jobs = *_candidates;
+	  else
+	  {
+	    for ( const Repository & repo : sat::Pool::instance().repos() )
+	    {
+	      if ( ! _repos.empty() && _repos.find( repo ) == _repos.end() )
+		continue;
+	      if ( _status_flags && ( (_status_flags == PoolQuery::INSTALLED_ONLY) != repo.isSystemRepo() ) )
+		continue;
+	      if ( ! repo.solvablesEmpty() )
+		jobs.push_back( std::make_pair( repo, std::vector<sat::detail::SolvableIdType>() ) );
+	    }
+	  }
+	  if ( jobs.size() < 2 )
+	    return;
+
+	  // Libsolv can't turn paging on again: the repodata stay in memory
+	  // until the repo is freed (documented in PoolQuery::setParallel).
+	  for ( const auto & job : jobs )
+	  {
+	    sat::detail::CRepo * repo = job.first.get();
+	    for ( int id = 1; id < repo->nrepodata; ++id )
+	      ::repodata_disable_paging( ::repo_id2repodata( repo, id ) );
+	  }
+
+	  std::vector<std::vector<sat::detail::SolvableIdType>> found( jobs.size() );
+	  std::vector<char> failed( jobs.size(), false );
+	  {
+	    WorkerPool workers;
+	    for ( unsigned i = 0; i < jobs.size(); ++i )
+	    {
+	      workers.add( [&,i]() {
+		try
+		{
+		  const auto & job( jobs[i] );
+		  if ( job.second.empty() )
+		    collectMatches( startNewQyery( job.first ), found[i] );
+		  else
+		  {
+		    for ( sat::detail::SolvableIdType id : job.second )
+		      collectMatches( startNewQyery( sat::Solvable( id ) ), found[i] );
+		  }
+		}
+		catch ( ... )
+		{ failed[i] = true; }
+	      } );
+	    }
+	  }
+	  if ( std::find( failed.begin(), failed.end(), true ) != failed.end() )
+	  {
+	    WAR << "Parallel search failed, search sequential." << endl;
+	    return;
+	  }
+
+	  shared_ptr<Candidates> candidates( new Candidates );
+	  size_t cnt = 0;
+	  for ( unsigned i = 0; i < jobs.size(); ++i )
+	  {
+	    if ( found[i].empty() )
+	      continue;
+	    cnt += found[i].size();
+	    candidates->push_back( std::make_pair( jobs[i].first, std::move(found[i]) ) );
+	  }
+	  std::sort( candidates->begin(), candidates->end(),
+		     []( const Candidates::value_type & lhs, const Candidates::value_type & rhs )
+		     { return lhs.second.front() < rhs.second.front(); } );
+	  DBG << "Parallel search in " << jobs.size() << " repos: " << cnt << " matches" << endl;
+	  _candidates = candidates;
+	}
+
+	/** The matching solvables as \ref _candidates.
+	 * Listed per repo in pool order, like a plain query finds them.
+	 */
+	void initCandidates( const sat::Map & result_r )
+	{
+	  shared_ptr<Candidates> candidates( new Candidates );
+	  for ( const Repository & repo : sat::Pool::instance().repos() )
+	  {
+	    std::vector<sat::detail::SolvableIdType> ids;
+	    for ( const sat::Solvable & solv : repo.solvables() )
+	    {
+	      if ( solv.id() < result_r.size() && result_r.test( solv.id() ) )
+		ids.push_back( solv.id() );
+	    }
+	    if ( ! ids.empty() )
+	      candidates->push_back( std::make_pair( repo, std::move(ids) ) );
+	  }
+	  _candidates = candidates;
+	}
+
+	/** Append the solvables \a base_r finds matches in to \a ret_r. */
+	void collectMatches( base_iterator base_r, std::vector<sat::detail::SolvableIdType> & ret_r ) const
+	{
+	  while ( base_r != end() )
+	  {
+	    if ( isAMatch( base_r ) )
+	    {
+	      ret_r.push_back( base_r.inSolvable().id() );
+	      base_r.nextSkipSolvable();
+	    }
+	    ++base_r;
+	  }
+	}
+
+	/** \ref advance visiting the preselected \ref _candidates only. */
+	bool advanceCandidates( base_iterator & base_r ) const
+	{
+	  // Where to continue:
+	  sat::Solvable current;
+	  if ( base_r != end() )
+	    current = base_r.inSolvable();
+	  Candidates::const_iterator block( _candidates->begin() );
+	  if ( current )
+	  {
+	    while ( block != _candidates->end() && block->first != current.repository() )
+	      ++block;
+	  }
+
+	  for ( ; block != _candidates->end(); ++block )
+	  {
+	    auto next( block->second.begin() );
+	    if ( current && block->first == current.repository() )
+	      next = std::upper_bound( block->second.begin(), block->second.end(), current.id() );
+	    for ( ; next != block->second.end(); ++next )
+	    {
+	      base_r = startNewQyery( sat::Solvable( *next ) );
+	      while ( base_r != end() )
+	      {
+	        if ( isAMatch( base_r ) )
+	          return true;
+	        // No match: try next
+	        ++base_r;
+	      }
+	    }
+	  }
+	  base_r = end();
+	  return false;
+	}
 
 	/** Check whether we are on a match.
 	 *
@@ -1773,6 +2246,16 @@ namespace zypp
         int _status_flags;
         /** StrMatcher per attribtue. */
         AttrMatchList _attrMatchList;
+        /** The solvables per repo to visit, if preselected by the \ref sat::SearchIndex or \ref initParallel. */
+        typedef std::vector<std::pair<Repository, std::vector<sat::detail::SolvableIdType>>> Candidates;
+        shared_ptr<const Candidates> _candidates;
+        /** Record the result for the \ref CompiledQueryCache. */
+        mutable bool _record = false;
+        std::string _cacheKey;
+        unsigned _poolSerial = 0;
+        /** The matches the leading iterator found so far, up to \ref _recordedLast. */
+        mutable shared_ptr<sat::Map> _recorded;
+        mutable sat::Solvable _recordedLast;
     };
     ///////////////////////////////////////////////////////////////////
 
@@ -1825,7 +2308,10 @@ namespace zypp
 
   detail::PoolQueryIterator PoolQuery::begin() const
   {
-    return shared_ptr<detail::PoolQueryMatcher>( new detail::PoolQueryMatcher( _pimpl.getPtr() ) );
+    std::string key;
+    if ( CompiledQueryCache::enabled() )
+      key = cacheKey( *this, *_pimpl );
+    return shared_ptr<detail::PoolQueryMatcher>( new detail::PoolQueryMatcher( _pimpl.getPtr(), key ) );
   }
 
   /////////////////////////////////////////////////////////////////
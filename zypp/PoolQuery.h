@@ -376,6 +376,25 @@ namespace zypp
     //void setLocale(const Locale & locale);
     //@}
 
+    /**
+     * Search the repositories in parallel (default off).
+     *
+     * Worth it for queries looking at bulky attributes like file lists
+     * or descriptions in many repos. The result is the same, but ordered
+     * by solvable id. Queries matching dependencies, full file paths or
+     * all attributes silently run sequentially.
+     *
+     * \note The threads must not page in data on demand. So the data of
+     * the searched repos (incl. file lists and descriptions not needed
+     * otherwise) are loaded into memory and stay there until the repo is
+     * removed from the pool. Don't use it for a single query in a memory
+     * tight environment.
+     *
+     * \note This is not part of the query itself, i.e. it is neither
+     * serialized nor compared.
+     */
+    void setParallel( bool value = true );
+
     /** \name getters */
     //@{
 
@@ -419,6 +438,9 @@ namespace zypp
     { return flags().mode(); }
 
     StatusFilter statusFilterFlags() const;
+
+    /** Whether to search the repositories in parallel. */
+    bool parallel() const;
     //@}
 
     /**
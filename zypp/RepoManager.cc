@@ -10,12 +10,15 @@
  *
 */
 
+#include <fcntl.h>
+#include <unistd.h>
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <list>
 #include <map>
+#include <set>
 #include <algorithm>
 
 #include <solv/solvversion.h>
@@ -26,6 +29,7 @@
 #include <zypp/base/DefaultIntegral.h>
 #include <zypp/base/Function.h>
 #include <zypp/base/Regex.h>
+#include <zypp/base/WorkerPool_p.h>
 #include <zypp/PathInfo.h>
 #include <zypp/TmpPath.h>
 
@@ -45,6 +49,8 @@
 #include <zypp/repo/yum/Downloader.h>
 #include <zypp/repo/susetags/Downloader.h>
 #include <zypp/repo/PluginServices.h>
+#include <zypp/repo/SolvBuilder_p.h>
+#include <zypp/repo/PackageContentStore_p.h>
 
 #include <zypp/Target.h> // for Target::targetDistribution() for repo index services
 #include <zypp/ZYppFactory.h> // to get the Target from ZYpp instance
@@ -52,7 +58,12 @@
 
 #include <zypp/ZYppCallbacks.h>
 
+#include <zypp/zyppng/base/EventDispatcher>
+#include <zypp/zyppng/media/network/downloader.h>
+#include <zypp/zyppng/media/network/networkrequestdispatcher.h>
+
 #include "sat/Pool.h"
+#include <zypp/sat/SearchIndex_p.h>
 
 using std::endl;
 using std::string;
@@ -73,6 +84,13 @@ namespace zypp
       const char * env = getenv("ZYPP_PLUGIN_APPDATA_FORCE_COLLECT");
       return( env && str::strToBool( env, true ) );
     }
+
+    /** To build the solv files using the external repo2solv (in-process otherwise) */
+    inline bool ZYPP_USE_REPO2SOLV()
+    {
+      const char * env = getenv("ZYPP_USE_REPO2SOLV");
+      return( env && str::strToBool( env, true ) );
+    }
   } // namespace env
   ///////////////////////////////////////////////////////////////////
 
@@ -149,6 +167,17 @@ namespace zypp
   ///////////////////////////////////////////////////////////////////
   namespace
   {
+    /** Let the kernel read \a file_r into the page cache in the background. */
+    inline void prefetchFile( const Pathname & file_r )
+    {
+      int fd = ::open( file_r.c_str(), O_RDONLY|O_CLOEXEC );
+      if ( fd != -1 )
+      {
+        ::posix_fadvise( fd, 0, 0, POSIX_FADV_WILLNEED );
+        ::close( fd );
+      }
+    }
+
     /** Simple media mounter to access non-downloading URLs e.g. for non-local plaindir repos.
      * \ingroup g_RAII
      */
@@ -454,6 +483,236 @@ namespace zypp
   } // namespace
   ///////////////////////////////////////////////////////////////////
 
+  ///////////////////////////////////////////////////////////////////
+  namespace
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class RemoteRepoStatusProbe
+    /// \brief Retrieve the remote \ref RepoStatus of many rpm-md repos concurrently.
+    ///
+    /// Downloads the master index (and the optional \c /media.1/media file)
+    /// of all added repos in parallel, driving a \ref zyppng::Downloader on
+    /// the threads event loop. The number of parallel transfers is limited by
+    /// \ref ZConfig::download_max_concurrent_connections.
+    ///
+    /// The computed status is the same as \ref yum::Downloader::status would
+    /// return. Failed transfers are not reported, the \ref status of such a
+    /// repo is simply empty and it must be checked the conventional way.
+    ///
+    /// The files in the repos raw cache are passed as delta files, so the
+    /// transfers are conditional and an unchanged file is not downloaded
+    /// again (\ref media::TransferValidators).
+    ///
+    /// For the repos found to have changed, the metadata files listed in
+    /// the retrieved master index can be downloaded concurrently as well
+    /// (\ref prefetch).
+    ///////////////////////////////////////////////////////////////////
+    class RemoteRepoStatusProbe
+    {
+    public:
+      /** Whether the status of \a info_r at \a url_r can be retrieved here. */
+      static bool canProbe( const RepoInfo & info_r, const Url & url_r )
+      {
+	if ( info_r.type() != RepoType::RPMMD )
+	  return false;	// type must be known; probing the type requires the media stack
+	const std::string & scheme( url_r.getScheme() );
+	return( ( scheme == "http" || scheme == "https" || scheme == "ftp" )
+	        && zyppng::NetworkRequestDispatcher::supportsProtocol( url_r ) );
+      }
+
+    public:
+      RemoteRepoStatusProbe()
+      : _tmpdir( filesystem::TmpDir::defaultLocation(), "zypp-refresh." )
+      {}
+
+      bool empty() const
+      { return _jobs.empty(); }
+
+      size_t size() const
+      { return _jobs.size(); }
+
+      /** Add \a info_r to probe at \a url_r; \a rawcache_r is its raw metadata cache. */
+      void add( const RepoInfo & info_r, const Url & url_r, const Pathname & rawcache_r )
+      { _jobs.push_back( Job{ info_r, url_r, rawcache_r, nullptr, nullptr, RepoStatus() } ); }
+
+      /** Download all master indices; blocks until all transfers are done. */
+      void run()
+      {
+	transfer( [this]( const StartFnc & startDownload ) {
+	  for ( unsigned idx = 0; idx < _jobs.size(); ++idx )
+	  {
+	    Job & job { _jobs[idx] };
+	    Pathname dir { _tmpdir.path() / str::numstring( idx ) };
+	    filesystem::assert_dir( dir );
+	    job._repomd = startDownload( job._url, job._info.path() / "/repodata/repomd.xml", dir/"repomd.xml", job._rawcache / job._info.path() / "repodata/repomd.xml" );
+	    job._media  = startDownload( job._url, "/media.1/media", dir/"media", job._rawcache / "media.1/media" );
+	  }
+	},
+	[this]() {
+	  for ( Job & job : _jobs )
+	  {
+	    job._status = evaluate( job );
+	    job._repomd.reset();
+	    job._media.reset();
+	  }
+	} );
+      }
+
+      /** Download the metadata files of the repos in \a aliases_r, as listed
+       * in the master index retrieved by \ref run; blocks until all transfers
+       * are done.
+       *
+       * The files are not verified here. The conventional refresh takes them
+       * from \ref prefetched only if the checksum in the (signed) master index
+       * matches (\ref repo::Downloader::addCachePath). Zchunk files are left to
+       * the conventional refresh, which downloads just the changed chunks.
+       */
+      void prefetch( const std::set<std::string> & aliases_r )
+      {
+	std::vector<std::shared_ptr<zyppng::Download>> downloads;
+	transfer( [&]( const StartFnc & startDownload ) {
+	  for ( unsigned idx = 0; idx < _jobs.size(); ++idx )
+	  {
+	    Job & job { _jobs[idx] };
+	    if ( job._status.empty() || ! aliases_r.count( job._info.alias() ) )
+	      continue;
+	    Pathname dir { _tmpdir.path() / str::numstring( idx ) };
+	    std::list<OnMediaLocation> files;
+	    try
+	    {
+	      files = yum::Downloader::wantedFiles( job._info, dir/"repomd.xml" );
+	    }
+	    catch ( const Exception & e )
+	    {
+	      ZYPP_CAUGHT( e );
+	      continue;
+	    }
+	    for ( const OnMediaLocation & file : files )
+	    {
+	      if ( file.checksum().empty() || file.filename().extension() == ".zck" )
+		continue;
+	      Pathname target { dir / "prefetch" / file.filename() };
+	      filesystem::assert_dir( target.dirname() );
+	      downloads.push_back( startDownload( job._url, file.filename(), target, Pathname() ) );
+	    }
+	    job._prefetched = dir / "prefetch";
+	  }
+	  MIL << "Concurrently prefetching " << downloads.size() << " files..." << endl;
+	},
+	[&]() {
+	  downloads.clear();
+	} );
+      }
+
+      /** Where \ref prefetch stored the metadata files of \a info_r (empty if not). */
+      Pathname prefetched( const RepoInfo & info_r ) const
+      {
+	for ( const Job & job : _jobs )
+	{
+	  if ( job._info.alias() == info_r.alias() )
+	    return job._prefetched;
+	}
+	return Pathname();
+      }
+
+      /** The remote status of \a info_r, including \ref RepoStatus(const RepoInfo&).
+       * Empty if the status is not known for sure.
+       */
+      RepoStatus status( const RepoInfo & info_r ) const
+      {
+	for ( const Job & job : _jobs )
+	{
+	  if ( job._info.alias() == info_r.alias() )
+	    return job._status;
+	}
+	return RepoStatus();
+      }
+
+    private:
+      struct Job
+      {
+	RepoInfo _info;
+	Url _url;
+	Pathname _rawcache;
+	std::shared_ptr<zyppng::Download> _repomd;
+	std::shared_ptr<zyppng::Download> _media;
+	RepoStatus _status;
+	Pathname _prefetched;
+      };
+
+      /** Start the download of \a path_r below \a url_r to \a target_r, passing \a cached_r as delta file. */
+      typedef function<std::shared_ptr<zyppng::Download>( Url url_r, const Pathname & path_r, const Pathname & target_r, const Pathname & cached_r )> StartFnc;
+
+      /** Drive the downloads \a start_r starts on the threads event loop until all are done.
+       * \a done_r is called before the downloader and event loop go out of scope.
+       */
+      void transfer( const function<void( const StartFnc & )> & start_r, const function<void()> & done_r )
+      {
+	if ( _jobs.empty() )
+	  return;
+
+	zyppng::EventDispatcher::Ptr ev { zyppng::EventDispatcher::instance() };
+	if ( ! ev )
+	  ev = zyppng::EventDispatcher::createForThread();
+
+	zyppng::Downloader downloader;
+	downloader.requestDispatcher()->setMaximumConcurrentConnections( std::max( 1L, ZConfig::instance().download_max_concurrent_connections() ) );
+
+	unsigned pending = 0;
+	StartFnc startDownload = [&]( Url url_r, const Pathname & path_r, const Pathname & target_r, const Pathname & cached_r ) {
+	  url_r.setPathName( Pathname(url_r.getPathName()) / path_r );
+	  std::shared_ptr<zyppng::Download> dl { downloader.downloadFile( url_r, target_r ) };
+	  if ( PathInfo( cached_r ).isFile() )
+	    dl->setDeltaFile( cached_r );
+	  dl->setPriority( zyppng::NetworkRequest::High );	// metadata: never a background download
+	  dl->sigFinished().connect( [&]( zyppng::Download & ) {
+	    if ( --pending == 0 )
+	      ev->quit();
+	  });
+	  ++pending;
+	  dl->start();
+	  return dl;
+	};
+	start_r( startDownload );
+
+	// Transfers failing early may already be finished.
+	if ( pending )
+	  ev->run();
+
+	// Evaluate the results before downloader and event loop go out of scope.
+	done_r();
+      }
+
+      static RepoStatus evaluate( const Job & job )
+      {
+	if ( ! job._repomd || job._repomd->state() != zyppng::Download::Success )
+	{
+	  DBG << "Concurrent check failed for " << job._info.alias() << ": " << ( job._repomd ? job._repomd->errorString() : "" ) << endl;
+	  return RepoStatus();
+	}
+
+	RepoStatus ret { job._repomd->targetPath() };
+	if ( ret.empty() )
+	  return ret;
+
+	// The optional media file must either exist or be definitely missing on the server.
+	if ( job._media->state() == zyppng::Download::Success )
+	  ret = ret && RepoStatus( job._media->targetPath() );
+	else if ( job._media->lastRequestError().type() != zyppng::NetworkRequestError::NotFound )
+	{
+	  DBG << "Concurrent check inconclusive for " << job._info.alias() << ": " << job._media->errorString() << endl;
+	  return RepoStatus();
+	}
+	return RepoStatus( job._info ) && ret;
+      }
+
+    private:
+      std::vector<Job> _jobs;
+      filesystem::TmpDir _tmpdir;
+    };
+  } // namespace
+  ///////////////////////////////////////////////////////////////////
+
   std::list<RepoInfo> readRepoFile( const Url & repo_file )
   {
     ManagedFile local = MediaSetAccess::provideFileFromUrl(repo_file);
@@ -597,7 +856,10 @@ namespace zypp
 
     RefreshCheckStatus checkIfToRefreshMetadata( const RepoInfo & info, const Url & url, RawMetadataRefreshPolicy policy );
 
-    void refreshMetadata( const RepoInfo & info, RawMetadataRefreshPolicy policy, OPT_PROGRESS );
+    /** \a prefetched: metadata files already downloaded for \a info (\see RemoteRepoStatusProbe::prefetch) */
+    void refreshMetadata( const RepoInfo & info, RawMetadataRefreshPolicy policy, OPT_PROGRESS, const Pathname & prefetched = Pathname() );
+
+    RefreshErrors refreshMetadata( const std::list<RepoInfo> & infos, RawMetadataRefreshPolicy policy, OPT_PROGRESS );
 
     void cleanMetadata( const RepoInfo & info, OPT_PROGRESS );
 
@@ -605,6 +867,8 @@ namespace zypp
 
     void buildCache( const RepoInfo & info, CacheBuildPolicy policy, OPT_PROGRESS );
 
+    RefreshErrors buildCache( const std::list<RepoInfo> & infos, CacheBuildPolicy policy, OPT_PROGRESS );
+
     repo::RepoType probe( const Url & url, const Pathname & path = Pathname() ) const;
     repo::RepoType probeCache( const Pathname & path_r ) const;
 
@@ -685,6 +949,43 @@ namespace zypp
 
     void touchIndexFile( const RepoInfo & info );
 
+    /** The part of \ref checkIfToRefreshMetadata not requiring to contact the server.
+     * Returns \c true and sets \a result_r if the decision was made; \a oldstatus_r
+     * is set to the cached metadata status.
+     */
+    bool checkIfToRefreshMetadataLocally( const RepoInfo & info, const Url & url, RawMetadataRefreshPolicy policy,
+					  RepoStatus & oldstatus_r, RefreshCheckStatus & result_r );
+
+    /** Compare cached and remote status, touching the index file if the repo is up to date. */
+    RefreshCheckStatus compareRemoteStatus( const RepoInfo & info, const RepoStatus & oldstatus, const RepoStatus & newstatus );
+
+    /** The data needed to build a repos solv file. */
+    struct CacheJob
+    {
+      RepoInfo _info;
+      RepoStatus _rawMetadataStatus;
+      repo::RepoType _repokind;
+      Pathname _productdatapath;
+      Pathname _solvfile;
+      repo::SolvBuilder _builder;	///< if valid, build in-process
+      std::string _error;		///< in-process build result
+    };
+
+    /** The part of \ref buildCache deciding whether the cache needs to be built.
+     * Returns \c true and sets \a raw_metadata_status_r if so.
+     */
+    bool checkIfToBuildCache( const RepoInfo & info, CacheBuildPolicy policy, const ProgressData::ReceiverFnc & progressrcv,
+			      RepoStatus & raw_metadata_status_r );
+
+    /** Clean the old cache and set up the \ref CacheJob. */
+    CacheJob prepareCacheJob( const RepoInfo & info, const RepoStatus & raw_metadata_status );
+
+    /** Build the solv file using the external \c repo2solv. */
+    void repo2solv( const CacheJob & job );
+
+    /** Check the result of an in-process build and store the cache status. */
+    void finishCacheJob( const CacheJob & job );
+
     template<typename OutputIterator>
     void getRepositoriesInService( const std::string & alias, OutputIterator out ) const
     {
@@ -707,6 +1008,7 @@ namespace zypp
     ServiceSet		_services;
 
     DefaultIntegral<bool,false> _reposDirty;
+    DefaultIntegral<bool,false> _solvPrefetched;	///< solv files of enabled repos were prefetched
 
   private:
     friend Impl * rwcowClone<Impl>( const Impl * rhs );
@@ -823,6 +1125,8 @@ namespace zypp
 	{
 	  if ( old == Repository::systemRepoAlias() )	// don't remove the @System solv file
 	    continue;
+	  if ( old == repo::PackageContentStore::dirName() )	// garbage collected by cleanCacheDirGarbage
+	    continue;
 	  pi( cachePath_r/old );
 	  if ( pi.isDir() )
 	    filesystem::recursive_rmdir( pi.path() );
@@ -980,74 +1284,106 @@ namespace zypp
   }
 
 
-  RepoManager::RefreshCheckStatus RepoManager::Impl::checkIfToRefreshMetadata( const RepoInfo & info, const Url & url, RawMetadataRefreshPolicy policy )
+  bool RepoManager::Impl::checkIfToRefreshMetadataLocally( const RepoInfo & info, const Url & url, RawMetadataRefreshPolicy policy,
+								  RepoStatus & oldstatus_r, RefreshCheckStatus & result_r )
   {
-    assert_alias(info);
-    try
-    {
-      MIL << "Check if to refresh repo " << info.alias() << " at " << url << " (" << info.type() << ")" << endl;
+    // first check old (cached) metadata
+    Pathname mediarootpath = rawcache_path_for_repoinfo( _options, info );
+    filesystem::assert_dir( mediarootpath );
+    RepoStatus & oldstatus( oldstatus_r );
+    oldstatus = metadataStatus( info );
 
-      // first check old (cached) metadata
-      Pathname mediarootpath = rawcache_path_for_repoinfo( _options, info );
-      filesystem::assert_dir( mediarootpath );
-      RepoStatus oldstatus = metadataStatus( info );
+    if ( oldstatus.empty() )
+    {
+      MIL << "No cached metadata, going to refresh" << endl;
+      result_r = REFRESH_NEEDED;
+      return true;
+    }
 
-      if ( oldstatus.empty() )
-      {
-        MIL << "No cached metadata, going to refresh" << endl;
-        return REFRESH_NEEDED;
-      }
+    if ( url.schemeIsVolatile() )
+    {
+      MIL << "Never refresh CD/DVD" << endl;
+      result_r = REPO_UP_TO_DATE;
+      return true;
+    }
 
-      if ( url.schemeIsVolatile() )
-      {
-	MIL << "Never refresh CD/DVD" << endl;
-	return REPO_UP_TO_DATE;
-      }
+    if ( policy == RefreshForced )
+    {
+      MIL << "Forced refresh!" << endl;
+      result_r = REFRESH_NEEDED;
+      return true;
+    }
 
-      if ( policy == RefreshForced )
-      {
-	MIL << "Forced refresh!" << endl;
-	return REFRESH_NEEDED;
-      }
+    if ( url.schemeIsLocal() )
+    {
+      policy = RefreshIfNeededIgnoreDelay;
+    }
 
-      if ( url.schemeIsLocal() )
-      {
-	policy = RefreshIfNeededIgnoreDelay;
-      }
+    // Check whether repo.refresh.delay applies...
+    if ( policy != RefreshIfNeededIgnoreDelay )
+    {
+      // bsc#1174016: Prerequisite to skipping the refresh is that metadata
+      // and solv cache status match. They will not, if the repos URL was
+      // changed e.g. due to changed repovars.
+      RepoStatus cachestatus = cacheStatus( info );
 
-      // Check whether repo.refresh.delay applies...
-      if ( policy != RefreshIfNeededIgnoreDelay )
+      if ( oldstatus == cachestatus )
       {
-	// bsc#1174016: Prerequisite to skipping the refresh is that metadata
-	// and solv cache status match. They will not, if the repos URL was
-	// changed e.g. due to changed repovars.
-	RepoStatus cachestatus = cacheStatus( info );
-
-	if ( oldstatus == cachestatus )
+	// difference in seconds
+	double diff = ::difftime( (Date::ValueType)Date::now(), (Date::ValueType)oldstatus.timestamp() ) / 60;
+	if ( diff < ZConfig::instance().repo_refresh_delay() )
 	{
-	  // difference in seconds
-	  double diff = ::difftime( (Date::ValueType)Date::now(), (Date::ValueType)oldstatus.timestamp() ) / 60;
-	  if ( diff < ZConfig::instance().repo_refresh_delay() )
+	  if ( diff < 0 )
 	  {
-	    if ( diff < 0 )
-	    {
-	      WAR << "Repository '" << info.alias() << "' was refreshed in the future!" << endl;
-	    }
-	    else
-	    {
-	      MIL << "Repository '" << info.alias()
-	      << "' has been refreshed less than repo.refresh.delay ("
-	      << ZConfig::instance().repo_refresh_delay()
-	      << ") minutes ago. Advising to skip refresh" << endl;
-	      return REPO_CHECK_DELAYED;
-	    }
+	    WAR << "Repository '" << info.alias() << "' was refreshed in the future!" << endl;
+	  }
+	  else
+	  {
+	    MIL << "Repository '" << info.alias()
+	    << "' has been refreshed less than repo.refresh.delay ("
+	    << ZConfig::instance().repo_refresh_delay()
+	    << ") minutes ago. Advising to skip refresh" << endl;
+	    result_r = REPO_CHECK_DELAYED;
+	    return true;
 	  }
 	}
-	else {
-	  MIL << "Metadata and solv cache don't match. Check data on server..." << endl;
-	}
       }
+      else {
+	MIL << "Metadata and solv cache don't match. Check data on server..." << endl;
+      }
+    }
+    return false;	// need to check the data on the server
+  }
 
+  RepoManager::RefreshCheckStatus RepoManager::Impl::compareRemoteStatus( const RepoInfo & info, const RepoStatus & oldstatus, const RepoStatus & newstatus )
+  {
+    // check status
+    if ( oldstatus == newstatus )
+    {
+      MIL << "repo has not changed" << endl;
+      touchIndexFile( info );
+      return REPO_UP_TO_DATE;
+    }
+    else // includes newstatus.empty() if e.g. repo format changed
+    {
+      MIL << "repo has changed, going to refresh" << endl;
+      return REFRESH_NEEDED;
+    }
+  }
+
+  RepoManager::RefreshCheckStatus RepoManager::Impl::checkIfToRefreshMetadata( const RepoInfo & info, const Url & url, RawMetadataRefreshPolicy policy )
+  {
+    assert_alias(info);
+    try
+    {
+      MIL << "Check if to refresh repo " << info.alias() << " at " << url << " (" << info.type() << ")" << endl;
+
+      RepoStatus oldstatus;
+      RefreshCheckStatus ret;
+      if ( checkIfToRefreshMetadataLocally( info, url, policy, oldstatus, ret ) )
+	return ret;
+
+      Pathname mediarootpath = rawcache_path_for_repoinfo( _options, info );
       repo::RepoType repokind = info.type();
       // if unknown: probe it
       if ( repokind == RepoType::NONE )
@@ -1081,18 +1417,7 @@ namespace zypp
 	  break;
       }
 
-      // check status
-      if ( oldstatus == newstatus )
-      {
-	MIL << "repo has not changed" << endl;
-	touchIndexFile( info );
-	return REPO_UP_TO_DATE;
-      }
-      else // includes newstatus.empty() if e.g. repo format changed
-      {
-	MIL << "repo has changed, going to refresh" << endl;
-	return REFRESH_NEEDED;
-      }
+      return compareRemoteStatus( info, oldstatus, newstatus );
     }
     catch ( const Exception &e )
     {
@@ -1105,7 +1430,7 @@ namespace zypp
   }
 
 
-  void RepoManager::Impl::refreshMetadata( const RepoInfo & info, RawMetadataRefreshPolicy policy, const ProgressData::ReceiverFnc & progress )
+  void RepoManager::Impl::refreshMetadata( const RepoInfo & info, RawMetadataRefreshPolicy policy, const ProgressData::ReceiverFnc & progress, const Pathname & prefetched )
   {
     assert_alias(info);
     assert_urls(info);
@@ -1200,6 +1525,8 @@ namespace zypp
             if ( PathInfo(cachepath).isExist() )
               downloader_ptr->addCachePath(cachepath);
           }
+          if ( ! prefetched.empty() )
+            downloader_ptr->addCachePath( prefetched );
 
           downloader_ptr->download( media, tmpdir.path() );
         }
@@ -1246,6 +1573,112 @@ namespace zypp
     ZYPP_THROW(rexception);
   }
 
+  RepoManager::RefreshErrors RepoManager::Impl::refreshMetadata( const std::list<RepoInfo> & infos, RawMetadataRefreshPolicy policy, const ProgressData::ReceiverFnc & progressrcv )
+  {
+    RefreshErrors errors;
+
+    ProgressData progress( infos.size() + 1 );	// +1 for the concurrent status check
+    progress.sendTo( progressrcv );
+    progress.toMin();
+
+    // Decide as much as possible locally and collect the repos whose remote
+    // status can be retrieved concurrently. Anything failing here is left to
+    // the conventional refresh below, which reports the error.
+    std::map<std::string,RepoStatus> oldstatus;
+    RemoteRepoStatusProbe probe;
+    for ( const RepoInfo & info : infos )
+    {
+      if ( info.baseUrlsEmpty() || ! RemoteRepoStatusProbe::canProbe( info, info.url() ) )
+	continue;
+      if ( policy == RefreshForced )
+      {
+	// just to prefetch the metadata files
+	probe.add( info, info.url(), rawcache_path_for_repoinfo( _options, info ) );
+	continue;
+      }
+      try
+      {
+	RepoStatus status;
+	RefreshCheckStatus ret;
+	if ( ! checkIfToRefreshMetadataLocally( info, info.url(), policy, status, ret ) )
+	{
+	  oldstatus[info.alias()] = status;
+	  probe.add( info, info.url(), rawcache_path_for_repoinfo( _options, info ) );
+	}
+      }
+      catch ( const Exception & e )
+      {
+	ZYPP_CAUGHT( e );
+      }
+    }
+    if ( ! probe.empty() )
+    {
+      MIL << "Concurrently checking " << probe.size() << " repos..." << endl;
+      probe.run();
+
+      // The changed repos are refreshed one by one below, but their metadata
+      // files are downloaded concurrently now.
+      std::set<std::string> changed;
+      for ( const RepoInfo & info : infos )
+      {
+	RepoStatus newstatus { probe.status( info ) };
+	if ( newstatus.empty() )
+	  continue;
+	auto it = oldstatus.find( info.alias() );
+	if ( policy == RefreshForced || ( it != oldstatus.end() && newstatus != it->second ) )
+	  changed.insert( info.alias() );
+      }
+      if ( ! changed.empty() )
+	probe.prefetch( changed );
+    }
+    progress.incr();
+
+    for ( const RepoInfo & info : infos )
+    {
+      progress.name( str::form( _("Retrieving repository '%s' metadata"), info.label().c_str() ) );
+      try
+      {
+	RawMetadataRefreshPolicy repopolicy = policy;
+
+	auto it = oldstatus.find( info.alias() );
+	if ( it != oldstatus.end() )
+	{
+	  RepoStatus newstatus { probe.status( info ) };
+	  if ( ! newstatus.empty() )
+	  {
+	    MIL << "Concurrent check of repo " << info.alias() << " at " << info.url() << endl;
+	    if ( compareRemoteStatus( info, it->second, newstatus ) == REPO_UP_TO_DATE )
+	    {
+	      progress.incr();
+	      continue;
+	    }
+	    repopolicy = RefreshForced;	// we already know it changed
+	  }
+	}
+
+	refreshMetadata( info, repopolicy, ProgressData::ReceiverFnc(), probe.prefetched( info ) );
+      }
+      catch ( const RepoException & e )
+      {
+	ZYPP_CAUGHT( e );
+	ERR << "Failed to refresh repo " << info.alias() << endl;
+	errors.insert( std::make_pair( info.alias(), e ) );
+      }
+      catch ( const Exception & e )
+      {
+	ZYPP_CAUGHT( e );
+	ERR << "Failed to refresh repo " << info.alias() << endl;
+	RepoException rexception( info, e.asUserString() );
+	rexception.remember( e );
+	errors.insert( std::make_pair( info.alias(), rexception ) );
+      }
+      progress.incr();
+    }
+
+    progress.toMax();
+    return errors;
+  }
+
   ////////////////////////////////////////////////////////////////////////////
 
   void RepoManager::Impl::cleanMetadata( const RepoInfo & info, const ProgressData::ReceiverFnc & progressfnc )
@@ -1263,16 +1696,15 @@ namespace zypp
     ProgressData progress(100);
     progress.sendTo(progressfnc);
 
-    filesystem::recursive_rmdir(packagescache_path_for_repoinfo(_options, info));
+    filesystem::recursive_rmdir(packagescache_path_for_repoinfo(_options, info), true/*parallel*/);
     progress.toMax();
   }
 
 
-  void RepoManager::Impl::buildCache( const RepoInfo & info, CacheBuildPolicy policy, const ProgressData::ReceiverFnc & progressrcv )
+  bool RepoManager::Impl::checkIfToBuildCache( const RepoInfo & info, CacheBuildPolicy policy, const ProgressData::ReceiverFnc & progressrcv,
+					       RepoStatus & raw_metadata_status_r )
   {
     assert_alias(info);
-    Pathname mediarootpath = rawcache_path_for_repoinfo( _options, info );
-    Pathname productdatapath = rawproductdata_path_for_repoinfo( _options, info );
 
     if( filesystem::assert_dir(_options.repoCachePath) )
     {
@@ -1288,8 +1720,8 @@ namespace zypp
       refreshMetadata(info, RefreshIfNeeded, progressrcv );
       raw_metadata_status = metadataStatus(info);
     }
+    raw_metadata_status_r = raw_metadata_status;
 
-    bool needs_cleaning = false;
     if ( isCached( info ) )
     {
       MIL << info.alias() << " is already cached." << endl;
@@ -1305,23 +1737,24 @@ namespace zypp
 	  if ( ! PathInfo(base/"solv.idx").isExist() )
 	    sat::updateSolvFileIndex( base/"solv" );
 
-	  return;
+	  return false;
         }
         else {
           MIL << info.alias() << " cache rebuild is forced" << endl;
         }
       }
-
-      needs_cleaning = true;
     }
+    return true;
+  }
 
-    ProgressData progress(100);
-    callback::SendReport<ProgressReport> report;
-    progress.sendTo( ProgressReportAdaptor( progressrcv, report ) );
-    progress.name(str::form(_("Building repository '%s' cache"), info.label().c_str()));
-    progress.toMin();
+  RepoManager::Impl::CacheJob RepoManager::Impl::prepareCacheJob( const RepoInfo & info, const RepoStatus & raw_metadata_status )
+  {
+    CacheJob job;
+    job._info = info;
+    job._rawMetadataStatus = raw_metadata_status;
+    job._productdatapath = rawproductdata_path_for_repoinfo( _options, info );
 
-    if (needs_cleaning)
+    if ( isCached( info ) )
     {
       cleanCache(info);
     }
@@ -1341,88 +1774,214 @@ namespace zypp
       Exception ex(str::form( _("Can't create cache at %s - no writing permissions."), base.c_str()) );
       ZYPP_THROW(ex);
     }
-    Pathname solvfile = base / "solv";
+    job._solvfile = base / "solv";
 
     // do we have type?
-    repo::RepoType repokind = info.type();
+    job._repokind = info.type();
 
     // if the type is unknown, try probing.
-    switch ( repokind.toEnum() )
+    switch ( job._repokind.toEnum() )
     {
       case RepoType::NONE_e:
         // unknown, probe the local metadata
-        repokind = probeCache( productdatapath );
+        job._repokind = probeCache( job._productdatapath );
       break;
       default:
       break;
     }
 
-    MIL << "repo type is " << repokind << endl;
+    MIL << "repo type is " << job._repokind << endl;
 
-    switch ( repokind.toEnum() )
+    switch ( job._repokind.toEnum() )
     {
       case RepoType::RPMMD_e :
       case RepoType::YAST2_e :
       case RepoType::RPMPLAINDIR_e :
-      {
-        // Take care we unlink the solvfile on exception
-        ManagedFile guard( solvfile, filesystem::unlink );
-        scoped_ptr<MediaMounter> forPlainDirs;
+        if ( ! env::ZYPP_USE_REPO2SOLV() )
+          job._builder = repo::SolvBuilder( job._repokind, job._productdatapath );
+        if ( job._builder.valid() )
+          DBG << job._builder << endl;
+      break;
+      default:
+        ZYPP_THROW(RepoUnknownTypeException( info, _("Unhandled repository type") ));
+      break;
+    }
+    return job;
+  }
 
-        ExternalProgram::Arguments cmd;
-        cmd.push_back( PathInfo( "/usr/bin/repo2solv" ).isFile() ? "repo2solv" : "repo2solv.sh" );
-        // repo2solv expects -o as 1st arg!
-        cmd.push_back( "-o" );
-        cmd.push_back( solvfile.asString() );
-	cmd.push_back( "-X" );	// autogenerate pattern from pattern-package
-        // bsc#1104415: no more application support // cmd.push_back( "-A" );	// autogenerate application pseudo packages
+  void RepoManager::Impl::repo2solv( const CacheJob & job )
+  {
+    // Take care we unlink the solvfile on exception
+    ManagedFile guard( job._solvfile, filesystem::unlink );
+    scoped_ptr<MediaMounter> forPlainDirs;
+
+    ExternalProgram::Arguments cmd;
+    cmd.push_back( PathInfo( "/usr/bin/repo2solv" ).isFile() ? "repo2solv" : "repo2solv.sh" );
+    // repo2solv expects -o as 1st arg!
+    cmd.push_back( "-o" );
+    cmd.push_back( job._solvfile.asString() );
+    cmd.push_back( "-X" );	// autogenerate pattern from pattern-package
+    // bsc#1104415: no more application support // cmd.push_back( "-A" );	// autogenerate application pseudo packages
+
+    if ( job._repokind == RepoType::RPMPLAINDIR )
+    {
+      forPlainDirs.reset( new MediaMounter( job._info.url() ) );
+      // recusive for plaindir as 2nd arg!
+      cmd.push_back( "-R" );
+      // FIXME this does only work form dir: URLs
+      cmd.push_back( forPlainDirs->getPathName( job._info.path() ).c_str() );
+    }
+    else
+      cmd.push_back( job._productdatapath.asString() );
 
-        if ( repokind == RepoType::RPMPLAINDIR )
-        {
-          forPlainDirs.reset( new MediaMounter( info.url() ) );
-          // recusive for plaindir as 2nd arg!
-          cmd.push_back( "-R" );
-          // FIXME this does only work form dir: URLs
-          cmd.push_back( forPlainDirs->getPathName( info.path() ).c_str() );
-        }
-        else
-          cmd.push_back( productdatapath.asString() );
+    ExternalProgram prog( cmd, ExternalProgram::Stderr_To_Stdout );
+    std::string errdetail;
 
-        ExternalProgram prog( cmd, ExternalProgram::Stderr_To_Stdout );
-        std::string errdetail;
+    for ( std::string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
+      WAR << "  " << output;
+      if ( errdetail.empty() ) {
+        errdetail = prog.command();
+        errdetail += '\n';
+      }
+      errdetail += output;
+    }
 
-        for ( std::string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
-          WAR << "  " << output;
-          if ( errdetail.empty() ) {
-            errdetail = prog.command();
-            errdetail += '\n';
-          }
-          errdetail += output;
-        }
+    int ret = prog.close();
+    if ( ret != 0 )
+    {
+      RepoException ex(str::form( _("Failed to cache repo (%d)."), ret ));
+      ex.remember( errdetail );
+      ZYPP_THROW(ex);
+    }
 
-        int ret = prog.close();
-        if ( ret != 0 )
-        {
-          RepoException ex(str::form( _("Failed to cache repo (%d)."), ret ));
-          ex.remember( errdetail );
-          ZYPP_THROW(ex);
-        }
+    // We keep it.
+    guard.resetDispose();
+  }
 
-        // We keep it.
-        guard.resetDispose();
-	sat::updateSolvFileIndex( solvfile );	// content digest for zypper bash completion
-      }
-      break;
-      default:
-        ZYPP_THROW(RepoUnknownTypeException( info, _("Unhandled repository type") ));
-      break;
+  void RepoManager::Impl::finishCacheJob( const CacheJob & job )
+  {
+    if ( ! job._error.empty() )
+    {
+      filesystem::unlink( job._solvfile );
+      RepoException ex( job._info, _("Failed to cache repo.") );
+      ex.remember( job._error );
+      ZYPP_THROW(ex);
     }
+
+    sat::updateSolvFileIndex( job._solvfile );	// content digest for zypper bash completion
+    if ( sat::SearchIndex::enabled() )
+      sat::SearchIndex::buildCacheFile( job._solvfile );	// trigrams for PoolQuery
     // update timestamp and checksum
-    setCacheStatus(info, raw_metadata_status);
+    setCacheStatus( job._info, job._rawMetadataStatus );
     MIL << "Commit cache.." << endl;
+  }
+
+  void RepoManager::Impl::buildCache( const RepoInfo & info, CacheBuildPolicy policy, const ProgressData::ReceiverFnc & progressrcv )
+  {
+    RepoStatus raw_metadata_status;
+    if ( ! checkIfToBuildCache( info, policy, progressrcv, raw_metadata_status ) )
+      return;
+
+    ProgressData progress(100);
+    callback::SendReport<ProgressReport> report;
+    progress.sendTo( ProgressReportAdaptor( progressrcv, report ) );
+    progress.name(str::form(_("Building repository '%s' cache"), info.label().c_str()));
+    progress.toMin();
+
+    CacheJob job { prepareCacheJob( info, raw_metadata_status ) };
+    if ( job._builder.valid() )
+      job._error = job._builder.build( job._solvfile );
+    else
+      repo2solv( job );
+    finishCacheJob( job );
+
     progress.toMax();
   }
 
+  RepoManager::RefreshErrors RepoManager::Impl::buildCache( const std::list<RepoInfo> & infos, CacheBuildPolicy policy, const ProgressData::ReceiverFnc & progressrcv )
+  {
+    RefreshErrors errors;
+    auto remember = [&errors]( const RepoInfo & info, const Exception & e ) {
+      ERR << "Failed to build cache for repo " << info.alias() << endl;
+      RepoException rexception( info, e.asUserString() );
+      rexception.remember( e );
+      errors.insert( std::make_pair( info.alias(), rexception ) );
+    };
+
+    ProgressData progress( infos.size() );
+    progress.sendTo( progressrcv );
+    progress.toMin();
+
+    // Prepare in order; solv files which can be built in-process are handed
+    // to the worker pool, repo2solv is run meanwhile.
+    std::list<CacheJob> jobs;
+    std::list<CacheJob*> repo2solvJobs;
+    std::set<const CacheJob*> failed;
+    WorkerPool pool;
+    for ( const RepoInfo & info : infos )
+    {
+      try
+      {
+	RepoStatus raw_metadata_status;
+	if ( ! checkIfToBuildCache( info, policy, ProgressData::ReceiverFnc(), raw_metadata_status ) )
+	{
+	  progress.incr();
+	  continue;
+	}
+	jobs.push_back( prepareCacheJob( info, raw_metadata_status ) );
+	CacheJob & job { jobs.back() };
+	if ( job._builder.valid() )
+	  pool.add( [&job](){ job._error = job._builder.build( job._solvfile ); } );
+	else
+	  repo2solvJobs.push_back( &job );
+      }
+      catch ( const Exception & e )
+      {
+	ZYPP_CAUGHT( e );
+	remember( info, e );
+	progress.incr();
+      }
+    }
+
+    for ( CacheJob * job : repo2solvJobs )
+    {
+      try
+      {
+	progress.name( str::form( _("Building repository '%s' cache"), job->_info.label().c_str() ) );
+	repo2solv( *job );
+      }
+      catch ( const Exception & e )
+      {
+	ZYPP_CAUGHT( e );
+	remember( job->_info, e );
+	failed.insert( job );
+      }
+    }
+    pool.wait();
+
+    for ( const CacheJob & job : jobs )
+    {
+      if ( failed.count( &job ) )
+      {
+	progress.incr();
+	continue;
+      }
+      try
+      {
+	finishCacheJob( job );
+      }
+      catch ( const Exception & e )
+      {
+	ZYPP_CAUGHT( e );
+	remember( job._info, e );
+      }
+      progress.incr();
+    }
+
+    progress.toMax();
+    return errors;
+  }
+
   ////////////////////////////////////////////////////////////////////////////
 
 
@@ -1572,6 +2131,10 @@ namespace zypp
             if ( subdir->basename() == r->escaped_alias() )
             { found = true; break; }
 
+          // the package content store is cleaned below
+          if ( subdir->basename() == repo::PackageContentStore::dirName() )
+            found = true;
+
           if ( ! found && ( Date::now()-PathInfo(*subdir).mtime() > Date::day ) )
             filesystem::recursive_rmdir( *subdir );
 
@@ -1582,6 +2145,9 @@ namespace zypp
       else
         progress.set( progress.val() + 100 );
     }
+
+    // drop the stored packages no repo cache uses anymore
+    repo::PackageContentStore( _options.repoPackagesCachePath ).gc();
     progress.toMax();
   }
 
@@ -1609,10 +2175,24 @@ namespace zypp
     if ( ! PathInfo(solvfile).isExist() )
       ZYPP_THROW(RepoNotCachedException(info));
 
+    if ( ! _solvPrefetched )
+    {
+      // Usually all enabled repos are loaded one after the other. Let the kernel
+      // read their solv files in the background while the first ones are parsed.
+      _solvPrefetched = true;
+      for ( const RepoInfo & repo : repos() )
+      {
+        if ( repo.enabled() && repo.alias() != info.alias() )
+          prefetchFile( solv_path_for_repoinfo( _options, repo ) / "solv" );
+      }
+    }
+
     sat::Pool::instance().reposErase( info.alias() );
     try
     {
+      sat::detail::SolvableIdType base = sat::Pool::instance().capacity();
       Repository repo = sat::Pool::instance().addRepoSolv( solvfile, info );
+      sat::SearchIndex::attach( repo, base, solvfile );
       // test toolversion in order to rebuild solv file in case
       // it was written by a different libsolv-tool parser.
       const std::string & toolversion( sat::LookupRepoAttr( sat::SolvAttr::repositoryToolVersion, repo ).begin().asString() );
@@ -1629,7 +2209,9 @@ namespace zypp
       cleanCache( info, progressrcv );
       buildCache( info, BuildIfNeeded, progressrcv );
 
-      sat::Pool::instance().addRepoSolv( solvfile, info );
+      sat::detail::SolvableIdType base = sat::Pool::instance().capacity();
+      Repository repo = sat::Pool::instance().addRepoSolv( solvfile, info );
+      sat::SearchIndex::attach( repo, base, solvfile );
     }
   }
 
@@ -2595,6 +3177,9 @@ namespace zypp
   void RepoManager::refreshMetadata( const RepoInfo &info, RawMetadataRefreshPolicy policy, const ProgressData::ReceiverFnc & progressrcv )
   { return _pimpl->refreshMetadata( info, policy, progressrcv ); }
 
+  RepoManager::RefreshErrors RepoManager::refreshMetadata( const std::list<RepoInfo> & infos, RawMetadataRefreshPolicy policy, const ProgressData::ReceiverFnc & progressrcv )
+  { return _pimpl->refreshMetadata( infos, policy, progressrcv ); }
+
   void RepoManager::cleanMetadata( const RepoInfo &info, const ProgressData::ReceiverFnc & progressrcv )
   { return _pimpl->cleanMetadata( info, progressrcv ); }
 
@@ -2607,6 +3192,9 @@ namespace zypp
   void RepoManager::buildCache( const RepoInfo &info, CacheBuildPolicy policy, const ProgressData::ReceiverFnc & progressrcv )
   { return _pimpl->buildCache( info, policy, progressrcv ); }
 
+  RepoManager::RefreshErrors RepoManager::buildCache( const std::list<RepoInfo> & infos, CacheBuildPolicy policy, const ProgressData::ReceiverFnc & progressrcv )
+  { return _pimpl->buildCache( infos, policy, progressrcv ); }
+
   void RepoManager::cleanCache( const RepoInfo &info, const ProgressData::ReceiverFnc & progressrcv )
   { return _pimpl->cleanCache( info, progressrcv ); }
 
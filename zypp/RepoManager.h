@@ -14,6 +14,7 @@
 
 #include <iosfwd>
 #include <list>
+#include <map>
 
 #include <zypp/base/PtrTypes.h>
 #include <zypp/base/Iterator.h>
@@ -120,6 +121,9 @@ namespace zypp
     typedef RepoSet::const_iterator RepoConstIterator;
     typedef RepoSet::size_type RepoSizeType;
 
+    /** Errors collected by the batch \ref refreshMetadata and \ref buildCache (alias -> exception) */
+    typedef std::map<std::string, repo::RepoException> RefreshErrors;
+
   public:
    RepoManager( const RepoManagerOptions &options = RepoManagerOptions() );
    /** Dtor */
@@ -301,6 +305,30 @@ namespace zypp
                          RawMetadataRefreshPolicy policy = RefreshIfNeeded,
                          const ProgressData::ReceiverFnc & progressrcv = ProgressData::ReceiverFnc() );
 
+   /**
+    * \short Refresh local raw cache of multiple repositories
+    *
+    * Same as calling \ref refreshMetadata for each repo in \a infos,
+    * but the remote status of all http/https/ftp based rpm-md repos is
+    * checked concurrently (at most \ref ZConfig::download_max_concurrent_connections
+    * parallel transfers). Repos found to be up to date are not contacted
+    * again. For the remaining ones (all of them if \ref RefreshForced) the
+    * metadata files listed in the master index are then downloaded
+    * concurrently as well. Checking the signature of the master index
+    * and storing the files in the raw cache is done one repo after the
+    * other, like \ref refreshMetadata does. The prefetched files are used
+    * only if their checksum matches the signed master index; otherwise
+    * they are downloaded again.
+    *
+    * A repo failing to refresh does not affect the others. The exceptions
+    * are collected and returned per alias. The progress is advanced per repo.
+    *
+    * \return The \ref RefreshErrors of all repos which failed to refresh.
+    */
+   RefreshErrors refreshMetadata( const std::list<RepoInfo> & infos,
+                                  RawMetadataRefreshPolicy policy = RefreshIfNeeded,
+                                  const ProgressData::ReceiverFnc & progressrcv = ProgressData::ReceiverFnc() );
+
    /**
     * \short Clean local metadata
     *
@@ -350,6 +378,26 @@ namespace zypp
                     CacheBuildPolicy policy = BuildIfNeeded,
                     const ProgressData::ReceiverFnc & progressrcv = ProgressData::ReceiverFnc() );
 
+   /**
+    * \short Build the cache of multiple repositories
+    *
+    * Same as calling \ref buildCache for each repo in \a infos, but
+    * the solv files of rpm-md repos are built in-process by a pool of
+    * worker threads, while the remaining ones are built by \c repo2solv
+    * meanwhile.
+    *
+    * A repo failing to build does not affect the others. The exceptions
+    * are collected and returned per alias. The progress is advanced per repo.
+    *
+    * \note Setting \c ZYPP_USE_REPO2SOLV=1 in the environment disables the
+    * in-process build and always uses \c repo2solv.
+    *
+    * \return The \ref RefreshErrors of all repos which failed to build.
+    */
+   RefreshErrors buildCache( const std::list<RepoInfo> & infos,
+                             CacheBuildPolicy policy = BuildIfNeeded,
+                             const ProgressData::ReceiverFnc & progressrcv = ProgressData::ReceiverFnc() );
+
    /**
     * \short clean local cache
     *
@@ -9,8 +9,10 @@
 /** \file	zypp/sat/Repository.cc
  *
 */
+#include <fcntl.h>
 #include <climits>
 #include <iostream>
+#include <memory>
 
 #include <zypp/base/Logger.h>
 #include <zypp/base/Gettext.h>
@@ -321,6 +323,8 @@ namespace zypp
     {
       NO_REPOSITORY_THROW( Exception( "Can't add solvables to norepo." ) );
 
+      static const size_t solvReadBufferSize = 256 * 1024;
+      std::unique_ptr<char[]> buffer( new char[solvReadBufferSize] );	// must outlive file
       AutoDispose<FILE*> file( ::fopen( file_r.c_str(), "re" ), ::fclose );
       if ( file == NULL )
       {
@@ -328,6 +332,14 @@ namespace zypp
         ZYPP_THROW( Exception( "Can't open solv-file: "+file_r.asString() ) );
       }
 
+      // libsolv parses the incore data sequentially and keeps the (paged) vertical
+      // attribute data in the file, reading it on demand via the fd. So hand it
+      // the file itself (not a copy in memory) and let the kernel read ahead into
+      // the page cache, which is shared by concurrent processes. A large buffer
+      // saves most of the read calls.
+      ::posix_fadvise( ::fileno( file ), 0, 0, POSIX_FADV_WILLNEED );
+      ::setvbuf( file, buffer.get(), _IOFBF, solvReadBufferSize );
+
       if ( myPool()._addSolv( _repo, file ) != 0 )
       {
         ZYPP_THROW( Exception( "Error reading solv-file: "+file_r.asString() ) );
@@ -62,6 +62,45 @@ namespace zypp
     }
   }
 
+  void ResStatus::resetTransactAll( ResStatus * begin_r, ResStatus * end_r,
+                                    TransactByValue causer_r, bool transactingOnly_r )
+  {
+    for ( ResStatus * it = begin_r; it != end_r; ++it )
+    {
+      FieldType val = it->_bitfield.value();
+      FieldType transact = val & TransactField::Mask::value;
+      bool eligible = ( (val & TransactByField::Mask::value) <= causer_r )
+                   && ( ! transactingOnly_r || transact == TRANSACT );
+      // Details are always reset; TRANSACT and KEEP_STATE become KEEP_STATE
+      // by SOLVER, LOCKED stays as it is.
+      FieldType clear = TransactDetailField::Mask::value
+                      | ( transact == LOCKED ? 0 : TransactField::Mask::value | TransactByField::Mask::value );
+      it->_bitfield = FieldType( eligible ? val & ~clear : val );
+    }
+  }
+
+  namespace
+  {
+    /** The number of statuses in the range whose bits in \a mask_r equal \a value_r. */
+    inline size_t countMasked( const ResStatus * begin_r, const ResStatus * end_r,
+                               ResStatus::FieldType mask_r, ResStatus::FieldType value_r )
+    {
+      size_t ret = 0;
+      for ( const ResStatus * it = begin_r; it != end_r; ++it )
+        ret += ( ( it->bitfield().value() & mask_r ) == value_r );
+      return ret;
+    }
+  }
+
+  size_t ResStatus::countToBeInstalled( const ResStatus * begin_r, const ResStatus * end_r )
+  { return countMasked( begin_r, end_r, StateField::Mask::value | TransactField::Mask::value, UNINSTALLED | TRANSACT ); }
+
+  size_t ResStatus::countToBeUninstalled( const ResStatus * begin_r, const ResStatus * end_r )
+  { return countMasked( begin_r, end_r, StateField::Mask::value | TransactField::Mask::value, INSTALLED | TRANSACT ); }
+
+  size_t ResStatus::countLocked( const ResStatus * begin_r, const ResStatus * end_r )
+  { return countMasked( begin_r, end_r, TransactField::Mask::value, LOCKED ); }
+
   namespace
   {
     // NOTE: Strings defined here are written to the history file
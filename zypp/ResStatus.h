@@ -657,6 +657,30 @@ namespace zypp
       return true;
     }
 
+    /** \name Bulk operations.
+     * Applied to a contiguous range of statuses at once (like the
+     * pools status store). Each status is computed from
+     * its bitfield without branching, so the compiler may process many
+     * of them in parallel.
+     */
+    //@{
+    /** Like \ref resetTransact( \a causer_r ) on all statuses in the range
+     * not set by a superior causer. If \a transactingOnly_r, just on the
+     * transacting ones.
+     */
+    static void resetTransactAll( ResStatus * begin_r, ResStatus * end_r,
+                                  TransactByValue causer_r, bool transactingOnly_r = false );
+
+    /** The number of statuses in the range which \ref isToBeInstalled. */
+    static size_t countToBeInstalled( const ResStatus * begin_r, const ResStatus * end_r );
+
+    /** The number of statuses in the range which \ref isToBeUninstalled. */
+    static size_t countToBeUninstalled( const ResStatus * begin_r, const ResStatus * end_r );
+
+    /** The number of statuses in the range which \ref isLocked. */
+    static size_t countLocked( const ResStatus * begin_r, const ResStatus * end_r );
+    //@}
+
     /** \name Builtin ResStatus constants. */
     //@{
     static const ResStatus toBeInstalled;
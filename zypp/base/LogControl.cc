@@ -12,6 +12,8 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <mutex>
+#include <thread>
 
 #include <zypp/base/Logger.h>
 #include <zypp/base/LogControl.h>
@@ -288,7 +290,10 @@ namespace zypp
 
         /** NULL _lineWriter indicates no loggin. */
         void setLineWriter( const shared_ptr<LogControl::LineWriter> & writer_r )
-        { _lineWriter = writer_r; }
+        {
+          std::lock_guard<std::mutex> lock( _writeMutex );
+          _lineWriter = writer_r;
+        }
 
         shared_ptr<LogControl::LineWriter> getLineWriter() const
         { return _lineWriter; }
@@ -296,6 +301,7 @@ namespace zypp
         /** Assert \a _lineFormater is not NULL. */
         void setLineFormater( const shared_ptr<LogControl::LineFormater> & format_r )
         {
+          std::lock_guard<std::mutex> lock( _writeMutex );
           if ( format_r )
             _lineFormater = format_r;
           else
@@ -319,6 +325,9 @@ namespace zypp
         shared_ptr<LogControl::LineFormater> _lineFormater;
         shared_ptr<LogControl::LineWriter>   _lineWriter;
 
+        /** Serialize writing loglines from multiple threads. */
+        std::mutex _writeMutex;
+
       public:
         /** Provide the log stream to write (logger interface) */
         std::ostream & getStream( const std::string & group_r,
@@ -332,11 +341,12 @@ namespace zypp
           if ( level_r == E_XXX && !_excessive )
             return _no_stream;
 
-          if ( !_streamtable[group_r][level_r] )
+          StreamPtr & stream( streamtable()[group_r][level_r] );
+          if ( !stream )
             {
-              _streamtable[group_r][level_r].reset( new Loglinestream( group_r, level_r ) );
+              stream.reset( new Loglinestream( group_r, level_r ) );
             }
-          std::ostream & ret( _streamtable[group_r][level_r]->getStream( file_r, func_r, line_r ) );
+          std::ostream & ret( stream->getStream( file_r, func_r, line_r ) );
 	  if ( !ret )
 	  {
 	    ret.clear();
@@ -353,6 +363,7 @@ namespace zypp
                         int                 line_r,
                         const std::string & message_r )
         {
+          std::lock_guard<std::mutex> lock( _writeMutex );
           if ( _lineWriter )
             _lineWriter->writeOut( _lineFormater->format( group_r, level_r,
                                                           file_r, func_r, line_r,
@@ -365,6 +376,22 @@ namespace zypp
         typedef std::map<std::string,StreamSet>  StreamTable;
         /** one streambuffer per group and level */
         StreamTable _streamtable;
+        /** The thread using \ref _streamtable. */
+        std::thread::id _streamtableThread;
+
+        /** The threads streambuffers.
+         * Loglines are assembled in the thread writing them and written
+         * out under \ref _writeMutex. The thread creating the singleton
+         * (usually main) uses \ref _streamtable, which must outlive all
+         * statics logging from their dtor. Others use a thread_local one.
+         */
+        StreamTable & streamtable()
+        {
+          if ( std::this_thread::get_id() == _streamtableThread )
+            return _streamtable;
+          static thread_local StreamTable _threadStreamtable;
+          return _threadStreamtable;
+        }
 
       private:
         /** Singleton ctor.
@@ -374,6 +401,7 @@ namespace zypp
         : _no_stream( NULL )
         , _excessive( getenv("ZYPP_FULLLOG") )
         , _lineFormater( new LogControl::LineFormater )
+        , _streamtableThread( std::this_thread::get_id() )
         {
           if ( getenv("ZYPP_LOGFILE") )
             logfile( getenv("ZYPP_LOGFILE") );
@@ -0,0 +1,81 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/base/WorkerPool.cc
+ */
+#include <algorithm>
+
+#include <zypp/base/WorkerPool_p.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  WorkerPool::WorkerPool( unsigned workers_r )
+  : _workers( workers_r ? workers_r : defaultWorkers() )
+  {}
+
+  WorkerPool::~WorkerPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _stop = true;
+    }
+    _jobAvailable.notify_all();
+    for ( std::thread & thread : _threads )
+      thread.join();
+  }
+
+  unsigned WorkerPool::defaultWorkers()
+  { return std::max( 1U, std::thread::hardware_concurrency() ); }
+
+  void WorkerPool::add( Job job_r )
+  {
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _jobs.push_back( std::move(job_r) );
+      if ( _threads.size() < _workers && _threads.size() < _jobs.size() + _busy )
+	_threads.push_back( std::thread( [this]() { work(); } ) );
+    }
+    _jobAvailable.notify_one();
+  }
+
+  void WorkerPool::wait()
+  {
+    std::unique_lock<std::mutex> lock( _mutex );
+    _allDone.wait( lock, [this]() { return _jobs.empty() && ! _busy; } );
+  }
+
+  void WorkerPool::work()
+  {
+    while ( true )
+    {
+      Job job;
+      {
+	std::unique_lock<std::mutex> lock( _mutex );
+	_jobAvailable.wait( lock, [this]() { return _stop || ! _jobs.empty(); } );
+	if ( _jobs.empty() )
+	  return;	// stopped and nothing left to do
+	job = std::move( _jobs.front() );
+	_jobs.pop_front();
+	++_busy;
+      }
+
+      try { job(); }
+      catch (...) {}	// the job is responsible for remembering its outcome
+
+      {
+	std::lock_guard<std::mutex> lock( _mutex );
+	--_busy;
+	if ( _jobs.empty() && ! _busy )
+	  _allDone.notify_all();
+      }
+    }
+  }
+
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
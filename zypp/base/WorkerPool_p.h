@@ -0,0 +1,96 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/base/WorkerPool_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_BASE_WORKERPOOL_P_H
+#define ZYPP_BASE_WORKERPOOL_P_H
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+#include <zypp/APIConfig.h>
+#include <zypp/base/NonCopyable.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  /// \class WorkerPool
+  /// \brief Execute independent jobs on a fixed number of threads.
+  ///
+  /// Jobs are started in the order they were added. Threads are created
+  /// on demand, up to the number of \ref workers. \ref wait blocks until
+  /// all queued jobs are done; so does the dtor.
+  ///
+  /// \note Jobs run outside the main thread and must not use anything
+  /// which is not thread safe, e.g. callbacks. The global \ref sat::Pool
+  /// must not be changed while jobs run. Jobs may only read it, if the
+  /// lookups neither use the pools temporary string space nor page in
+  /// data on demand (\see PoolQuery::setParallel).
+  /// Exceptions escaping a job are silently dropped, so
+  /// a job should remember its outcome on its own.
+  ///
+  /// \code
+  ///   std::vector<std::string> errors( files.size() );
+  ///   WorkerPool workers;
+  ///   for ( unsigned i = 0; i < files.size(); ++i )
+  ///     workers.add( [&,i]() { errors[i] = convert( files[i] ); } );
+  ///   workers.wait();
+  /// \endcode
+  ///////////////////////////////////////////////////////////////////
+  class ZYPP_LOCAL WorkerPool : private base::NonCopyable
+  {
+  public:
+    typedef std::function<void()> Job;
+
+  public:
+    /** Ctor. If \a workers_r is \c 0, \ref defaultWorkers are used. */
+    explicit WorkerPool( unsigned workers_r = 0 );
+
+    /** Dtor waits for all queued jobs to complete. */
+    ~WorkerPool();
+
+    /** The number of workers used by default (number of CPUs). */
+    static unsigned defaultWorkers();
+
+  public:
+    /** The maximum number of threads. */
+    unsigned workers() const
+    { return _workers; }
+
+    /** Queue a job for execution. */
+    void add( Job job_r );
+
+    /** Block until all queued jobs are done. */
+    void wait();
+
+  private:
+    void work();
+
+  private:
+    const unsigned _workers;
+    std::vector<std::thread> _threads;
+    std::deque<Job> _jobs;
+    unsigned _busy = 0;
+    bool _stop = false;
+    std::mutex _mutex;
+    std::condition_variable _jobAvailable;
+    std::condition_variable _allDone;
+  };
+  ///////////////////////////////////////////////////////////////////
+
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_BASE_WORKERPOOL_P_H
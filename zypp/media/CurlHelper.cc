@@ -9,6 +9,7 @@
 #include <zypp/media/MediaUserAuth.h>
 #include <zypp/media/MediaException.h>
 #include <list>
+#include <mutex>
 
 using std::endl;
 using namespace zypp;
@@ -25,6 +26,108 @@ void globalInitCurlOnce()
   } (), true );
 }
 
+namespace
+{
+  std::mutex & curlShareMutex( curl_lock_data data_r )
+  {
+    static std::mutex mutexes[CURL_LOCK_DATA_LAST];
+    return mutexes[data_r];
+  }
+
+  void curlShareLock( CURL *, curl_lock_data data_r, curl_lock_access, void * )
+  { curlShareMutex( data_r ).lock(); }
+
+  void curlShareUnlock( CURL *, curl_lock_data data_r, void * )
+  { curlShareMutex( data_r ).unlock(); }
+
+  /** Owns the share object of \ref curlThreadShare until the thread exits.
+   * It is locked, as easy handles may still use it in another thread.
+   */
+  struct ThreadShare
+  {
+    /** The share object and its locks, freed together. */
+    struct Data
+    {
+      CURLSH * _share = nullptr;
+      std::mutex _mutexes[CURL_LOCK_DATA_LAST];
+    };
+
+    ThreadShare()
+    : _data( new Data )
+    {
+      globalInitCurlOnce();
+      _data->_share = curl_share_init();
+      if ( ! _data->_share )
+      {
+        WAR << "curl share init failed" << std::endl;
+        return;
+      }
+      curl_share_setopt( _data->_share, CURLSHOPT_LOCKFUNC, lock );
+      curl_share_setopt( _data->_share, CURLSHOPT_UNLOCKFUNC, unlock );
+      curl_share_setopt( _data->_share, CURLSHOPT_USERDATA, _data );
+      curl_share_setopt( _data->_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS );
+      curl_share_setopt( _data->_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION );
+#if CURLVERSION_AT_LEAST(7,57,0)
+      curl_share_setopt( _data->_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT );
+#endif
+    }
+
+    ThreadShare( const ThreadShare & ) = delete;
+    ThreadShare & operator=( const ThreadShare & ) = delete;
+
+    ~ThreadShare()
+    {
+      // Fails if easy handles outliving the thread still use it. The share
+      // and its locks are leaked then, so these handles stay usable.
+      // (no logging here, at process exit the logger might be gone already)
+      if ( ! _data->_share || curl_share_cleanup( _data->_share ) == CURLSHE_OK )
+        delete _data;
+    }
+
+    static void lock( CURL *, curl_lock_data data_r, curl_lock_access, void * data_p )
+    { static_cast<Data *>( data_p )->_mutexes[data_r].lock(); }
+
+    static void unlock( CURL *, curl_lock_data data_r, void * data_p )
+    { static_cast<Data *>( data_p )->_mutexes[data_r].unlock(); }
+
+    CURLSH * share() const
+    { return _data->_share; }
+
+  private:
+    Data * _data;	///< not owned if the share is still in use at exit
+  };
+} // namespace
+
+CURLSH * curlShare()
+{
+  // never cleaned up, easy handles may use it until the process exits
+  static CURLSH * share = [] {
+    globalInitCurlOnce();
+    CURLSH * sh = curl_share_init();
+    if ( ! sh )
+    {
+      WAR << "curl share init failed" << std::endl;
+      return sh;
+    }
+    curl_share_setopt( sh, CURLSHOPT_LOCKFUNC, curlShareLock );
+    curl_share_setopt( sh, CURLSHOPT_UNLOCKFUNC, curlShareUnlock );
+    curl_share_setopt( sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS );
+    curl_share_setopt( sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION );
+    return sh;
+  }();
+  return share;
+}
+
+CURLSH * curlThreadShare()
+{
+#if CURLVERSION_AT_LEAST(7,57,0)
+  static thread_local ThreadShare share;
+  return share.share();
+#else
+  return curlShare();
+#endif
+}
+
 int log_curl(CURL *curl, curl_infotype info,
   char *ptr, size_t len, void *max_lvl)
 {
@@ -103,6 +206,43 @@ size_t log_redirects_curl( char *ptr, size_t size, size_t nmemb, void *userdata)
   return max;
 }
 
+void track_validators_curl( const char *ptr, size_t len, std::string & etag_r, time_t & lastModified_r )
+{
+  std::string line { ptr, len };
+  while ( ! line.empty() && ( line.back() == '\n' || line.back() == '\r' ) )
+    line.pop_back();
+
+  if ( zypp::str::hasPrefixCI( line, "HTTP/" ) )
+  {
+    // a new response (e.g. after a redirect)
+    etag_r.clear();
+    lastModified_r = 0;
+    return;
+  }
+
+  std::string::size_type sep = line.find( ':' );
+  if ( sep == std::string::npos )
+    return;
+  std::string name { line.substr( 0, sep ) };
+  if ( zypp::str::compareCI( name, "ETag" ) == 0 )
+    etag_r = zypp::str::trim( line.substr( sep+1 ) );
+  else if ( zypp::str::compareCI( name, "Last-Modified" ) == 0 )
+  {
+    time_t t = curl_getdate( zypp::str::trim( line.substr( sep+1 ) ).c_str(), nullptr );
+    lastModified_r = t > 0 ? t : 0;
+  }
+}
+
+size_t conditional_request_header_curl( char *ptr, size_t size, size_t nmemb, void *userdata )
+{
+  if ( !userdata )
+    return log_redirects_curl( ptr, size, nmemb, nullptr );
+
+  CurlConditionalRequest & request { *reinterpret_cast<CurlConditionalRequest *>( userdata ) };
+  track_validators_curl( ptr, size * nmemb, request.etag, request.lastModified );
+  return log_redirects_curl( ptr, size, nmemb, request.lastRedirect );
+}
+
 /**
  * Fills the settings structure using options passed on the url
  * for example ?timeout=x&proxy=foo
@@ -19,6 +19,7 @@
 #include <zypp/media/TransferSettings.h>
 
 #define  CONNECT_TIMEOUT        60
+#define  CONNECTION_MAXAGE      120
 #define  TRANSFER_TIMEOUT_MAX   60 * 60
 #define  DETECT_DIR_INDEX       0
 
@@ -41,9 +42,72 @@ namespace env {
 }
 
 void globalInitCurlOnce();
+
+/**
+ * The process wide share object holding curl's DNS and TLS session caches.
+ * Easy handles using it resolve each host and do a full TLS handshake with it only
+ * once, no matter which thread or multi handle they run in.
+ * \note Connections are not shared, curl does not support using them from several
+ * threads. Easy handles added to the same multi handle share their connections anyway.
+ */
+CURLSH * curlShare();
+
+/**
+ * The share object for the media backends easy handles in the current thread.
+ * Besides the DNS and TLS session caches it holds the connection cache, so the
+ * connections of a released \ref zypp::media::MediaCurl stay open and are reused
+ * by the next one talking to the same host through the same proxy with the same
+ * credentials. curl closes connections idle for more than \ref CONNECTION_MAXAGE
+ * seconds when it looks for a connection to reuse.
+ * \note curl does not support using connections from several threads, so each
+ * thread gets its own share. A handle used by another thread than the one it was
+ * set up in should be switched to that threads share before each transfer (the
+ * share is locked, so handles still attached to it from other threads are safe;
+ * if they are when the thread exits, the share and its locks are not freed).
+ * With curl older than 7.57 this is \ref curlShare.
+ */
+CURLSH * curlThreadShare();
 int  log_curl(CURL *curl, curl_infotype info,  char *ptr, size_t len, void *max_lvl);
 size_t log_redirects_curl( char *ptr, size_t size, size_t nmemb, void *userdata);
 
+/**
+ * Remember the \c ETag and \c Last-Modified of the current response in \a etag_r and
+ * \a lastModified_r, if the header line \a ptr is one of them. A status line starts a
+ * new response (e.g. after a redirect) and clears them.
+ * \see zypp::media::TransferValidators
+ */
+void track_validators_curl( const char *ptr, size_t len, std::string & etag_r, time_t & lastModified_r );
+
+/**
+ * The state of a conditional transfer of the media backends, living as long as the transfer.
+ * \see zypp::media::MediaCurl::setupConditionalRequest
+ */
+struct CurlConditionalRequest
+{
+  CurlConditionalRequest()
+  {}
+
+  CurlConditionalRequest( const CurlConditionalRequest & ) = delete;
+  CurlConditionalRequest & operator=( const CurlConditionalRequest & ) = delete;
+
+  ~CurlConditionalRequest()
+  {
+    if ( headers )
+      curl_slist_free_all( headers );
+  }
+
+  std::string *lastRedirect = nullptr;	///< to log/report redirections
+  std::string etag;		///< ETag of the last response
+  time_t lastModified = 0;	///< Last-Modified of the last response
+  curl_slist *headers = nullptr;	///< headers of the request, if an ETag is sent
+};
+
+/**
+ * Header callback for a \ref CurlConditionalRequest passed as \a userdata:
+ * Logs redirects like \ref log_redirects_curl and tracks the validators of the response.
+ */
+size_t conditional_request_header_curl( char *ptr, size_t size, size_t nmemb, void *userdata );
+
 
 void fillSettingsFromUrl( const zypp::Url &url, zypp::media::TransferSettings &s );
 void fillSettingsSystemProxy( const zypp::Url& url, zypp::media::TransferSettings &s );
@@ -0,0 +1,190 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/media/DnsLookup.cc
+ *
+*/
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <poll.h>
+
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <system_error>
+#include <thread>
+
+#include <zypp/media/DnsLookup_p.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace media
+  {
+    namespace
+    {
+      /** The lookups waiting for a resolver thread. */
+      struct Resolver
+      {
+        std::mutex _mutex;
+        unsigned _running = 0;		///< resolver threads
+        std::deque<std::weak_ptr<DnsLookup>> _pending;
+      };
+
+      Resolver & resolver()
+      {
+        // never deleted, detached resolver threads may use it until the process exits
+        static Resolver * _resolver = new Resolver;
+        return *_resolver;
+      }
+
+      int getaddrinfoResolve( const std::string & host_r )
+      {
+        struct addrinfo *ai, aihints;
+        memset(&aihints, 0, sizeof(aihints));
+        aihints.ai_family = PF_UNSPEC;
+        int tstsock = socket(PF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (tstsock == -1)
+          aihints.ai_family = PF_INET;
+        else
+          close(tstsock);
+        aihints.ai_socktype = SOCK_STREAM;
+        aihints.ai_flags = AI_CANONNAME;
+        int error = getaddrinfo(host_r.c_str(), NULL, &aihints, &ai);
+        if ( error == 0 )
+          freeaddrinfo(ai);
+        return error;
+      }
+    } // namespace
+
+    ///////////////////////////////////////////////////////////////////
+    //
+    //	CLASS NAME : DnsLookup
+    //
+    ///////////////////////////////////////////////////////////////////
+
+    DnsLookup::DnsLookup( const std::string & host_r, ResolveFnc resolve_r )
+    : _host( host_r )
+    , _resolve( std::move(resolve_r) )
+    {}
+
+    DnsLookup::~DnsLookup()
+    {
+      for ( int fd : _pipefds )
+        if ( fd != -1 )
+          ::close( fd );
+    }
+
+    std::shared_ptr<DnsLookup> DnsLookup::start( const std::string & host_r, ResolveFnc resolve_r )
+    {
+      std::shared_ptr<DnsLookup> lookup( new DnsLookup( host_r, std::move(resolve_r) ) );
+#ifdef HAVE_PIPE2
+      int res = ::pipe2( lookup->_pipefds, O_CLOEXEC );
+#else
+      int res = ::pipe( lookup->_pipefds );
+      if ( res == 0 )
+      {
+        ::fcntl( lookup->_pipefds[0], F_SETFD, FD_CLOEXEC );
+        ::fcntl( lookup->_pipefds[1], F_SETFD, FD_CLOEXEC );
+      }
+#endif
+      if ( res != 0 )
+        throw std::system_error( errno, std::generic_category(), "DNS pipe creation failed" );
+
+      Resolver & r { resolver() };
+      std::lock_guard<std::mutex> lock( r._mutex );
+      if ( r._running < maxThreads )
+      {
+        std::thread( &DnsLookup::runThread, lookup ).detach();
+        ++r._running;
+      }
+      else
+        r._pending.push_back( lookup );
+      return lookup;
+    }
+
+    void DnsLookup::runThread( std::shared_ptr<DnsLookup> lookup_r )
+    {
+      Resolver & r { resolver() };
+      while ( lookup_r )
+      {
+        lookup_r->run();
+        lookup_r.reset();
+
+        std::lock_guard<std::mutex> lock( r._mutex );
+        while ( ! lookup_r && ! r._pending.empty() )
+        {
+          lookup_r = r._pending.front().lock();	// null if dropped meanwhile
+          r._pending.pop_front();
+        }
+        if ( ! lookup_r )
+          --r._running;
+      }
+    }
+
+    void DnsLookup::run()
+    {
+      _error = _resolve ? _resolve( _host ) : getaddrinfoResolve( _host );
+      _done.store( true, std::memory_order_release );
+      char c = 0;
+      while ( ::write( _pipefds[1], &c, 1 ) == -1 && errno == EINTR )
+        ;
+    }
+
+    bool DnsLookup::wait( unsigned timeout_r ) const
+    {
+      if ( done() )
+        return true;
+      struct pollfd pfd { readfd(), POLLIN, 0 };
+      while ( ::poll( &pfd, 1, timeout_r ) == -1 && errno == EINTR )
+        ;
+      return done();
+    }
+
+    ///////////////////////////////////////////////////////////////////
+    //
+    //	CLASS NAME : DnsCache
+    //
+    ///////////////////////////////////////////////////////////////////
+
+    DnsCache::DnsCache( unsigned ttl_r )
+    : _ttl( ttl_r )
+    {}
+
+    DnsCache & DnsCache::instance()
+    {
+      static DnsCache _instance;
+      return _instance;
+    }
+
+    bool DnsCache::ok( const std::string & host_r ) const
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      auto it = _expires.find( host_r );
+      if ( it == _expires.end() )
+        return false;
+      if ( Clock::now() < it->second )
+        return true;
+      _expires.erase( it );
+      return false;
+    }
+
+    void DnsCache::setOk( const std::string & host_r )
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _expires[host_r] = Clock::now() + std::chrono::seconds( _ttl );
+    }
+
+  } // namespace media
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
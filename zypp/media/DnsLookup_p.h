@@ -0,0 +1,149 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/media/DnsLookup_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_MEDIA_DNSLOOKUP_P_H
+#define ZYPP_MEDIA_DNSLOOKUP_P_H
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <zypp/APIConfig.h>
+#include <zypp/base/NonCopyable.h>
+#include <zypp/base/Function.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace media
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class DnsLookup
+    /// \brief Resolve a host via getaddrinfo in a thread.
+    ///
+    /// Like curl's threaded resolver, this avoids blocking the download
+    /// loop (and forking a process per mirror). At most \ref maxThreads
+    /// hosts are resolved at the same time, further lookups wait for a
+    /// free thread.
+    ///
+    /// getaddrinfo can not be interrupted. A lookup dropped by its owner
+    /// (e.g. after a timeout) occupies its thread until getaddrinfo
+    /// returns. If it did not start yet, it is skipped.
+    ///
+    /// Once \ref done, \ref readfd becomes readable, so it can be added
+    /// to a select set.
+    ///////////////////////////////////////////////////////////////////
+    class ZYPP_LOCAL DnsLookup : private base::NonCopyable
+    {
+    public:
+      /** Resolve \a host_r, returning \c 0 or a getaddrinfo error code. */
+      typedef function<int( const std::string & host_r )> ResolveFnc;
+
+      /** Maximum number of resolver threads. */
+      static constexpr unsigned maxThreads = 4;
+
+    public:
+      /** Start resolving \a host_r (by getaddrinfo unless \a resolve_r is given).
+       * \throws std::system_error if the thread or pipe can not be created
+       */
+      static std::shared_ptr<DnsLookup> start( const std::string & host_r, ResolveFnc resolve_r = ResolveFnc() );
+
+      /** Dtor */
+      ~DnsLookup();
+
+    public:
+      /** The host to resolve. */
+      const std::string & host() const
+      { return _host; }
+
+      /** Readable once \ref done. */
+      int readfd() const
+      { return _pipefds[0]; }
+
+      /** Whether the lookup is done. */
+      bool done() const
+      { return _done.load( std::memory_order_acquire ); }
+
+      /** Whether the host resolved (once \ref done). */
+      bool ok() const
+      { return _error == 0; }
+
+      /** Wait up to \a timeout_r milliseconds for the lookup to be \ref done.
+       * \returns whether it is done.
+       */
+      bool wait( unsigned timeout_r ) const;
+
+    private:
+      DnsLookup( const std::string & host_r, ResolveFnc resolve_r );
+      /** Resolve the host and wake up \ref readfd. */
+      void run();
+      /** Body of a resolver thread, running \a lookup_r and the waiting ones. */
+      static void runThread( std::shared_ptr<DnsLookup> lookup_r );
+
+    private:
+      std::string _host;
+      ResolveFnc _resolve;
+      int _pipefds[2] = { -1, -1 };
+      int _error = 0;
+      std::atomic<bool> _done { false };
+    };
+    ///////////////////////////////////////////////////////////////////
+
+    ///////////////////////////////////////////////////////////////////
+    /// \class DnsCache
+    /// \brief The hosts known to resolve.
+    ///
+    /// The global \ref instance is shared by all \ref MediaMultiCurl.
+    /// An entry expires \ref ttl seconds after it was set, so a host whose
+    /// address changed or which does not resolve anymore is checked again.
+    ///////////////////////////////////////////////////////////////////
+    class ZYPP_LOCAL DnsCache : private base::NonCopyable
+    {
+    public:
+      /** Seconds an entry of the global \ref instance is valid. */
+      static constexpr unsigned defaultTtl = 60;
+
+    public:
+      /** Ctor keeping the entries for \a ttl_r seconds. */
+      explicit DnsCache( unsigned ttl_r = defaultTtl );
+
+      /** The cache shared by all downloads. */
+      static DnsCache & instance();
+
+    public:
+      /** Seconds an entry is valid. */
+      unsigned ttl() const
+      { return _ttl; }
+
+      /** Whether \a host_r is known to resolve. */
+      bool ok( const std::string & host_r ) const;
+
+      /** Remember \a host_r resolved. */
+      void setOk( const std::string & host_r );
+
+    private:
+      typedef std::chrono::steady_clock Clock;
+      unsigned _ttl;
+      mutable std::mutex _mutex;
+      mutable std::map<std::string,Clock::time_point> _expires;
+    };
+    ///////////////////////////////////////////////////////////////////
+
+  } // namespace media
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_MEDIA_DNSLOOKUP_P_H
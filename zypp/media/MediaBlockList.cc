@@ -14,6 +14,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include <vector>
 #include <iostream>
@@ -28,6 +32,72 @@ using namespace zypp::base;
 namespace zypp {
   namespace media {
 
+namespace {
+
+/**
+ * add len bytes to the parts s and m of a rsum. Same as
+ *
+ *   for each byte c: s += c; m += s;
+ *
+ * but processing 16 bytes at once. Computes modulo 2^32, the caller
+ * masks the 16 bits it needs.
+ **/
+inline void
+rsumAdd(uint32_t &s, uint32_t &m, const unsigned char *bytes, size_t len)
+{
+  // a chunk of 16 bytes adds 16 * s plus the bytes weighted 16..1 to m
+#ifdef __SSE2__
+  if (len >= 16)
+    {
+      size_t chunks = len / 16;
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i whi = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+      const __m128i wlo = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+      __m128i vs = zero;	// sum of the bytes
+      __m128i vsacc = zero;	// sum of vs before each chunk
+      __m128i vw = zero;	// sum of the weighted bytes
+      for (size_t k = 0; k < chunks; k++, bytes += 16)
+	{
+	  __m128i v = _mm_loadu_si128((const __m128i *)bytes);
+	  vsacc = _mm_add_epi32(vsacc, vs);
+	  vw = _mm_add_epi32(vw, _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), whi));
+	  vw = _mm_add_epi32(vw, _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), wlo));
+	  vs = _mm_add_epi32(vs, _mm_sad_epu8(v, zero));
+	}
+      uint32_t lanes[3][4];
+      _mm_storeu_si128((__m128i *)lanes[0], vs);
+      _mm_storeu_si128((__m128i *)lanes[1], vsacc);
+      _mm_storeu_si128((__m128i *)lanes[2], vw);
+      uint32_t sum[3];
+      for (int i = 0; i < 3; i++)
+	sum[i] = lanes[i][0] + lanes[i][1] + lanes[i][2] + lanes[i][3];
+      m += uint32_t(chunks * 16) * s + 16 * sum[1] + sum[2];
+      s += sum[0];
+      len -= chunks * 16;
+    }
+#else
+  // written so the compiler can vectorize the inner loop
+  for (; len >= 16; len -= 16, bytes += 16)
+    {
+      uint32_t cs = 0, cw = 0;
+      for (unsigned j = 0; j < 16; j++)
+	{
+	  cs += bytes[j];
+	  cw += (16 - j) * bytes[j];
+	}
+      m += 16 * s + cw;
+      s += cs;
+    }
+#endif
+  for (; len > 0; len--)
+    {
+      s += *bytes++;
+      m += s;
+    }
+}
+
+} // namespace
+
 MediaBlockList::MediaBlockList(off_t size)
 {
   filesize = size;
@@ -145,15 +215,10 @@ MediaBlockList::updateRsum(unsigned int rs, const char* bytes, size_t len) const
 {
   if (!len)
     return rs;
-  unsigned short s, m;
+  uint32_t s, m;
   s = (rs >> 16) & 65535;
   m = rs & 65535;
-  for (; len > 0 ; len--)
-    {
-      unsigned short c = (unsigned char)*bytes++;
-      s += c;
-      m += s;
-    }
+  rsumAdd(s, m, (const unsigned char *)bytes, len);
   return (s & 65535) << 16 | (m & 65535);
 }
 
@@ -262,7 +327,6 @@ static size_t
 fetchnext(FILE *fp, unsigned char *bp, size_t blksize, size_t pushback, unsigned char *pushbackp)
 {
   size_t l = blksize;
-  int c;
 
   if (pushback)
     {
@@ -271,14 +335,9 @@ fetchnext(FILE *fp, unsigned char *bp, size_t blksize, size_t pushback, unsigned
       bp += pushback;
       l -= pushback;
     }
-  while (l)
-    {
-      c = getc(fp);
-      if (c == EOF)
-        break;
-      *bp++ = c;
-      l--;
-    }
+  size_t r = fread(bp, 1, l, fp);
+  bp += r;
+  l -= r;
   if (l)
     memset(bp, 0, l);
   return blksize - l;
@@ -292,6 +351,8 @@ MediaBlockList::reuseBlocks(FILE *wfp, std::string filename)
 
   if (!chksumlen || (fp = fopen(filename.c_str(), "r")) == 0)
     return;
+  // we read byte by byte below, avoid the syscall overhead
+  setvbuf(fp, NULL, _IOFBF, 256 * 1024);
   size_t nblks = blocks.size();
   std::vector<bool> found;
   found.resize(nblks + 1);
@@ -309,6 +370,12 @@ MediaBlockList::reuseBlocks(FILE *wfp, std::string filename)
 	hm = 16383;
       unsigned int *ht = new unsigned int[hm + 1];
       memset(ht, 0, (hm + 1) * sizeof(unsigned int));
+      // bitmap of the rsums in the hash, 8 bits per hash entry. It is small
+      // enough to stay in the cache and rejects most positions before the
+      // hash itself is looked at.
+      unsigned int bm = (hm + 1) * 8 - 1;
+      unsigned char *bits = new unsigned char[hm + 1];
+      memset(bits, 0, hm + 1);
       for (unsigned int i = 0; i < rsums.size(); i++)
 	{
 	  if (blocks[i].size != blksize && (i != nblks - 1 || rsumpad != blksize))
@@ -319,6 +386,7 @@ MediaBlockList::reuseBlocks(FILE *wfp, std::string filename)
 	  while (ht[h])
 	    h = (h + hh++) & hm;
 	  ht[h] = i + 1;
+	  bits[(r & bm) >> 3] |= 1 << (r & 7);
 	}
 
       unsigned char *buf = new unsigned char[blksize];
@@ -350,7 +418,7 @@ MediaBlockList::reuseBlocks(FILE *wfp, std::string filename)
 		      pushback--;
 		    }
 		  else
-		    c = getc(fp);
+		    c = getc_unlocked(fp);
 		  if (c == EOF)
 		    {
 		      eof = true;
@@ -381,6 +449,8 @@ MediaBlockList::reuseBlocks(FILE *wfp, std::string filename)
 		r = ((unsigned int)a & 255) << 16 | ((unsigned int)b & 65535);
 	      else
 		r = ((unsigned int)a & 65535) << 16 | ((unsigned int)b & 65535);
+	      if (!(bits[(r & bm) >> 3] & (1 << (r & 7))))
+		continue;
 	      unsigned int h = r & hm;
 	      unsigned int hh = 7;
 	      for (; ht[h]; h = (h + hh++) & hm)
@@ -436,6 +506,7 @@ MediaBlockList::reuseBlocks(FILE *wfp, std::string filename)
 	}
       delete[] buf2;
       delete[] buf;
+      delete[] bits;
       delete[] ht;
     }
   else if (chksumlen >= 16)
@@ -26,6 +26,7 @@
 #include <zypp/media/CredentialManager.h>
 #include <zypp/media/CurlConfig.h>
 #include <zypp/media/CurlHelper.h>
+#include <zypp/media/TransferValidators_p.h>
 #include <zypp/Target.h>
 #include <zypp/ZYppFactory.h>
 #include <zypp/ZConfig.h>
@@ -280,6 +281,12 @@ void MediaCurl::setupEasy()
   SET_OPTION(CURLOPT_FAILONERROR, 1L);
   SET_OPTION(CURLOPT_NOSIGNAL, 1L);
 
+  // keep connections, TLS sessions and DNS entries after this media is released
+  SET_OPTION(CURLOPT_SHARE, curlThreadShare());
+#if CURLVERSION_AT_LEAST(7,65,0)
+  SET_OPTION_LONG(CURLOPT_MAXAGE_CONN, CONNECTION_MAXAGE);
+#endif
+
   // create non persistant settings
   // so that we don't add headers twice
   TransferSettings vol_settings(_settings);
@@ -920,6 +927,8 @@ bool MediaCurl::doGetDoesFileExist( const Pathname & filename ) const
       ZYPP_THROW(MediaCurlSetOptException(url, err));
   }
 
+  // the media may be used by another thread than the one it was attached in
+  curl_easy_setopt( _curl, CURLOPT_SHARE, curlThreadShare() );
   CURLcode ok = curl_easy_perform( _curl );
   MIL << "perform code: " << ok << " [ " << curl_easy_strerror(ok) << " ]" << endl;
 
@@ -1053,27 +1062,19 @@ void MediaCurl::doGetFileCopy(const Pathname & filename , const Pathname & targe
     DBG << "dest: " << dest << endl;
     DBG << "temp: " << destNew << endl;
 
-    // set IFMODSINCE time condition (no download if not modified)
-    if( PathInfo(target).isExist() && !(options & OPTION_NO_IFMODSINCE) )
-    {
-      curl_easy_setopt(_curl, CURLOPT_TIMECONDITION, CURL_TIMECOND_IFMODSINCE);
-      curl_easy_setopt(_curl, CURLOPT_TIMEVALUE, (long)PathInfo(target).mtime());
-    }
-    else
-    {
-      curl_easy_setopt(_curl, CURLOPT_TIMECONDITION, CURL_TIMECOND_NONE);
-      curl_easy_setopt(_curl, CURLOPT_TIMEVALUE, 0L);
-    }
+    // no download if not modified
+    CurlConditionalRequest conditional;
+    Pathname unmodified { setupConditionalRequest( conditional, filename, target, options, _customHeaders ) };
     try
     {
       doGetFileCopyFile(filename, dest, file, report, expectedFileSize_r, options);
     }
     catch (Exception &e)
     {
-      curl_easy_setopt(_curl, CURLOPT_TIMECONDITION, CURL_TIMECOND_NONE);
-      curl_easy_setopt(_curl, CURLOPT_TIMEVALUE, 0L);
+      resetConditionalRequest( conditional, _customHeaders );
       ZYPP_RETHROW(e);
     }
+    resetConditionalRequest( conditional, _customHeaders );
 
     long httpReturnCode = 0;
     CURLcode infoRet = curl_easy_getinfo(_curl,
@@ -1118,12 +1119,88 @@ void MediaCurl::doGetFileCopy(const Pathname & filename , const Pathname & targe
       }
       destNew.resetDispose();	// no more need to unlink it
     }
+    else if ( ! unmodified.empty() && unmodified != target )
+    {
+      // provide the unmodified deltafile
+      if ( filesystem::copy( unmodified, dest ) != 0 )
+        ZYPP_THROW(MediaWriteException(dest));
+    }
+    rememberValidators( conditional, filename, dest );
 
     DBG << "done: " << PathInfo(dest) << endl;
 }
 
 ///////////////////////////////////////////////////////////////////
 
+Pathname MediaCurl::setupConditionalRequest( CurlConditionalRequest & request_r, const Pathname & filename, const Pathname & target, RequestOptions options, curl_slist * headers_r ) const
+{
+  resetConditionalRequest( request_r, headers_r );
+  request_r.etag.clear();
+  request_r.lastModified = 0;
+  request_r.lastRedirect = &_lastRedirect;
+  curl_easy_setopt(_curl, CURLOPT_HEADERFUNCTION, conditional_request_header_curl);
+  curl_easy_setopt(_curl, CURLOPT_HEADERDATA, &request_r);
+  if ( options & OPTION_NO_IFMODSINCE )
+    return Pathname();
+
+  // set IFMODSINCE time condition
+  if ( PathInfo(target).isExist() )
+  {
+    curl_easy_setopt(_curl, CURLOPT_TIMECONDITION, CURL_TIMECOND_IFMODSINCE);
+    curl_easy_setopt(_curl, CURLOPT_TIMEVALUE, (long)PathInfo(target).mtime());
+    return target;
+  }
+
+  if ( deltafile().empty() || ! TransferValidators::enabled() )
+    return Pathname();
+
+  TransferValidators::Entry validators { TransferValidators::instance().lookup( clearQueryString( getFileUrl( filename ) ), deltafile() ) };
+  if ( validators.empty() )
+    return Pathname();
+
+  DBG << "Conditional request for " << filename << ": " << validators << endl;
+  if ( validators.lastModified != Date() )
+  {
+    curl_easy_setopt(_curl, CURLOPT_TIMECONDITION, CURL_TIMECOND_IFMODSINCE);
+    curl_easy_setopt(_curl, CURLOPT_TIMEVALUE, (long)validators.lastModified);
+  }
+  if ( ! validators.etag.empty() )
+  {
+    for ( curl_slist *sl = headers_r; sl; sl = sl->next )
+      request_r.headers = curl_slist_append( request_r.headers, sl->data );
+    request_r.headers = curl_slist_append( request_r.headers, ( "If-None-Match: " + validators.etag ).c_str() );
+    if ( request_r.headers )
+      curl_easy_setopt(_curl, CURLOPT_HTTPHEADER, request_r.headers);
+  }
+  return deltafile();
+}
+
+void MediaCurl::resetConditionalRequest( CurlConditionalRequest & request_r, curl_slist * headers_r ) const
+{
+  curl_easy_setopt(_curl, CURLOPT_TIMECONDITION, CURL_TIMECOND_NONE);
+  curl_easy_setopt(_curl, CURLOPT_TIMEVALUE, 0L);
+  curl_easy_setopt(_curl, CURLOPT_HTTPHEADER, headers_r);
+  curl_easy_setopt(_curl, CURLOPT_HEADERFUNCTION, log_redirects_curl);
+  curl_easy_setopt(_curl, CURLOPT_HEADERDATA, &_lastRedirect);
+  if ( request_r.headers )
+  {
+    curl_slist_free_all(request_r.headers);
+    request_r.headers = nullptr;
+  }
+}
+
+void MediaCurl::rememberValidators( const CurlConditionalRequest & request_r, const Pathname & filename, const Pathname & file_r ) const
+{
+  if ( deltafile().empty() || ! TransferValidators::enabled() )
+    return;
+
+  TransferValidators & validators { TransferValidators::instance() };
+  validators.remember( clearQueryString( getFileUrl( filename ) ), request_r.etag, Date( request_r.lastModified ), file_r );
+  validators.save();
+}
+
+///////////////////////////////////////////////////////////////////
+
 void MediaCurl::doGetFileCopyFile(const Pathname & filename , const Pathname & dest, FILE *file, callback::SendReport<DownloadProgressReport> & report, const ByteCount &expectedFileSize_r, RequestOptions options ) const
 {
     DBG << filename.asString() << endl;
@@ -1172,6 +1249,8 @@ void MediaCurl::doGetFileCopyFile(const Pathname & filename , const Pathname & d
       WAR << "Can't set CURLOPT_PROGRESSDATA: " << _curlError << endl;;
     }
 
+    // the media may be used by another thread than the one it was attached in
+    curl_easy_setopt( _curl, CURLOPT_SHARE, curlThreadShare() );
     ret = curl_easy_perform( _curl );
 #if CURLVERSION_AT_LEAST(7,19,4)
     // bnc#692260: If the client sends a request with an If-Modified-Since header
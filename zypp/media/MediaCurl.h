@@ -19,6 +19,10 @@
 
 #include <curl/curl.h>
 
+namespace internal {
+  struct CurlConditionalRequest;
+}
+
 namespace zypp {
   namespace media {
 
@@ -153,6 +157,26 @@ class MediaCurl : public MediaHandler
 
     static void resetExpectedFileSize ( void *clientp, const ByteCount &expectedFileSize );
 
+    /**
+     * Make the next transfer of \a filename conditional, if there is a local copy of it.
+     * The copy is an existing \a target (If-Modified-Since its mtime) or the \ref deltafile,
+     * if the \ref TransferValidators sent with it are known (If-None-Match, If-Modified-Since).
+     * \p headers_r are the request headers to send. The validators of the response
+     * are tracked in \a request_r, which must live until \ref resetConditionalRequest.
+     * \returns The copy to provide if the server reports the file as not modified,
+     * empty if the transfer is not conditional.
+     */
+    Pathname setupConditionalRequest( internal::CurlConditionalRequest & request_r, const Pathname & filename, const Pathname & target, RequestOptions options, curl_slist * headers_r ) const;
+
+    /** Undo \ref setupConditionalRequest and send \p headers_r again. */
+    void resetConditionalRequest( internal::CurlConditionalRequest & request_r, curl_slist * headers_r ) const;
+
+    /**
+     * If a \ref deltafile is used, remember the \ref TransferValidators of the
+     * last response of \a request_r for \a filename, whose content is now in \a file_r.
+     */
+    void rememberValidators( const internal::CurlConditionalRequest & request_r, const Pathname & filename, const Pathname & file_r ) const;
+
   private:
     /**
      * Return a comma separated list of available authentication methods
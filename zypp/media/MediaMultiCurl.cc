@@ -12,20 +12,22 @@
 
 #include <ctype.h>
 #include <sys/types.h>
-#include <signal.h>
-#include <sys/wait.h>
+#include <unistd.h>
 #include <netdb.h>
 #include <arpa/inet.h>
 
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <memory>
 
 
 #include <zypp/ZConfig.h>
 #include <zypp/base/Logger.h>
 #include <zypp/media/MediaMultiCurl.h>
 #include <zypp/media/MetaLinkParser.h>
+#include <zypp/media/MirrorStats_p.h>
+#include <zypp/media/DnsLookup_p.h>
 #include <zypp/ManagedFile.h>
 #include <zypp/media/CurlHelper.h>
 
@@ -61,7 +63,7 @@ public:
 
   void checkdns();
   void adddnsfd(fd_set &rset, int &maxfd);
-  void dnsevent(fd_set &rset);
+  void dnsevent();
 
   int _workerno;
 
@@ -76,9 +78,11 @@ public:
   double _blkstarttime;
   size_t _blkreceived;
   off_t  _received;
+  size_t _blksdone;	// blocks fetched and verified
 
   double _avgspeed;
   double _maxspeed;
+  double _rtt;
 
   double _sleepuntil;
 
@@ -98,8 +102,8 @@ private:
   size_t _size;
   Digest _dig;
 
-  pid_t _pid;
-  int _dnspipe;
+  std::shared_ptr<DnsLookup> _dnslookup;
+  double _dnsstart;
 };
 
 #define WORKER_STARTING 0
@@ -122,6 +126,8 @@ public:
 protected:
   friend class multifetchworker;
 
+  void recordMirrorStats();
+
   const MediaMultiCurl *_context;
   const Pathname _filename;
   Url _baseurl;
@@ -308,16 +314,20 @@ multifetchworker::multifetchworker(int no, multifetchrequest &request, const Url
   _size = _blksize = 0;
   _pass = 0;
   _blkno = 0;
-  _pid = 0;
-  _dnspipe = -1;
+  _dnsstart = 0;
   _blkreceived = 0;
   _received = 0;
+  _blksdone = 0;
   _blkstarttime = 0;
-  _avgspeed = 0;
   _sleepuntil = 0;
   _maxspeed = _request->_maxspeed;
+  _rtt = 0;
   _noendrange = false;
 
+  // start with the speed seen in earlier downloads, so blocks are assigned
+  // and stolen according to it until we have our own measurement
+  _avgspeed = MirrorStats::instance().get(url.getHost()).throughput;
+
   Url curlUrl( clearQueryString(url) );
   _urlbuf = curlUrl.asString();
   _curl = _request->_context->fromEasyPool(_url.getHost());
@@ -398,20 +408,8 @@ multifetchworker::~multifetchworker()
         curl_easy_cleanup(_curl);
       _curl = 0;
     }
-  if (_pid)
-    {
-      kill(_pid, SIGKILL);
-      int status;
-      while (waitpid(_pid, &status, 0) == -1)
-        if (errno != EINTR)
-	  break;
-      _pid = 0;
-    }
-  if (_dnspipe != -1)
-    {
-      close(_dnspipe);
-      _dnspipe = -1;
-    }
+  // a still running DNS lookup finishes on its own
+  _dnslookup.reset();
   // the destructor in MediaCurl doesn't call disconnect() if
   // the media is not attached, so we do it here manually
   disconnectFrom();
@@ -457,47 +455,18 @@ multifetchworker::checkdns()
     }
 
   XXX << "checking DNS lookup of " << host << endl;
-  int pipefds[2];
-  if (pipe(pipefds))
+  try
     {
-      _state = WORKER_BROKEN;
-      strncpy(_curlError, "DNS pipe creation failed", CURL_ERROR_SIZE);
-      return;
+      _dnslookup = DnsLookup::start(host);
     }
-  _pid = fork();
-  if (_pid == pid_t(-1))
+  catch (const std::exception &ex)
     {
-      close(pipefds[0]);
-      close(pipefds[1]);
-      _pid = 0;
+      WAR << "#" << _workerno << ": " << ex.what() << endl;
       _state = WORKER_BROKEN;
-      strncpy(_curlError, "DNS checker fork failed", CURL_ERROR_SIZE);
+      strncpy(_curlError, "DNS checker start failed", CURL_ERROR_SIZE);
       return;
     }
-  else if (_pid == 0)
-    {
-      close(pipefds[0]);
-      // XXX: close all other file descriptors
-      struct addrinfo *ai, aihints;
-      memset(&aihints, 0, sizeof(aihints));
-      aihints.ai_family = PF_UNSPEC;
-      int tstsock = socket(PF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0);
-      if (tstsock == -1)
-	aihints.ai_family = PF_INET;
-      else
-	close(tstsock);
-      aihints.ai_socktype = SOCK_STREAM;
-      aihints.ai_flags = AI_CANONNAME;
-      unsigned int connecttimeout = _request->_connect_timeout;
-      if (connecttimeout)
-	alarm(connecttimeout);
-      signal(SIGALRM, SIG_DFL);
-      if (getaddrinfo(host.c_str(), NULL, &aihints, &ai))
-        _exit(1);
-      _exit(0);
-    }
-  close(pipefds[1]);
-  _dnspipe = pipefds[0];
+  _dnsstart = currentTime();
   _state = WORKER_LOOKUP;
 }
 
@@ -506,39 +475,33 @@ multifetchworker::adddnsfd(fd_set &rset, int &maxfd)
 {
   if (_state != WORKER_LOOKUP)
     return;
-  FD_SET(_dnspipe, &rset);
-  if (maxfd < _dnspipe)
-    maxfd = _dnspipe;
+  int fd = _dnslookup->readfd();
+  FD_SET(fd, &rset);
+  if (maxfd < fd)
+    maxfd = fd;
 }
 
 void
-multifetchworker::dnsevent(fd_set &rset)
+multifetchworker::dnsevent()
 {
-
-  if (_state != WORKER_LOOKUP || !FD_ISSET(_dnspipe, &rset))
+  if (_state != WORKER_LOOKUP)
     return;
-  int status;
-  while (waitpid(_pid, &status, 0) == -1)
-    {
-      if (errno != EINTR)
-        return;
-    }
-  _pid = 0;
-  if (_dnspipe != -1)
-    {
-      close(_dnspipe);
-      _dnspipe = -1;
-    }
-  if (!WIFEXITED(status))
+  if (!_dnslookup->done())
     {
-      _state = WORKER_BROKEN;
-      strncpy(_curlError, "DNS lookup failed", CURL_ERROR_SIZE);
-      _request->_activeworkers--;
+      // getaddrinfo can not be interrupted, stop waiting for it after the connect timeout
+      if (_request->_connect_timeout && currentTime() - _dnsstart > _request->_connect_timeout)
+	{
+	  _dnslookup.reset();
+	  _state = WORKER_BROKEN;
+	  strncpy(_curlError, "DNS lookup timed out", CURL_ERROR_SIZE);
+	  _request->_activeworkers--;
+	}
       return;
     }
-  int exitcode = WEXITSTATUS(status);
-  XXX << "#" << _workerno << ": DNS lookup returned " << exitcode << endl;
-  if (exitcode != 0)
+  bool ok = _dnslookup->ok();
+  _dnslookup.reset();
+  XXX << "#" << _workerno << ": DNS lookup " << (ok ? "succeeded" : "failed") << endl;
+  if (!ok)
     {
       _state = WORKER_BROKEN;
       strncpy(_curlError, "DNS lookup failed", CURL_ERROR_SIZE);
@@ -761,6 +724,8 @@ multifetchworker::run()
       strncpy(_curlError, "curl_easy_setopt range failed", CURL_ERROR_SIZE);
       return;
     }
+  // the media may be used by another thread than the one it was attached in
+  curl_easy_setopt(_curl, CURLOPT_SHARE, internal::curlThreadShare());
   if (curl_multi_add_handle(_request->_multi, _curl) != CURLM_OK)
     {
       _request->_activeworkers--;
@@ -827,6 +792,7 @@ multifetchrequest::multifetchrequest(const MediaMultiCurl *context, const Pathna
 
 multifetchrequest::~multifetchrequest()
 {
+  recordMirrorStats();
   for (std::list<multifetchworker *>::iterator workeriter = _workers.begin(); workeriter != _workers.end(); ++workeriter)
     {
       multifetchworker *worker = *workeriter;
@@ -836,6 +802,22 @@ multifetchrequest::~multifetchrequest()
   _workers.clear();
 }
 
+void
+multifetchrequest::recordMirrorStats()
+{
+  MirrorStats &stats = MirrorStats::instance();
+  for (std::list<multifetchworker *>::iterator workeriter = _workers.begin(); workeriter != _workers.end(); ++workeriter)
+    {
+      multifetchworker *worker = *workeriter;
+      if (!worker->_curl)
+	continue;	// never started
+      if (worker->_state == WORKER_BROKEN)
+	stats.addFailure(worker->_url.getHost());
+      else if (worker->_blksdone && worker->_avgspeed)	// not just the speed we started with
+	stats.addTransfer(worker->_url.getHost(), worker->_avgspeed, worker->_rtt);
+    }
+}
+
 void
 multifetchrequest::run(std::vector<Url> &urllist)
 {
@@ -923,13 +905,13 @@ multifetchrequest::run(std::vector<Url> &urllist)
       int r = select(maxfd + 1, &rset, &wset, &xset, &tv);
       if (r == -1 && errno != EINTR)
 	ZYPP_THROW(MediaCurlException(_baseurl, "select() failed", "unknown error"));
-      if (r != 0 && _lookupworkers)
+      if (_lookupworkers)
 	for (std::list<multifetchworker *>::iterator workeriter = _workers.begin(); workeriter != _workers.end(); ++workeriter)
 	  {
 	    multifetchworker *worker = *workeriter;
 	    if (worker->_state != WORKER_LOOKUP)
 	      continue;
-	    (*workeriter)->dnsevent(rset);
+	    (*workeriter)->dnsevent();
 	    if (worker->_state != WORKER_LOOKUP)
 	      _lookupworkers--;
 	  }
@@ -998,6 +980,15 @@ multifetchrequest::run(std::vector<Url> &urllist)
 	      else
 		worker->_avgspeed = worker->_blkreceived / (now - worker->_blkstarttime);
 	    }
+	  if (!worker->_rtt)
+	    {
+	      // the TCP handshake takes one round trip
+	      double connecttime = 0, lookuptime = 0;
+	      if (curl_easy_getinfo(easy, CURLINFO_CONNECT_TIME, &connecttime) == CURLE_OK
+		  && curl_easy_getinfo(easy, CURLINFO_NAMELOOKUP_TIME, &lookuptime) == CURLE_OK
+		  && connecttime > lookuptime)
+		worker->_rtt = connecttime - lookuptime;
+	    }
 	  XXX << "#" << worker->_workerno << ": BLK " << worker->_blkno << " done code " << cc << " speed " << worker->_avgspeed << endl;
 	  curl_multi_remove_handle(_multi, easy);
 	  if (cc == CURLE_HTTP_RETURNED_ERROR)
@@ -1056,6 +1047,7 @@ multifetchrequest::run(std::vector<Url> &urllist)
 			}
 		    }
 		  _fetchedgoodsize += worker->_blksize;
+		  worker->_blksdone++;
 		}
 
 	      // make bad workers sleep a little
@@ -1179,6 +1171,8 @@ MediaMultiCurl::~MediaMultiCurl()
       curl_multi_cleanup(_multi);
       _multi = 0;
     }
+  // store the mirror stats of all downloads done by this media at once
+  MirrorStats::instance().save();
   std::map<std::string, CURL *>::iterator it;
   for (it = _easypool.begin(); it != _easypool.end(); it++)
     {
@@ -1335,19 +1329,9 @@ void MediaMultiCurl::doGetFileCopy( const Pathname & filename , const Pathname &
   DBG << "dest: " << dest << endl;
   DBG << "temp: " << destNew << endl;
 
-  // set IFMODSINCE time condition (no download if not modified)
-  if( PathInfo(target).isExist() && !(options & OPTION_NO_IFMODSINCE) )
-  {
-    curl_easy_setopt(_curl, CURLOPT_TIMECONDITION, CURL_TIMECOND_IFMODSINCE);
-    curl_easy_setopt(_curl, CURLOPT_TIMEVALUE, (long)PathInfo(target).mtime());
-  }
-  else
-  {
-    curl_easy_setopt(_curl, CURLOPT_TIMECONDITION, CURL_TIMECOND_NONE);
-    curl_easy_setopt(_curl, CURLOPT_TIMEVALUE, 0L);
-  }
-  // change header to include Accept: metalink
-  curl_easy_setopt(_curl, CURLOPT_HTTPHEADER, _customHeadersMetalink);
+  // no download if not modified; change header to include Accept: metalink
+  internal::CurlConditionalRequest conditional;
+  Pathname unmodified { setupConditionalRequest( conditional, filename, target, options, _customHeadersMetalink ) };
   // change to our own progress funcion
   curl_easy_setopt(_curl, CURLOPT_PROGRESSFUNCTION, &progressCallback);
   curl_easy_setopt(_curl, CURLOPT_PRIVATE, (*file) );	// important to pass the FILE* explicitly (passing through varargs)
@@ -1357,15 +1341,11 @@ void MediaMultiCurl::doGetFileCopy( const Pathname & filename , const Pathname &
     }
   catch (Exception &ex)
     {
-      curl_easy_setopt(_curl, CURLOPT_TIMECONDITION, CURL_TIMECOND_NONE);
-      curl_easy_setopt(_curl, CURLOPT_TIMEVALUE, 0L);
-      curl_easy_setopt(_curl, CURLOPT_HTTPHEADER, _customHeaders);
+      resetConditionalRequest( conditional, _customHeaders );
       curl_easy_setopt(_curl, CURLOPT_PRIVATE, (void *)0);
       ZYPP_RETHROW(ex);
     }
-  curl_easy_setopt(_curl, CURLOPT_TIMECONDITION, CURL_TIMECOND_NONE);
-  curl_easy_setopt(_curl, CURLOPT_TIMEVALUE, 0L);
-  curl_easy_setopt(_curl, CURLOPT_HTTPHEADER, _customHeaders);
+  resetConditionalRequest( conditional, _customHeaders );
   curl_easy_setopt(_curl, CURLOPT_PRIVATE, (void *)0);
   long httpReturnCode = 0;
   CURLcode infoRet = curl_easy_getinfo(_curl, CURLINFO_RESPONSE_CODE, &httpReturnCode);
@@ -1375,6 +1355,13 @@ void MediaMultiCurl::doGetFileCopy( const Pathname & filename , const Pathname &
     if ( httpReturnCode == 304
 	 || ( httpReturnCode == 213 && _url.getScheme() == "ftp" ) ) // not modified
     {
+      if ( ! unmodified.empty() && unmodified != target )
+      {
+        // provide the unmodified deltafile
+        if ( filesystem::copy( unmodified, dest ) != 0 )
+          ZYPP_THROW(MediaWriteException(dest));
+        rememberValidators( conditional, filename, dest );
+      }
       DBG << "not modified: " << PathInfo(dest) << endl;
       return;
     }
@@ -1500,6 +1487,8 @@ void MediaMultiCurl::doGetFileCopy( const Pathname & filename , const Pathname &
       ZYPP_THROW(MediaWriteException(dest));
     }
   destNew.resetDispose();	// no more need to unlink it
+  if ( ! ismetalink )
+    rememberValidators( conditional, filename, dest );
 
   DBG << "done: " << PathInfo(dest) << endl;
 }
@@ -1552,6 +1541,8 @@ void MediaMultiCurl::multifetch(const Pathname & filename, FILE *fp, std::vector
     }
   if (!myurllist.size())
     myurllist.push_back(baseurl);
+  else
+    MirrorStats::instance().sort(myurllist);
   req.run(myurllist);
   checkFileDigest(baseurl, fp, blklist);
 }
@@ -1574,12 +1565,12 @@ void MediaMultiCurl::checkFileDigest(Url &url, FILE *fp, MediaBlockList *blklist
 
 bool MediaMultiCurl::isDNSok(const std::string &host) const
 {
-  return _dnsok.find(host) == _dnsok.end() ? false : true;
+  return DnsCache::instance().ok(host);
 }
 
 void MediaMultiCurl::setDNSok(const std::string &host) const
 {
-  _dnsok.insert(host);
+  DnsCache::instance().setOk(host);
 }
 
 CURL *MediaMultiCurl::fromEasyPool(const std::string &host) const
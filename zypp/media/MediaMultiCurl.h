@@ -71,7 +71,7 @@ private:
   // the custom headers from MediaCurl plus a "Accept: metalink" header
   curl_slist *_customHeadersMetalink;
   mutable CURLM *_multi;	// reused for all fetches so we can make use of the dns cache
-  mutable std::set<std::string> _dnsok;
+  mutable std::set<std::string> _dnsok;	// unused, kept for ABI compatibility: the resolved hosts are cached process wide
   mutable std::map<std::string, CURL *> _easypool;
 };
 
@@ -0,0 +1,241 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/media/MirrorStats.cc
+ *
+*/
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include <zypp/base/Logger.h>
+#include <zypp/base/IOStream.h>
+#include <zypp/base/String.h>
+#include <zypp/PathInfo.h>
+#include <zypp/TmpPath.h>
+#include <zypp/ZConfig.h>
+
+#include <zypp/media/MirrorStats_p.h>
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace media
+  {
+    namespace
+    {
+      /** Weight of a new throughput/RTT sample in the moving average. */
+      constexpr double sampleWeight = 0.3;
+      /** Decay of the success/failure counts per recorded transfer. */
+      constexpr double countDecay = 0.9;
+
+      inline double average( double old_r, double sample_r )
+      { return old_r ? old_r * ( 1 - sampleWeight ) + sample_r * sampleWeight : sample_r; }
+
+      /** Expected throughput, counting failed transfers as zero. */
+      inline double expected( const MirrorStats::Entry & entry_r )
+      { return entry_r.throughput * ( 1 - entry_r.failureRate() ); }
+    } // namespace
+
+    constexpr Date::Duration MirrorStats::maxAge;
+
+    MirrorStats::MirrorStats()
+    {}
+
+    MirrorStats::MirrorStats( const Pathname & file_r )
+    : _file( file_r )
+    {
+      PathInfo pi( _file );
+      if ( ! pi.isFile() )
+        return;
+
+      std::ifstream inp( _file.c_str() );
+      iostr::simpleParseFile( inp, [this]( int num_r, std::string line_r )->bool
+      {
+        std::istringstream words( line_r );
+        std::string host;
+        Entry entry;
+        Date::ValueType lastSeen = 0;
+        if ( words >> host >> entry.throughput >> entry.rtt >> entry.successes >> entry.failures >> lastSeen )
+        {
+          entry.lastSeen = lastSeen;
+          _entries[host] = entry;
+        }
+        else
+          WAR << _file << ":" << num_r << ": ignore malformed line '" << line_r << "'" << endl;
+        return true;
+      } );
+      prune( Date::now() );
+      _dirty = false;
+      MIL << "Read " << _entries.size() << " mirror stats from " << _file << endl;
+    }
+
+    MirrorStats & MirrorStats::instance()
+    {
+      static MirrorStats _instance( [](){
+        const char *env = getenv( "ZYPP_MIRRORSTATS" );
+        if ( env && ! str::strToBool( env, true ) )
+        {
+          MIL << "ZYPP_MIRRORSTATS=" << env << ": mirror stats are not stored" << endl;
+          return Pathname();
+        }
+        return ZConfig::instance().repoCachePath() / "mirrorstats";
+      }() );
+      return _instance;
+    }
+
+    MirrorStats::Entry MirrorStats::get( const std::string & host_r ) const
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      auto it = _entries.find( host_r );
+      if ( it == _entries.end() || Date::now() - it->second.lastSeen > maxAge )
+        return Entry();
+      return it->second;
+    }
+
+    void MirrorStats::addTransfer( const std::string & host_r, double throughput_r, double rtt_r )
+    {
+      if ( host_r.empty() || throughput_r <= 0 )
+        return;
+      std::lock_guard<std::mutex> lock( _mutex );
+      Entry & entry( _entries[host_r] );
+      entry.throughput = average( entry.throughput, throughput_r );
+      if ( rtt_r > 0 )
+        entry.rtt = average( entry.rtt, rtt_r );
+      entry.successes = entry.successes * countDecay + 1;
+      entry.failures *= countDecay;
+      entry.lastSeen = Date::now();
+      _dirty = true;
+    }
+
+    void MirrorStats::addFailure( const std::string & host_r )
+    {
+      if ( host_r.empty() )
+        return;
+      std::lock_guard<std::mutex> lock( _mutex );
+      Entry & entry( _entries[host_r] );
+      entry.successes *= countDecay;
+      entry.failures = entry.failures * countDecay + 1;
+      entry.lastSeen = Date::now();
+      _dirty = true;
+    }
+
+    void MirrorStats::sort( std::vector<Url> & urls_r ) const
+    {
+      if ( urls_r.size() < 2 )
+        return;
+
+      std::vector<Entry> entries;
+      entries.reserve( urls_r.size() );
+      double best = 0;
+      for ( const Url & url : urls_r )
+      {
+        entries.push_back( get( url.getHost() ) );
+        if ( entries.back().failureRate() < 0.5 )
+          best = std::max( best, expected( entries.back() ) );
+      }
+
+      // 0: fast, 1: unknown, 2: slow, 3: failing
+      auto rank = [best]( const Entry & entry_r )->int
+      {
+        if ( ! entry_r.known() )
+          return 1;
+        if ( entry_r.failureRate() >= 0.5 )
+          return 3;
+        if ( ! entry_r.throughput )
+          return 1;
+        return expected( entry_r ) >= best / 4 ? 0 : 2;
+      };
+
+      std::vector<size_t> order( urls_r.size() );
+      for ( size_t i = 0; i < order.size(); ++i )
+        order[i] = i;
+      std::stable_sort( order.begin(), order.end(), [&]( size_t lhs, size_t rhs )->bool
+      {
+        int lrank = rank( entries[lhs] );
+        int rrank = rank( entries[rhs] );
+        if ( lrank != rrank )
+          return lrank < rrank;
+        return lrank == 0 && expected( entries[lhs] ) > expected( entries[rhs] );
+      } );
+
+      std::vector<Url> sorted;
+      sorted.reserve( urls_r.size() );
+      for ( size_t i : order )
+        sorted.push_back( std::move( urls_r[i] ) );
+      urls_r.swap( sorted );
+    }
+
+    void MirrorStats::save()
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      if ( ! _dirty || _file.empty() )
+        return;
+
+      prune( Date::now() );
+      _dirty = false;
+      if ( filesystem::assert_dir( _file.dirname() ) != 0 )
+      {
+        DBG << "Can't create " << _file.dirname() << ", mirror stats are not stored" << endl;
+        return;
+      }
+      filesystem::TmpFile tmp( filesystem::TmpFile::makeSibling( _file ) );
+      if ( ! tmp )
+      {
+        DBG << "Can't write " << _file << ", mirror stats are not stored" << endl;
+        return;
+      }
+      filesystem::chmod( tmp.path(), 0644 );
+
+      std::ofstream out( tmp.path().c_str() );
+      out << "# host throughput[B/s] rtt[s] successes failures lastseen" << endl;
+      for ( const auto & el : _entries )
+      {
+        const Entry & entry( el.second );
+        out << el.first << ' ' << entry.throughput << ' ' << entry.rtt << ' '
+            << entry.successes << ' ' << entry.failures << ' ' << Date::ValueType(entry.lastSeen) << '\n';
+      }
+      out.close();
+
+      if ( out.fail() || filesystem::rename( tmp.path(), _file ) != 0 )
+      {
+        ERR << "Can't write " << PathInfo(tmp.path()) << endl;
+        return;
+      }
+      DBG << "Wrote " << _entries.size() << " mirror stats to " << _file << endl;
+    }
+
+    void MirrorStats::prune( Date now_r )
+    {
+      for ( auto it = _entries.begin(); it != _entries.end(); )
+      {
+        if ( now_r - it->second.lastSeen > maxAge )
+        {
+          it = _entries.erase( it );
+          _dirty = true;
+        }
+        else
+          ++it;
+      }
+    }
+
+    std::ostream & operator<<( std::ostream & str, const MirrorStats::Entry & obj )
+    {
+      if ( ! obj.known() )
+        return str << "MirrorStats(unknown)";
+      return str << "MirrorStats(" << obj.throughput << " B/s, rtt " << obj.rtt << " s, failures " << obj.failureRate() << ", " << obj.lastSeen << ")";
+    }
+
+  } // namespace media
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
@@ -0,0 +1,132 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/media/MirrorStats_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_MEDIA_MIRRORSTATS_P_H
+#define ZYPP_MEDIA_MIRRORSTATS_P_H
+
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <zypp/APIConfig.h>
+#include <zypp/Date.h>
+#include <zypp/Pathname.h>
+#include <zypp/Url.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace media
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class MirrorStats
+    /// \brief Performance of the mirrors seen by metalink downloads.
+    ///
+    /// Remembers per mirror host the throughput and round trip time
+    /// observed by \ref MediaMultiCurl as well as how often transfers
+    /// succeeded or failed. Throughput and RTT are moving averages, the
+    /// success and failure counts decay, so the stats follow changes of
+    /// a mirror. Entries not seen for \ref maxAge are forgotten.
+    ///
+    /// The stats are used to put the mirrors of a metalink file into an
+    /// order starting with the fast ones, so subsequent downloads start on
+    /// them immediately. The global \ref instance is stored in the
+    /// \c mirrorstats file in \ref ZConfig::repoCachePath when a
+    /// \ref MediaMultiCurl is released, not after each download.
+    ///////////////////////////////////////////////////////////////////
+    class ZYPP_LOCAL MirrorStats
+    {
+    public:
+      /** Stats of one mirror host. */
+      struct Entry
+      {
+        double throughput = 0.0;	//< bytes/s
+        double rtt = 0.0;		//< seconds
+        double successes = 0.0;
+        double failures = 0.0;
+        Date lastSeen;
+
+        /** Whether there are stats for the mirror at all. */
+        bool known() const
+        { return lastSeen != Date(); }
+
+        /** Part of the transfers that failed [0,1]. */
+        double failureRate() const
+        { return ( successes + failures ) ? failures / ( successes + failures ) : 0.0; }
+      };
+
+      /** Entries not seen for this many seconds are forgotten (30 days). */
+      static constexpr Date::Duration maxAge = 30 * Date::day;
+
+    public:
+      /** Default ctor: in memory only, \ref save is a no-op. */
+      MirrorStats();
+
+      /** Ctor loading the stats stored in \a file_r (if it exists). */
+      explicit MirrorStats( const Pathname & file_r );
+
+      /** The stats shared by all downloads.
+       * They are kept in memory only if \c ZYPP_MIRRORSTATS=0 is set.
+       */
+      static MirrorStats & instance();
+
+    public:
+      /** The file the stats are stored in (empty if in memory only). */
+      const Pathname & file() const
+      { return _file; }
+
+      /** Stats of \a host_r (empty if unknown). */
+      Entry get( const std::string & host_r ) const;
+
+      /** Record a successful transfer from \a host_r.
+       * \a rtt_r may be \c 0 if it was not measured.
+       */
+      void addTransfer( const std::string & host_r, double throughput_r, double rtt_r = 0.0 );
+
+      /** Record a failed transfer from \a host_r. */
+      void addFailure( const std::string & host_r );
+
+      /** Stable sort \a urls_r putting the fastest known mirrors first.
+       *
+       * Mirrors reaching a quarter of the best known throughput come first
+       * ordered by their expected throughput, followed by the unknown ones,
+       * the slow ones and last the ones failing most of the time. Mirrors
+       * within the latter groups keep their order, as mirrors are usually
+       * ordered by priority already.
+       */
+      void sort( std::vector<Url> & urls_r ) const;
+
+      /** Store the stats if they changed. */
+      void save();
+
+    private:
+      /** Prune entries older than \ref maxAge. */
+      void prune( Date now_r );
+
+    private:
+      Pathname _file;
+      std::map<std::string, Entry> _entries;
+      bool _dirty = false;
+      mutable std::mutex _mutex;
+    };
+
+    /** \relates MirrorStats::Entry Stream output */
+    std::ostream & operator<<( std::ostream & str, const MirrorStats::Entry & obj );
+
+  } // namespace media
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_MEDIA_MIRRORSTATS_P_H
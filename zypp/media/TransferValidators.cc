@@ -0,0 +1,224 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/media/TransferValidators.cc
+ *
+*/
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#include <zypp/base/Logger.h>
+#include <zypp/base/IOStream.h>
+#include <zypp/base/String.h>
+#include <zypp/PathInfo.h>
+#include <zypp/TmpPath.h>
+#include <zypp/ZConfig.h>
+
+#include <zypp/media/TransferValidators_p.h>
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace media
+  {
+    namespace
+    {
+      /** The key for \a url_r (never contains a password). */
+      inline std::string key( const Url & url_r )
+      { return url_r.asString(); }
+
+      /** The checksum of \a file_r, empty if it is too big to remember validators for. */
+      inline std::string contentChecksum( const Pathname & file_r )
+      {
+        PathInfo pi( file_r );
+        if ( ! pi.isFile() || pi.size() > TransferValidators::maxFileSize )
+          return std::string();
+        return filesystem::sha1sum( file_r );
+      }
+
+      /** An ETag we can store (the file format is whitespace separated). */
+      inline bool storableETag( const std::string & etag_r )
+      { return etag_r.find_first_of( " \t\r\n" ) == std::string::npos; }
+    } // namespace
+
+    constexpr Date::Duration TransferValidators::maxAge;
+    constexpr off_t TransferValidators::maxFileSize;
+
+    TransferValidators::TransferValidators()
+    {}
+
+    TransferValidators::TransferValidators( const Pathname & file_r )
+    : _file( file_r )
+    {
+      PathInfo pi( _file );
+      if ( ! pi.isFile() )
+        return;
+
+      std::ifstream inp( _file.c_str() );
+      iostr::simpleParseFile( inp, [this]( int num_r, std::string line_r )->bool
+      {
+        std::istringstream words( line_r );
+        std::string url;
+        Entry entry;
+        Date::ValueType lastModified = 0;
+        Date::ValueType lastSeen = 0;
+        if ( words >> url >> entry.etag >> lastModified >> entry.checksum >> lastSeen )
+        {
+          if ( entry.etag == "-" )
+            entry.etag.clear();
+          entry.lastModified = lastModified;
+          entry.lastSeen = lastSeen;
+          _entries[url] = entry;
+        }
+        else
+          WAR << _file << ":" << num_r << ": ignore malformed line '" << line_r << "'" << endl;
+        return true;
+      } );
+      prune( Date::now() );
+      _dirty = false;
+      MIL << "Read " << _entries.size() << " transfer validators from " << _file << endl;
+    }
+
+    TransferValidators & TransferValidators::instance()
+    {
+      static TransferValidators _instance( ZConfig::instance().repoCachePath() / "validators" );
+      return _instance;
+    }
+
+    bool TransferValidators::enabled()
+    {
+      static bool _enabled = [](){
+        const char *env = getenv( "ZYPP_MEDIA_CURL_CONDITIONAL" );
+        if ( env && ! str::strToBool( env, true ) )
+        {
+          MIL << "ZYPP_MEDIA_CURL_CONDITIONAL=" << env << ": no conditional requests" << endl;
+          return false;
+        }
+        return true;
+      }();
+      return _enabled;
+    }
+
+    TransferValidators::Entry TransferValidators::lookup( const Url & url_r, const Pathname & localfile_r ) const
+    {
+      Entry ret;
+      {
+        std::lock_guard<std::mutex> lock( _mutex );
+        auto it = _entries.find( key( url_r ) );
+        if ( it == _entries.end() || Date::now() - it->second.lastSeen > maxAge )
+          return Entry();
+        ret = it->second;
+      }
+      if ( contentChecksum( localfile_r ) != ret.checksum )
+      {
+        DBG << localfile_r << " does not match the validators of " << url_r << endl;
+        return Entry();
+      }
+      return ret;
+    }
+
+    void TransferValidators::remember( const Url & url_r, const std::string & etag_r, Date lastModified_r, const Pathname & file_r )
+    {
+      Entry entry;
+      if ( storableETag( etag_r ) )
+        entry.etag = etag_r;
+      entry.lastModified = lastModified_r;
+      entry.checksum = contentChecksum( file_r );
+      entry.lastSeen = Date::now();
+
+      std::lock_guard<std::mutex> lock( _mutex );
+      auto it = _entries.find( key( url_r ) );
+      if ( it != _entries.end() && it->second.checksum == entry.checksum )
+      {
+        if ( entry.etag.empty() )
+          entry.etag = it->second.etag;
+        if ( entry.lastModified == Date() )
+          entry.lastModified = it->second.lastModified;
+      }
+
+      if ( entry.empty() || entry.checksum.empty() )
+      {
+        if ( it != _entries.end() )
+        {
+          _entries.erase( it );
+          _dirty = true;
+        }
+        return;
+      }
+      _entries[key( url_r )] = entry;
+      _dirty = true;
+    }
+
+    void TransferValidators::save()
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      if ( ! _dirty || _file.empty() )
+        return;
+
+      prune( Date::now() );
+      _dirty = false;
+      if ( filesystem::assert_dir( _file.dirname() ) != 0 )
+      {
+        DBG << "Can't create " << _file.dirname() << ", transfer validators are not stored" << endl;
+        return;
+      }
+      filesystem::TmpFile tmp( filesystem::TmpFile::makeSibling( _file ) );
+      if ( ! tmp )
+      {
+        DBG << "Can't write " << _file << ", transfer validators are not stored" << endl;
+        return;
+      }
+      filesystem::chmod( tmp.path(), 0644 );
+
+      std::ofstream out( tmp.path().c_str() );
+      out << "# url etag lastmodified sha1 lastseen" << endl;
+      for ( const auto & el : _entries )
+      {
+        const Entry & entry( el.second );
+        out << el.first << ' ' << ( entry.etag.empty() ? "-" : entry.etag ) << ' ' << Date::ValueType(entry.lastModified) << ' '
+            << entry.checksum << ' ' << Date::ValueType(entry.lastSeen) << '\n';
+      }
+      out.close();
+
+      if ( out.fail() || filesystem::rename( tmp.path(), _file ) != 0 )
+      {
+        ERR << "Can't write " << PathInfo(tmp.path()) << endl;
+        return;
+      }
+      DBG << "Wrote " << _entries.size() << " transfer validators to " << _file << endl;
+    }
+
+    void TransferValidators::prune( Date now_r )
+    {
+      for ( auto it = _entries.begin(); it != _entries.end(); )
+      {
+        if ( now_r - it->second.lastSeen > maxAge )
+        {
+          it = _entries.erase( it );
+          _dirty = true;
+        }
+        else
+          ++it;
+      }
+    }
+
+    std::ostream & operator<<( std::ostream & str, const TransferValidators::Entry & obj )
+    {
+      if ( obj.empty() )
+        return str << "TransferValidators(none)";
+      return str << "TransferValidators(" << ( obj.etag.empty() ? "-" : obj.etag ) << ", " << obj.lastModified << ", " << obj.checksum << ")";
+    }
+
+  } // namespace media
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
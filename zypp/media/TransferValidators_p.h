@@ -0,0 +1,129 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/media/TransferValidators_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_MEDIA_TRANSFERVALIDATORS_P_H
+#define ZYPP_MEDIA_TRANSFERVALIDATORS_P_H
+
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+#include <zypp/APIConfig.h>
+#include <zypp/Date.h>
+#include <zypp/Pathname.h>
+#include <zypp/Url.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace media
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class TransferValidators
+    /// \brief The ETag and Last-Modified header of downloaded files.
+    ///
+    /// Files like the master index of a repo or a mirror list are downloaded
+    /// again and again just to find out that they did not change. If the
+    /// download passes the previously downloaded copy as \c deltafile, the
+    /// media backends look up the validators the server sent along with that
+    /// copy and make the request conditional (\c If-None-Match,
+    /// \c If-Modified-Since). If the server answers \c 304 (Not Modified),
+    /// the copy is provided instead.
+    ///
+    /// The validators are remembered per URL together with the checksum of
+    /// the content they were sent with, so they are only used if the local
+    /// copy is exactly that content. Files bigger than \ref maxFileSize are
+    /// not remembered; large metadata files are referenced by checksum from
+    /// the master index and are never downloaded again unchanged. Entries
+    /// not used for \ref maxAge are forgotten.
+    ///////////////////////////////////////////////////////////////////
+    class ZYPP_LOCAL TransferValidators
+    {
+    public:
+      /** Validators of one URL. */
+      struct Entry
+      {
+        std::string etag;	//< as sent by the server, including the quotes
+        Date lastModified;
+        std::string checksum;	//< sha1 of the content they were sent with
+        Date lastSeen;
+
+        /** Whether there are no validators. */
+        bool empty() const
+        { return etag.empty() && lastModified == Date(); }
+      };
+
+      /** Entries not used for this many seconds are forgotten (30 days). */
+      static constexpr Date::Duration maxAge = 30 * Date::day;
+
+      /** Validators of bigger files are not remembered (1 MiB). */
+      static constexpr off_t maxFileSize = 1024 * 1024;
+
+    public:
+      /** Default ctor: in memory only, \ref save is a no-op. */
+      TransferValidators();
+
+      /** Ctor loading the validators stored in \a file_r (if it exists). */
+      explicit TransferValidators( const Pathname & file_r );
+
+      /** The validators shared by all downloads, stored in
+       * \c validators in \ref ZConfig::repoCachePath.
+       */
+      static TransferValidators & instance();
+
+      /** Whether the media backends should send conditional requests.
+       * Not if \c ZYPP_MEDIA_CURL_CONDITIONAL=0 is set.
+       */
+      static bool enabled();
+
+    public:
+      /** The file the validators are stored in (empty if in memory only). */
+      const Pathname & file() const
+      { return _file; }
+
+      /** The validators of \a url_r, if \a localfile_r holds the content they were sent with.
+       * Otherwise (or if there are none) an empty \ref Entry is returned.
+       */
+      Entry lookup( const Url & url_r, const Pathname & localfile_r ) const;
+
+      /** Remember the validators of a response for \a url_r, whose content is now in \a file_r.
+       * Missing validators are taken from the entry for the same content, as a
+       * \c 304 response does not need to repeat them. If there are none at all,
+       * \a url_r is forgotten.
+       */
+      void remember( const Url & url_r, const std::string & etag_r, Date lastModified_r, const Pathname & file_r );
+
+      /** Store the validators if they changed. */
+      void save();
+
+    private:
+      /** Prune entries older than \ref maxAge. */
+      void prune( Date now_r );
+
+    private:
+      Pathname _file;
+      std::map<std::string, Entry> _entries;
+      bool _dirty = false;
+      mutable std::mutex _mutex;
+    };
+
+    /** \relates TransferValidators::Entry Stream output */
+    std::ostream & operator<<( std::ostream & str, const TransferValidators::Entry & obj );
+
+  } // namespace media
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_MEDIA_TRANSFERVALIDATORS_P_H
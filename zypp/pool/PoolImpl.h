@@ -370,6 +370,11 @@ namespace zypp
 	    bool reusedIDs = _watcherIDs.remember( pool.serialIDs() );
             std::list<PoolItem> addedProducts;
 
+	    for ( size_t i = pool.capacity(); i < _store.size(); ++i )
+	    {
+	      if ( _store[i] )
+		_store[i].detachStatus();	// the pool shrunk
+	    }
 	    _store.resize( pool.capacity() );
 
             if ( pool.capacity() )
@@ -381,11 +386,14 @@ namespace zypp
                 if ( ! s &&  pi )
                 {
                   // the PoolItem got invalidated (e.g unloaded repo)
+                  pi.detachStatus();
                   pi = PoolItem();
                 }
                 else if ( reusedIDs || (s && ! pi) )
                 {
                   // new PoolItem to add
+                  if ( pi )
+                    pi.detachStatus();
                   pi = PoolItem::makePoolItem( s ); // the only way to create a new one!
                   // remember products for buddy processing (requires clean store)
                   if ( s.isKind( ResKind::product ) )
@@ -0,0 +1,151 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/pool/StatusStore.cc
+ *
+*/
+extern "C"
+{
+#include <solv/bitmap.h>
+}
+#include <iostream>
+#include <cstring>
+#include <stdint.h>
+
+#include <zypp/base/LogTools.h>
+#include <zypp/pool/StatusStore_p.h>
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace pool
+  {
+    constexpr StatusStore::IdType StatusStore::blockSize;
+
+    StatusStore & StatusStore::instance()
+    {
+      // never destructed: PoolItems in static objects may outlive the pool
+      static StatusStore * _instance = new StatusStore;
+      return *_instance;
+    }
+
+    StatusStore::StatusStore()
+    {}
+
+    ResStatus & StatusStore::slot( IdType id_r )
+    {
+      IdType block = id_r / blockSize;
+      while ( block >= _blocks.size() )
+        _blocks.emplace_back( new ResStatus[blockSize] );
+      return _blocks[block][id_r % blockSize];
+    }
+
+    ResStatus & StatusStore::assign( IdType id_r, const ResStatus & status_r )
+    {
+      _buddies.erase( id_r );
+      ResStatus & ret( slot( id_r ) );
+      ret = status_r;
+      return ret;
+    }
+
+    void StatusStore::release( IdType id_r )
+    {
+      _buddies.erase( id_r );
+      slot( id_r ) = ResStatus();
+    }
+
+    void StatusStore::setBuddy( IdType id_r, IdType buddy_r )
+    { _buddies[id_r] = buddy_r; }
+
+    ResStatus & StatusStore::status( IdType id_r )
+    {
+      if ( ! _buddies.empty() )
+      {
+        auto it( _buddies.find( id_r ) );
+        if ( it != _buddies.end() )
+          id_r = it->second;
+      }
+      return slot( id_r );
+    }
+
+    void StatusStore::resetTransact( ResStatus::TransactByValue causer_r, bool transactingOnly_r )
+    {
+      for ( const auto & block : _blocks )
+        ResStatus::resetTransactAll( block.get(), block.get() + blockSize, causer_r, transactingOnly_r );
+    }
+
+    size_t StatusStore::setToBeInstalled( const sat::Map & ids_r, ResStatus::TransactByValue causer_r )
+    {
+      const sat::detail::CMap * map = ids_r;
+      size_t ret = 0;
+      for ( int byte = 0; byte < map->size; )
+      {
+        if ( byte + 8 <= map->size )
+        {
+          uint64_t word;
+          ::memcpy( &word, map->map + byte, sizeof(word) );
+          if ( ! word )
+          {
+            byte += 8;
+            continue;
+          }
+        }
+        for ( unsigned bit = 0; bit < 8; ++bit )
+        {
+          if ( map->map[byte] & ( 1 << bit ) )
+          {
+            // like SATResolver did per item
+            ResStatus & itemStatus( status( byte * 8 + bit ) );
+            itemStatus.resetTransact( causer_r );
+            itemStatus.resetWeak();
+            itemStatus.setToBeInstalled( causer_r );
+            ++ret;
+          }
+        }
+        ++byte;
+      }
+      return ret;
+    }
+
+    size_t StatusStore::countToBeInstalled() const
+    {
+      size_t ret = 0;
+      for ( const auto & block : _blocks )
+        ret += ResStatus::countToBeInstalled( block.get(), block.get() + blockSize );
+      return ret;
+    }
+
+    size_t StatusStore::countToBeUninstalled() const
+    {
+      size_t ret = 0;
+      for ( const auto & block : _blocks )
+        ret += ResStatus::countToBeUninstalled( block.get(), block.get() + blockSize );
+      return ret;
+    }
+
+    size_t StatusStore::countLocked() const
+    {
+      size_t ret = 0;
+      for ( const auto & block : _blocks )
+        ret += ResStatus::countLocked( block.get(), block.get() + blockSize );
+      return ret;
+    }
+
+    std::ostream & operator<<( std::ostream & str, const StatusStore & obj )
+    {
+      return str << "StatusStore(" << obj._blocks.size() * StatusStore::blockSize << " slots, "
+                 << obj._buddies.size() << " buddies)";
+    }
+
+  } // namespace pool
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
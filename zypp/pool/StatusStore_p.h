@@ -0,0 +1,117 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/pool/StatusStore_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_POOL_STATUSSTORE_P_H
+#define ZYPP_POOL_STATUSSTORE_P_H
+
+#include <iosfwd>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <zypp/APIConfig.h>
+#include <zypp/base/NonCopyable.h>
+#include <zypp/ResStatus.h>
+#include <zypp/sat/Map.h>
+#include <zypp/sat/detail/PoolMember.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace pool
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class StatusStore
+    /// \brief The \ref ResStatus of all \ref PoolItem s, indexed by solvable id.
+    ///
+    /// Instead of each \ref PoolItem holding its own status, the statuses
+    /// are stored densely in blocks of \ref blockSize. Blocks are never
+    /// moved or freed, so the \c ResStatus& handed out by
+    /// \ref PoolItem::status stay valid while the pool grows.
+    ///
+    /// Operations concerning the whole pool (resetting the transactions
+    /// before solving, counting the transactions, ...) run over the blocks
+    /// (\see ResStatus::resetTransactAll) instead of visiting each
+    /// \ref PoolItem.
+    ///
+    /// A \ref PoolItem leaving the pool \ref release s its slot and takes
+    /// a copy of its status with it. A product sharing the status of its
+    /// reference package (\ref PoolItem::buddy) keeps an unused slot, so
+    /// the bulk operations see each status once.
+    ///////////////////////////////////////////////////////////////////
+    class ZYPP_LOCAL StatusStore : private base::NonCopyable
+    {
+      friend std::ostream & operator<<( std::ostream & str, const StatusStore & obj );
+
+    public:
+      typedef sat::detail::SolvableIdType IdType;
+
+      /** Number of statuses per block. */
+      static constexpr IdType blockSize = 4096;
+
+      /** The store used by the \ref ResPool. */
+      static StatusStore & instance();
+
+    public:
+      /** Initialize the status of solvable \a id_r to \a status_r. */
+      ResStatus & assign( IdType id_r, const ResStatus & status_r );
+
+      /** The \ref PoolItem using the slot of \a id_r left the pool. */
+      void release( IdType id_r );
+
+      /** Solvable \a id_r uses the status of \a buddy_r. */
+      void setBuddy( IdType id_r, IdType buddy_r );
+
+      /** The status of solvable \a id_r (or of its buddy). */
+      ResStatus & status( IdType id_r );
+
+    public:
+      /** \ref ResStatus::resetTransactAll on all statuses. */
+      void resetTransact( ResStatus::TransactByValue causer_r, bool transactingOnly_r = false );
+
+      /** Set the solvables in \a ids_r to be installed by \a causer_r,
+       * resetting their former transaction and weak bits. Zero words
+       * in \a ids_r are skipped at once.
+       * \return The number of solvables in \a ids_r.
+       */
+      size_t setToBeInstalled( const sat::Map & ids_r, ResStatus::TransactByValue causer_r );
+
+      /** The number of statuses which \ref ResStatus::isToBeInstalled. */
+      size_t countToBeInstalled() const;
+
+      /** The number of statuses which \ref ResStatus::isToBeUninstalled. */
+      size_t countToBeUninstalled() const;
+
+      /** The number of statuses which \ref ResStatus::isLocked. */
+      size_t countLocked() const;
+
+    private:
+      StatusStore();
+
+      /** The slot of \a id_r, allocating its block if needed. */
+      ResStatus & slot( IdType id_r );
+
+    private:
+      std::vector<std::unique_ptr<ResStatus[]>> _blocks;
+      std::unordered_map<IdType,IdType> _buddies;
+    };
+    ///////////////////////////////////////////////////////////////////
+
+    /** \relates StatusStore Stream output */
+    std::ostream & operator<<( std::ostream & str, const StatusStore & obj );
+
+  } // namespace pool
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_POOL_STATUSSTORE_P_H
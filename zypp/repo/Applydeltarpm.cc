@@ -10,6 +10,7 @@
  *
 */
 #include <iostream>
+#include <mutex>
 
 #include <zypp/base/Logger.h>
 #include <zypp/base/String.h>
@@ -69,6 +70,9 @@ namespace zypp
     bool haveApplydeltarpm()
     {
       // To track changes in availability of applydeltarpm.
+      // (rpms may be built by several threads)
+      static std::mutex _mutex;
+      std::lock_guard<std::mutex> lock( _mutex );
       static TriBool _last = indeterminate;
       PathInfo prog( applydeltarpm_prog );
       bool have = prog.isX();
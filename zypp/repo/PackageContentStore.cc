@@ -0,0 +1,142 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/repo/PackageContentStore.cc
+ *
+*/
+#include <iostream>
+#include <fstream>
+#include <list>
+
+#include <zypp/base/LogTools.h>
+#include <zypp/PathInfo.h>
+
+#include <zypp/repo/PackageContentStore_p.h>
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace repo
+  {
+    const std::string & PackageContentStore::dirName()
+    {
+      static const std::string _name( ".content" );	// not a valid alias
+      return _name;
+    }
+
+    PackageContentStore::PackageContentStore( const Pathname & packagesCachePath_r )
+    : _root( packagesCachePath_r / dirName() )
+    {}
+
+    Pathname PackageContentStore::entry( const CheckSum & checksum_r ) const
+    {
+      const std::string & sum( checksum_r.checksum() );
+      if ( checksum_r.empty() || sum.size() < 3 )
+	return Pathname();
+      return _root / checksum_r.type() / sum.substr( 0, 2 ) / sum;
+    }
+
+    bool PackageContentStore::has( const CheckSum & checksum_r ) const
+    {
+      Pathname file( entry( checksum_r ) );
+      return ! file.empty() && PathInfo( file ).isFile();
+    }
+
+    bool PackageContentStore::provide( const CheckSum & checksum_r, const Pathname & dest_r ) const
+    {
+      Pathname file( entry( checksum_r ) );
+      if ( file.empty() || ! PathInfo( file ).isFile() )
+	return false;
+
+      if ( CheckSum( checksum_r.type(), std::ifstream( file.c_str() ) ) != checksum_r )
+      {
+	WAR << "Remove corrupted " << file << endl;
+	filesystem::unlink( file );
+	return false;
+      }
+
+      if ( filesystem::assert_dir( dest_r.dirname() ) != 0 )
+	return false;
+      if ( PathInfo( dest_r ).isExist() )
+	filesystem::unlink( dest_r );	// not a valid package, otherwise we'd have a cache hit
+      if ( filesystem::hardlinkCopy( file, dest_r ) != 0 )
+	return false;
+
+      DBG << "Provided " << dest_r << " from " << file << endl;
+      return true;
+    }
+
+    bool PackageContentStore::add( const CheckSum & checksum_r, const Pathname & file_r ) const
+    {
+      Pathname file( entry( checksum_r ) );
+      if ( file.empty() || ! PathInfo( file_r ).isFile() )
+	return false;
+      if ( PathInfo( file ).isExist() )
+	return true;
+
+      // no copy, it would not save anything
+      if ( filesystem::assert_dir( file.dirname() ) != 0 || filesystem::hardlink( file_r, file ) != 0 )
+      {
+	DBG << "Can't store " << file_r << " as " << file << endl;
+	return false;
+      }
+      DBG << "Stored " << file_r << " as " << file << endl;
+      return true;
+    }
+
+    unsigned PackageContentStore::gc() const
+    {
+      unsigned removed = 0;
+      if ( ! PathInfo( _root ).isDir() )
+	return removed;
+
+      std::list<Pathname> types;
+      filesystem::readdir( types, _root, false );
+      for ( const Pathname & type : types )
+      {
+	std::list<Pathname> subdirs;
+	filesystem::readdir( subdirs, type, false );
+	unsigned keptSubdirs = 0;
+	for ( const Pathname & subdir : subdirs )
+	{
+	  std::list<Pathname> files;
+	  filesystem::readdir( files, subdir, false );
+	  unsigned kept = 0;
+	  for ( const Pathname & file : files )
+	  {
+	    PathInfo pi( file, PathInfo::LSTAT );
+	    if ( pi.isFile() && pi.nlink() > 1 )
+	    {
+	      ++kept;	// still in a repo cache
+	      continue;
+	    }
+	    if ( pi.isDir() ? filesystem::recursive_rmdir( file ) == 0 : filesystem::unlink( file ) == 0 )
+	      ++removed;
+	    else
+	      ++kept;
+	  }
+	  if ( kept || filesystem::rmdir( subdir ) != 0 )
+	    ++keptSubdirs;
+	}
+	if ( ! keptSubdirs )
+	  filesystem::rmdir( type );
+      }
+      MIL << "Removed " << removed << " unused entries from " << _root << endl;
+      return removed;
+    }
+
+    std::ostream & operator<<( std::ostream & str, const PackageContentStore & obj )
+    { return str << "PackageContentStore(" << obj.root() << ")"; }
+
+  } // namespace repo
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
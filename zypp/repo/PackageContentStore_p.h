@@ -0,0 +1,105 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/repo/PackageContentStore_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_REPO_PACKAGECONTENTSTORE_P_H
+#define ZYPP_REPO_PACKAGECONTENTSTORE_P_H
+
+#include <iosfwd>
+#include <string>
+
+#include <zypp/APIConfig.h>
+#include <zypp/Pathname.h>
+#include <zypp/CheckSum.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace repo
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class PackageContentStore
+    /// \brief Packages in the cache stored by their checksum.
+    ///
+    /// The package cache is kept per repo alias, so the same rpm provided
+    /// by several repos (update and pool repo, services mirroring the same
+    /// content) would be downloaded and stored once per repo. The store
+    /// is a directory next to the per repo caches (\c packages/.content),
+    /// holding a hardlink of every cached package named after it's
+    /// checksum (\c .content/<type>/<first 2 digits>/<checksum>).
+    ///
+    /// Before downloading a package, \ref provide looks it up and links it
+    /// into the repos cache. Packages kept in a repos cache are \ref add ed
+    /// to the store. As store and caches share the files, this costs no
+    /// extra space. An entry no cache links to anymore is removed by \ref gc.
+    ///
+    /// \code
+    ///   PackageContentStore store( info.packagesPath().dirname() );
+    ///   if ( store.provide( loc.checksum(), dest ) )
+    ///     return ManagedFile( dest );
+    ///   ...download to dest...
+    ///   store.add( loc.checksum(), dest );
+    /// \endcode
+    ///////////////////////////////////////////////////////////////////
+    class ZYPP_LOCAL PackageContentStore
+    {
+      friend std::ostream & operator<<( std::ostream & str, const PackageContentStore & obj );
+
+    public:
+      /** Name of the store below the package cache dir. */
+      static const std::string & dirName();
+
+      /** Ctor for the store of the repo caches below \a packagesCachePath_r. */
+      explicit PackageContentStore( const Pathname & packagesCachePath_r );
+
+    public:
+      /** The stores directory. */
+      const Pathname & root() const
+      { return _root; }
+
+      /** Where the package with \a checksum_r is stored (empty if \a checksum_r is empty). */
+      Pathname entry( const CheckSum & checksum_r ) const;
+
+      /** Whether the package with \a checksum_r is stored. */
+      bool has( const CheckSum & checksum_r ) const;
+
+      /** Create \a dest_r as hardlink (or copy) of the package with \a checksum_r.
+       * The stored file is checked against \a checksum_r first and removed if
+       * it does not match.
+       * \return Whether \a dest_r was created.
+       */
+      bool provide( const CheckSum & checksum_r, const Pathname & dest_r ) const;
+
+      /** Store a hardlink of \a file_r which matches \a checksum_r.
+       * If \a file_r is on a different filesystem, it is not stored.
+       * \return Whether the package is stored.
+       */
+      bool add( const CheckSum & checksum_r, const Pathname & file_r ) const;
+
+      /** Remove the entries not linked from any repo cache.
+       * \return The number of entries removed.
+       */
+      unsigned gc() const;
+
+    private:
+      Pathname _root;
+    };
+    ///////////////////////////////////////////////////////////////////
+
+    /** \relates PackageContentStore Stream output */
+    std::ostream & operator<<( std::ostream & str, const PackageContentStore & obj );
+
+  } // namespace repo
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_REPO_PACKAGECONTENTSTORE_P_H
@@ -19,6 +19,7 @@
 #include <zypp/base/NonCopyable.h>
 #include <zypp/repo/PackageProvider.h>
 #include <zypp/repo/Applydeltarpm.h>
+#include <zypp/repo/PackageContentStore_p.h>
 #include <zypp/repo/PackageDelta.h>
 
 #include <zypp/TmpPath.h>
@@ -405,6 +406,56 @@ namespace zypp
 	}
       }
 
+      // Check the content store shared by all repos
+      PackageContentStore contentStore( info.packagesPath().dirname() );
+      {
+	const OnMediaLocation & loc( _package->location() );
+	if ( contentStore.has( loc.checksum() ) )
+	{
+	  const Pathname & dest( info.packagesPath() / info.path() / loc.filename() );
+	  report()->start( _package, contentStore.entry( loc.checksum() ).asFileUrl() );
+	  if ( contentStore.provide( loc.checksum(), dest ) )
+	  {
+	    ret = ManagedFile( dest );
+	    if ( ! info.keepPackages() )
+	      ret.setDispose( filesystem::unlink );
+
+	    // The entry may have been stored for a repo not checking the signature.
+	    try
+	    {
+	      rpmSigFileChecker( dest );
+	    }
+	    catch ( const RpmSigCheckException & excpt )
+	    {
+	      ERR << "Failed to provide Package from content store " << _package << endl;
+	      ret.setDispose( filesystem::unlink );
+	      ret.reset();
+	      // Signature verification error was already reported by the
+	      // rpmSigFileChecker. Just handle the users action decision:
+	      switch ( excpt.action() )
+	      {
+		case repo::DownloadResolvableReport::RETRY:
+		  break;	// download it
+		case repo::DownloadResolvableReport::IGNORE:
+		  ZYPP_THROW(SkipRequestException("User requested skip of corrupted file"));
+		  break;
+		default:
+		case repo::DownloadResolvableReport::ABORT:
+		  ZYPP_THROW(AbortRequestException("User requested to abort"));
+		  break;
+	      }
+	    }
+
+	    if ( ! ret->empty() )
+	    {
+	      MIL << "provided Package from content store " << _package << " at " << ret << endl;
+	      report()->finish( _package, repo::DownloadResolvableReport::NO_ERROR, std::string() );
+	      return ret; // <-- content store hit
+	    }
+	  }
+	}
+      }
+
       // FIXME we only support the first url for now.
       if ( info.baseUrlsEmpty() )
         ZYPP_THROW(Exception("No url in repository."));
@@ -509,6 +560,10 @@ namespace zypp
 	throw;
       }
 
+      // share packages we keep with other repos providing them
+      if ( info.keepPackages() )
+	contentStore.add( _package->location().checksum(), ret );
+
       report()->finish( _package, repo::DownloadResolvableReport::NO_ERROR, std::string() );
       MIL << "provided Package " << _package << " at " << ret << endl;
       return ret;
@@ -555,8 +610,10 @@ namespace zypp
     ManagedFile RpmPackageProvider::doProvidePackage() const
     {
       // check whether to process patch/delta rpms
+      // (not if the rpm was already downloaded or built for us)
       // FIXME we only check the first url for now.
       if ( ZConfig::instance().download_use_deltarpm()
+	&& ! _access.inCacheRoot( _package->repoInfo(), _package->location() )
 	&& ( _package->repoInfo().url().schemeIsDownloading() || ZConfig::instance().download_use_deltarpm_always() ) )
       {
 	std::list<DeltaRpm> deltaRpms;
@@ -45,13 +45,17 @@ namespace zypp
 	RepoMirrorListTempProvider( const Pathname & localfile_r )
 	: _localfile( localfile_r )
 	{}
-	RepoMirrorListTempProvider( const Url & url_r )
+	/** Download the mirror list at \a url_r. If \a cachefile_r is the copy
+	 * downloaded last time, it's only downloaded again if it changed.
+	 */
+	RepoMirrorListTempProvider( const Url & url_r, const Pathname & cachefile_r = Pathname() )
 	{
 	  Url abs_url( url_r );
 	  abs_url.setPathName( "/" );
 	  abs_url.setQueryParam( "mediahandler", "curl" );
 	  _access.reset( new MediaSetAccess( abs_url ) );
-	  _localfile = _access->provideFile( url_r.getPathName() );
+	  _localfile = _access->provideFile( OnMediaLocation( url_r.getPathName() ), MediaSetAccess::PROVIDE_DEFAULT,
+					     PathInfo( cachefile_r ).isFile() ? cachefile_r : Pathname() );
 	}
 
 	const Pathname & localfile() const
@@ -149,7 +153,7 @@ namespace zypp
 	if ( !cacheinfo.isFile() || cacheinfo.mtime() < time(NULL) - (long) ZConfig::instance().repo_refresh_delay() * 60 )
 	{
 	  DBG << "Getting MirrorList from URL: " << url_r << endl;
-	  RepoMirrorListTempProvider provider( url_r );	// RAII: lifetime of downloaded file
+	  RepoMirrorListTempProvider provider( url_r, cachefile );	// RAII: lifetime of downloaded file
 
 	  // Create directory, if not existing
 	  DBG << "Copy MirrorList file to " << cachefile << endl;
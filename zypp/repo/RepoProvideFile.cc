@@ -228,6 +228,7 @@ namespace zypp
 
       public:
         ProvideFilePolicy _defaultPolicy;
+        std::set<Pathname> _cacheRoots;
     };
     ///////////////////////////////////////////////////////////////////
 
@@ -245,6 +246,19 @@ namespace zypp
     const ProvideFilePolicy & RepoMediaAccess::defaultPolicy() const
     { return _impl->_defaultPolicy; }
 
+    void RepoMediaAccess::addCacheRoot( const Pathname & root_r )
+    { _impl->_cacheRoots.insert( root_r ); }
+
+    bool RepoMediaAccess::inCacheRoot( const RepoInfo & repo_r, const OnMediaLocation & loc_r ) const
+    {
+      for ( const Pathname & root : _impl->_cacheRoots )
+      {
+        if ( PathInfo( root / repo_r.alias() / repo_r.path() / loc_r.filename() ).isFile() )
+          return true;
+      }
+      return false;
+    }
+
     ManagedFile RepoMediaAccess::provideFile( RepoInfo repo_r,
                                               const OnMediaLocation & loc_rx,
                                               const ProvideFilePolicy & policy_r )
@@ -271,6 +285,15 @@ namespace zypp
       Fetcher fetcher;
       fetcher.addCachePath( repo_r.packagesPath() );
       MIL << "Added cache path " << repo_r.packagesPath() << endl;
+      for ( const Pathname & root : _impl->_cacheRoots )
+      {
+        Pathname cachePath( root / repo_r.alias() );
+        if ( PathInfo( cachePath ).isDir() )
+        {
+          fetcher.addCachePath( cachePath );
+          MIL << "Added cache path " << cachePath << endl;
+        }
+      }
 
       // Test whether download destination is writable, if not
       // switch into the tmpspace (e.g. bnc#755239, download and
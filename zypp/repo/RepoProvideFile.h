@@ -88,6 +88,18 @@ namespace zypp
       /** Get the current default \ref ProvideFilePolicy. */
       const ProvideFilePolicy & defaultPolicy() const;
 
+      /** Also look for already downloaded files below \a root_r.
+       * A repos files are expected in \c root_r/alias/. Files found
+       * there with a matching checksum are used instead of downloading
+       * them, but pass the same \ref ProvideFilePolicy::fileChecker.
+       */
+      void addCacheRoot( const Pathname & root_r );
+
+      /** Whether \a loc_r of \a repo_r is below one of the \ref addCacheRoot dirs.
+       * It's verified when it's provided, not here.
+       */
+      bool inCacheRoot( const RepoInfo & repo_r, const OnMediaLocation & loc_r ) const;
+
    private:
       class Impl;
        RW_pointer<Impl> _impl;
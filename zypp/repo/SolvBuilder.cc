@@ -0,0 +1,261 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/repo/SolvBuilder.cc
+ *
+*/
+extern "C"
+{
+#include <solv/solvversion.h>
+#include <solv/pool.h>
+#include <solv/repo.h>
+#include <solv/repo_write.h>
+#include <solv/solv_xfopen.h>
+#include <solv/repo_repomdxml.h>
+#include <solv/repo_rpmmd.h>
+#include <solv/repo_updateinfoxml.h>
+#include <solv/repo_deltainfoxml.h>
+#include <solv/repo_autopattern.h>
+#if defined(LIBSOLVEXT_FEATURE_APPDATA)
+#include <solv/repo_appdata.h>
+#endif
+#if defined(LIBSOLVEXT_FEATURE_COMPS)
+#include <solv/repo_comps.h>
+#endif
+}
+#include <iostream>
+#include <map>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <zypp/base/LogTools.h>
+#include <zypp/base/String.h>
+#include <zypp/PathInfo.h>
+#include <zypp/parser/yum/RepomdFileReader.h>
+
+#include <zypp/repo/SolvBuilder_p.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace repo
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace
+    {
+      /** Map a repomd.xml resource type to the parser handling it.
+       * \return \c false if the type is not known to us.
+       */
+      bool parserForType( const std::string & basetype_r, SolvBuilder::Input::Parser & parser_r, std::string & language_r )
+      {
+	typedef SolvBuilder::Input Input;
+	if ( basetype_r == "primary" )
+	  parser_r = Input::Rpmmd;
+	else if ( basetype_r == "susedata" )
+	  parser_r = Input::Rpmmd;
+	else if ( str::startsWith( basetype_r, "susedata." ) )
+	{
+	  parser_r = Input::Rpmmd;
+	  language_r = basetype_r.substr( 9 );
+	}
+	else if ( basetype_r == "updateinfo" )
+	  parser_r = Input::Updateinfo;
+	else if ( basetype_r == "deltainfo" || basetype_r == "prestodelta" )
+	  parser_r = Input::Deltainfo;
+#if defined(LIBSOLVEXT_FEATURE_APPDATA)
+	else if ( basetype_r == "appdata" )
+	  parser_r = Input::Appdata;
+#endif
+#if defined(LIBSOLVEXT_FEATURE_COMPS)
+	else if ( basetype_r == "group" || basetype_r == "group_gz" )
+	  parser_r = Input::Comps;
+#endif
+	else
+	  return false;
+	return true;
+      }
+
+      /** The order repo2solv feeds the files into the pool.
+       * Solvables must be created (primary) before they can be extended.
+       */
+      unsigned rank( const SolvBuilder::Input & input_r )
+      {
+	switch ( input_r._parser )
+	{
+	  case SolvBuilder::Input::Repomd:	return 0;
+	  case SolvBuilder::Input::Rpmmd:	return input_r._type == "primary" ? 1 : 2;
+	  default:				break;
+	}
+	return 3;
+      }
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
+
+    SolvBuilder::SolvBuilder( const RepoType & repokind_r, const Pathname & productdatapath_r )
+    {
+      if ( repokind_r != RepoType::RPMMD )
+	return;	// not (yet) handled here
+
+      Pathname repomd { productdatapath_r / "repodata/repomd.xml" };
+      if ( ! PathInfo( repomd ).isFile() )
+	return;
+
+      // basetype -> input (prefer zchunk)
+      std::map<std::string,Input> wanted;
+      bool unhandledZchunk = false;
+
+      try
+      {
+	parser::yum::RepomdFileReader( repomd, [&]( OnMediaLocation && loc_r, const std::string & typestr_r ) -> bool
+	{
+	  if ( str::endsWith( typestr_r, "_db" ) )
+	    return true;	// skip sqlitedb
+
+	  bool zchk { str::endsWith( typestr_r, "_zck" ) };
+	  const std::string & basetype { zchk ? typestr_r.substr( 0, typestr_r.size()-4 ) : typestr_r };
+
+	  if ( basetype == "other" || basetype == "filelists" || basetype == "appdata-icons" )
+	    return true;	// not used by zypp
+
+	  Pathname file { productdatapath_r / loc_r.filename() };
+	  if ( ! PathInfo( file ).isFile() )
+	    return true;	// not downloaded (e.g. unwanted locale)
+
+#if !defined(LIBSOLVEXT_FEATURE_ZCHUNK_COMPRESSION)
+	  if ( zchk )
+	  {
+	    unhandledZchunk = true;	// unexpected, but let repo2solv decide
+	    return true;
+	  }
+#endif
+	  Input input;
+	  if ( ! parserForType( basetype, input._parser, input._language ) )
+	  {
+	    // like repo2solv: e.g. 'suseinfo' is downloaded but not used
+	    DBG << "Ignore metadata type '" << typestr_r << "' in " << repomd << endl;
+	    return true;
+	  }
+	  input._file = file;
+	  input._type = basetype;
+
+	  if ( zchk || ! wanted.count( basetype ) )
+	    wanted[basetype] = std::move(input);
+	  return true;
+	} );
+      }
+      catch ( const Exception & excpt )
+      {
+	ZYPP_CAUGHT( excpt );
+	return;	// let repo2solv report the error
+      }
+
+      if ( unhandledZchunk || ! wanted.count( "primary" ) )
+	return;
+
+      _inputs.push_back( Input{ Input::Repomd, repomd, std::string(), "repomd" } );
+      for ( auto & el : wanted )
+	_inputs.push_back( std::move(el.second) );
+      std::stable_sort( _inputs.begin(), _inputs.end(), []( const Input & lhs, const Input & rhs ) { return rank( lhs ) < rank( rhs ); } );
+    }
+
+    std::string SolvBuilder::build( const Pathname & solvfile_r ) const
+    {
+      if ( ! valid() )
+	return "No metadata to build the solv file from.";
+
+      ::Pool * pool = ::pool_create();
+      ::Repo * repo = ::repo_create( pool, "" );
+      std::string err;
+
+      for ( const Input & input : _inputs )
+      {
+	FILE * fp = ::solv_xfopen( input._file.c_str(), "r" );
+	if ( ! fp )
+	{
+	  err = str::Str() << input._file << ": " << ::strerror( errno );
+	  break;
+	}
+
+	int res = 0;
+	switch ( input._parser )
+	{
+	  case Input::Repomd:
+	    res = ::repo_add_repomdxml( repo, fp, REPO_NO_INTERNALIZE );
+	    break;
+	  case Input::Rpmmd:
+	    if ( rank( input ) == 1 )	// primary
+	      res = ::repo_add_rpmmd( repo, fp, 0, REPO_NO_INTERNALIZE );
+	    else
+	      res = ::repo_add_rpmmd( repo, fp, input._language.empty() ? 0 : input._language.c_str(), REPO_NO_INTERNALIZE|REPO_EXTEND_SOLVABLES );
+	    break;
+	  case Input::Updateinfo:
+	    res = ::repo_add_updateinfoxml( repo, fp, REPO_NO_INTERNALIZE );
+	    break;
+	  case Input::Deltainfo:
+	    res = ::repo_add_deltainfoxml( repo, fp, REPO_NO_INTERNALIZE );
+	    break;
+	  case Input::Appdata:
+#if defined(LIBSOLVEXT_FEATURE_APPDATA)
+	    res = ::repo_add_appdata( repo, fp, REPO_NO_INTERNALIZE );
+#endif
+	    break;
+	  case Input::Comps:
+#if defined(LIBSOLVEXT_FEATURE_COMPS)
+	    res = ::repo_add_comps( repo, fp, REPO_NO_INTERNALIZE );
+#endif
+	    break;
+	}
+	::fclose( fp );
+
+	if ( res != 0 )
+	{
+	  err = str::Str() << input._file << ": " << ::pool_errstr( pool );
+	  break;
+	}
+      }
+
+      if ( err.empty() )
+      {
+	::repo_internalize( repo );
+	::repo_add_autopattern( repo, 0 );	// as 'repo2solv -X'
+
+	// Tag the file like repo2solv does, loadFromCache checks it.
+	::Repodata * info = ::repo_add_repodata( repo, 0 );
+	::repodata_set_str( info, SOLVID_META, REPOSITORY_TOOLVERSION, LIBSOLV_TOOLVERSION );
+	::repodata_internalize( info );
+
+	FILE * fp = ::fopen( solvfile_r.c_str(), "we" );
+	if ( ! fp )
+	  err = str::Str() << solvfile_r << ": " << ::strerror( errno );
+	else
+	{
+	  if ( ::repo_write( repo, fp ) != 0 )
+	    err = str::Str() << solvfile_r << ": " << ::pool_errstr( pool );
+	  if ( ::fclose( fp ) != 0 && err.empty() )
+	    err = str::Str() << solvfile_r << ": " << ::strerror( errno );
+	}
+      }
+
+      ::pool_free( pool );
+      return err;
+    }
+
+    std::ostream & operator<<( std::ostream & str, const SolvBuilder & obj )
+    {
+      str << "SolvBuilder(" << obj._inputs.size() << ")";
+      for ( const SolvBuilder::Input & input : obj._inputs )
+	str << endl << "  " << input._file;
+      return str;
+    }
+
+  } // namespace repo
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
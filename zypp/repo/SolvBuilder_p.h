@@ -0,0 +1,103 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/repo/SolvBuilder_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_REPO_SOLVBUILDER_P_H
+#define ZYPP_REPO_SOLVBUILDER_P_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <zypp/APIConfig.h>
+#include <zypp/Pathname.h>
+#include <zypp/repo/RepoType.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace repo
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class SolvBuilder
+    /// \brief Build a repositories solv file in-process, without spawning \c repo2solv.
+    ///
+    /// The metadata files are fed directly into the libsolv parsers
+    /// (\c repo_add_rpmmd, \c repo_add_updateinfoxml, ...) and the result is
+    /// written as solv file, the same way \c repo2solv would do it.
+    ///
+    /// The ctor inspects the raw metadata and decides whether the conversion
+    /// can be done here. Currently this is the case for rpm-md repos. Like
+    /// in \c repo2solv, file types without a parser (e.g. \c suseinfo) are
+    /// ignored. If the conversion can't be done here, \ref valid returns
+    /// \c false and \c repo2solv must be used.
+    ///
+    /// \ref build uses it's own libsolv pool and may be executed in a
+    /// worker thread. It does not log, nor throw.
+    ///
+    /// \code
+    ///   SolvBuilder builder( repokind, productdatapath );
+    ///   if ( builder.valid() )
+    ///   {
+    ///     std::string err { builder.build( solvfile ) };
+    ///     if ( ! err.empty() )
+    ///       ZYPP_THROW( RepoException( info, err ) );
+    ///   }
+    /// \endcode
+    ///////////////////////////////////////////////////////////////////
+    class ZYPP_LOCAL SolvBuilder
+    {
+      friend std::ostream & operator<<( std::ostream & str, const SolvBuilder & obj );
+
+    public:
+      /** Default ctor: nothing to build. */
+      SolvBuilder()
+      {}
+
+      /** Ctor inspecting the raw metadata of type \a repokind_r in \a productdatapath_r. */
+      SolvBuilder( const RepoType & repokind_r, const Pathname & productdatapath_r );
+
+    public:
+      /** Whether the solv file can be built in-process. */
+      bool valid() const
+      { return ! _inputs.empty(); }
+
+      /** Write the solv file \a solvfile_r.
+       * \return An empty string on success, otherwise the error message.
+       * \note Thread safe, no logging.
+       */
+      std::string build( const Pathname & solvfile_r ) const;
+
+    public:
+      /** A metadata file and the libsolv parser to feed it into. */
+      struct Input
+      {
+	enum Parser { Repomd, Rpmmd, Updateinfo, Deltainfo, Appdata, Comps };
+	Parser _parser;
+	Pathname _file;
+	std::string _language;	///< for localized susedata
+	std::string _type;	///< the repomd.xml resource type (without \c _zck)
+      };
+
+    private:
+      std::vector<Input> _inputs;
+    };
+    ///////////////////////////////////////////////////////////////////
+
+    /** \relates SolvBuilder Stream output */
+    std::ostream & operator<<( std::ostream & str, const SolvBuilder & obj );
+
+  } // namespace repo
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_REPO_SOLVBUILDER_P_H
@@ -17,6 +17,7 @@
 #include "Downloader.h"
 #include <zypp/repo/MediaInfoDownloader.h>
 #include <zypp/base/UserRequestException.h>
+#include <zypp/media/MediaException.h>
 #include <zypp/parser/xml/Reader.h>
 #include <zypp/parser/yum/RepomdFileReader.h>
 
@@ -39,6 +40,25 @@ namespace yum
       return loc_r;
     }
 
+    /** Provide the optional \a file_r, passing the cached copy \a deltafile_r.
+     * An unchanged file is then not downloaded again (\ref media::TransferValidators).
+     * Unlike \ref MediaSetAccess::provideOptionalFile the file is requested right
+     * away, an existence check would be one more roundtrip.
+     */
+    inline Pathname provideOptionalFile( MediaSetAccess & media_r, const Pathname & file_r, const Pathname & deltafile_r )
+    {
+      try
+      {
+	return media_r.provideFile( OnMediaLocation( file_r ), MediaSetAccess::PROVIDE_NON_INTERACTIVE,
+				    PathInfo( deltafile_r ).isFile() ? deltafile_r : Pathname() );
+      }
+      catch ( const media::MediaFileNotFoundException & excpt_r )
+      { ZYPP_CAUGHT( excpt_r ); }
+      catch ( const media::MediaNotAFileException & excpt_r )
+      { ZYPP_CAUGHT( excpt_r ); }
+      return Pathname();
+    }
+
     // search old repository file to run the delta algorithm on
     Pathname search_deltafile( const Pathname & dir, const Pathname & file )
     {
@@ -85,10 +105,8 @@ namespace yum
     NON_COPYABLE( Impl );
     NON_MOVABLE( Impl );
 
-    Impl( Downloader & downloader_r, MediaSetAccess & media_r, const Pathname & destDir_r )
+    Impl( Downloader & downloader_r )
     : _downloader { downloader_r }
-    , _media { media_r }
-    , _destDir { destDir_r }
     {
       addWantedLocale( ZConfig::instance().textLocale() );
       for ( const Locale & it : ZConfig::instance().repoRefreshLocales() )
@@ -143,6 +161,15 @@ namespace yum
       }
     }
 
+    /** The files \ref finalize would schedule. */
+    std::list<OnMediaLocation> wantedFiles() const
+    {
+      std::list<OnMediaLocation> ret;
+      for ( const auto & el : _wantedFiles )
+	ret.push_back( loc_with_path_prefix( el.second, _downloader.repoInfo().path() ) );
+      return ret;
+    }
+
   private:
     const Pathname & deltaDir() const
     { return _downloader._deltaDir; }
@@ -161,8 +188,6 @@ namespace yum
 
   private:
     Downloader & _downloader;
-    MediaSetAccess & _media;
-    const Pathname & _destDir;
 
     LocaleSet _wantedLocales;	///< Locales do download
     std::map<std::string,OnMediaLocation> _wantedFiles;
@@ -187,7 +212,7 @@ namespace yum
     defaultDownloadMasterIndex( media_r, destDir_r, masterIndex );
 
     // setup parser
-    Impl pimpl( *this, media_r, destDir_r );
+    Impl pimpl( *this );
     RepomdFileReader( destDir_r / masterIndex, std::ref(pimpl) );
     pimpl.finalize();
 
@@ -195,11 +220,21 @@ namespace yum
     start( destDir_r, media_r );
   }
 
+  std::list<OnMediaLocation> Downloader::wantedFiles( const RepoInfo & info_r, const Pathname & masterIndex_r )
+  {
+    Downloader downloader( info_r );
+    Impl pimpl( downloader );
+    RepomdFileReader( masterIndex_r, std::ref(pimpl) );
+    return pimpl.wantedFiles();
+  }
+
   RepoStatus Downloader::status( MediaSetAccess & media_r )
   {
-    RepoStatus ret { media_r.provideOptionalFile( repoInfo().path() / "/repodata/repomd.xml" ) };
+    RepoStatus ret { provideOptionalFile( media_r, repoInfo().path() / "/repodata/repomd.xml",
+					  _deltaDir.empty() ? Pathname() : _deltaDir / repoInfo().path() / "repodata/repomd.xml" ) };
     if ( !ret.empty() )	// else: mandatory master index is missing
-      ret = ret && RepoStatus( media_r.provideOptionalFile( "/media.1/media" ) );
+      ret = ret && RepoStatus( provideOptionalFile( media_r, "/media.1/media",
+						    _deltaDir.empty() ? Pathname() : _deltaDir / "media.1/media" ) );
     // else: mandatory master index is missing -> stay empty
     return ret;
   }
@@ -67,6 +67,16 @@ namespace zypp
          */
         RepoStatus status( MediaSetAccess & media_r ) override;
 
+        /**
+         * \short The metadata files \ref download would retrieve for \a info_r
+         *
+         * As listed in the local copy \a masterIndex_r of the repos \c repomd.xml,
+         * with the repos path prefix.
+         *
+         * \throws Exception if \a masterIndex_r can not be parsed
+         */
+        static std::list<OnMediaLocation> wantedFiles( const RepoInfo & info_r, const Pathname & masterIndex_r );
+
       private:
 	class Impl;
 	friend class Impl;
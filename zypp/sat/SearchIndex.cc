@@ -0,0 +1,407 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/sat/SearchIndex.cc
+ *
+*/
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+
+#include <zypp/base/LogTools.h>
+#include <zypp/base/String.h>
+#include <zypp/PathInfo.h>
+#include <zypp/TmpPath.h>
+
+#include <zypp/sat/detail/PoolImpl.h>
+#include <zypp/sat/Pool.h>
+#include <zypp/sat/SearchIndex_p.h>
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace sat
+  {
+    namespace
+    {
+      inline unsigned char lower( unsigned char ch_r )
+      { return ( ch_r >= 'A' && ch_r <= 'Z' ) ? ch_r + ( 'a' - 'A' ) : ch_r; }
+
+      inline void addTrigram( SearchIndex::Signature & sig_r, const char * tri_r )
+      {
+        uint32_t hash = ( uint32_t(lower( tri_r[0] )) << 16 | uint32_t(lower( tri_r[1] )) << 8 | lower( tri_r[2] ) ) * 2654435761U;
+        unsigned bit = ( uint64_t(hash) * SearchIndex::signatureBits ) >> 32;
+        sig_r[bit / 64] |= uint64_t(1) << ( bit % 64 );
+      }
+
+      /** Add the trigrams of an attribute value. */
+      void addValue( SearchIndex::Signature & sig_r, const char * value_r )
+      {
+        if ( ! value_r )
+          return;
+        for ( ; value_r[0] && value_r[1] && value_r[2]; ++value_r )
+          addTrigram( sig_r, value_r );
+      }
+
+      /** Add the trigrams of a literal search string.
+       * Trigrams with non ASCII characters are skipped, as we don't know
+       * how a case insensitive match would fold them.
+       */
+      void addLiteral( SearchIndex::Signature & sig_r, const std::string & literal_r )
+      {
+        for ( size_t i = 0; i + 3 <= literal_r.size(); ++i )
+        {
+          const char * tri = literal_r.data() + i;
+          if ( ( tri[0] | tri[1] | tri[2] ) & 0x80 )
+            continue;
+          addTrigram( sig_r, tri );
+        }
+      }
+
+      /** Add the trigrams of the literal parts of a glob. */
+      void addGlob( SearchIndex::Signature & sig_r, const std::string & glob_r )
+      {
+        std::string literal;
+        for ( size_t i = 0; i < glob_r.size(); ++i )
+        {
+          char ch = glob_r[i];
+          if ( ch == '*' || ch == '?' || ch == '[' )
+          {
+            addLiteral( sig_r, literal );
+            literal.clear();
+            if ( ch == '[' )
+            {
+              // skip the bracket expression ('[]...]' and '[!]...]' contain a literal ']')
+              size_t end = i + 1;
+              if ( end < glob_r.size() && ( glob_r[end] == '!' || glob_r[end] == '^' ) )
+                ++end;
+              if ( end < glob_r.size() && glob_r[end] == ']' )
+                ++end;
+              end = glob_r.find( ']', end );
+              if ( end == std::string::npos )
+                return;	// fewer trigrams are always safe
+              i = end;
+            }
+          }
+          else if ( ch == '\\' && i + 1 < glob_r.size() )
+            literal += glob_r[++i];
+          else
+            literal += ch;
+        }
+        addLiteral( sig_r, literal );
+      }
+
+      /** Whether \a sig_r contains all bits of \a query_r. */
+      inline bool contains( const SearchIndex::Signature & sig_r, const SearchIndex::Signature & query_r )
+      {
+        for ( size_t i = 0; i < sig_r.size(); ++i )
+        {
+          if ( ( sig_r[i] & query_r[i] ) != query_r[i] )
+            return false;
+        }
+        return true;
+      }
+
+      /** Header of the \ref SearchIndex::cacheFile. */
+      struct FileHeader
+      {
+        uint32_t magic = 0x58444953;	// "SIDX", in native byte order
+        uint32_t version = 1;
+        uint64_t solvSize = 0;		// the solv file the index was built from
+        int64_t solvMtime = 0;
+        uint64_t count = 0;		// number of signatures following
+      };
+
+      /** A repo and where its index comes from. */
+      struct Attached
+      {
+        Pathname solvfile;			// loaded from this solv file (if not empty)
+        detail::SolvableIdType base = 0;	// id of the first solvable in the solv file
+        detail::SolvableIdType start = 0;	// the repos solvables when attached
+        detail::SolvableIdType end = 0;
+        unsigned serialIDs = 0;
+        shared_ptr<const SearchIndex> index;
+      };
+
+      std::mutex & registryMutex()
+      {
+        static std::mutex _mutex;
+        return _mutex;
+      }
+
+      /** The attached repos (guarded by \ref registryMutex). */
+      std::map<detail::RepoIdType, Attached> & registry()
+      {
+        static std::map<detail::RepoIdType, Attached> _registry;
+        return _registry;
+      }
+    } // namespace
+
+    constexpr unsigned SearchIndex::signatureBits;
+
+    bool SearchIndex::enabled()
+    {
+      static bool _enabled = [](){
+        const char *env = getenv( "ZYPP_POOLQUERY_INDEX" );
+        if ( env && ! str::strToBool( env, true ) )
+        {
+          MIL << "ZYPP_POOLQUERY_INDEX=" << env << ": no search index" << endl;
+          return false;
+        }
+        return true;
+      }();
+      return _enabled;
+    }
+
+    bool SearchIndex::indexed( SolvAttr attr_r )
+    { return attr_r == SolvAttr::name || attr_r == SolvAttr::summary || attr_r == SolvAttr::description; }
+
+    bool SearchIndex::querySignature( const StrMatcher & matcher_r, Signature & sig_r )
+    {
+      sig_r.fill( 0 );
+      switch ( matcher_r.flags().mode() )
+      {
+        case Match::STRING:
+        case Match::STRINGSTART:
+        case Match::STRINGEND:
+        case Match::SUBSTRING:
+          addLiteral( sig_r, matcher_r.searchstring() );
+          break;
+        case Match::GLOB:
+          addGlob( sig_r, matcher_r.searchstring() );
+          break;
+        default:
+          return false;	// regex or nothing to match
+      }
+      return sig_r != Signature();
+    }
+
+    Pathname SearchIndex::cacheFile( const Pathname & solvfile_r )
+    { return solvfile_r.extend( ".search" ); }
+
+    bool SearchIndex::buildCacheFile( const Pathname & solvfile_r )
+    {
+      shared_ptr<SearchIndex> index { build( solvfile_r ) };
+      return index && index->save( cacheFile( solvfile_r ), solvfile_r );
+    }
+
+    void SearchIndex::attach( Repository repo_r, detail::SolvableIdType base_r, const Pathname & solvfile_r )
+    {
+      detail::CRepo * repo = repo_r.get();
+      if ( ! repo )
+        return;
+
+      std::lock_guard<std::mutex> lock( registryMutex() );
+      std::map<detail::RepoIdType, Attached> & reg( registry() );
+
+      // forget the repos no longer in the pool
+      if ( reg.size() >= Pool::instance().reposSize() )
+      {
+        std::set<detail::RepoIdType> inPool;
+        for ( const Repository & r : Pool::instance().repos() )
+          inPool.insert( r.get() );
+        for ( auto it = reg.begin(); it != reg.end(); )
+        {
+          if ( inPool.count( it->first ) )
+            ++it;
+          else
+            it = reg.erase( it );
+        }
+      }
+
+      Attached & entry( reg[repo] );
+      entry = Attached();
+      entry.solvfile = solvfile_r;
+      entry.base = base_r;
+      entry.start = repo->start;
+      entry.end = repo->end;
+      entry.serialIDs = Pool::instance().serialIDs().serial();
+    }
+
+    shared_ptr<const SearchIndex> SearchIndex::get( Repository repo_r )
+    {
+      detail::CRepo * repo = repo_r.get();
+      if ( ! repo )
+        return shared_ptr<const SearchIndex>( new SearchIndex );
+
+      std::lock_guard<std::mutex> lock( registryMutex() );
+      Attached & entry( registry()[repo] );
+      unsigned serialIDs = Pool::instance().serialIDs().serial();
+      if ( entry.start != detail::SolvableIdType(repo->start) || entry.end != detail::SolvableIdType(repo->end) || entry.serialIDs != serialIDs )
+      {
+        // not attached or changed since
+        entry = Attached();
+        entry.start = repo->start;
+        entry.end = repo->end;
+        entry.serialIDs = serialIDs;
+      }
+
+      if ( ! entry.index )
+      {
+        shared_ptr<SearchIndex> index;
+        if ( ! entry.solvfile.empty() )
+        {
+          Pathname file( cacheFile( entry.solvfile ) );
+          index = load( file, entry.solvfile );
+          if ( ! index && PathInfo( file.dirname() ).userMayW() && ( index = build( entry.solvfile ) ) )
+            index->save( file, entry.solvfile );
+          if ( index )
+          {
+            index->_base = entry.base;
+            if ( entry.base > entry.start || entry.base + index->size() < entry.end )
+            {
+              WAR << *index << " does not match " << repo_r << endl;
+              index.reset();
+            }
+          }
+        }
+        if ( ! index )
+          index = build( repo );
+        DBG << repo_r << ": " << *index << endl;
+        entry.index = index;
+      }
+      return entry.index;
+    }
+
+    void SearchIndex::candidates( Repository repo_r, const std::vector<Signature> & sigs_r, std::vector<detail::SolvableIdType> & ret_r ) const
+    {
+      detail::CRepo * repo = repo_r.get();
+      if ( ! repo )
+        return;
+
+      detail::SolvableIdType begin = std::max( detail::SolvableIdType(repo->start), _base );
+      detail::SolvableIdType end = std::min( detail::SolvableIdType(repo->end), detail::SolvableIdType(_base + _signatures.size()) );
+      for ( detail::SolvableIdType id = begin; id < end; ++id )
+      {
+        const Signature & sig( _signatures[id - _base] );
+        for ( const Signature & query : sigs_r )
+        {
+          if ( contains( sig, query ) )
+          {
+            if ( repo->pool->solvables[id].repo == repo )
+              ret_r.push_back( id );
+            break;
+          }
+        }
+      }
+    }
+
+    shared_ptr<SearchIndex> SearchIndex::build( detail::CRepo * repo_r )
+    {
+      shared_ptr<SearchIndex> ret( new SearchIndex );
+      ret->_base = repo_r->start;
+      ret->_signatures.resize( repo_r->end - repo_r->start );
+
+      detail::CPool * pool = repo_r->pool;
+      for ( detail::SolvableIdType id = repo_r->start; id < detail::SolvableIdType(repo_r->end); ++id )
+      {
+        detail::CSolvable * solv = pool->solvables + id;
+        if ( solv->repo != repo_r )
+          continue;
+        Signature & sig( ret->_signatures[id - ret->_base] );
+        addValue( sig, ::pool_id2str( pool, solv->name ) );
+        addValue( sig, ::solvable_lookup_str( solv, SOLVABLE_SUMMARY ) );
+        addValue( sig, ::solvable_lookup_str( solv, SOLVABLE_DESCRIPTION ) );
+      }
+      return ret;
+    }
+
+    shared_ptr<SearchIndex> SearchIndex::build( const Pathname & solvfile_r )
+    {
+      FILE * file = ::fopen( solvfile_r.c_str(), "re" );
+      if ( ! file )
+      {
+        DBG << "Can't open " << solvfile_r << endl;
+        return nullptr;
+      }
+
+      shared_ptr<SearchIndex> ret;
+      detail::CPool * pool = ::pool_create();
+      detail::CRepo * repo = ::repo_create( pool, "searchindex" );
+      if ( ::repo_add_solv( repo, file, 0 ) == 0 )
+        ret = build( repo );
+      else
+        WAR << "Can't read " << solvfile_r << ": " << ::pool_errstr( pool ) << endl;
+      ::pool_free( pool );
+      ::fclose( file );
+      return ret;
+    }
+
+    shared_ptr<SearchIndex> SearchIndex::load( const Pathname & file_r, const Pathname & solvfile_r )
+    {
+      PathInfo solv( solvfile_r );
+      std::ifstream inp( file_r.c_str(), std::ios::binary );
+      if ( ! solv.isFile() || ! inp )
+        return nullptr;
+
+      FileHeader expected;
+      expected.solvSize = solv.size();
+      expected.solvMtime = solv.mtime();
+
+      FileHeader header;
+      inp.read( reinterpret_cast<char *>( &header ), sizeof(header) );
+      if ( ! inp || header.magic != expected.magic || header.version != expected.version
+           || header.solvSize != expected.solvSize || header.solvMtime != expected.solvMtime )
+      {
+        DBG << file_r << " is outdated" << endl;
+        return nullptr;
+      }
+
+      shared_ptr<SearchIndex> ret( new SearchIndex );
+      ret->_signatures.resize( header.count );
+      inp.read( reinterpret_cast<char *>( ret->_signatures.data() ), header.count * sizeof(Signature) );
+      if ( ! inp )
+      {
+        WAR << "Can't read " << file_r << endl;
+        return nullptr;
+      }
+      return ret;
+    }
+
+    bool SearchIndex::save( const Pathname & file_r, const Pathname & solvfile_r ) const
+    {
+      PathInfo solv( solvfile_r );
+      filesystem::TmpFile tmp( filesystem::TmpFile::makeSibling( file_r ) );
+      if ( ! solv.isFile() || ! tmp )
+      {
+        DBG << "Can't write " << file_r << ", the search index is not stored" << endl;
+        return false;
+      }
+      filesystem::chmod( tmp.path(), 0644 );
+
+      FileHeader header;
+      header.solvSize = solv.size();
+      header.solvMtime = solv.mtime();
+      header.count = _signatures.size();
+
+      std::ofstream out( tmp.path().c_str(), std::ios::binary );
+      out.write( reinterpret_cast<const char *>( &header ), sizeof(header) );
+      out.write( reinterpret_cast<const char *>( _signatures.data() ), _signatures.size() * sizeof(Signature) );
+      out.close();
+
+      if ( out.fail() || filesystem::rename( tmp.path(), file_r ) != 0 )
+      {
+        ERR << "Can't write " << PathInfo(tmp.path()) << endl;
+        return false;
+      }
+      DBG << "Wrote " << *this << " to " << file_r << endl;
+      return true;
+    }
+
+    std::ostream & operator<<( std::ostream & str, const SearchIndex & obj )
+    { return str << "SearchIndex(" << obj.size() << " solvables from " << obj._base << ")"; }
+
+  } // namespace sat
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
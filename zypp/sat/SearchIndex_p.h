@@ -0,0 +1,130 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/sat/SearchIndex_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_SAT_SEARCHINDEX_P_H
+#define ZYPP_SAT_SEARCHINDEX_P_H
+
+#include <iosfwd>
+#include <array>
+#include <vector>
+#include <stdint.h>
+
+#include <zypp/APIConfig.h>
+#include <zypp/base/PtrTypes.h>
+#include <zypp/base/StrMatcher.h>
+#include <zypp/Pathname.h>
+#include <zypp/Repository.h>
+#include <zypp/sat/SolvAttr.h>
+#include <zypp/sat/detail/PoolMember.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace sat
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class SearchIndex
+    /// \brief Trigram index of the names, summaries and descriptions of a repos solvables.
+    ///
+    /// A \ref PoolQuery matching these attributes visits every solvable
+    /// and applies its \ref StrMatcher to each value. The index maps the
+    /// (lowercased) trigrams of the values to the solvables containing
+    /// them: For each solvable it stores a \ref Signature, a bitset with
+    /// one bit per trigram hash. A solvable can only match a plain string
+    /// or glob, if its signature contains all bits of the searched trigrams
+    /// (\ref querySignature). Scanning the signatures takes about a
+    /// millisecond for the whole pool, so the query only needs to run the
+    /// exact matcher on the \ref candidates.
+    ///
+    /// The index of a repo is built from the solv file when the cache is
+    /// built and stored next to it (\ref cacheFile). It lists the solvables
+    /// in the order of the solv file, independent of the ids they get in the
+    /// pool and of the architectures filtered out when loading. The index of
+    /// a repo not loaded from the cache, or if the stored one is missing or
+    /// outdated, is built on first use.
+    ///
+    /// The index is used unless \c ZYPP_POOLQUERY_INDEX=0 is set.
+    ///////////////////////////////////////////////////////////////////
+    class ZYPP_LOCAL SearchIndex
+    {
+      friend std::ostream & operator<<( std::ostream & str, const SearchIndex & obj );
+
+    public:
+      /** Bits per solvable. */
+      static constexpr unsigned signatureBits = 512;
+
+      /** The trigram hashes of a solvable or a search string. */
+      typedef std::array<uint64_t, signatureBits / 64> Signature;
+
+      /** Whether \ref PoolQuery should use the index (not if \c ZYPP_POOLQUERY_INDEX=0 is set). */
+      static bool enabled();
+
+      /** Whether the values of \a attr_r are indexed. */
+      static bool indexed( SolvAttr attr_r );
+
+      /** Compute the signature every value matched by \a matcher_r contains.
+       * Only plain strings and globs containing at least 3 consecutive
+       * ASCII characters can be looked up.
+       * \return Whether \a sig_r can be used to find candidates.
+       */
+      static bool querySignature( const StrMatcher & matcher_r, Signature & sig_r );
+
+      /** Where the index of \a solvfile_r is stored. */
+      static Pathname cacheFile( const Pathname & solvfile_r );
+
+      /** Build the index of \a solvfile_r and store it in \ref cacheFile.
+       * \return Whether the index was stored.
+       */
+      static bool buildCacheFile( const Pathname & solvfile_r );
+
+      /** Remember \a repo_r was loaded from \a solvfile_r, its solvables getting ids starting at \a base_r. */
+      static void attach( Repository repo_r, detail::SolvableIdType base_r, const Pathname & solvfile_r );
+
+      /** The index of \a repo_r, loaded from its \ref cacheFile or built (never \c nullptr). */
+      static shared_ptr<const SearchIndex> get( Repository repo_r );
+
+    public:
+      /** Append the solvables in \a repo_r whose signature contains one of \a sigs_r (in ascending id order). */
+      void candidates( Repository repo_r, const std::vector<Signature> & sigs_r, std::vector<detail::SolvableIdType> & ret_r ) const;
+
+      /** The number of indexed solvables. */
+      size_t size() const
+      { return _signatures.size(); }
+
+    private:
+      /** Build the index of the solvables in \a repo_r. */
+      static shared_ptr<SearchIndex> build( detail::CRepo * repo_r );
+
+      /** Build the index of \a solvfile_r (in a pool of its own). */
+      static shared_ptr<SearchIndex> build( const Pathname & solvfile_r );
+
+      /** Read the index of \a solvfile_r from \a file_r, \c nullptr if it does not exist or is outdated. */
+      static shared_ptr<SearchIndex> load( const Pathname & file_r, const Pathname & solvfile_r );
+
+      /** Store the index of \a solvfile_r in \a file_r. */
+      bool save( const Pathname & file_r, const Pathname & solvfile_r ) const;
+
+    private:
+      detail::SolvableIdType _base = 0;	///< id of the first indexed solvable
+      std::vector<Signature> _signatures;
+    };
+    ///////////////////////////////////////////////////////////////////
+
+    /** \relates SearchIndex Stream output */
+    std::ostream & operator<<( std::ostream & str, const SearchIndex & obj );
+
+  } // namespace sat
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_SAT_SEARCHINDEX_P_H
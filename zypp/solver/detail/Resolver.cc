@@ -34,6 +34,7 @@
 
 #include <zypp/ZConfig.h>
 #include <zypp/sat/Transaction.h>
+#include <zypp/pool/StatusStore_p.h>
 
 #define MAXSOLVERRUNS 5
 
@@ -225,21 +226,6 @@ void Resolver::addWeak( const PoolItem & item )
 
 //---------------------------------------------------------------------------
 
-struct UndoTransact : public resfilter::PoolItemFilterFunctor
-{
-    ResStatus::TransactByValue resStatus;
-    UndoTransact ( const ResStatus::TransactByValue &status)
-	:resStatus(status)
-    { }
-
-    bool operator()( PoolItem item )		// only transacts() items go here
-    {
-	item.status().resetTransact( resStatus );// clear any solver/establish transactions
-	return true;
-    }
-};
-
-
 struct DoTransact : public resfilter::PoolItemFilterFunctor
 {
     ResStatus::TransactByValue resStatus;
@@ -257,15 +243,12 @@ struct DoTransact : public resfilter::PoolItemFilterFunctor
 
 bool Resolver::verifySystem()
 {
-    UndoTransact resetting (ResStatus::APPL_HIGH);
-
     DBG << "Resolver::verifySystem()" << endl;
 
     _verifying = true;
 
-    invokeOnEach ( _pool.begin(), _pool.end(),
-		   resfilter::ByTransact( ),			// Resetting all transcations
-		   functor::functorRef<bool,PoolItem>(resetting) );
+    // Resetting all transcations
+    pool::StatusStore::instance().resetTransact( ResStatus::APPL_HIGH, true );
 
     return resolvePool();
 }
@@ -275,11 +258,9 @@ bool Resolver::verifySystem()
 // undo
 void Resolver::undo()
 {
-    UndoTransact info(ResStatus::APPL_LOW);
     MIL << "*** undo ***" << endl;
-    invokeOnEach ( _pool.begin(), _pool.end(),
-		   resfilter::ByTransact( ),			// collect transacts from Pool to resolver queue
-		   functor::functorRef<bool,PoolItem>(info) );
+    // clear any solver/establish transactions
+    pool::StatusStore::instance().resetTransact( ResStatus::APPL_LOW, true );
     //  Regard dependencies of the item weak onl
     _addWeak.clear();
 
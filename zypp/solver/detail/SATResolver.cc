@@ -41,6 +41,7 @@ extern "C"
 #include <zypp/sat/WhatProvides.h>
 #include <zypp/sat/WhatObsoletes.h>
 #include <zypp/sat/detail/PoolImpl.h>
+#include <zypp/pool/StatusStore_p.h>
 
 #include <zypp/solver/detail/Resolver.h>
 #include <zypp/solver/detail/SATResolver.h>
@@ -366,7 +367,8 @@ SATSolutionToPool (PoolItem item, const ResStatus & status, const ResStatus::Tra
 /// \class SATCollectTransact
 /// \brief Commit helper functor distributing PoolItem by status into lists
 ///
-/// On the fly it clears all PoolItem bySolver/ByApplLow status.
+/// PoolItem bySolver/ByApplLow status must have been cleared before
+/// (\ref pool::StatusStore::resetTransact), they are not queued.
 /// The lists are cleared in the Ctor, populated by \ref operator().
 /////////////////////////////////////////////////////////////////////////
 struct SATCollectTransact : public resfilter::PoolItemFilterFunctor
@@ -395,11 +397,7 @@ struct SATCollectTransact : public resfilter::PoolItemFilterFunctor
     bool by_solver = ( itemStatus.isBySolver() || itemStatus.isByApplLow() );
 
     if ( by_solver )
-    {
-      // Clear former solver/establish resultd
-      itemStatus.resetTransact( ResStatus::APPL_LOW );
       return true;	// -> back out here, don't re-queue former results
-    }
 
     if ( !_solveSrcPackages && item_r.isKind<SrcPackage>() )
     {
@@ -566,6 +564,7 @@ SATResolver::solving(const CapabilitySet & requires_caps,
     Queue decisionq;
     queue_init(&decisionq);
     solver_get_decisionqueue(_satSolver, &decisionq);
+    sat::Map toInstall( sat::Map::poolSize );
     for ( int i = 0; i < decisionq.count; ++i )
     {
       Id p = decisionq.elements[i];
@@ -576,11 +575,11 @@ SATResolver::solving(const CapabilitySet & requires_caps,
       if ( ! slv || slv.isSystem() )
 	continue;
 
-      PoolItem poolItem( slv );
-      SATSolutionToPool (poolItem, ResStatus::toBeInstalled, ResStatus::SOLVER);
-      _result_items_to_install.push_back( poolItem );
+      toInstall.set( slv.id() );
+      _result_items_to_install.push_back( PoolItem( slv ) );
     }
     queue_free(&decisionq);
+    pool::StatusStore::instance().setToBeInstalled( toInstall, ResStatus::SOLVER );
 
     /* solvables to be erased */
     Repository systemRepo( sat::Pool::instance().findSystemRepo() ); // don't create if it does not exist
@@ -622,6 +621,12 @@ SATResolver::solving(const CapabilitySet & requires_caps,
       }
     }
 
+    {
+      const pool::StatusStore & statusStore( pool::StatusStore::instance() );
+      MIL << "Pool transactions: " << statusStore.countToBeInstalled() << " to install, "
+          << statusStore.countToBeUninstalled() << " to remove" << endl;
+    }
+
     // copy back computed status values to pool
     // (on the fly cache orphaned items for the UI)
     solverCopyBackWeak( *_satSolver, _problem_items );
@@ -673,6 +678,8 @@ SATResolver::solverInit(const PoolItemList & weakItems)
 
     // clear and rebuild: _items_to_install, _items_to_remove, _items_to_lock, _items_to_keep
     {
+      // Clear former solver/establish results
+      pool::StatusStore::instance().resetTransact( ResStatus::APPL_LOW );
       SATCollectTransact collector( _items_to_install, _items_to_remove, _items_to_lock, _items_to_keep, solveSrcPackages() );
       invokeOnEach ( _pool.begin(), _pool.end(), functor::functorRef<bool,PoolItem>( collector ) );
     }
@@ -102,6 +102,9 @@ namespace zypp
       return ret;
     }
 
+    void RepoProvidePackage::addCacheRoot( const Pathname & root_r )
+    { _impl->_access.addCacheRoot( root_r ); }
+
     ///////////////////////////////////////////////////////////////////
     //
     //	CLASS NAME : CommitPackageCache
@@ -44,6 +44,11 @@ namespace zypp
       /** Provide package optionally fron cache only. */
       ManagedFile operator()( const PoolItem & pi, bool fromCache_r );
 
+      /** Also look for already downloaded packages below \a root_r.
+       * \see \ref repo::RepoMediaAccess::addCacheRoot
+       */
+      void addCacheRoot( const Pathname & root_r );
+
     private:
       struct Impl;
       RW_pointer<Impl> _impl;
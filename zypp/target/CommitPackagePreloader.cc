@@ -0,0 +1,475 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/target/CommitPackagePreloader.cc
+ *
+*/
+#include <iostream>
+#include <fstream>
+
+#include <zypp/base/LogTools.h>
+#include <zypp/base/Gettext.h>
+#include <zypp/AutoDispose.h>
+#include <zypp/PathInfo.h>
+#include <zypp/ZConfig.h>
+#include <zypp/ZYppCallbacks.h>
+#include <zypp/ResPool.h>
+#include <zypp/Package.h>
+#include <zypp/repo/DeltaCandidates.h>
+#include <zypp/repo/Applydeltarpm.h>
+#include <zypp/repo/PackageContentStore_p.h>
+#include <zypp/base/WorkerPool_p.h>
+#include <zypp/target/rpm/RpmDb.h>
+
+#include <zypp/zyppng/base/EventDispatcher>
+#include <zypp/zyppng/base/Timer>
+#include <zypp/zyppng/media/network/downloader.h>
+#include <zypp/zyppng/media/network/networkrequestdispatcher.h>
+
+#include <zypp/target/CommitPackagePreloader_p.h>
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace target
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace
+    {
+      /** Root of the preload dirs: below the package cache, so the files can be hardlinked. */
+      Pathname preloadParentDir()
+      {
+	Pathname ret { ZConfig::instance().repoPackagesPath() };
+	if ( filesystem::assert_dir( ret ) != 0 )
+	  ret = filesystem::TmpDir::defaultLocation();
+	return ret;
+      }
+
+      /** The url of \a loc_r in \a info_r, if we can download it. */
+      bool preloadUrl( const RepoInfo & info_r, const OnMediaLocation & loc_r, Url & url_r )
+      {
+	if ( info_r.baseUrlsEmpty() || loc_r.checksum().empty() || loc_r.medianr() > 1 )
+	  return false;	// no cache hit without checksum
+
+	const Url & url { *info_r.baseUrlsBegin() };
+	const std::string & scheme( url.getScheme() );
+	if ( ! ( ( scheme == "http" || scheme == "https" || scheme == "ftp" )
+	         && zyppng::NetworkRequestDispatcher::supportsProtocol( url ) ) )
+	  return false;
+
+	// Url copies share their data; let the thread have its own.
+	url_r = Url( url.asCompleteString() );
+	url_r.setPathName( Pathname(url.getPathName()) / info_r.path() / loc_r.filename() );
+	return true;
+      }
+
+      /** Whether \a pkg_r is installed (in edition \a ed_r); like the \ref repo::PackageProviderPolicy::queryInstalled. */
+      bool isInstalled( const Package::constPtr & pkg_r, const Edition & ed_r = Edition::noedition )
+      {
+	for ( const PoolItem & pi : ResPool::instance().byName( pkg_r->name() ) )
+	{
+	  if ( pi.satSolvable().isSystem() && pi.arch() == pkg_r->arch()
+	    && ( ed_r == Edition::noedition || pi.edition() == ed_r ) )
+	    return true;
+	}
+	return false;
+      }
+
+      /** Find the deltarpm \a pkg_r will be built from, like \ref repo::PackageProvider does.
+       * \return \c false if there is one, but we can't download it (the package is then
+       * left to the conventional download). Otherwise \a delta_r is the deltarpm to use,
+       * or has no location if the full rpm is needed.
+       */
+      bool findDelta( const Package::constPtr & pkg_r, const Url & url_r, packagedelta::DeltaRpm & delta_r, Url & deltaUrl_r )
+      {
+	delta_r = packagedelta::DeltaRpm();
+	if ( ! ( ZConfig::instance().download_use_deltarpm()
+	      && ( url_r.schemeIsDownloading() || ZConfig::instance().download_use_deltarpm_always() ) ) )
+	  return true;
+
+	const ResPool & pool( ResPool::instance() );
+	repo::DeltaCandidates deltas( std::list<Repository>( pool.knownRepositoriesBegin(), pool.knownRepositoriesEnd() ), pkg_r->name() );
+	std::list<packagedelta::DeltaRpm> deltaRpms { deltas.deltaRpms( pkg_r ) };
+	if ( deltaRpms.empty() || ! isInstalled( pkg_r ) || ! applydeltarpm::haveApplydeltarpm() )
+	  return true;
+
+	for ( const packagedelta::DeltaRpm & delta : deltaRpms )
+	{
+	  if ( delta.baseversion().edition() != Edition::noedition
+	       && ! isInstalled( pkg_r, delta.baseversion().edition() ) )
+	    continue;
+
+	  if ( ! applydeltarpm::quickcheck( delta.baseversion().sequenceinfo() ) )
+	    continue;
+
+	  if ( ! preloadUrl( delta.repository().info(), delta.location(), deltaUrl_r ) )
+	    return false;
+
+	  delta_r = delta;
+	  return true;
+	}
+	return true;
+      }
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
+
+    CommitPackagePreloader::CommitPackagePreloader( const rpm::RpmDb * rpmDb_r )
+    : _rpmDb( rpmDb_r )
+    , _cacheRoot( preloadParentDir(), "preload." )
+    , _stop( false )
+    , _wanted( 0 )
+    , _done( 0 )
+    {}
+
+    CommitPackagePreloader::~CommitPackagePreloader()
+    {
+      stop();
+      if ( _rpmDb )
+	rpm::RpmDb::discardPrecheckedPackageSignatures();
+    }
+
+    void CommitPackagePreloader::start( const ZYppCommitResult::TransactionStepList & steps_r )
+    {
+      if ( _thread.joinable() || cacheRoot().empty() )
+	return;
+
+      unsigned deltas = 0;
+      for ( const sat::Transaction::Step & step : steps_r )
+      {
+	switch ( step.stepType() )
+	{
+	  case sat::Transaction::TRANSACTION_INSTALL:
+	  case sat::Transaction::TRANSACTION_MULTIINSTALL:
+	    // proceed: only install actionas may require download.
+	    break;
+
+	  default:
+	    continue;
+	    break;
+	}
+
+	PoolItem pi( step.satSolvable() );
+	if ( ! pi->isKind<Package>() )
+	  continue;
+
+	Package::constPtr pkg { pi->asKind<Package>() };
+	RepoInfo info { pkg->repoInfo() };
+	const OnMediaLocation & loc { pkg->location() };
+	Url url;
+	if ( ! preloadUrl( info, loc, url ) )
+	  continue;
+
+	if ( ! pkg->cachedLocation().empty() )
+	  continue;
+
+	if ( repo::PackageContentStore( info.packagesPath().dirname() ).has( loc.checksum() ) )
+	  continue;	// another repo downloaded it already
+
+	packagedelta::DeltaRpm delta;
+	Url deltaUrl;
+	if ( ! findDelta( pkg, url, delta, deltaUrl ) )
+	  continue;
+
+	_jobIndex[step.satSolvable()] = _jobs.size();
+	if ( delta.location().filename().empty() )
+	{
+	  _jobs.push_back( Job{ url, cacheRoot() / info.alias() / info.path() / loc.filename(), loc.downloadSize(), loc.checksum(), ( _rpmDb && info.pkgGpgCheck() ) } );
+	}
+	else
+	{
+	  ++deltas;
+	  _jobs.push_back( Job{ deltaUrl, cacheRoot() / info.alias() / info.path() / loc.filename(), delta.location().downloadSize(), loc.checksum(), ( _rpmDb && info.pkgGpgCheck() ),
+				cacheRoot() / ".deltas" / ( str::numstring( _jobs.size() ) + ".delta.rpm" ), delta.location().checksum(), loc.downloadSize() } );
+	}
+      }
+
+      MIL << "Preloading " << _jobs.size() << " packages (" << deltas << " from deltarpms) to " << cacheRoot() << endl;
+      if ( ! _jobs.empty() )
+      {
+	_jobDone.assign( _jobs.size(), false );
+	_jobProgress.assign( _jobs.size(), -1 );
+	_thread = std::thread( &CommitPackagePreloader::run, this );
+      }
+    }
+
+    void CommitPackagePreloader::waitFor( const sat::Solvable & solv_r )
+    {
+      auto it = _jobIndex.find( solv_r );
+      if ( it == _jobIndex.end() )
+	return;
+
+      const size_t idx { it->second };
+      _wanted = idx;
+      std::unique_lock<std::mutex> lock( _mutex );
+      if ( _jobs[idx]._deltaFile.empty() || _jobDone[idx] )
+      {
+	_jobDoneCond.wait( lock, [&]() { return _jobDone[idx]; } );
+	return;
+      }
+
+      // Report the build progress while waiting (callbacks without holding the lock).
+      callback::SendReport<repo::DownloadResolvableReport> report;
+      bool started = false;
+      int reported = -1;
+      while ( true )
+      {
+	_jobDoneCond.wait( lock, [&]() { return _jobDone[idx] || _jobProgress[idx] != reported; } );
+	bool done = _jobDone[idx];
+	int progress = _jobProgress[idx];
+	lock.unlock();
+
+	if ( progress >= 0 )
+	{
+	  if ( ! started )
+	  {
+	    report->startDeltaApply( _jobs[idx]._deltaFile );
+	    started = true;
+	  }
+	  if ( progress != reported )
+	    report->progressDeltaApply( progress );
+	}
+	reported = progress;
+
+	if ( done )
+	{
+	  if ( started )
+	  {
+	    if ( PathInfo( _jobs[idx]._target ).isFile() )
+	      report->finishDeltaApply();
+	    else
+	      report->problemDeltaApply( _("applydeltarpm failed.") );
+	  }
+	  return;
+	}
+	lock.lock();
+      }
+    }
+
+    void CommitPackagePreloader::stop()
+    {
+      _stop = true;
+      if ( _thread.joinable() )
+      {
+	_thread.join();
+	MIL << "Preloading stopped: " << *this << endl;
+      }
+    }
+
+    void CommitPackagePreloader::verify( size_t idx_r )
+    {
+      const Job & job { _jobs[idx_r] };
+      if ( CheckSum( job._checksum.type(), std::ifstream( job._target.c_str() ) ) != job._checksum )
+      {
+	DBG << "Preload failed: " << job._url << ": checksum mismatch" << endl;
+	filesystem::unlink( job._target );	// the conventional download will report problems
+      }
+      else if ( job._sigCheck )
+	_rpmDb->precheckPackageSignature( job._target );
+      jobDone( idx_r );
+    }
+
+    void CommitPackagePreloader::rebuild( size_t idx_r )
+    {
+      const Job & job { _jobs[idx_r] };
+      AutoDispose<const Pathname> deltaCleanup( job._deltaFile, filesystem::unlink );
+      if ( _stop )
+      {
+	jobDone( idx_r );
+	return;
+      }
+
+      if ( CheckSum( job._deltaChecksum.type(), std::ifstream( job._deltaFile.c_str() ) ) != job._deltaChecksum )
+      {
+	DBG << "Preload failed: " << job._url << ": checksum mismatch" << endl;
+	jobDone( idx_r );
+	return;
+      }
+
+      if ( ! reserveSpace( job._buildSize ) )
+      {
+	DBG << "Preload failed: no space to build " << job._target << endl;
+	jobDone( idx_r );
+	return;
+      }
+      jobProgress( idx_r, 0 );
+      bool built = applydeltarpm::provide( job._deltaFile, job._target, [this,idx_r]( unsigned value_r ) { jobProgress( idx_r, value_r ); } );
+      releaseSpace( job._buildSize );
+
+      if ( ! built )
+      {
+	DBG << "Preload failed: applydeltarpm " << job._url << endl;
+	jobDone( idx_r );	// the conventional download will report problems
+	return;
+      }
+      DBG << "Built " << job._target << " from " << job._url << endl;
+      verify( idx_r );
+    }
+
+    bool CommitPackagePreloader::reserveSpace( const ByteCount & size_r )
+    {
+      std::unique_lock<std::mutex> lock( _mutex );
+      while ( true )
+      {
+	ByteCount avail { filesystem::df( cacheRoot() ) };
+	if ( avail < 0 || _reserved + size_r * 2 <= avail )	// the rpm and room for the commit
+	{
+	  _reserved += size_r;
+	  return true;
+	}
+	if ( _reserved == 0 || _stop )
+	  return false;
+	_jobDoneCond.wait( lock );	// for a running build to finish
+      }
+    }
+
+    void CommitPackagePreloader::releaseSpace( const ByteCount & size_r )
+    {
+      {
+	std::lock_guard<std::mutex> lock( _mutex );
+	_reserved -= size_r;
+      }
+      _jobDoneCond.notify_all();
+    }
+
+    void CommitPackagePreloader::jobProgress( size_t idx_r, unsigned value_r )
+    {
+      {
+	std::lock_guard<std::mutex> lock( _mutex );
+	if ( _jobProgress[idx_r] == int(value_r) )
+	  return;
+	_jobProgress[idx_r] = value_r;
+      }
+      _jobDoneCond.notify_all();
+    }
+
+    void CommitPackagePreloader::jobDone( size_t idx_r )
+    {
+      {
+	std::lock_guard<std::mutex> lock( _mutex );
+	if ( ! _jobDone[idx_r] )
+	{
+	  _jobDone[idx_r] = true;
+	  ++_done;
+	}
+      }
+      _jobDoneCond.notify_all();
+    }
+
+    void CommitPackagePreloader::run()
+    {
+      zyppng::EventDispatcher::Ptr ev { zyppng::EventDispatcher::createForThread() };
+      zyppng::Downloader downloader;
+      {
+	size_t perHost = std::max( 1L, ZConfig::instance().download_max_concurrent_connections() );
+	zyppng::NetworkRequestDispatcher::Ptr dispatcher { downloader.requestDispatcher() };
+	dispatcher->setMaximumConnectionsPerHost( perHost );
+	dispatcher->setMaximumConcurrentConnections( std::max( perHost, size_t(10) ) );	// 10: the dispatchers default
+      }
+
+      std::vector<std::shared_ptr<zyppng::Download>> downloads( _jobs.size() );
+
+      // Check for stop requests while waiting on the event loop.
+      // Raise the package the commit waits for, the others are background downloads.
+      size_t raised { _wanted };
+      std::shared_ptr<zyppng::Timer> stopCheck { zyppng::Timer::create() };
+      stopCheck->sigExpired().connect( [&]( zyppng::Timer & ) {
+	if ( _stop )
+	  ev->quit();
+	else if ( _wanted != raised )
+	{
+	  raised = _wanted;
+	  if ( downloads[raised] )
+	    downloads[raised]->setPriority( zyppng::NetworkRequest::High );
+	}
+      });
+      stopCheck->start( 250 );
+
+      // Downloaded files are verified in parallel, not blocking the event loop.
+      // Rpms are built from deltarpms by their own workers, so a build does
+      // not delay verifying the downloads.
+      WorkerPool verifier;
+      WorkerPool rebuilder;
+      size_t pending = 0;
+      auto finished = [&]( size_t idx_r, zyppng::Download & dl_r ) {
+	const Job & job { _jobs[idx_r] };
+	if ( dl_r.state() != zyppng::Download::Success )
+	{
+	  DBG << "Preload failed: " << job._url << ": " << dl_r.errorString() << endl;
+	  filesystem::unlink( downloadTarget( job ) );	// the conventional download will report problems
+	  jobDone( idx_r );
+	}
+	else if ( job._deltaFile.empty() )
+	  verifier.add( [this,idx_r]() { verify( idx_r ); } );
+	else
+	  rebuilder.add( [this,idx_r]() { rebuild( idx_r ); } );
+	if ( --pending == 0 )
+	  ev->quit();
+      };
+
+      // Queue all in commit order, the dispatcher starts as many as allowed.
+      std::vector<zyppng::connection> connections;
+      connections.reserve( _jobs.size() );
+      for ( size_t idx = 0; idx < _jobs.size(); ++idx )
+      {
+	const Job & job { _jobs[idx] };
+	if ( filesystem::assert_dir( job._target.dirname() ) != 0
+	     || filesystem::assert_dir( downloadTarget( job ).dirname() ) != 0 )
+	{
+	  jobDone( idx );
+	  continue;
+	}
+	std::shared_ptr<zyppng::Download> dl { downloader.downloadFile( job._url, downloadTarget( job ), job._size ) };
+	connections.push_back( dl->sigFinished().connect( [&finished,idx]( zyppng::Download & dl_r ) { finished( idx, dl_r ); } ) );
+	dl->setPriority( idx == raised ? zyppng::NetworkRequest::High : zyppng::NetworkRequest::Low );
+	++pending;
+	downloads[idx] = dl;
+	dl->start();
+      }
+
+      // Transfers failing early may already be finished.
+      if ( pending && ! _stop )
+	ev->run();
+
+      // Downloads still running are cancelled when the downloader goes out of scope.
+      for ( zyppng::connection & conn : connections )
+	conn.disconnect();
+      verifier.wait();
+      rebuilder.wait();
+
+      if ( pending )
+      {
+	// Stopped: unfinished files are unusable.
+	for ( size_t idx = 0; idx < _jobs.size(); ++idx )
+	{
+	  if ( ! _jobDone[idx] )
+	    filesystem::unlink( downloadTarget( _jobs[idx] ) );
+	}
+      }
+
+      // Don't let anybody wait for jobs we will not process.
+      {
+	std::lock_guard<std::mutex> lock( _mutex );
+	_jobDone.assign( _jobs.size(), true );
+	_done = _jobs.size();
+      }
+      _jobDoneCond.notify_all();
+    }
+
+    std::ostream & operator<<( std::ostream & str, const CommitPackagePreloader & obj )
+    {
+      std::lock_guard<std::mutex> lock( const_cast<std::mutex &>( obj._mutex ) );
+      return str << "CommitPackagePreloader(" << obj._done << "/" << obj._jobs.size() << ")";
+    }
+
+  } // namespace target
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
@@ -0,0 +1,194 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/target/CommitPackagePreloader_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_TARGET_COMMITPACKAGEPRELOADER_P_H
+#define ZYPP_TARGET_COMMITPACKAGEPRELOADER_P_H
+
+#include <iosfwd>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <zypp/APIConfig.h>
+#include <zypp/base/NonCopyable.h>
+#include <zypp/TmpPath.h>
+#include <zypp/Url.h>
+#include <zypp/ByteCount.h>
+#include <zypp/CheckSum.h>
+#include <zypp/ZYppCommitResult.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace target
+  {
+    namespace rpm
+    {
+      class RpmDb;
+    }
+
+    ///////////////////////////////////////////////////////////////////
+    /// \class CommitPackagePreloader
+    /// \brief Download the packages of a commit in the background.
+    ///
+    /// The packages to install are downloaded by a separate thread,
+    /// driving a \ref zyppng::Downloader on its own event loop. All
+    /// downloads are queued at once in commit order and processed
+    /// concurrently: at most \ref ZConfig::download_max_concurrent_connections
+    /// per host, spreading metalink downloads across mirrors. Each file is
+    /// verified by a pool of worker threads as soon as it arrives: The
+    /// checksum is checked and, if the repo wants it, the rpm signature is
+    /// prechecked (\ref rpm::RpmDb::precheckPackageSignature).
+    ///
+    /// The files are stored below \ref cacheRoot, which must be passed
+    /// to the \ref RepoProvidePackage used by the \ref CommitPackageCache.
+    ///
+    /// Before a package is requested from the \ref CommitPackageCache,
+    /// \ref waitFor blocks until the background download is done. The
+    /// \ref CommitPackageCache then takes the preloaded file, if the
+    /// checksum matches, and checks it exactly like a downloaded one (all
+    /// user interaction happens in the calling thread, the signature check
+    /// just picks up the precheck result).
+    /// If the preload failed, the package is simply downloaded the
+    /// conventional way.
+    ///
+    /// The downloads run in the background (\ref zyppng::NetworkRequest::Low),
+    /// except for the package \ref waitFor blocks on. It is raised to
+    /// \ref zyppng::NetworkRequest::High, so it is started on a connection kept
+    /// free for it and gets the biggest share of a limited bandwidth
+    /// (\ref ZConfig::download_max_download_speed).
+    ///
+    /// Only packages from http/https/ftp repos with a known checksum are
+    /// preloaded.
+    ///
+    /// If a package would be built from a deltarpm (\ref repo::PackageProvider),
+    /// the deltarpm is preloaded instead and the rpm is built by a separate pool
+    /// of worker threads, running as many \c applydeltarpm as there are CPUs,
+    /// overlapped with the remaining downloads. A build only starts if the free
+    /// space below \ref cacheRoot leaves room for twice the size of all rpms
+    /// being built, otherwise it waits for the running ones (or, if there are
+    /// none, leaves the package to the conventional download). The built rpm
+    /// is verified like a downloaded one. While \ref waitFor blocks on a
+    /// package being built, the build progress is reported per package
+    /// (\ref repo::DownloadResolvableReport::progressDeltaApply).
+    ///
+    /// \code
+    ///   RepoProvidePackage repoProvidePackage;
+    ///   CommitPackageCache packageCache( repoProvidePackage );
+    ///   CommitPackagePreloader preloader( &rpmDb );
+    ///   repoProvidePackage.addCacheRoot( preloader.cacheRoot() );
+    ///   preloader.start( steps );
+    ///   ...
+    ///   preloader.waitFor( citem );
+    ///   localfile = packageCache.get( citem );
+    /// \endcode
+    ///////////////////////////////////////////////////////////////////
+    class ZYPP_LOCAL CommitPackagePreloader : private base::NonCopyable
+    {
+      friend std::ostream & operator<<( std::ostream & str, const CommitPackagePreloader & obj );
+
+    public:
+      /** Ctor creating the \ref cacheRoot below the package cache.
+       * If \a rpmDb_r is provided, it's used to precheck the package signatures.
+       */
+      explicit CommitPackagePreloader( const rpm::RpmDb * rpmDb_r = nullptr );
+
+      /** Dtor stops a running preload and removes all preloaded files. */
+      ~CommitPackagePreloader();
+
+    public:
+      /** Where preloaded packages are stored (below \c alias/). */
+      const Pathname & cacheRoot() const
+      { return _cacheRoot.path(); }
+
+      /** Start preloading the packages to install in \a steps_r. */
+      void start( const ZYppCommitResult::TransactionStepList & steps_r );
+
+      /** Block until the preload of \a solv_r is done (if it is preloaded at all). */
+      void waitFor( const sat::Solvable & solv_r );
+
+      /** Stop preloading, waiting for the thread to finish.
+       * Running \c applydeltarpm are completed, queued ones are dropped.
+       */
+      void stop();
+
+    private:
+      /** A package to download. */
+      struct Job
+      {
+	Url _url;		///< the rpm or the deltarpm to build it from
+	Pathname _target;	///< the rpm
+	ByteCount _size;	///< download size
+	CheckSum _checksum;	///< the rpms checksum
+	bool _sigCheck;
+	Pathname _deltaFile;	///< if not empty, the deltarpm is downloaded here and the rpm built from it
+	CheckSum _deltaChecksum;
+	ByteCount _buildSize;	///< the size of the rpm to build
+      };
+
+      /** The file \a job_r downloads. */
+      static const Pathname & downloadTarget( const Job & job_r )
+      { return job_r._deltaFile.empty() ? job_r._target : job_r._deltaFile; }
+
+      /** Verify the downloaded file of \a idx_r (runs in a worker thread). */
+      void verify( size_t idx_r );
+
+      /** Build the rpm of \a idx_r from the downloaded deltarpm and verify it (runs in a worker thread). */
+      void rebuild( size_t idx_r );
+
+      /** Wait until building an rpm of \a size_r fits on the disk and reserve the space.
+       * \return \c false if it does not fit even if no other rpm is built.
+       */
+      bool reserveSpace( const ByteCount & size_r );
+
+      /** Release the space reserved by \ref reserveSpace. */
+      void releaseSpace( const ByteCount & size_r );
+
+      /** Remember the build progress of \a idx_r. */
+      void jobProgress( size_t idx_r, unsigned value_r );
+
+      /** Remember \a idx_r as done. */
+      void jobDone( size_t idx_r );
+
+      /** The thread downloading the \ref _jobs. */
+      void run();
+
+    private:
+      const rpm::RpmDb * _rpmDb;
+      filesystem::TmpDir _cacheRoot;
+      std::vector<Job> _jobs;			///< immutable while the thread is running
+      std::map<sat::Solvable,size_t> _jobIndex;	///< immutable while the thread is running
+
+      std::thread _thread;
+      std::atomic<bool> _stop;
+      std::atomic<size_t> _wanted;		///< the job \ref waitFor blocks on, raised by the thread
+      std::mutex _mutex;
+      std::condition_variable _jobDoneCond;
+      std::vector<bool> _jobDone;		///< per job (guarded by _mutex)
+      std::vector<int> _jobProgress;		///< per job build progress, -1 if not building (guarded by _mutex)
+      size_t _done;				///< jobs done (guarded by _mutex)
+      ByteCount _reserved;			///< space reserved by running builds (guarded by _mutex)
+    };
+    ///////////////////////////////////////////////////////////////////
+
+    /** \relates CommitPackagePreloader Stream output */
+    std::ostream & operator<<( std::ostream & str, const CommitPackagePreloader & obj );
+
+  } // namespace target
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_TARGET_COMMITPACKAGEPRELOADER_P_H
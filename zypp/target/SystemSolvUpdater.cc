@@ -0,0 +1,192 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/target/SystemSolvUpdater.cc
+ *
+*/
+extern "C"
+{
+#include <solv/pool.h>
+#include <solv/repo.h>
+#include <solv/repo_solv.h>
+#include <solv/repo_write.h>
+#include <solv/repo_rpmdb.h>
+}
+#include <iostream>
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+
+#include <zypp/base/LogTools.h>
+#include <zypp/base/String.h>
+#include <zypp/AutoDispose.h>
+#include <zypp/PathInfo.h>
+
+#include <zypp/target/SystemSolvUpdater_p.h>
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace target
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace
+    {
+      /** Whether \a solv_r provides \c pattern() or \c product(), so autogenerated solvables depend on it. */
+      bool providesAutogenerated( ::Pool * pool_r, ::Solvable * solv_r )
+      {
+	if ( ! solv_r->provides )
+	  return false;
+	for ( ::Id * pp = solv_r->repo->idarraydata + solv_r->provides; *pp; ++pp )
+	{
+	  ::Id dep = *pp;
+	  while ( ISRELDEP( dep ) )
+	    dep = GETRELDEP( pool_r, dep )->name;
+	  const char * name = ::pool_id2str( pool_r, dep );
+	  if ( str::startsWith( name, "pattern()" ) || str::startsWith( name, "product()" ) )
+	    return true;
+	}
+	return false;
+      }
+    } // namespace
+    ///////////////////////////////////////////////////////////////////
+
+    SystemSolvUpdater::SystemSolvUpdater( const Pathname & root_r, const Pathname & solvfilesPath_r )
+    : _root( root_r )
+    , _solvfilesPath( solvfilesPath_r )
+    {}
+
+    void SystemSolvUpdater::writeJournal( const RepoStatus & status_r ) const
+    {
+      try
+      {
+	status_r.saveToCookieFile( journalFile() );
+	MIL << "Commit journal " << journalFile() << ": " << status_r << endl;
+      }
+      catch ( const Exception & excpt )
+      {
+	ZYPP_CAUGHT( excpt );
+	clearJournal();	// rebuild
+      }
+    }
+
+    void SystemSolvUpdater::clearJournal() const
+    {
+      if ( PathInfo( journalFile() ).isExist() )
+	filesystem::unlink( journalFile() );
+    }
+
+    bool SystemSolvUpdater::valid( const RepoStatus & status_r ) const
+    {
+      if ( ! PathInfo( journalFile() ).isFile() )
+	return false;
+      return( RepoStatus::fromCookieFile( journalFile() ) == status_r );
+    }
+
+    std::string SystemSolvUpdater::update( const Pathname & solvfile_r, const Pathname & outfile_r ) const
+    {
+      ::Pool * pool = ::pool_create();
+      AutoDispose< ::Pool *> guard( pool, ::pool_free );
+      ::Repo * repo = ::repo_create( pool, "@System" );
+
+      {
+	AutoDispose<FILE*> fp( ::fopen( solvfile_r.c_str(), "re" ), ::fclose );
+	if ( ! fp )
+	{
+	  fp.resetDispose();
+	  return str::Str() << solvfile_r << ": " << ::strerror( errno );
+	}
+	if ( ::repo_add_solv( repo, fp, 0 ) != 0 )
+	  return str::Str() << solvfile_r << ": " << ::pool_errstr( pool );
+      }
+      if ( ! repo->rpmdbid )
+	return str::Str() << solvfile_r << ": no rpmdb header ids";
+
+      AutoDispose<void*> state( ::rpm_state_create( pool, _root.c_str() ), ::rpm_state_free );
+      // sorted, so the new headers are added in rpmdb order
+      std::vector< ::Id> installed;
+      {
+	::Queue q;
+	::queue_init( &q );
+	int res = ::rpm_installedrpmdbids( state, "Packages", nullptr, &q );
+	installed.assign( q.elements, q.elements + q.count );
+	::queue_free( &q );
+	if ( res < 0 )
+	  return "Can't read the rpmdb header ids";
+	std::sort( installed.begin(), installed.end() );
+      }
+
+      // Remove packages no longer installed; remember the ones still there.
+      std::unordered_set< ::Id> known;
+      std::vector< ::Id> removed;
+      ::Id p;
+      ::Solvable * s;
+      FOR_REPO_SOLVABLES( repo, p, s )
+      {
+	::Id rpmdbid = repo->rpmdbid[p - repo->start];
+	if ( ! rpmdbid )
+	  continue;	// not from the rpmdb (e.g. product)
+	if ( std::binary_search( installed.begin(), installed.end(), rpmdbid ) )
+	  known.insert( rpmdbid );
+	else if ( providesAutogenerated( pool, s ) )
+	  return str::Str() << "Removed package provides autogenerated solvables: " << ::pool_solvable2str( pool, s );
+	else
+	  removed.push_back( p );
+      }
+      for ( auto it = removed.rbegin(); it != removed.rend(); ++it )
+	::repo_free_solvable( repo, *it, /*reuseids*/true );
+
+      // Add the new headers to a new repodata.
+      unsigned added = 0;
+      ::repo_add_repodata( repo, 0 );
+      for ( ::Id rpmdbid : installed )
+      {
+	if ( known.count( rpmdbid ) )
+	  continue;
+	void * head = ::rpm_byrpmdbid( state, rpmdbid );
+	if ( ! head )
+	  return str::Str() << "Can't read rpmdb header " << rpmdbid << ": " << ::pool_errstr( pool );
+	::Id np = ::repo_add_rpm_handle( repo, head, REPO_REUSE_REPODATA|REPO_NO_INTERNALIZE|RPM_ADD_TRIGGERS );
+	if ( ! np )
+	  return str::Str() << "Can't add rpmdb header " << rpmdbid << ": " << ::pool_errstr( pool );
+	if ( providesAutogenerated( pool, pool->solvables + np ) )
+	  return str::Str() << "New package provides autogenerated solvables: " << ::pool_solvid2str( pool, np );
+	repo->rpmdbid = static_cast< ::Id *>( ::repo_sidedata_extend( repo, repo->rpmdbid, sizeof(::Id), np, 1 ) );
+	repo->rpmdbid[np - repo->start] = rpmdbid;
+	++added;
+      }
+      ::repo_internalize( repo );
+
+      AutoDispose<FILE*> fp( ::fopen( outfile_r.c_str(), "we" ), ::fclose );
+      if ( ! fp )
+      {
+	fp.resetDispose();
+	return str::Str() << outfile_r << ": " << ::strerror( errno );
+      }
+      if ( ::repo_write( repo, fp ) != 0 )
+	return str::Str() << outfile_r << ": " << ::pool_errstr( pool );
+      fp.resetDispose();
+      if ( ::fclose( fp ) != 0 )
+	return str::Str() << outfile_r << ": " << ::strerror( errno );
+
+      MIL << "Updated " << solvfile_r << ": removed " << removed.size() << ", added " << added << " packages" << endl;
+      return std::string();
+    }
+
+    std::ostream & operator<<( std::ostream & str, const SystemSolvUpdater & obj )
+    { return str << "SystemSolvUpdater(" << obj._root << ", " << obj.journalFile() << ")"; }
+
+  } // namespace target
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
@@ -0,0 +1,92 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/target/SystemSolvUpdater_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_TARGET_SYSTEMSOLVUPDATER_P_H
+#define ZYPP_TARGET_SYSTEMSOLVUPDATER_P_H
+
+#include <iosfwd>
+#include <string>
+
+#include <zypp/APIConfig.h>
+#include <zypp/Pathname.h>
+#include <zypp/RepoStatus.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace target
+  {
+    ///////////////////////////////////////////////////////////////////
+    /// \class SystemSolvUpdater
+    /// \brief Update the \c @System solv file incrementally after our own commit.
+    ///
+    /// If the solv file was up to date when the commit started, the commit
+    /// writes a journal (\c cookie.commit) remembering the rpmdb state it
+    /// left behind. As long as the rpmdb is still in this state, nobody else
+    /// touched it and \ref update may patch the existing solv file instead of
+    /// running \c rpmdb2solv over the whole database: Packages whose rpmdb
+    /// header id is gone are removed, new headers are read and added.
+    ///
+    /// Autogenerated patterns and products are not updated incrementally.
+    /// If a changed package provides \c pattern() or \c product(), \ref update
+    /// fails and the solv file must be rebuilt.
+    ///
+    /// \code
+    ///   SystemSolvUpdater updater( root, solvfilesPath );
+    ///   if ( updater.valid( rpmstatus ) && updater.update( solvfile, tmpfile ).empty() )
+    ///     ...; // tmpfile is the updated solv file
+    ///   updater.clearJournal();
+    /// \endcode
+    ///////////////////////////////////////////////////////////////////
+    class ZYPP_LOCAL SystemSolvUpdater
+    {
+      friend std::ostream & operator<<( std::ostream & str, const SystemSolvUpdater & obj );
+
+    public:
+      /** Ctor taking the target root and the directory holding the \c @System solv file. */
+      SystemSolvUpdater( const Pathname & root_r, const Pathname & solvfilesPath_r );
+
+    public:
+      /** The journal file. */
+      Pathname journalFile() const
+      { return _solvfilesPath / "cookie.commit"; }
+
+      /** Remember \a status_r as the state our commit left the rpmdb in. */
+      void writeJournal( const RepoStatus & status_r ) const;
+
+      /** Forget the journal. */
+      void clearJournal() const;
+
+      /** Whether the journal says the rpmdb state \a status_r is the result of our commit. */
+      bool valid( const RepoStatus & status_r ) const;
+
+      /** Apply the rpmdb changes to \a solvfile_r and write the result to \a outfile_r.
+       * \return An empty string on success, otherwise the reason why the solv
+       * file must be rebuilt.
+       */
+      std::string update( const Pathname & solvfile_r, const Pathname & outfile_r ) const;
+
+    private:
+      Pathname _root;
+      Pathname _solvfilesPath;
+    };
+    ///////////////////////////////////////////////////////////////////
+
+    /** \relates SystemSolvUpdater Stream output */
+    std::ostream & operator<<( std::ostream & str, const SystemSolvUpdater & obj );
+
+  } // namespace target
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_TARGET_SYSTEMSOLVUPDATER_P_H
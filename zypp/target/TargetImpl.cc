@@ -47,6 +47,8 @@
 #include <zypp/target/TargetCallbackReceiver.h>
 #include <zypp/target/rpm/librpmDb.h>
 #include <zypp/target/CommitPackageCache.h>
+#include <zypp/target/CommitPackagePreloader_p.h>
+#include <zypp/target/SystemSolvUpdater_p.h>
 #include <zypp/target/RpmPostTransCollector.h>
 
 #include <zypp/parser/ProductFileReader.h>
@@ -91,6 +93,10 @@ namespace zypp
     inline RepoStatus rpmDbRepoStatus( const Pathname & root_r )
     { return RepoStatus( rpmDbStateHash( root_r ), Date() ); }
 
+    /** The status the \c @System solv file cookie is compared to. */
+    inline RepoStatus systemSolvStatus( const Pathname & root_r )
+    { return rpmDbRepoStatus( root_r ) && RepoStatus( root_r/"etc/products.d" ); }
+
   } // namespace target
 } // namespace
 ///////////////////////////////////////////////////////////////////
@@ -111,6 +117,18 @@ namespace zypp
   } //namespace
   /////////////////////////////////////////////////////////////////
 
+  ///////////////////////////////////////////////////////////////////
+  namespace env
+  {
+    /** To run one rpm process per package (in-process librpm transactions otherwise) */
+    inline bool ZYPP_RPM_SUBPROCESS()
+    {
+      const char * env = getenv("ZYPP_RPM_SUBPROCESS");
+      return( env && str::strToBool( env, true ) );
+    }
+  } // namespace env
+  ///////////////////////////////////////////////////////////////////
+
   ///////////////////////////////////////////////////////////////////
   namespace json
   {
@@ -903,7 +921,8 @@ namespace zypp
       bool build_rpm_solv = true;
       // lets see if the rpm solv cache exists
 
-      RepoStatus rpmstatus( rpmDbRepoStatus(_root) && RepoStatus(_root/"etc/products.d") );
+      RepoStatus rpmstatus( systemSolvStatus( _root ) );
+      SystemSolvUpdater updater( _root, base );
 
       bool solvexisted = PathInfo(rpmsolv).isExist();
       if ( solvexisted )
@@ -970,44 +989,60 @@ namespace zypp
         // Take care we unlink the solvfile on exception
         ManagedFile guard( base, filesystem::recursive_rmdir );
 
-        ExternalProgram::Arguments cmd;
-        cmd.push_back( "rpmdb2solv" );
-        if ( ! _root.empty() ) {
-          cmd.push_back( "-r" );
-          cmd.push_back( _root.asString() );
+        // After our own commit the solv file is updated incrementally,
+        // unless the rpmdb was touched by someone else meanwhile.
+        bool updated = false;
+        if ( ! oldSolvFile.empty() && updater.valid( rpmstatus ) )
+        {
+          std::string err { updater.update( oldSolvFile, tmpsolv.path() ) };
+          if ( err.empty() )
+            updated = true;
+          else
+            WAR << "Can't update " << oldSolvFile << " incrementally: " << err << endl;
         }
-        cmd.push_back( "-X" );	// autogenerate pattern/product/... from -package
-        // bsc#1104415: no more application support // cmd.push_back( "-A" );	// autogenerate application pseudo packages
-        cmd.push_back( "-p" );
-        cmd.push_back( Pathname::assertprefix( _root, "/etc/products.d" ).asString() );
+        updater.clearJournal();
+
+        if ( ! updated )
+        {
+          ExternalProgram::Arguments cmd;
+          cmd.push_back( "rpmdb2solv" );
+          if ( ! _root.empty() ) {
+            cmd.push_back( "-r" );
+            cmd.push_back( _root.asString() );
+          }
+          cmd.push_back( "-X" );	// autogenerate pattern/product/... from -package
+          // bsc#1104415: no more application support // cmd.push_back( "-A" );	// autogenerate application pseudo packages
+          cmd.push_back( "-p" );
+          cmd.push_back( Pathname::assertprefix( _root, "/etc/products.d" ).asString() );
 
-        if ( ! oldSolvFile.empty() )
-          cmd.push_back( oldSolvFile.asString() );
+          if ( ! oldSolvFile.empty() )
+            cmd.push_back( oldSolvFile.asString() );
 
-        cmd.push_back( "-o" );
-        cmd.push_back( tmpsolv.path().asString() );
+          cmd.push_back( "-o" );
+          cmd.push_back( tmpsolv.path().asString() );
 
-        ExternalProgram prog( cmd, ExternalProgram::Stderr_To_Stdout );
-	std::string errdetail;
+          ExternalProgram prog( cmd, ExternalProgram::Stderr_To_Stdout );
+          std::string errdetail;
 
-        for ( std::string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
-          WAR << "  " << output;
-          if ( errdetail.empty() ) {
-            errdetail = prog.command();
-            errdetail += '\n';
+          for ( std::string output( prog.receiveLine() ); output.length(); output = prog.receiveLine() ) {
+            WAR << "  " << output;
+            if ( errdetail.empty() ) {
+              errdetail = prog.command();
+              errdetail += '\n';
+            }
+            errdetail += output;
           }
-          errdetail += output;
-        }
 
-        int ret = prog.close();
-        if ( ret != 0 )
-        {
-          Exception ex(str::form("Failed to cache rpm database (%d).", ret));
-          ex.remember( errdetail );
-          ZYPP_THROW(ex);
+          int ret = prog.close();
+          if ( ret != 0 )
+          {
+            Exception ex(str::form("Failed to cache rpm database (%d).", ret));
+            ex.remember( errdetail );
+            ZYPP_THROW(ex);
+          }
         }
 
-        ret = filesystem::rename( tmpsolv, rpmsolv );
+        int ret = filesystem::rename( tmpsolv, rpmsolv );
         if ( ret != 0 )
           ZYPP_THROW(Exception("Failed to move cache to final destination"));
         // if this fails, don't bother throwing exceptions
@@ -1030,6 +1065,7 @@ namespace zypp
       }
       else
       {
+        updater.clearJournal();	// nothing changed
 	// On the fly add missing solv.idx files for bash completion.
 	if ( ! PathInfo(base/"solv.idx").isExist() )
 	  sat::updateSolvFileIndex( rpmsolv );
@@ -1198,8 +1234,12 @@ namespace zypp
         policy_r.allMedia();
 
       if ( policy_r.downloadMode() == DownloadDefault ) {
+        // DownloadInHeaps does not preload all packages, so the file
+        // conflicts check would be incomplete and a failed download may
+        // leave a partially committed transaction. It must be explicitly
+        // requested (policy or zypp.conf), thus it's not the default.
         if ( root() == "/" )
-          policy_r.downloadMode(DownloadInHeaps);
+          policy_r.downloadMode(DownloadInAdvance);
         else
           policy_r.downloadMode(DownloadAsNeeded);
       }
@@ -1330,15 +1370,28 @@ namespace zypp
       if ( ! policy_r.dryRun() || policy_r.downloadMode() == DownloadOnly )
       {
 	// Prepare the package cache. Pass all items requiring download.
-        CommitPackageCache packageCache;
+        RepoProvidePackage repoProvidePackage;
+        CommitPackageCache packageCache( repoProvidePackage );
 	packageCache.setCommitList( steps.begin(), steps.end() );
 
+        // Download the packages concurrently in the background. Each package
+        // is waited for right before it's needed: DownloadInHeaps when
+        // installing it, otherwise when preloading the cache.
+        scoped_ptr<CommitPackagePreloader> preloader;
+        if ( policy_r.downloadMode() == DownloadInAdvance
+             || policy_r.downloadMode() == DownloadOnly
+             || policy_r.downloadMode() == DownloadInHeaps )
+        {
+          preloader.reset( new CommitPackagePreloader( &rpm() ) );
+          repoProvidePackage.addCacheRoot( preloader->cacheRoot() );
+          preloader->start( steps );
+        }
+
         bool miss = false;
-        if ( policy_r.downloadMode() != DownloadAsNeeded )
+        if ( policy_r.downloadMode() == DownloadInAdvance || policy_r.downloadMode() == DownloadOnly )
         {
-          // Preload the cache. Until now this means pre-loading all packages.
-          // Once DownloadInHeaps is fully implemented, this will change and
-          // we may actually have more than one heap.
+          // Preload the cache: all packages are downloaded before
+          // the first one gets installed.
           for_( it, steps.begin(), steps.end() )
           {
 	    switch ( it->stepType() )
@@ -1360,6 +1413,8 @@ namespace zypp
               ManagedFile localfile;
               try
               {
+		if ( preloader )
+		  preloader->waitFor( pi.satSolvable() );
 		localfile = packageCache.get( pi );
                 localfile.resetDispose(); // keep the package file in the cache
               }
@@ -1403,8 +1458,25 @@ namespace zypp
 	  if ( ! policy_r.dryRun() )
 	  {
 	    // if cache is preloaded, check for file conflicts
+	    if ( policy_r.downloadMode() == DownloadInHeaps )
+	    {
+	      // Packages still downloading in the background are reported
+	      // as having no filelist (FindFileConflictstReport::result).
+	      WAR << "DownloadInHeaps: file conflicts are checked for the packages downloaded so far only." << endl;
+	    }
 	    commitFindFileConflicts( policy_r, result );
-	    commit( policy_r, packageCache, result );
+
+	    // If the @System solv file is up to date, a journal remembering the
+	    // rpmdb state we leave behind allows to update it incrementally.
+	    SystemSolvUpdater updater( _root, solvfilesPath() );
+	    RepoStatus productsStatus( _root/"etc/products.d" );
+	    bool solvUptodate = ( systemSolvStatus( _root ) == RepoStatus::fromCookieFile( solvfilesPath()/"cookie" ) );
+	    updater.clearJournal();
+
+	    commit( policy_r, packageCache, result, preloader.get() );
+
+	    if ( solvUptodate && RepoStatus( _root/"etc/products.d" ) == productsStatus )
+	      updater.writeJournal( systemSolvStatus( _root ) );
 	  }
 	  else
 	  {
@@ -1464,7 +1536,8 @@ namespace zypp
 
     void TargetImpl::commit( const ZYppCommitPolicy & policy_r,
 			     CommitPackageCache & packageCache_r,
-			     ZYppCommitResult & result_r )
+			     ZYppCommitResult & result_r,
+			     CommitPackagePreloader * preloader_r )
     {
       // steps: this is our todo-list
       ZYppCommitResult::TransactionStepList & steps( result_r.rTransactionStepList() );
@@ -1481,6 +1554,165 @@ namespace zypp
       std::vector<sat::Solvable> successfullyInstalledPackages;
       TargetImpl::PoolItemList remaining;
 
+      // Unless ZYPP_RPM_SUBPROCESS is set, the packages are collected in a
+      // batch and installed/removed by a single in-process librpm transaction.
+      // In DownloadAsNeeded and DownloadInHeaps mode the transaction is run
+      // in chunks, to keep downloading (or cleaning the cache) meanwhile.
+      // (%posttrans scripts are then run by rpm at the end of each chunk.)
+      const bool rpmTransaction = ! env::ZYPP_RPM_SUBPROCESS();
+      const size_t batchLimit = ( policy_r.downloadMode() == DownloadAsNeeded || policy_r.downloadMode() == DownloadInHeaps ) ? 64 : size_t(-1);
+      struct BatchItem
+      {
+	ZYppCommitResult::TransactionStepList::iterator _step;
+	PoolItem _citem;
+	ManagedFile _localfile;	// if to be installed
+      };
+      std::vector<BatchItem> batch;
+
+      // Returns false if the commit must stop.
+      auto commitBatch = [&]() -> bool
+      {
+	if ( batch.empty() )
+	  return true;
+
+	// rpm changes root for the transaction, affecting the preloading
+	// thread as well. So it must be done when using a non-/ root.
+	if ( preloader_r && _root != "/" )
+	{
+	  for ( const sat::Transaction::Step & s : steps )
+	    preloader_r->waitFor( s.satSolvable() );
+	}
+
+	std::vector<rpm::RpmDb::TransactionElement> elements;
+	elements.reserve( batch.size() );
+	for ( const BatchItem & item : batch )
+	{
+	  Package::constPtr p = item._citem->asKind<Package>();
+	  if ( ! item._localfile->empty() )
+	    elements.push_back( rpm::RpmDb::TransactionElement( *item._localfile, p->multiversionInstall() ) );
+	  else // 'rpm -e' does not like epochs
+	    elements.push_back( rpm::RpmDb::TransactionElement( p->name()
+	                                                        + "-" + p->edition().version()
+	                                                        + "-" + p->edition().release()
+	                                                        + "." + p->arch().asString() ) );
+	}
+
+	// NODEPS and FORCE: See the comment in the per package install below.
+	rpm::RpmInstFlags flags( policy_r.rpmInstFlags() & rpm::RPMINST_JUSTDB );
+	flags |= rpm::RPMINST_NODEPS;
+	flags |= rpm::RPMINST_FORCE;
+	if (policy_r.dryRun())         flags |= rpm::RPMINST_TEST;
+	if (policy_r.rpmExcludeDocs()) flags |= rpm::RPMINST_EXCLUDEDOCS;
+	if (policy_r.rpmNoSignature()) flags |= rpm::RPMINST_NOSIGNATURE;
+
+	// installation progress report proxies, one per element as failed
+	// ones are reported after the transaction; one connected at a time
+	std::vector<std::unique_ptr<RpmInstallPackageReceiver>> installProgress( batch.size() );
+	std::vector<std::unique_ptr<RpmRemovePackageReceiver>> removeProgress( batch.size() );
+	bool aborted = false;
+	auto disconnectProgress = [&]() {
+	  for ( size_t idx = 0; idx < batch.size(); ++idx )
+	  {
+	    if ( installProgress[idx] )
+	    {
+	      aborted = aborted || installProgress[idx]->aborted();
+	      installProgress[idx].reset();
+	    }
+	    if ( removeProgress[idx] )
+	    {
+	      aborted = aborted || removeProgress[idx]->aborted();
+	      removeProgress[idx].reset();
+	    }
+	  }
+	};
+
+	attemptToModify();
+	try
+	{
+	  rpm().runTransaction( elements, flags, [&]( size_t idx_r ) {
+	    if ( ! elements[idx_r].file.empty() )
+	    {
+	      if ( ! installProgress[idx_r] )
+	      {
+		installProgress[idx_r].reset( new RpmInstallPackageReceiver( batch[idx_r]._citem.resolvable() ) );
+		installProgress[idx_r]->tryLevel( target::rpm::InstallResolvableReport::RPM_NODEPS_FORCE );
+	      }
+	      installProgress[idx_r]->connect();
+	    }
+	    else
+	    {
+	      if ( ! removeProgress[idx_r] )
+		removeProgress[idx_r].reset( new RpmRemovePackageReceiver( batch[idx_r]._citem.resolvable() ) );
+	      removeProgress[idx_r]->connect();
+	    }
+	  } );
+	  disconnectProgress();
+	}
+	catch ( const Exception & excpt_r )
+	{
+	  ZYPP_CAUGHT( excpt_r );
+	  disconnectProgress();
+	  ERR << "rpm transaction failed" << endl;
+	  for ( BatchItem & item : batch )
+	  {
+	    item._localfile.resetDispose(); // keep the package file in the cache
+	    item._step->stepStage( sat::Transaction::STEP_ERROR );
+	  }
+	  batch.clear();
+	  return false;
+	}
+
+	bool installFailed = false;
+	for ( size_t idx = 0; idx < batch.size(); ++idx )
+	{
+	  BatchItem & item( batch[idx] );
+	  PoolItem citem( item._citem );
+	  if ( ! elements[idx].file.empty() )
+	  {
+	    if ( elements[idx].failed )
+	    {
+	      WAR << "Install failed: " << citem << endl;
+	      item._localfile.resetDispose(); // keep the package file in the cache
+	      item._step->stepStage( sat::Transaction::STEP_ERROR );
+	      installFailed = true;
+	      continue;
+	    }
+	    HistoryLog().install(citem);
+	    if ( citem.isNeedreboot() ) {
+	      auto rebootNeededFile = root() / "/run/reboot-needed";
+	      if ( filesystem::assert_file( rebootNeededFile ) == EEXIST)
+		filesystem::touch( rebootNeededFile );
+	    }
+	    if ( !policy_r.dryRun() )
+	    {
+	      citem.status().resetTransact( ResStatus::USER );
+	      successfullyInstalledPackages.push_back( citem.satSolvable() );
+	    }
+	  }
+	  else
+	  {
+	    if ( elements[idx].failed )
+	    {
+	      WAR << "removal of " << citem << " failed" << endl;
+	      item._step->stepStage( sat::Transaction::STEP_ERROR );
+	      continue;
+	    }
+	    HistoryLog().remove(citem);
+	    if ( !policy_r.dryRun() )
+	      citem.status().resetTransact( ResStatus::USER );
+	  }
+	  item._step->stepStage( sat::Transaction::STEP_DONE );
+	}
+	batch.clear();
+
+	if ( aborted )
+	{
+	  WAR << "commit aborted by the user" << endl;
+	  abort = true;
+	}
+	return ! ( aborted || installFailed );
+      };
+
       for_( step, steps.begin(), steps.end() )
       {
 	PoolItem citem( *step );
@@ -1503,6 +1735,8 @@ namespace zypp
             ManagedFile localfile;
             try
             {
+	      if ( preloader_r )
+		preloader_r->waitFor( citem.satSolvable() );
 	      localfile = packageCache_r.get( citem );
             }
             catch ( const AbortRequestException &e )
@@ -1529,6 +1763,14 @@ namespace zypp
               continue;
             }
 
+            if ( rpmTransaction )
+            {
+              batch.push_back( BatchItem { step, citem, localfile } );
+              if ( batch.size() >= batchLimit && ! commitBatch() )
+                break;
+              continue;
+            }
+
             // create a installation progress report proxy
             RpmInstallPackageReceiver progress( citem.resolvable() );
             progress.connect(); // disconnected on destruction.
@@ -1613,6 +1855,14 @@ namespace zypp
           }
           else
           {
+            if ( rpmTransaction )
+            {
+              batch.push_back( BatchItem { step, citem, ManagedFile() } );
+              if ( batch.size() >= batchLimit && ! commitBatch() )
+                break;
+              continue;
+            }
+
             RpmRemovePackageReceiver progress( citem.resolvable() );
             progress.connect(); // disconnected on destruction.
 
@@ -1667,6 +1917,10 @@ namespace zypp
           // gets installed/deleted. Handle non-buddies only.
           if ( ! citem.buddy() )
           {
+            // Keep the commit order: the packages batched so far come first.
+            if ( ( citem->isKind<Product>() || citem->isKind<SrcPackage>() ) && ! commitBatch() )
+              break;
+
             if ( citem->isKind<Product>() )
             {
               Product::constPtr p = citem->asKind<Product>();
@@ -1715,6 +1969,9 @@ namespace zypp
 
       } // for
 
+      if ( ! abort )
+        commitBatch();
+
       // process all remembered posttrans scripts. If aborting,
       // at least log omitted scripts.
       if ( abort || (abort = !postTransCollector.executeScripts()) )
@@ -41,6 +41,7 @@ namespace zypp
 
     DEFINE_PTR_TYPE(TargetImpl);
     class CommitPackageCache;
+    class CommitPackagePreloader;
 
     ///////////////////////////////////////////////////////////////////
     //
@@ -207,10 +208,14 @@ namespace zypp
 
   public:
     private:
-      /** Commit ordered changes (internal helper) */
+      /** Commit ordered changes (internal helper)
+       * If a \a preloader_r is passed, each package is waited for before
+       * it is requested from the \a packageCache_r.
+       */
       void commit( const ZYppCommitPolicy & policy_r,
 		   CommitPackageCache & packageCache_r,
-		   ZYppCommitResult & result_r );
+		   ZYppCommitResult & result_r,
+		   CommitPackagePreloader * preloader_r = nullptr );
 
       /** Commit helper checking for file conflicts after download. */
       void commitFindFileConflicts( const ZYppCommitPolicy & policy_r, ZYppCommitResult & result_r );
@@ -28,11 +28,14 @@ extern "C"
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <clocale>
 
 #include <zypp/base/Logger.h>
 #include <zypp/base/String.h>
 #include <zypp/base/Gettext.h>
-#include <zypp/base/LocaleGuard.h>
+#include <zypp/base/Easy.h>
 #include <zypp/base/DtorReset.h>
 
 #include <zypp/Date.h>
@@ -47,6 +50,8 @@ extern "C"
 #include <zypp/HistoryLog.h>
 #include <zypp/target/rpm/librpmDb.h>
 #include <zypp/target/rpm/RpmException.h>
+#include <zypp/target/rpm/RpmTransaction_p.h>
+#include <zypp/target/rpm/RpmTransactionReport_p.h>
 #include <zypp/TmpPath.h>
 #include <zypp/KeyRing.h>
 #include <zypp/ZYppFactory.h>
@@ -685,6 +690,12 @@ void RpmDb::importZyppKeyRingTrustedKeys()
 void RpmDb::exportTrustedKeysInZyppKeyRing()
 { syncTrustedKeys( SYNC_TO_KEYRING ); }
 
+namespace
+{
+  /** Prechecked package signatures are void if the rpm keyring changes. */
+  void sigCheckKeyringChanged();
+} // namespace
+
 ///////////////////////////////////////////////////////////////////
 //
 //
@@ -753,7 +764,9 @@ void RpmDb::importPubkey( const PublicKey & pubkey_r )
       ( str::startsWith( line, "error:" ) ? WAR : DBG ) << line << endl;
     }
 
-    if ( systemStatus() != 0 )
+    int status = systemStatus();
+    sigCheckKeyringChanged();
+    if ( status != 0 )
     {
       ERR << "Failed to remove key " << pubkey_r << " from RPM trusted keyring (ignored)" << endl;
     }
@@ -784,7 +797,9 @@ void RpmDb::importPubkey( const PublicKey & pubkey_r )
       DBG << line << endl;
   }
 
-  if ( systemStatus() != 0 )
+  int status = systemStatus();
+  sigCheckKeyringChanged();
+  if ( status != 0 )
   {
     // Translator: %1% is a gpg public key
     RpmSubprocessException excp( str::Format(_("Failed to import public key %1%") ) % pubkey_r.asString() );
@@ -851,7 +866,9 @@ void RpmDb::removePubkey( const PublicKey & pubkey_r )
       DBG << line << endl;
   }
 
-  if ( systemStatus() != 0 )
+  int status = systemStatus();
+  sigCheckKeyringChanged();
+  if ( status != 0 )
   {
     // Translator: %1% is a gpg public key
     RpmSubprocessException excp( str::Format(_("Failed to remove public key %1%") ) % pubkey_r.asString() );
@@ -1107,19 +1124,19 @@ void RpmDb::getData( const std::string & name_r, const Edition & ed_r,
 ///////////////////////////////////////////////////////////////////
 namespace
 {
+  /** Capture the rpm log messages issued by the current thread. */
   struct RpmlogCapture : public std::string
   {
     RpmlogCapture()
-    { rpmlog()._cap = this; }
+    { rpmlog(); Rpmlog::_cap = this; }
 
     ~RpmlogCapture()
-    { rpmlog()._cap = nullptr; }
+    { Rpmlog::_cap = nullptr; }
 
   private:
     struct Rpmlog
     {
       Rpmlog()
-      : _cap( nullptr )
       {
 	rpmlogSetCallback( rpmLogCB, this );
 	rpmSetVerbosity( RPMLOG_INFO );
@@ -1140,17 +1157,155 @@ namespace
       }
 
       FILE * _f;
-      std::string * _cap;
+      static thread_local std::string * _cap;	// per thread, as signatures are checked in parallel
     };
 
     static Rpmlog & rpmlog()
     { static Rpmlog _rpmlog; return _rpmlog; }
   };
+  thread_local std::string * RpmlogCapture::Rpmlog::_cap = nullptr;
+
+  /** Temporarily use the "C" locale in the current thread.
+   * Unlike \ref LocaleGuard (\c setlocale) this does not affect other threads.
+   */
+  struct ThreadLocaleGuard
+  {
+    NON_COPYABLE(ThreadLocaleGuard);
+    NON_MOVABLE(ThreadLocaleGuard);
+
+    ThreadLocaleGuard()
+    : _locale( ::newlocale( LC_ALL_MASK, "C", (locale_t)0 ) )
+    , _saved( _locale ? ::uselocale( _locale ) : (locale_t)0 )
+    {}
+
+    ~ThreadLocaleGuard()
+    { restore(); }
+
+    void restore()
+    {
+      if ( _locale )
+      {
+	::uselocale( _saved );
+	::freelocale( _locale );
+	_locale = (locale_t)0;
+      }
+    }
+
+  private:
+    locale_t _locale;
+    locale_t _saved;
+  };
+
+  ///////////////////////////////////////////////////////////////////
+  /// \brief Signature check results remembered by \ref RpmDb::precheckPackageSignature.
+  ///
+  /// Results are valid for an unchanged file and rpm keyring. A result
+  /// is handed out once and then forgotten.
+  ///////////////////////////////////////////////////////////////////
+  struct SigCheckCache
+  {
+    struct Entry
+    {
+      Pathname _root;
+      unsigned _keyring;
+      ino_t _ino;
+      off_t _size;
+      time_t _mtime;
+      RpmDb::CheckPackageResult _result;
+      RpmDb::CheckPackageDetail _detail;
+    };
+
+    static SigCheckCache & instance()
+    { static SigCheckCache _instance; return _instance; }
+
+    /** The rpm keyrings state. */
+    unsigned keyring() const
+    { return _keyring; }
+
+    /** Forget all results as the keyring changed. */
+    void keyringChanged()
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      ++_keyring;
+      _entries.clear();
+    }
+
+    void clear()
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      _entries.clear();
+    }
+
+    void put( const Pathname & path_r, Entry && entry_r )
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      if ( entry_r._keyring == _keyring )
+	_entries[path_r] = std::move(entry_r);
+    }
+
+    bool take( const Pathname & path_r, const Pathname & root_r, RpmDb::CheckPackageResult & result_r, RpmDb::CheckPackageDetail & detail_r )
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      auto it = _entries.find( path_r );
+      if ( it == _entries.end() )
+	return false;
+
+      Entry entry { std::move(it->second) };
+      _entries.erase( it );
+
+      PathInfo pi( path_r );
+      if ( entry._root != root_r || entry._keyring != _keyring
+	   || ! pi.isFile() || pi.ino() != entry._ino || pi.size() != entry._size || pi.mtime() != entry._mtime )
+	return false;
+
+      result_r = entry._result;
+      detail_r = std::move(entry._detail);
+      return true;
+    }
+
+  private:
+    std::mutex _mutex;
+    std::atomic<unsigned> _keyring { 0 };
+    std::map<Pathname,Entry> _entries;
+  };
+
+  void sigCheckKeyringChanged()
+  { SigCheckCache::instance().keyringChanged(); }
+
+  /** A signature checking \c rpmts per worker thread. Its keyring is loaded once. */
+  struct ThreadSigCheckTs
+  {
+    ~ThreadSigCheckTs()
+    { if ( _ts ) ::rpmtsFree( _ts ); }
+
+    rpmts get( const Pathname & root_r, unsigned keyring_r )
+    {
+      if ( _ts && ( _root != root_r || _keyring != keyring_r ) )
+      {
+	::rpmtsFree( _ts );
+	_ts = nullptr;
+      }
+      if ( ! _ts )
+      {
+	_ts = ::rpmtsCreate();
+	::rpmtsSetRootDir( _ts, root_r.c_str() );
+	_root = root_r;
+	_keyring = keyring_r;
+      }
+      return _ts;
+    }
+
+  private:
+    rpmts _ts = nullptr;
+    Pathname _root;
+    unsigned _keyring = 0;
+  };
 
   RpmDb::CheckPackageResult doCheckPackageSig( const Pathname & path_r,			// rpm file to check
 					       const Pathname & root_r,			// target root
 					       bool  requireGPGSig_r,			// whether no gpg signature is to be reported
-					       RpmDb::CheckPackageDetail & detail_r )	// detailed result
+					       RpmDb::CheckPackageDetail & detail_r,	// detailed result
+					       rpmts ts_r = nullptr )			// (reused) ts to check with, a temporary one otherwise
   {
     PathInfo file( path_r );
     if ( ! file.isFile() )
@@ -1167,8 +1322,12 @@ namespace
 	::Fclose( fd );
       return RpmDb::CHK_ERROR;
     }
-    rpmts ts = ::rpmtsCreate();
-    ::rpmtsSetRootDir( ts, root_r.c_str() );
+    rpmts ts = ts_r;
+    if ( ! ts )
+    {
+      ts = ::rpmtsCreate();
+      ::rpmtsSetRootDir( ts, root_r.c_str() );
+    }
     ::rpmtsSetVSFlags( ts, RPMVSF_DEFAULT );
 
     rpmQVKArguments_s qva;
@@ -1181,11 +1340,12 @@ namespace
     ::rpmtsSetVfyFlags( ts, RPMVSF_DEFAULT );
 #endif
     RpmlogCapture vresult;
-    LocaleGuard guard( LC_ALL, "C" );	// bsc#1076415: rpm log output is localized, but we need to parse it :(
+    ThreadLocaleGuard guard;	// bsc#1076415: rpm log output is localized, but we need to parse it :(
     int res = ::rpmVerifySignatures( &qva, ts, fd, path_r.basename().c_str() );
     guard.restore();
 
-    ts = rpmtsFree(ts);
+    if ( ts != ts_r )
+      ts = rpmtsFree(ts);
     ::Fclose( fd );
 
     // results per line...
@@ -1269,7 +1429,37 @@ RpmDb::CheckPackageResult RpmDb::checkPackage( const Pathname & path_r )
 { CheckPackageDetail dummy; return checkPackage( path_r, dummy ); }
 
 RpmDb::CheckPackageResult RpmDb::checkPackageSignature( const Pathname & path_r, RpmDb::CheckPackageDetail & detail_r )
-{ return doCheckPackageSig( path_r, root(), true/*requireGPGSig_r*/, detail_r ); }
+{
+  CheckPackageResult ret;
+  if ( SigCheckCache::instance().take( path_r, root(), ret, detail_r ) )
+  {
+    DBG << "Prechecked signature " << path_r << ": " << ret << endl;
+    return ret;
+  }
+  return doCheckPackageSig( path_r, root(), true/*requireGPGSig_r*/, detail_r );
+}
+
+void RpmDb::precheckPackageSignature( const Pathname & path_r ) const
+{
+  static thread_local ThreadSigCheckTs threadTs;
+
+  SigCheckCache & cache( SigCheckCache::instance() );
+  PathInfo pi( path_r );
+  if ( ! pi.isFile() )
+    return;
+
+  SigCheckCache::Entry entry;
+  entry._root = root();
+  entry._keyring = cache.keyring();
+  entry._ino = pi.ino();
+  entry._size = pi.size();
+  entry._mtime = pi.mtime();
+  entry._result = doCheckPackageSig( path_r, entry._root, true/*requireGPGSig_r*/, entry._detail, threadTs.get( entry._root, entry._keyring ) );
+  cache.put( path_r, std::move(entry) );
+}
+
+void RpmDb::discardPrecheckedPackageSignatures()
+{ SigCheckCache::instance().clear(); }
 
 
 // determine changed files of installed package
@@ -1896,6 +2086,124 @@ void RpmDb::doRemovePackage( const std::string & name_r, RpmInstFlags flags, cal
   }
 }
 
+///////////////////////////////////////////////////////////////////
+//
+//
+//	METHOD NAME : RpmDb::runTransaction
+//	METHOD TYPE : void
+//
+void RpmDb::runTransaction( std::vector<TransactionElement> & elements_r, RpmInstFlags flags, const TransactionElementCallback & start_r )
+{
+  FAILIFNOTINITIALIZED;
+
+  MIL << "RpmDb::runTransaction(" << elements_r.size() << "," << flags << ")" << endl;
+
+  // Invalidate all outstanding database handles as
+  // the database gets modified.
+  librpmDb::dbRelease( true );
+
+  RpmTransactionReport result( elements_r );
+  {
+    RpmTransaction trans( _root, _dbPath, flags );
+    for ( size_t idx = 0; idx < elements_r.size(); ++idx )
+    {
+      TransactionElement & el( elements_r[idx] );
+      el.failed = false;
+      if ( el.file.empty() )
+      {
+        if ( _packagebackups && ! backupPackage( el.name ) )
+          ERR << "backup of " << el.name << " failed" << endl;
+        trans.addErase( idx, el.name );
+      }
+      else
+      {
+        if ( _packagebackups && ! backupPackage( el.file ) )
+          ERR << "backup of " << el.file.asString() << " failed" << endl;
+        trans.addInstall( idx, el.file, el.noupgrade );
+      }
+    }
+
+    callback::SendReport<RpmInstallReport> installReport;
+    callback::SendReport<RpmRemoveReport> removeReport;
+    RpmlogCapture rpmlogcap;	// rpm errors logged while processing an element
+
+    auto start = [&]( size_t idx_r )
+    {
+      const TransactionElement & el( elements_r[idx_r] );
+      if ( start_r )
+        start_r( idx_r );
+      if ( el.file.empty() )
+        removeReport->start( el.name );
+      else
+        installReport->start( el.file );
+    };
+
+    auto progress = [&]( size_t idx_r, unsigned percent_r )
+    {
+      if ( elements_r[idx_r].file.empty() )
+        removeReport->progress( percent_r );
+      else
+        installReport->progress( percent_r );
+    };
+
+    // A failed element is reported once the transaction is closed,
+    // no user interaction while rpm holds the database.
+    auto done = [&]( size_t idx_r, bool failed_r, const std::string & output_r )
+    {
+      std::string output;
+      output.swap( rpmlogcap );
+      output += output_r;
+      result.done( idx_r, failed_r, output );
+    };
+
+    trans.run( start, progress, done );
+  }
+
+  bool completed = result.send( start_r, [this]( const Pathname & file_r, const std::string & line_r ) {
+    processConfigFiles(line_r, Pathname::basename(file_r), " saved as ",
+                       // %s = filenames
+                       _("rpm saved %s as %s, but it was impossible to determine the difference"),
+                       // %s = filenames
+                       _("rpm saved %s as %s.\nHere are the first 25 lines of difference:\n"));
+    processConfigFiles(line_r, Pathname::basename(file_r), " created as ",
+                       // %s = filenames
+                       _("rpm created %s as %s, but it was impossible to determine the difference"),
+                       // %s = filenames
+                       _("rpm created %s as %s.\nHere are the first 25 lines of difference:\n"));
+  } );
+  if ( ! completed )
+    return;
+
+  // Retrying an element is not possible within the transaction.
+  for ( size_t idx : result.retries() )
+  {
+    TransactionElement & el( elements_r[idx] );
+    MIL << "Retry outside the transaction: " << ( el.file.empty() ? el.name : el.file.asString() ) << endl;
+    if ( start_r )
+      start_r( idx );
+    try
+    {
+      if ( el.file.empty() )
+        removePackage( el.name, flags );
+      else
+      {
+        RpmInstFlags iflags( flags );
+        if ( el.noupgrade )
+          iflags |= RPMINST_NOUPGRADE;
+        installPackage( el.file, iflags );
+      }
+      el.failed = false;
+    }
+    catch ( const RpmException & excpt_r )
+    {
+      // installPackage and removePackage throw if the user aborted
+      ZYPP_CAUGHT( excpt_r );
+      el.failed = true;
+      break;
+    }
+  }
+}
+
 ///////////////////////////////////////////////////////////////////
 //
 //
@@ -20,6 +20,7 @@
 #include <vector>
 #include <string>
 
+#include <zypp/base/Function.h>
 #include <zypp/Pathname.h>
 #include <zypp/ExternalProgram.h>
 
@@ -392,6 +393,22 @@ public:
    */
   CheckPackageResult checkPackageSignature( const Pathname & path_r, CheckPackageDetail & detail_r );
 
+  /**
+   * Check the signature of rpm file on disk in advance.
+   *
+   * The result is remembered and returned by the next \ref checkPackageSignature
+   * for this file, if neither the file nor the rpm keyring changed meanwhile.
+   * So the usual signature check workflow stays unchanged, but the actual
+   * checks of many packages can be done in parallel.
+   *
+   * \note This may be called from any thread. Each thread uses it's own
+   * rpm keyring handle.
+   */
+  void precheckPackageSignature( const Pathname & path_r ) const;
+
+  /** Forget all results of \ref precheckPackageSignature not yet used. */
+  static void discardPrecheckedPackageSignatures();
+
   /** install rpm package
    *
    * @param filename file to install
@@ -417,6 +434,54 @@ public:
   void removePackage( const std::string & name_r, RpmInstFlags flags = RPMINST_NONE );
   void removePackage( Package::constPtr package, RpmInstFlags flags = RPMINST_NONE );
 
+  /** An element of \ref runTransaction: A package to install or to remove. */
+  struct TransactionElement
+  {
+    /** Install the package \a file_r, optionally without replacing other versions (like <tt>rpm -i</tt>). */
+    TransactionElement( const Pathname & file_r, bool noupgrade_r = false )
+    : file { file_r }, noupgrade { noupgrade_r }, failed { false }
+    {}
+
+    /** Remove the installed package \a name_r (<tt>N-V-R.A</tt>). */
+    TransactionElement( const std::string & name_r )
+    : name { name_r }, noupgrade { false }, failed { false }
+    {}
+
+    Pathname    file;		//!< package to install or
+    std::string name;		//!< package to remove
+    bool        noupgrade;	//!< install without replacing other versions
+    bool        failed;		//!< result: the element could not be processed
+  };
+
+  /** Callback invoked before an element of \ref runTransaction is started or reported as failed. */
+  typedef function<void( size_t idx_r )> TransactionElementCallback;
+
+  /** install and remove packages in a single librpm transaction
+   *
+   * Rather than running one \c rpm process per package, all \a elements_r
+   * are processed in-process by one \c rpmts, in the given order. Like
+   * \ref installPackage and \ref removePackage a \ref RpmInstallReport or
+   * \ref RpmRemoveReport is sent for each element while rpm processes
+   * it. Only a failed element is reported as \c problem and finished once
+   * the transaction is closed (as well as config file diffs and the
+   * history are written). \a start_r is invoked before an element is
+   * started or reported as failed, so the caller may (re)connect the
+   * receiver of the element.
+   *
+   * Elements rpm failed to process are tagged \c failed. As the
+   * transaction can't be repeated, a failed element the user wants to
+   * retry is retried by \ref installPackage or \ref removePackage once
+   * the transaction is done. If the user aborts, no element is retried.
+   *
+   * @param elements_r what to do
+   * @param flags which rpm options to use
+   * @param start_r callback invoked before an element is started or reported as failed
+   *
+   * \throws RpmException if the transaction could not be set up.
+   * */
+  void runTransaction( std::vector<TransactionElement> & elements_r, RpmInstFlags flags = RPMINST_NONE,
+                       const TransactionElementCallback & start_r = TransactionElementCallback() );
+
   /**
    * get backup dir for rpm config files
    *
@@ -0,0 +1,476 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/target/rpm/RpmTransaction.cc
+ *
+*/
+#include "librpm.h"
+extern "C"
+{
+#include <rpm/rpmte.h>
+#include <rpm/rpmps.h>
+}
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+
+#include <zypp/base/LogTools.h>
+#include <zypp/base/String.h>
+#include <zypp/TmpPath.h>
+#include <zypp/ZConfig.h>
+
+#include <zypp/target/rpm/RpmTransaction_p.h>
+#include <zypp/target/rpm/RpmException.h>
+#include <zypp/target/rpm/librpmDb.h>
+
+#undef ZYPP_BASE_LOGGER_LOGGROUP
+#define ZYPP_BASE_LOGGER_LOGGROUP "librpmDb"
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace target
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace rpm
+    {
+      ///////////////////////////////////////////////////////////////////
+      /// \class RpmTransaction::Impl
+      /// \brief RpmTransaction implementation.
+      ///////////////////////////////////////////////////////////////////
+      class RpmTransaction::Impl : private base::NonCopyable
+      {
+	friend std::ostream & operator<<( std::ostream & str, const Impl & obj );
+
+	static constexpr size_t noidx = size_t(-1);
+
+	/** Our view of an element added to the \c rpmts. */
+	struct Element
+	{
+	  Pathname _file;		///< package to install (opened on demand)
+	  std::string _label;		///< installed package to remove
+	  std::string _error;		///< why it could not be added
+	  std::vector<rpmte> _te;	///< the transaction elements
+	  FD_t _fd = nullptr;
+	  bool _used = false;
+	  bool _added = false;
+	  bool _done = false;
+	};
+
+      public:
+	Impl( const Pathname & root_r, const Pathname & dbPath_r, RpmInstFlags flags_r )
+	: _root { root_r }
+	, _dbPath { dbPath_r }
+	, _ts { nullptr }
+	, _probFilter { RPMPROB_FILTER_NONE }
+	, _current { noidx }
+	{
+	  // set %_dbpath macro
+	  ::addMacro( NULL, "_dbpath", NULL, _dbPath.c_str(), RMIL_CMDLINE );
+
+	  _ts = ::rpmtsCreate();
+	  ::rpmtsSetRootDir( _ts, _root.c_str() );
+
+	  rpmtransFlags transFlags = RPMTRANS_FLAG_NONE;
+	  if ( flags_r & RPMINST_TEST )
+	    transFlags |= RPMTRANS_FLAG_TEST;
+	  if ( flags_r & RPMINST_JUSTDB )
+	    transFlags |= RPMTRANS_FLAG_JUSTDB;
+	  if ( flags_r & RPMINST_NOSCRIPTS )
+	    transFlags |= RPMTRANS_FLAG_NOSCRIPTS;
+	  if ( flags_r & RPMINST_EXCLUDEDOCS )
+	    transFlags |= RPMTRANS_FLAG_NODOCS;
+	  if ( flags_r & RPMINST_NOPOSTTRANS )
+	    transFlags |= RPMTRANS_FLAG_NOPOSTTRANS;
+	  ::rpmtsSetFlags( _ts, transFlags );
+
+	  rpmVSFlags vsFlags = ::rpmtsVSFlags( _ts );
+	  if ( flags_r & RPMINST_NODIGEST )
+	    vsFlags |= _RPMVSF_NODIGESTS;
+	  if ( flags_r & RPMINST_NOSIGNATURE )
+	    vsFlags |= _RPMVSF_NOSIGNATURES;
+	  ::rpmtsSetVSFlags( _ts, vsFlags );
+
+	  if ( flags_r & RPMINST_FORCE )
+	    _probFilter |= ( RPMPROB_FILTER_REPLACEPKG | RPMPROB_FILTER_OLDPACKAGE
+	                   | RPMPROB_FILTER_REPLACENEWFILES | RPMPROB_FILTER_REPLACEOLDFILES );
+	  if ( flags_r & RPMINST_IGNORESIZE )
+	    _probFilter |= ( RPMPROB_FILTER_DISKSPACE | RPMPROB_FILTER_DISKNODES );
+	  // ZConfig defines cross-arch installation
+	  if ( ! ZConfig::instance().systemArchitecture().compatibleWith( ZConfig::instance().defaultSystemArchitecture() ) )
+	    _probFilter |= RPMPROB_FILTER_IGNOREARCH;
+
+	  int res = ::rpmtsOpenDB( _ts, O_RDWR );
+	  if ( res )
+	  {
+	    ERR << "rpmdbOpen error(" << res << "): " << *this << endl;
+	    ::rpmtsFree( _ts );
+	    _ts = nullptr;
+	    ZYPP_THROW( RpmDbOpenException( _root, _dbPath ) );
+	  }
+	}
+
+	~Impl()
+	{
+	  for ( Element & el : _elements )
+	  {
+	    if ( el._fd )
+	      ::Fclose( el._fd );
+	  }
+	  if ( _ts )
+	    ::rpmtsFree( _ts );
+	}
+
+      public:
+	bool addInstall( size_t idx_r, const Pathname & file_r, bool noupgrade_r )
+	{
+	  Element & el { element( idx_r ) };
+	  el._file = file_r;
+
+	  FD_t fd = ::Fopen( file_r.c_str(), "r.ufdio" );
+	  if ( fd == 0 || ::Ferror(fd) )
+	  {
+	    el._error = str::Str() << "Can't open file for reading: " << file_r << " (" << ::Fstrerror(fd) << ")";
+	    ERR << el._error << endl;
+	    if ( fd )
+	      ::Fclose( fd );
+	    return false;
+	  }
+	  Header h = nullptr;
+	  rpmRC res = ::rpmReadPackageFile( _ts, fd, file_r.c_str(), &h );
+	  ::Fclose( fd );
+
+	  if ( ! h || ( res != RPMRC_OK && res != RPMRC_NOTTRUSTED && res != RPMRC_NOKEY ) )
+	  {
+	    el._error = str::Str() << file_r << ": not a valid rpm package (" << res << ")";
+	    ERR << el._error << endl;
+	    if ( h )
+	      ::headerFree( h );
+	    return false;
+	  }
+
+	  int rc = ::rpmtsAddInstallElement( _ts, h, idxKey( idx_r ), ( noupgrade_r ? 0 : 1 ), NULL );
+	  ::headerFree( h );
+	  if ( rc )
+	  {
+	    el._error = str::Str() << file_r << ": can't be added to the rpm transaction (" << rc << ")";
+	    ERR << el._error << endl;
+	    return false;
+	  }
+	  el._added = true;
+	  return true;
+	}
+
+	bool addErase( size_t idx_r, const std::string & label_r )
+	{
+	  Element & el { element( idx_r ) };
+	  el._label = label_r;
+
+	  rpmdbMatchIterator mi = ::rpmtsInitIterator( _ts, RPMDBI_LABEL, label_r.c_str(), 0 );
+	  while ( Header h = ::rpmdbNextIterator( mi ) )
+	  {
+	    unsigned offset = ::rpmdbGetIteratorOffset( mi );
+	    if ( ::rpmtsAddEraseElement( _ts, h, offset ) == 0 )
+	    {
+	      _eraseIdx[offset] = idx_r;
+	      el._added = true;
+	    }
+	  }
+	  ::rpmdbFreeIterator( mi );
+
+	  if ( ! el._added )
+	  {
+	    el._error = str::Str() << "package " << label_r << " is not installed";
+	    ERR << el._error << endl;
+	  }
+	  return el._added;
+	}
+
+	bool run( const StartFnc & start_r, const ProgressFnc & progress_r, const DoneFnc & done_r )
+	{
+	  _start = &start_r;
+	  _progress = &progress_r;
+	  _done = &done_r;
+
+	  // Map the transaction elements to ours. Erasing the old versions
+	  // of upgraded packages are elements of their own, not reported
+	  // separately.
+	  rpmtsi pi = ::rpmtsiInit( _ts );
+	  while ( rpmte te = ::rpmtsiNext( pi, rpmElementTypes(0) ) )
+	  {
+	    size_t idx = noidx;
+	    if ( ::rpmteType( te ) == TR_ADDED )
+	      idx = keyIdx( ::rpmteKey( te ) );
+	    else
+	    {
+	      auto it = _eraseIdx.find( ::rpmteDBOffset( te ) );
+	      if ( it != _eraseIdx.end() )
+		idx = it->second;
+	    }
+	    if ( idx < _elements.size() )
+	      _elements[idx]._te.push_back( te );
+	  }
+	  ::rpmtsiFree( pi );
+
+	  // Collect the scriptlets output in a file, forwarded per element.
+	  filesystem::TmpFile scriptOut( filesystem::TmpPath::defaultLocation(), "rpmscript." );
+	  FD_t scriptFd = ::Fopen( scriptOut.path().c_str(), "w.ufdio" );
+	  if ( scriptFd && ! ::Ferror( scriptFd ) )
+	  {
+	    ::rpmtsSetScriptFd( _ts, scriptFd );
+	    _scriptIn.open( scriptOut.path().c_str() );
+	  }
+
+	  ::rpmtsSetNotifyCallback( _ts, notifyCB, this );
+
+	  MIL << "rpmtsRun " << *this << endl;
+	  int res = ::rpmtsRun( _ts, NULL, _probFilter );
+	  elementDone();
+	  MIL << "rpmtsRun returned " << res << endl;
+
+	  ::rpmtsSetNotifyCallback( _ts, NULL, NULL );
+	  ::rpmtsSetScriptFd( _ts, NULL );
+	  if ( scriptFd )
+	    ::Fclose( scriptFd );
+	  _scriptIn.close();
+
+	  std::string problems;
+	  if ( res > 0 )
+	  {
+	    rpmps ps = ::rpmtsProblems( _ts );
+	    rpmpsi psi = ::rpmpsInitIterator( ps );
+	    while ( rpmProblem p = ::rpmpsiNext( psi ) )
+	    {
+	      char * msg = ::rpmProblemString( p );
+	      if ( msg )
+	      {
+		problems += msg;
+		problems += '\n';
+		::free( msg );
+	      }
+	    }
+	    ::rpmpsFreeIterator( psi );
+	    ::rpmpsFree( ps );
+	    ERR << "rpm transaction problems:" << endl << problems;
+	  }
+	  else if ( res < 0 )
+	  {
+	    problems = "rpm transaction failed\n";
+	  }
+
+	  // Report whatever rpm did not get to.
+	  for ( size_t idx = 0; idx < _elements.size(); ++idx )
+	  {
+	    Element & el { _elements[idx] };
+	    if ( ! el._used || el._done )
+	      continue;
+
+	    el._done = true;
+	    start_r( idx );
+	    if ( ! el._added )
+	      done_r( idx, true, el._error );
+	    else
+	      done_r( idx, ( res != 0 || teFailed( el ) ), problems );
+	  }
+
+	  _start = nullptr;
+	  _progress = nullptr;
+	  _done = nullptr;
+	  return res <= 0;
+	}
+
+      private:
+	Element & element( size_t idx_r )
+	{
+	  if ( idx_r >= _elements.size() )
+	    _elements.resize( idx_r+1 );
+	  _elements[idx_r]._used = true;
+	  return _elements[idx_r];
+	}
+
+	static fnpyKey idxKey( size_t idx_r )
+	{ return reinterpret_cast<fnpyKey>( idx_r + 1 ); }
+
+	static size_t keyIdx( fnpyKey key_r )
+	{ return reinterpret_cast<size_t>( key_r ) - 1; }	// NULL key: noidx
+
+	static bool teFailed( const Element & el_r )
+	{
+	  for ( rpmte te : el_r._te )
+	  {
+	    if ( ::rpmteFailed( te ) )
+	      return true;
+	  }
+	  return false;
+	}
+
+	/** Start reporting \a idx_r, finishing a previous one. */
+	void elementStart( size_t idx_r )
+	{
+	  if ( idx_r >= _elements.size() || idx_r == _current || _elements[idx_r]._done )
+	    return;
+	  elementDone();
+	  _current = idx_r;
+	  (*_start)( idx_r );
+	}
+
+	/** Finish reporting the current element.
+	 * rpm tags a failed element after it's done, so this happens
+	 * when the next one starts or after the transaction.
+	 */
+	void elementDone()
+	{
+	  if ( _current == noidx )
+	    return;
+	  size_t idx = _current;
+	  _current = noidx;
+
+	  Element & el { _elements[idx] };
+	  el._done = true;
+	  (*_done)( idx, teFailed( el ), scriptOutput() );
+	}
+
+	/** The scriptlets output since the last call. */
+	std::string scriptOutput()
+	{
+	  std::string ret;
+	  if ( _scriptIn.is_open() )
+	  {
+	    _scriptIn.clear();	// reset EOF
+	    for( std::string line; std::getline( _scriptIn, line ); )
+	    {
+	      ret += line;
+	      ret += '\n';
+	    }
+	  }
+	  return ret;
+	}
+
+	void * notify( Header h_r, rpmCallbackType what_r, rpm_loff_t amount_r, rpm_loff_t total_r, fnpyKey key_r )
+	{
+	  switch ( what_r )
+	  {
+	    case RPMCALLBACK_INST_OPEN_FILE:
+	    {
+	      // Also for %pretrans/%posttrans, so this does not start the element.
+	      size_t idx = keyIdx( key_r );
+	      if ( idx >= _elements.size() )
+		return nullptr;
+	      Element & el { _elements[idx] };
+	      if ( ! el._fd )
+	      {
+		el._fd = ::Fopen( el._file.c_str(), "r.ufdio" );
+		if ( el._fd == 0 || ::Ferror( el._fd ) )
+		{
+		  ERR << "Can't open file for reading: " << el._file << " (" << ::Fstrerror( el._fd ) << ")" << endl;
+		  if ( el._fd )
+		    ::Fclose( el._fd );
+		  el._fd = nullptr;
+		}
+	      }
+	      return el._fd;
+	    }
+	    break;
+
+	    case RPMCALLBACK_INST_CLOSE_FILE:
+	    {
+	      size_t idx = keyIdx( key_r );
+	      if ( idx < _elements.size() && _elements[idx]._fd )
+	      {
+		::Fclose( _elements[idx]._fd );
+		_elements[idx]._fd = nullptr;
+	      }
+	    }
+	    break;
+
+	    case RPMCALLBACK_INST_START:
+	      elementStart( keyIdx( key_r ) );
+	      break;
+
+	    case RPMCALLBACK_UNINST_START:
+	      if ( h_r )
+	      {
+		auto it = _eraseIdx.find( ::headerGetInstance( h_r ) );
+		if ( it != _eraseIdx.end() )
+		  elementStart( it->second );
+	      }
+	      break;
+
+	    case RPMCALLBACK_INST_PROGRESS:
+	    case RPMCALLBACK_UNINST_PROGRESS:
+	      // Erasing the old version of an upgraded package adds to the current one.
+	      if ( _current != noidx && total_r )
+		(*_progress)( _current, unsigned( amount_r * 100 / total_r ) );
+	      break;
+
+	    default:
+	      break;
+	  }
+	  return nullptr;
+	}
+
+	static void * notifyCB( const void * h_r, const rpmCallbackType what_r, const rpm_loff_t amount_r, const rpm_loff_t total_r, fnpyKey key_r, rpmCallbackData data_r )
+	{ return reinterpret_cast<Impl*>(data_r)->notify( (Header)h_r, what_r, amount_r, total_r, key_r ); }
+
+      private:
+	Pathname _root;
+	Pathname _dbPath;
+	rpmts _ts;
+	rpmprobFilterFlags _probFilter;
+
+	std::vector<Element> _elements;
+	std::map<unsigned,size_t> _eraseIdx;	///< rpmdb offset to element index
+
+	size_t _current;			///< element currently processed by rpm
+	std::ifstream _scriptIn;
+	const StartFnc * _start = nullptr;
+	const ProgressFnc * _progress = nullptr;
+	const DoneFnc * _done = nullptr;
+      };
+
+      /** \relates RpmTransaction::Impl Stream output */
+      inline std::ostream & operator<<( std::ostream & str, const RpmTransaction::Impl & obj )
+      {
+	return str << "RpmTransaction[" << librpmDb::stringPath( obj._root, obj._dbPath ) << " " << obj._elements.size() << " elements]";
+      }
+
+      ///////////////////////////////////////////////////////////////////
+      //
+      //	CLASS NAME : RpmTransaction
+      //
+      ///////////////////////////////////////////////////////////////////
+
+      RpmTransaction::RpmTransaction( const Pathname & root_r, const Pathname & dbPath_r, RpmInstFlags flags_r )
+      : _pimpl( new Impl( root_r, dbPath_r, flags_r ) )
+      {}
+
+      RpmTransaction::~RpmTransaction()
+      {}
+
+      bool RpmTransaction::addInstall( size_t idx_r, const Pathname & file_r, bool noupgrade_r )
+      { return _pimpl->addInstall( idx_r, file_r, noupgrade_r ); }
+
+      bool RpmTransaction::addErase( size_t idx_r, const std::string & label_r )
+      { return _pimpl->addErase( idx_r, label_r ); }
+
+      bool RpmTransaction::run( const StartFnc & start_r, const ProgressFnc & progress_r, const DoneFnc & done_r )
+      { return _pimpl->run( start_r, progress_r, done_r ); }
+
+      std::ostream & operator<<( std::ostream & str, const RpmTransaction & obj )
+      { return str << *obj._pimpl; }
+
+    } // namespace rpm
+    ///////////////////////////////////////////////////////////////////
+  } // namespace target
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
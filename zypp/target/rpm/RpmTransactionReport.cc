@@ -0,0 +1,207 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/target/rpm/RpmTransactionReport.cc
+ *
+*/
+#include <iostream>
+#include <sstream>
+
+#include <zypp/base/LogTools.h>
+#include <zypp/base/String.h>
+#include <zypp/base/Gettext.h>
+#include <zypp/HistoryLog.h>
+#include <zypp/ZYppCallbacks.h>
+
+#include <zypp/target/rpm/RpmTransactionReport_p.h>
+#include <zypp/target/rpm/RpmCallbacks.h>
+#include <zypp/target/rpm/RpmException.h>
+
+#undef ZYPP_BASE_LOGGER_LOGGROUP
+#define ZYPP_BASE_LOGGER_LOGGROUP "librpmDb"
+
+#define MAXRPMMESSAGELINES	10000	// like RpmDb
+
+using std::endl;
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace target
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace rpm
+    {
+      RpmTransactionReport::RpmTransactionReport( std::vector<RpmDb::TransactionElement> & elements_r )
+      : _elements( elements_r )
+      , _results( elements_r.size() )
+      {}
+
+      void RpmTransactionReport::done( size_t idx_r, bool failed_r, const std::string & output_r )
+      {
+	if ( idx_r >= _elements.size() )
+	  return;
+	RpmDb::TransactionElement & el( _elements[idx_r] );
+	Result & res( _results[idx_r] );
+	el.failed = failed_r;
+	bool install = ! el.file.empty();
+
+	callback::SendReport<RpmInstallReport> installReport;
+	callback::SendReport<RpmRemoveReport> removeReport;
+
+	// forward rpm output via report;
+	std::string line;
+	unsigned    lineno = 0;
+	callback::UserData cmdout( install ? InstallResolvableReport::contentRpmout : RemoveResolvableReport::contentRpmout );
+	// Key "solvable" injected by RpmInstallPackageReceiver
+	cmdout.set( "line",   std::cref(line) );
+	cmdout.set( "lineno", lineno );
+
+	std::istringstream in( output_r );
+	while ( std::getline( in, line ) )
+	{
+	  ++lineno;
+	  cmdout.set( "lineno", lineno );
+	  if ( install )
+	    installReport->report( cmdout );
+	  else
+	    removeReport->report( cmdout );
+
+	  if ( lineno >= MAXRPMMESSAGELINES ) {
+	    if ( line.find( " scriptlet failed, " ) == std::string::npos )	// always log %script errors
+	      continue;
+	  }
+	  res.rpmmsg += line+'\n';
+
+	  if ( install && str::startsWith( line, "warning:" ) )
+	    res.configwarnings.push_back(line);
+	}
+	if ( lineno >= MAXRPMMESSAGELINES )
+	  res.rpmmsg += "[truncated]\n";
+
+	if ( failed_r )
+	  return;	// problem and finish are sent once the transaction is closed
+
+	if ( ! res.rpmmsg.empty() )
+	{
+	  // report additional rpm output in finish
+	  // TranslatorExplanation Text is followed by a ':'  and the actual output.
+	  std::string info( str::form( "%s:\n%s\n", _("Additional rpm output"),  res.rpmmsg.c_str() ) );
+	  if ( install )
+	    installReport->finishInfo( info );
+	  else
+	    removeReport->finishInfo( info );
+	}
+	if ( install )
+	  installReport->finish();
+	else
+	  removeReport->finish();
+      }
+
+      ///////////////////////////////////////////////////////////////////
+      namespace
+      {
+	/** Ask the user about a failed element and finish its report (unless \a aborted_r). */
+	template <class TReport>
+	void finishFailed( const std::string & rpmmsg_r, bool & failed_r, bool & retry_r, bool & aborted_r )
+	{
+	  callback::SendReport<TReport> report;
+	  // TranslatorExplanation the colon is followed by an error message
+	  RpmSubprocessException excpt( _("RPM failed: ") + (rpmmsg_r.empty() ? std::string("rpm transaction failed") : rpmmsg_r) );
+
+	  if ( ! aborted_r )
+	  {
+	    typename TReport::Action user = report->problem( excpt );
+	    if ( user == TReport::IGNORE )
+	    {
+	      failed_r = false;
+	      return;
+	    }
+	    retry_r = ( user == TReport::RETRY );
+	    aborted_r = ( user == TReport::ABORT );
+	  }
+	  report->finish( excpt );
+	}
+      } // namespace
+      ///////////////////////////////////////////////////////////////////
+
+      bool RpmTransactionReport::send( const StartFnc & start_r, const ConfigWarningFnc & configWarning_r )
+      {
+	HistoryLog historylog;
+	bool aborted = false;
+	_retries.clear();
+
+	for ( size_t idx = 0; idx < _elements.size(); ++idx )
+	{
+	  RpmDb::TransactionElement & el( _elements[idx] );
+	  const Result & res( _results[idx] );
+	  bool install = ! el.file.empty();
+	  std::string what( install ? Pathname::basename(el.file) : el.name );
+	  const char * action = install ? "install" : "remove";
+
+	  if ( install && configWarning_r )
+	  {
+	    for ( const std::string & warning : res.configwarnings )
+	      configWarning_r( el.file, warning );
+	  }
+
+	  if ( ! el.failed )
+	  {
+	    if ( ! res.rpmmsg.empty() )
+	    {
+	      historylog.comment(
+		  str::form("%s %s ok", what.c_str(), action), true /*timestamp*/);
+	      std::ostringstream sstr;
+	      sstr << "Additional rpm output:" << endl << res.rpmmsg << endl;
+	      historylog.comment(sstr.str());
+	    }
+	    continue;
+	  }
+
+	  historylog.comment(
+	      str::form("%s %s failed", what.c_str(), action), true /*timestamp*/);
+	  std::ostringstream sstr;
+	  sstr << "rpm output:" << endl << res.rpmmsg << endl;
+	  historylog.comment(sstr.str());
+
+	  if ( start_r )
+	    start_r( idx );
+	  bool retry = false;
+	  if ( install )
+	    finishFailed<RpmInstallReport>( res.rpmmsg, el.failed, retry, aborted );
+	  else
+	    finishFailed<RpmRemoveReport>( res.rpmmsg, el.failed, retry, aborted );
+	  if ( retry )
+	    _retries.push_back( idx );
+	}
+
+	if ( aborted )
+	{
+	  WAR << "Aborted by the user: " << *this << endl;
+	  _retries.clear();
+	}
+	return ! aborted;
+      }
+
+      std::ostream & operator<<( std::ostream & str, const RpmTransactionReport & obj )
+      {
+	size_t failed = 0;
+	for ( const RpmDb::TransactionElement & el : obj._elements )
+	  if ( el.failed )
+	    ++failed;
+	return str << "RpmTransactionReport(" << obj._elements.size() << " elements, " << failed << " failed, "
+	           << obj._retries.size() << " to retry)";
+      }
+
+    } // namespace rpm
+    ///////////////////////////////////////////////////////////////////
+  } // namespace target
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
@@ -0,0 +1,108 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/target/rpm/RpmTransactionReport_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_TARGET_RPM_RPMTRANSACTIONREPORT_P_H
+#define ZYPP_TARGET_RPM_RPMTRANSACTIONREPORT_P_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <zypp/APIConfig.h>
+#include <zypp/base/NonCopyable.h>
+#include <zypp/base/Function.h>
+#include <zypp/Pathname.h>
+#include <zypp/target/rpm/RpmDb.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace target
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace rpm
+    {
+      ///////////////////////////////////////////////////////////////////
+      /// \class RpmTransactionReport
+      /// \brief Reports the elements of a \ref RpmDb::runTransaction.
+      ///
+      /// The transactions \c DoneFnc calls \ref done for each element as
+      /// rpm is done with it. The rpm output is forwarded and a successful
+      /// element is finished right away.
+      ///
+      /// While rpm runs the transaction it holds the database lock (and
+      /// maybe changed root). Asking the user about a failed element,
+      /// diffing config files and writing the history must wait until the
+      /// transaction is closed. This is done by \ref send.
+      ///////////////////////////////////////////////////////////////////
+      class ZYPP_LOCAL RpmTransactionReport : private base::NonCopyable
+      {
+	friend std::ostream & operator<<( std::ostream & str, const RpmTransactionReport & obj );
+
+      public:
+	/** Invoked before the failed element \a idx_r is reported (to connect its receiver). */
+	typedef RpmDb::TransactionElementCallback StartFnc;
+	/** Invoked for each config file \c warning: \a line_r of the installed package \a file_r. */
+	typedef function<void( const Pathname & file_r, const std::string & line_r )> ConfigWarningFnc;
+
+      public:
+	/** Ctor reporting the results of \a elements_r. */
+	explicit RpmTransactionReport( std::vector<RpmDb::TransactionElement> & elements_r );
+
+      public:
+	/** rpm is done with element \a idx_r: Forward rpms \a output_r and,
+	 * unless it \a failed_r, finish its report.
+	 */
+	void done( size_t idx_r, bool failed_r, const std::string & output_r );
+
+	/** Once the transaction is closed, write the history and process the
+	 * config file warnings of all elements. Report the failed elements as
+	 * problem via \ref RpmInstallReport or \ref RpmRemoveReport.
+	 *
+	 * Unless the user ignores it, a failed element stays \c failed and,
+	 * if the user wants to retry it, is added to \ref retries. Once the
+	 * user aborted, the remaining failed elements are finished without
+	 * asking.
+	 *
+	 * \returns \c false if the user aborted.
+	 */
+	bool send( const StartFnc & start_r, const ConfigWarningFnc & configWarning_r );
+
+	/** The failed elements the user wants to retry (if not aborted). */
+	const std::vector<size_t> & retries() const
+	{ return _retries; }
+
+      private:
+	/** What \ref done remembers for \ref send. */
+	struct Result
+	{
+	  std::string rpmmsg;				///< the (truncated) rpm output
+	  std::vector<std::string> configwarnings;	///< the config file \c warning: lines
+	};
+
+	std::vector<RpmDb::TransactionElement> & _elements;
+	std::vector<Result> _results;
+	std::vector<size_t> _retries;
+      };
+      ///////////////////////////////////////////////////////////////////
+
+      /** \relates RpmTransactionReport Stream output */
+      std::ostream & operator<<( std::ostream & str, const RpmTransactionReport & obj );
+
+    } // namespace rpm
+    ///////////////////////////////////////////////////////////////////
+  } // namespace target
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_TARGET_RPM_RPMTRANSACTIONREPORT_P_H
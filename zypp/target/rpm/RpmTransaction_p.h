@@ -0,0 +1,107 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+\---------------------------------------------------------------------*/
+/** \file	zypp/target/rpm/RpmTransaction_p.h
+ * This file contains private API, it will change without notice.
+ * You have been warned.
+*/
+#ifndef ZYPP_TARGET_RPM_RPMTRANSACTION_P_H
+#define ZYPP_TARGET_RPM_RPMTRANSACTION_P_H
+
+#include <iosfwd>
+#include <string>
+
+#include <zypp/APIConfig.h>
+#include <zypp/base/NonCopyable.h>
+#include <zypp/base/PtrTypes.h>
+#include <zypp/base/Function.h>
+#include <zypp/Pathname.h>
+#include <zypp/target/rpm/RpmFlags.h>
+
+///////////////////////////////////////////////////////////////////
+namespace zypp
+{
+  ///////////////////////////////////////////////////////////////////
+  namespace target
+  {
+    ///////////////////////////////////////////////////////////////////
+    namespace rpm
+    {
+      ///////////////////////////////////////////////////////////////////
+      /// \class RpmTransaction
+      /// \brief A librpm \c rpmts installing and removing packages in-process.
+      ///
+      /// Elements are added with an index chosen by the caller and are
+      /// processed in the order they were added (rpm is not asked to
+      /// reorder them, nor to check dependencies). The \ref RpmInstFlags
+      /// are translated into the corresponding transaction and problem
+      /// filter flags.
+      ///
+      /// \ref run reports each element by calling the \c StartFnc once rpm
+      /// begins to process it, and the \c DoneFnc once it is done. The
+      /// \c DoneFnc receives the output of the scriptlets run in the meantime.
+      /// Elements rpm did not get to (or which could not be added) are
+      /// reported as failed after the transaction.
+      ///
+      /// rpm changes root for the duration of the transaction, if the
+      /// target root is not \c /. This affects the whole process.
+      ///////////////////////////////////////////////////////////////////
+      class ZYPP_LOCAL RpmTransaction : private base::NonCopyable
+      {
+	friend std::ostream & operator<<( std::ostream & str, const RpmTransaction & obj );
+
+      public:
+	/** rpm begins to process the element \a idx_r. */
+	typedef function<void( size_t idx_r )> StartFnc;
+	/** Progress of the element \a idx_r. */
+	typedef function<void( size_t idx_r, unsigned percent_r )> ProgressFnc;
+	/** rpm is done with element \a idx_r; \a output_r is the scriptlet output or an error message. */
+	typedef function<void( size_t idx_r, bool failed_r, const std::string & output_r )> DoneFnc;
+
+      public:
+	/** Ctor opening the rpm database at \a dbPath_r below \a root_r for writing.
+	 * \throws RpmDbOpenException
+	 */
+	RpmTransaction( const Pathname & root_r, const Pathname & dbPath_r, RpmInstFlags flags_r );
+
+	~RpmTransaction();
+
+      public:
+	/** Add the package \a file_r to install as element \a idx_r.
+	 * Unless \a noupgrade_r, installed versions are replaced (like <tt>rpm -U</tt>).
+	 * \returns \c false if the package could not be added.
+	 */
+	bool addInstall( size_t idx_r, const Pathname & file_r, bool noupgrade_r );
+
+	/** Add all installed packages matching \a label_r (<tt>N-V-R.A</tt>) to remove as element \a idx_r.
+	 * \returns \c false if no such package is installed.
+	 */
+	bool addErase( size_t idx_r, const std::string & label_r );
+
+	/** Run the transaction. Each added element is reported exactly once to \a done_r.
+	 * \returns \c false if rpm reported problems preventing the transaction.
+	 */
+	bool run( const StartFnc & start_r, const ProgressFnc & progress_r, const DoneFnc & done_r );
+
+      public:
+	class Impl;			///< Implementation class.
+      private:
+	RW_pointer<Impl> _pimpl;	///< Pointer to implementation.
+      };
+      ///////////////////////////////////////////////////////////////////
+
+      /** \relates RpmTransaction Stream output */
+      std::ostream & operator<<( std::ostream & str, const RpmTransaction & obj );
+
+    } // namespace rpm
+    ///////////////////////////////////////////////////////////////////
+  } // namespace target
+  ///////////////////////////////////////////////////////////////////
+} // namespace zypp
+///////////////////////////////////////////////////////////////////
+#endif // ZYPP_TARGET_RPM_RPMTRANSACTION_P_H
@@ -0,0 +1,191 @@
+#include "eventdispatcher.h"
+#include "timer.h"
+#include "private/eventdispatcher_glib_p.h"
+#include "private/eventdispatcher_epoll_p.h"
+
+#include <zypp/base/Exception.h>
+#include <zypp/base/Logger.h>
+#include <zypp/base/String.h>
+
+namespace zyppng {
+
+//returns the thread local dispatcher, we only support one EventDispatcher per thread
+static EventDispatcher **threadLocalDispatcher ( EventDispatcher * set = nullptr )
+{
+  static __thread EventDispatcher *threadDispatch = nullptr;
+  if ( set ) {
+    if ( threadDispatch )
+      ZYPP_THROW( zypp::Exception( "EventDispatcher can only be created once per thread" ) );
+    threadDispatch = set;
+  }
+  return &threadDispatch;
+}
+
+//resolves Backend::Default using $ZYPP_EVENTDISPATCHER
+static EventDispatcher::Backend resolveBackend ( EventDispatcher::Backend backend )
+{
+  if ( backend != EventDispatcher::Backend::Default )
+    return backend;
+
+  const char *env = getenv( "ZYPP_EVENTDISPATCHER" );
+  if ( env && *env ) {
+    std::string val { zypp::str::toLower( env ) };
+    if ( val == "epoll" )
+      return EventDispatcher::Backend::Epoll;
+    if ( val != "glib" )
+      WAR << "Unknown ZYPP_EVENTDISPATCHER '" << env << "', using glib" << std::endl;
+  }
+  return EventDispatcher::Backend::Glib;
+}
+
+EventDispatcherPrivate::EventDispatcherPrivate()
+  : _myThreadId( std::this_thread::get_id() )
+{ }
+
+EventDispatcherPrivate::~EventDispatcherPrivate()
+{ }
+
+EventDispatcherPrivate *EventDispatcherPrivate::create( EventDispatcher::Backend backend, void *ctx )
+{
+  switch ( resolveBackend( backend ) ) {
+    case EventDispatcher::Backend::Epoll:
+      return new EpollEventDispatcherPrivate();
+    case EventDispatcher::Backend::Default:
+    case EventDispatcher::Backend::Glib:
+      break;
+  }
+  return new GlibEventDispatcherPrivate( reinterpret_cast<GMainContext*>(ctx) );
+}
+
+bool EventDispatcherPrivate::runIdleTasks()
+{
+  //run all user defined idle functions
+  //if they return true, they are executed again in the next idle run
+  decltype ( _idleFuncs ) rerunQueue;
+  while ( _idleFuncs.size() ) {
+    EventDispatcher::IdleFunction fun( std::move( _idleFuncs.front() ) );
+    _idleFuncs.pop();
+    if ( fun() )
+      rerunQueue.push( std::move(fun) );
+  }
+  if ( !rerunQueue.empty() )
+    _idleFuncs.swap( rerunQueue );
+
+
+  //keep this as the last thing to call after all user code was executed
+  if ( _unrefLater.size() )
+    _unrefLater.clear();
+
+  return _idleFuncs.size() || _unrefLater.size();
+}
+
+
+EventDispatcher::EventDispatcher(void *ctx)
+  : EventDispatcher( ctx, Backend::Default )
+{ }
+
+EventDispatcher::EventDispatcher( void *ctx, Backend backend )
+  : Base ( * EventDispatcherPrivate::create( backend, ctx ) )
+{
+  threadLocalDispatcher( this );
+}
+
+std::shared_ptr<EventDispatcher> EventDispatcher::createMain()
+{
+  return createMain( Backend::Default );
+}
+
+std::shared_ptr<EventDispatcher> EventDispatcher::createMain( Backend backend )
+{
+  backend = resolveBackend( backend );
+  void *ctx = ( backend == Backend::Glib ? g_main_context_default() : nullptr );
+  return std::shared_ptr<EventDispatcher>( new EventDispatcher( ctx, backend ) );
+}
+
+std::shared_ptr<EventDispatcher> EventDispatcher::createForThread()
+{
+  return createForThread( Backend::Default );
+}
+
+std::shared_ptr<EventDispatcher> EventDispatcher::createForThread( Backend backend )
+{
+  return std::shared_ptr<EventDispatcher>( new EventDispatcher( nullptr, backend ) );
+}
+
+EventDispatcher::~EventDispatcher()
+{
+  *threadLocalDispatcher() = nullptr;
+}
+
+void EventDispatcher::updateEventSource( AbstractEventSource *notifier, int fd, int mode )
+{
+  if ( notifier->eventDispatcher().lock().get() != this )
+    ZYPP_THROW( zypp::Exception("Invalid event dispatcher used to update event source") );
+  d_func()->updateEventSource( notifier, fd, mode );
+}
+
+void EventDispatcher::removeEventSource( AbstractEventSource *notifier, int fd )
+{
+  if ( notifier->eventDispatcher().lock().get() != this )
+    ZYPP_THROW( zypp::Exception("Invalid event dispatcher used to remove event source") );
+  d_func()->removeEventSource( notifier, fd );
+}
+
+void EventDispatcher::registerTimer( Timer *timer )
+{
+  d_func()->registerTimer( timer );
+}
+
+void EventDispatcher::removeTimer( Timer *timer )
+{
+  d_func()->removeTimer( timer );
+}
+
+bool EventDispatcher::run_once()
+{
+  return d_func()->runOnce();
+}
+
+void EventDispatcher::run()
+{
+  d_func()->run();
+}
+
+void EventDispatcher::quit()
+{
+  d_func()->quit();
+}
+
+void EventDispatcher::invokeOnIdleImpl(EventDispatcher::IdleFunction &&callback)
+{
+  auto d = instance()->d_func();
+  d->_idleFuncs.push( std::move(callback) );
+  d->enableIdleSource();
+}
+
+void EventDispatcher::unrefLaterImpl(std::shared_ptr<void> &&ptr )
+{
+  Z_D();
+  d->_unrefLater.push_back( std::forward< std::shared_ptr<void> >(ptr) );
+  d->enableIdleSource();
+}
+
+ulong EventDispatcher::runningTimers() const
+{
+  return d_func()->runningTimers();
+}
+
+EventDispatcher::Backend EventDispatcher::backend() const
+{
+  return d_func()->backend();
+}
+
+std::shared_ptr<EventDispatcher> EventDispatcher::instance()
+{
+  auto ev = *threadLocalDispatcher();
+  if ( ev )
+    return ev->shared_this<EventDispatcher>();
+  return std::shared_ptr<EventDispatcher>();
+}
+
+}
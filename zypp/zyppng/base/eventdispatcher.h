@@ -45,6 +45,10 @@ class EventDispatcherPrivate;
  * uses the glib eventloop, just like Qt and GTK, so integrating libzypp here is just a matter of passing the default main context
  * to the constructor of \a EventDispatcher.
  *
+ * Applications not integrating with another event loop may instead use the \ref Backend::Epoll backend, which
+ * waits on epoll and a timerfd directly and avoids the per source overhead of glib. The backend used by default
+ * can be chosen at runtime by setting \c ZYPP_EVENTDISPATCHER to \c glib or \c epoll.
+ *
  */
 class LIBZYPP_NG_EXPORT EventDispatcher : public Base
 {
@@ -58,6 +62,15 @@ public:
   using WeakPtr = std::shared_ptr<EventDispatcher>;
   using IdleFunction = std::function<bool ()>;
 
+  /*!
+   * The implementations of the event loop.
+   */
+  enum class Backend {
+    Default,  //!< Use \c $ZYPP_EVENTDISPATCHER if set, \ref Backend::Glib otherwise
+    Glib,     //!< Attach to a glib GMainContext
+    Epoll     //!< Use epoll and timerfd directly, does not integrate with other event loops
+  };
+
   /*!
    * Creates a new EventDispatcher, use this function to create a Dispatcher
    * running on the default thread
@@ -67,6 +80,11 @@ public:
    */
   static std::shared_ptr<EventDispatcher> createMain ( );
 
+  /*!
+   * \overload Creates the main EventDispatcher using the given \a backend
+   */
+  static std::shared_ptr<EventDispatcher> createMain ( Backend backend );
+
   /*!
    * Creates a new EventDispatcher, use this function to create a Dispatcher
    * running on a threads aside the main thread
@@ -77,6 +95,11 @@ public:
    */
   static std::shared_ptr<EventDispatcher> createForThread ( );
 
+  /*!
+   * \overload Creates a EventDispatcher for the current thread using the given \a backend
+   */
+  static std::shared_ptr<EventDispatcher> createForThread ( Backend backend );
+
   virtual ~EventDispatcher();
 
   /*!
@@ -126,6 +149,11 @@ public:
    */
   ulong runningTimers() const;
 
+  /*!
+   * Returns the backend this EventDispatcher was created with, never \ref Backend::Default
+   */
+  Backend backend() const;
+
   /*!
    * Returns the EventDispatcher instance for the current thread.
    */
@@ -139,6 +167,12 @@ protected:
    */
   EventDispatcher( void *ctx = nullptr );
 
+  /*!
+   * Create a new instance of the EventDispatcher using \a backend, \a ctx is only
+   * used by the glib backend
+   */
+  EventDispatcher( void *ctx, Backend backend );
+
   /*!
    * \see unrefLater
    */
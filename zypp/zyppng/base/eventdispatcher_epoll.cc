@@ -0,0 +1,351 @@
+#include "eventdispatcher.h"
+#include "timer.h"
+#include "private/eventdispatcher_epoll_p.h"
+
+#include <zypp/base/Exception.h>
+#include <zypp/base/Logger.h>
+#include <zypp/base/String.h>
+
+#include <algorithm>
+#include <array>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace zyppng {
+
+static uint32_t inline epollEvents ( int mode ) {
+  uint32_t events = 0;
+  if ( mode & AbstractEventSource::Read )
+    events |= EPOLLIN;
+  if ( mode & AbstractEventSource::Write )
+    events |= EPOLLOUT;
+  if ( mode & AbstractEventSource::Exception )
+    events |= EPOLLPRI;
+  return events;
+}
+
+//translates the epoll events into the AbstractEventSource::EventTypes requested by \a mode,
+//same as the glib backend does. epoll reports EPOLLHUP and EPOLLERR whether they were
+//requested or not, they are always delivered: a hangup is a Read if it was requested
+//(the reader sees EOF), otherwise an Error. Dropping them would wake up the loop forever.
+static int inline sourceEvents ( uint32_t revents, int mode ) {
+  int ev = 0;
+  if ( ( mode & AbstractEventSource::Read ) && ( revents & ( EPOLLIN | EPOLLHUP ) ) )
+    ev |= AbstractEventSource::Read;
+  if ( ( mode & AbstractEventSource::Write ) && ( revents & EPOLLOUT ) )
+    ev |= AbstractEventSource::Write;
+  if ( ( mode & AbstractEventSource::Exception ) && ( revents & EPOLLPRI ) )
+    ev |= AbstractEventSource::Exception;
+  if ( ( revents & EPOLLERR ) || ( !( mode & AbstractEventSource::Read ) && ( revents & EPOLLHUP ) ) )
+    ev |= AbstractEventSource::Error;
+  return ev;
+}
+
+static void inline drainFd ( int fd ) {
+  uint64_t buf;
+  while ( ::read( fd, &buf, sizeof(buf) ) == sizeof(buf) )
+    ;
+}
+
+EpollEventDispatcherPrivate::EpollEventDispatcherPrivate()
+{
+  _epollFd = ::epoll_create1( EPOLL_CLOEXEC );
+  if ( _epollFd < 0 )
+    ZYPP_THROW( zypp::Exception( "Unable to create epoll instance: " + zypp::str::strerror( errno ) ) );
+
+  _timerFd = ::timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+  _wakeFd  = ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+  if ( _timerFd < 0 || _wakeFd < 0 ) {
+    int err = errno;
+    for ( int fd : { _wakeFd, _timerFd, _epollFd } ) {
+      if ( fd >= 0 )
+        ::close( fd );
+    }
+    ZYPP_THROW( zypp::Exception( "Unable to create event loop descriptors: " + zypp::str::strerror( err ) ) );
+  }
+
+  for ( int fd : { _timerFd, _wakeFd } ) {
+    epoll_event ev {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    ::epoll_ctl( _epollFd, EPOLL_CTL_ADD, fd, &ev );
+  }
+}
+
+EpollEventDispatcherPrivate::~EpollEventDispatcherPrivate()
+{
+  for ( int *fd : { &_wakeFd, &_timerFd, &_epollFd } ) {
+    if ( *fd >= 0 ) {
+      ::close( *fd );
+      *fd = -1;
+    }
+  }
+}
+
+EventDispatcher::Backend EpollEventDispatcherPrivate::backend() const
+{
+  return EventDispatcher::Backend::Epoll;
+}
+
+void EpollEventDispatcherPrivate::enableIdleSource()
+{
+  _idlePending = true;
+}
+
+void EpollEventDispatcherPrivate::updateEventSource( AbstractEventSource *notifier, int fd, int mode )
+{
+  FdWatches &entry = _fds[fd];
+  auto it = std::find_if( entry.watches.begin(), entry.watches.end(), [ notifier ]( const Watch &w ){ return w.source == notifier; } );
+  if ( it != entry.watches.end() ) {
+    it->mode = mode;
+  } else {
+    entry.watches.push_back( Watch{ notifier, mode } );
+    _sourceFds[notifier].push_back( fd );
+  }
+  syncFd( fd );
+}
+
+void EpollEventDispatcherPrivate::removeEventSource( AbstractEventSource *notifier, int fd )
+{
+  if ( fd != -1 ) {
+    removeWatch( notifier, fd );
+    return;
+  }
+
+  auto it = _sourceFds.find( notifier );
+  if ( it == _sourceFds.end() )
+    return;
+
+  std::vector<int> fds;
+  fds.swap( it->second );
+  for ( int watchedFd : fds )
+    removeWatch( notifier, watchedFd );
+}
+
+void EpollEventDispatcherPrivate::removeWatch( AbstractEventSource *notifier, int fd )
+{
+  auto srcIt = _sourceFds.find( notifier );
+  if ( srcIt != _sourceFds.end() ) {
+    auto &fds = srcIt->second;
+    fds.erase( std::remove( fds.begin(), fds.end(), fd ), fds.end() );
+    if ( fds.empty() )
+      _sourceFds.erase( srcIt );
+  }
+
+  auto fdIt = _fds.find( fd );
+  if ( fdIt == _fds.end() )
+    return;
+
+  auto &watches = fdIt->second.watches;
+  watches.erase( std::remove_if( watches.begin(), watches.end(), [ notifier ]( const Watch &w ){ return w.source == notifier; } ), watches.end() );
+  syncFd( fd );
+}
+
+void EpollEventDispatcherPrivate::syncFd( int fd )
+{
+  auto it = _fds.find( fd );
+  if ( it == _fds.end() )
+    return;
+
+  FdWatches &entry = it->second;
+  if ( entry.watches.empty() ) {
+    //the fd might be closed already, which removed it from the epoll set anyway
+    if ( entry.registered )
+      ::epoll_ctl( _epollFd, EPOLL_CTL_DEL, fd, nullptr );
+    _fds.erase( it );
+    return;
+  }
+
+  uint32_t events = 0;
+  for ( const Watch &w : entry.watches )
+    events |= epollEvents( w.mode );
+
+  if ( entry.registered && events == entry.events )
+    return;
+
+  if ( events == 0 ) {
+    //epoll would still report hangups and errors, nobody asked for any events though
+    if ( entry.registered )
+      ::epoll_ctl( _epollFd, EPOLL_CTL_DEL, fd, nullptr );
+    entry.registered = false;
+    entry.events = 0;
+    return;
+  }
+
+  epoll_event ev {};
+  ev.events = events;
+  ev.data.fd = fd;
+
+  //a registered fd that was closed and reused is gone from the epoll set, a fd we did not
+  //know might still be in it if it was dup'ed before closing, retry with the other operation
+  int op = entry.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  int res = ::epoll_ctl( _epollFd, op, fd, &ev );
+  if ( res < 0 && errno == ENOENT && op == EPOLL_CTL_MOD )
+    res = ::epoll_ctl( _epollFd, EPOLL_CTL_ADD, fd, &ev );
+  else if ( res < 0 && errno == EEXIST && op == EPOLL_CTL_ADD )
+    res = ::epoll_ctl( _epollFd, EPOLL_CTL_MOD, fd, &ev );
+
+  if ( res < 0 ) {
+    ERR << "Unable to watch fd " << fd << ": " << zypp::str::strerror( errno ) << std::endl;
+    entry.registered = false;
+    entry.events = 0;
+    return;
+  }
+  entry.registered = true;
+  entry.events = events;
+}
+
+void EpollEventDispatcherPrivate::registerTimer( Timer *timer )
+{
+  //make sure timer is not double registered
+  if ( std::find( _runningTimers.begin(), _runningTimers.end(), timer ) != _runningTimers.end() )
+    return;
+  _runningTimers.push_back( timer );
+}
+
+void EpollEventDispatcherPrivate::removeTimer( Timer *timer )
+{
+  auto it = std::find( _runningTimers.begin(), _runningTimers.end(), timer );
+  if ( it != _runningTimers.end() )
+    _runningTimers.erase( it );
+}
+
+ulong EpollEventDispatcherPrivate::runningTimers() const
+{
+  return _runningTimers.size();
+}
+
+bool EpollEventDispatcherPrivate::armTimers()
+{
+  uint64_t next = 0;
+  for ( const Timer *t : _runningTimers ) {
+    uint64_t exp = t->expires();
+    if ( next == 0 || exp < next )
+      next = exp;
+  }
+
+  if ( next && next <= Timer::now() )
+    return true;
+
+  if ( next != _armedExpiry ) {
+    //Timer::now() is CLOCK_MONOTONIC in ms
+    itimerspec spec {};
+    spec.it_value.tv_sec  = next / 1000;
+    spec.it_value.tv_nsec = ( next % 1000 ) * 1000000;
+    if ( ::timerfd_settime( _timerFd, TFD_TIMER_ABSTIME, &spec, nullptr ) < 0 ) {
+      ERR << "Unable to arm the timerfd: " << zypp::str::strerror( errno ) << std::endl;
+      return true;
+    }
+    _armedExpiry = next;
+  }
+  return false;
+}
+
+bool EpollEventDispatcherPrivate::dispatchTimers()
+{
+  if ( _runningTimers.empty() )
+    return false;
+
+  //timers might be started, stopped or even deleted by the callbacks of the other
+  //timers, so we remember the due ones and check they are still running before
+  //expiring them
+  uint64_t now = Timer::now();
+  std::vector<Timer *> due;
+  for ( Timer *t : _runningTimers ) {
+    if ( t->expires() <= now )
+      due.push_back( t );
+  }
+
+  for ( Timer *t : due ) {
+    if ( std::find( _runningTimers.begin(), _runningTimers.end(), t ) == _runningTimers.end() )
+      continue;
+    //this will emit the expired signal and reset the timer
+    //or stop it in case its a single shot timer
+    t->expire();
+  }
+  return !due.empty();
+}
+
+bool EpollEventDispatcherPrivate::dispatchFd( int fd, uint32_t revents )
+{
+  //the watches of the fd might change in the callbacks, look them up again every time
+  bool dispatched = false;
+  for ( size_t i = 0; ; ++i ) {
+    auto it = _fds.find( fd );
+    if ( it == _fds.end() || i >= it->second.watches.size() )
+      break;
+
+    Watch w = it->second.watches[i];
+    int ev = sourceEvents( revents, w.mode );
+    if ( ev ) {
+      w.source->onFdReady( fd, ev );
+      dispatched = true;
+    }
+  }
+  return dispatched;
+}
+
+bool EpollEventDispatcherPrivate::iterate( bool mayBlock )
+{
+  int timeout = ( mayBlock && !_idlePending ) ? -1 : 0;
+  if ( armTimers() )
+    timeout = 0;
+
+  std::array<epoll_event, 256> events;
+  int ready = ::epoll_wait( _epollFd, events.data(), events.size(), timeout );
+  if ( ready < 0 ) {
+    if ( errno != EINTR )
+      ERR << "epoll_wait failed: " << zypp::str::strerror( errno ) << std::endl;
+    ready = 0;
+  }
+
+  bool dispatched = false;
+  for ( int i = 0; i < ready; ++i ) {
+    int fd = events[i].data.fd;
+    if ( fd == _timerFd ) {
+      drainFd( _timerFd );
+      _armedExpiry = 0;
+    } else if ( fd == _wakeFd ) {
+      drainFd( _wakeFd );
+    } else {
+      //a fd closed and reused by a callback may see a stale event here, which is
+      //harmless as with poll() the receiver has to expect spurious wakeups anyway
+      dispatched = dispatchFd( fd, events[i].events ) || dispatched;
+    }
+  }
+
+  dispatched = dispatchTimers() || dispatched;
+
+  if ( !dispatched && _idlePending ) {
+    _idlePending = runIdleTasks();
+    dispatched = true;
+  }
+  return dispatched;
+}
+
+bool EpollEventDispatcherPrivate::runOnce()
+{
+  return iterate( false );
+}
+
+void EpollEventDispatcherPrivate::run()
+{
+  _quit = false;
+  while ( !_quit )
+    iterate( true );
+}
+
+void EpollEventDispatcherPrivate::quit()
+{
+  _quit = true;
+  if ( std::this_thread::get_id() != _myThreadId ) {
+    uint64_t one = 1;
+    if ( ::write( _wakeFd, &one, sizeof(one) ) < 0 )
+      WAR << "Unable to wake up the event loop: " << zypp::str::strerror( errno ) << std::endl;
+  }
+}
+
+}
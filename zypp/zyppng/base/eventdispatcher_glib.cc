@@ -18,18 +18,6 @@ static int inline excpMask () {
   return ( G_IO_PRI );
 }
 
-//returns the thread local dispatcher, we only support one EventDispatcher per thread
-static EventDispatcher **threadLocalDispatcher ( EventDispatcher * set = nullptr )
-{
-  static __thread EventDispatcher *threadDispatch = nullptr;
-  if ( set ) {
-    if ( threadDispatch )
-      ZYPP_THROW( zypp::Exception( "EventDispatcher can only be created once per thread" ) );
-    threadDispatch = set;
-  }
-  return &threadDispatch;
-}
-
 static GSourceFuncs abstractEventSourceFuncs = {
   GAbstractEventSource::prepare,
   GAbstractEventSource::check,
@@ -39,7 +27,7 @@ static GSourceFuncs abstractEventSourceFuncs = {
   nullptr
 };
 
-GAbstractEventSource *GAbstractEventSource::create(EventDispatcherPrivate *ev ) {
+GAbstractEventSource *GAbstractEventSource::create(GlibEventDispatcherPrivate *ev ) {
   GAbstractEventSource *src = nullptr;
   src = reinterpret_cast<GAbstractEventSource *>(g_source_new(&abstractEventSourceFuncs, sizeof(GAbstractEventSource)));
   (void) new (&src->pollfds) std::vector<GUnixPollFD>();
@@ -215,7 +203,7 @@ void GLibTimerSource::destruct(GLibTimerSource *src)
  */
 static gboolean  eventLoopIdleFunc ( gpointer user_data )
 {
-  auto dPtr = reinterpret_cast<EventDispatcherPrivate *>( user_data );
+  auto dPtr = reinterpret_cast<GlibEventDispatcherPrivate *>( user_data );
   if ( dPtr ) {
     if( dPtr->runIdleTasks() ) {
       return G_SOURCE_CONTINUE;
@@ -225,10 +213,8 @@ static gboolean  eventLoopIdleFunc ( gpointer user_data )
 }
 
 
-EventDispatcherPrivate::EventDispatcherPrivate ( GMainContext *ctx )
+GlibEventDispatcherPrivate::GlibEventDispatcherPrivate ( GMainContext *ctx )
 {
-  _myThreadId = std::this_thread::get_id();
-
   //if we get a context specified ( usually when created for main thread ) we use it
   //otherwise we create our own
   if ( ctx ) {
@@ -250,7 +236,7 @@ EventDispatcherPrivate::EventDispatcherPrivate ( GMainContext *ctx )
   g_source_set_callback ( _idleSource, eventLoopIdleFunc, this, nullptr );
 }
 
-EventDispatcherPrivate::~EventDispatcherPrivate()
+GlibEventDispatcherPrivate::~GlibEventDispatcherPrivate()
 {
   std::for_each ( _runningTimers.begin(), _runningTimers.end(), []( GLibTimerSource *src ){
     GLibTimerSource::destruct( src );
@@ -268,72 +254,30 @@ EventDispatcherPrivate::~EventDispatcherPrivate()
   g_main_loop_unref( _loop );
 }
 
-bool EventDispatcherPrivate::runIdleTasks()
+EventDispatcher::Backend GlibEventDispatcherPrivate::backend() const
 {
-  //run all user defined idle functions
-  //if they return true, they are executed again in the next idle run
-  decltype ( _idleFuncs ) rerunQueue;
-  while ( _idleFuncs.size() ) {
-    EventDispatcher::IdleFunction fun( std::move( _idleFuncs.front() ) );
-    _idleFuncs.pop();
-    if ( fun() )
-      rerunQueue.push( std::move(fun) );
-  }
-  if ( !rerunQueue.empty() )
-    _idleFuncs.swap( rerunQueue );
-
-
-  //keep this as the last thing to call after all user code was executed
-  if ( _unrefLater.size() )
-    _unrefLater.clear();
-
-  return _idleFuncs.size() || _unrefLater.size();
+  return EventDispatcher::Backend::Glib;
 }
 
-void EventDispatcherPrivate::enableIdleSource()
+void GlibEventDispatcherPrivate::enableIdleSource()
 {
   if ( !_idleSource->context )
     g_source_attach ( _idleSource, _ctx );
 }
 
 
-EventDispatcher::EventDispatcher(void *ctx)
-  : Base ( * new EventDispatcherPrivate( reinterpret_cast<GMainContext*>(ctx) ) )
+void GlibEventDispatcherPrivate::updateEventSource( AbstractEventSource *notifier, int fd, int mode )
 {
-  threadLocalDispatcher( this );
-}
-
-std::shared_ptr<EventDispatcher> EventDispatcher::createMain()
-{
-  return std::shared_ptr<EventDispatcher>( new EventDispatcher(g_main_context_default()) );
-}
-
-std::shared_ptr<EventDispatcher> EventDispatcher::createForThread()
-{
-  return std::shared_ptr<EventDispatcher>( new EventDispatcher() );
-}
-
-EventDispatcher::~EventDispatcher()
-{
-  *threadLocalDispatcher() = nullptr;
-}
-
-void EventDispatcher::updateEventSource( AbstractEventSource *notifier, int fd, int mode )
-{
-  Z_D();
-  if ( notifier->eventDispatcher().lock().get() != this )
-    ZYPP_THROW( zypp::Exception("Invalid event dispatcher used to update event source") );
-
   GAbstractEventSource *evSrc = nullptr;
-  auto &evSrcList = d->_eventSources;
+  auto &evSrcList = _eventSources;
   auto itToEvSrc = std::find_if( evSrcList.begin(), evSrcList.end(), [ notifier ]( const auto elem ){ return elem->eventSource == notifier; } );
   if ( itToEvSrc == evSrcList.end() ) {
 
-    evSrc = GAbstractEventSource::create( d );
+    evSrc = GAbstractEventSource::create( this );
     evSrc->eventSource = notifier;
     evSrcList.push_back( evSrc );
 
-    g_source_attach( &evSrc->source, d->_ctx );
+    g_source_attach( &evSrc->source, _ctx );
 
   } else
     evSrc = (*itToEvSrc);
@@ -368,14 +312,9 @@ void EventDispatcher::updateEventSource( AbstractEventSource *notifier, int fd,
   }
 }
 
-void EventDispatcher::removeEventSource( AbstractEventSource *notifier, int fd )
+void GlibEventDispatcherPrivate::removeEventSource( AbstractEventSource *notifier, int fd )
 {
-  Z_D();
-
-  if ( notifier->eventDispatcher().lock().get() != this )
-    ZYPP_THROW( zypp::Exception("Invalid event dispatcher used to remove event source") );
-
-  auto &evList = d->_eventSources;
+  auto &evList = _eventSources;
   auto it = std::find_if( evList.begin(), evList.end(), [ notifier ]( const auto elem ){ return elem->eventSource == notifier; } );
 
   if ( it == evList.end() )
@@ -405,76 +344,52 @@ void EventDispatcher::removeEventSource( AbstractEventSource *notifier, int fd )
   }
 }
 
-void EventDispatcher::registerTimer( Timer *timer )
+void GlibEventDispatcherPrivate::registerTimer( Timer *timer )
 {
-  Z_D();
   //make sure timer is not double registered
-  for ( const GLibTimerSource *t : d->_runningTimers ) {
+  for ( const GLibTimerSource *t : _runningTimers ) {
     if ( t->_t == timer )
       return;
   }
 
   GLibTimerSource *newSrc = GLibTimerSource::create();
   newSrc->_t = timer;
-  d->_runningTimers.push_back( newSrc );
+  _runningTimers.push_back( newSrc );
 
-  g_source_attach( &newSrc->source, d->_ctx );
+  g_source_attach( &newSrc->source, _ctx );
 }
 
-void EventDispatcher::removeTimer( Timer *timer )
+void GlibEventDispatcherPrivate::removeTimer( Timer *timer )
 {
-  Z_D();
-  auto it = std::find_if( d->_runningTimers.begin(), d->_runningTimers.end(), [ timer ]( const GLibTimerSource *src ){
+  auto it = std::find_if( _runningTimers.begin(), _runningTimers.end(), [ timer ]( const GLibTimerSource *src ){
     return src->_t == timer;
   });
 
-  if ( it != d->_runningTimers.end() ) {
+  if ( it != _runningTimers.end() ) {
     GLibTimerSource *src = *it;
-    d->_runningTimers.erase( it );
+    _runningTimers.erase( it );
     GLibTimerSource::destruct( src );
   }
 }
 
-bool EventDispatcher::run_once()
-{
-  return g_main_context_iteration( d_func()->_ctx, false );
-}
-
-void EventDispatcher::run()
-{
-  g_main_loop_run( d_func()->_loop );
-}
-
-void EventDispatcher::quit()
-{
-  g_main_loop_quit( d_func()->_loop );
-}
-
-void EventDispatcher::invokeOnIdleImpl(EventDispatcher::IdleFunction &&callback)
+ulong GlibEventDispatcherPrivate::runningTimers() const
 {
-  auto d = instance()->d_func();
-  d->_idleFuncs.push( std::move(callback) );
-  d->enableIdleSource();
+  return _runningTimers.size();
 }
 
-void EventDispatcher::unrefLaterImpl(std::shared_ptr<void> &&ptr )
+bool GlibEventDispatcherPrivate::runOnce()
 {
-  Z_D();
-  d->_unrefLater.push_back( std::forward< std::shared_ptr<void> >(ptr) );
-  d->enableIdleSource();
+  return g_main_context_iteration( _ctx, false );
 }
 
-ulong EventDispatcher::runningTimers() const
+void GlibEventDispatcherPrivate::run()
 {
-  return d_func()->_runningTimers.size();
+  g_main_loop_run( _loop );
 }
 
-std::shared_ptr<EventDispatcher> EventDispatcher::instance()
+void GlibEventDispatcherPrivate::quit()
 {
-  auto ev = *threadLocalDispatcher();
-  if ( ev )
-    return ev->shared_this<EventDispatcher>();
-  return std::shared_ptr<EventDispatcher>();
+  g_main_loop_quit( _loop );
 }
 
 }
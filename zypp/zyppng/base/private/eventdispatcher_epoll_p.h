@@ -0,0 +1,100 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+----------------------------------------------------------------------/
+*
+* This file contains private API, this might break at any time between releases.
+* You have been warned!
+*
+*/
+#ifndef ZYPP_BASE_EVENTDISPATCHER_EPOLL_P_DEFINED
+#define ZYPP_BASE_EVENTDISPATCHER_EPOLL_P_DEFINED
+
+#include "eventdispatcher_p.h"
+#include <atomic>
+#include <unordered_map>
+
+namespace zyppng {
+
+/*!
+ * \internal EventDispatcher backend waiting on a epoll instance directly.
+ *
+ * All file descriptors are registered level triggered in one epoll instance,
+ * so a ready fd is reported just like by poll(). Timers share one timerfd which
+ * is armed for the earliest expiring \ref Timer before waiting. A eventfd is
+ * used to wake up the loop if \ref quit is called from another thread.
+ *
+ * Idle tasks run in a iteration that did not dispatch any other event, like
+ * the glib idle source does.
+ */
+class EpollEventDispatcherPrivate : public EventDispatcherPrivate
+{
+public:
+  EpollEventDispatcherPrivate();
+  virtual ~EpollEventDispatcherPrivate();
+
+  EventDispatcher::Backend backend () const override;
+  void enableIdleSource () override;
+
+  void updateEventSource ( AbstractEventSource *notifier, int fd, int mode ) override;
+  void removeEventSource ( AbstractEventSource *notifier, int fd ) override;
+  void registerTimer ( Timer *timer ) override;
+  void removeTimer ( Timer *timer ) override;
+  ulong runningTimers () const override;
+
+  bool runOnce () override;
+  void run () override;
+  void quit () override;
+
+  /*!
+   * Waits for events if \a mayBlock and dispatches them.
+   * Returns \c true if any event or idle task was dispatched.
+   */
+  bool iterate ( bool mayBlock );
+
+  /*!
+   * Arms the timerfd for the earliest running timer, returns \c true
+   * if a timer is due already.
+   */
+  bool armTimers ();
+  bool dispatchTimers ();
+  bool dispatchFd ( int fd, uint32_t revents );
+
+  /*!
+   * Registers the combined events of all watches of \a fd
+   * in the epoll instance.
+   */
+  void syncFd ( int fd );
+  void removeWatch ( AbstractEventSource *notifier, int fd );
+
+  struct Watch {
+    AbstractEventSource *source;
+    int mode;
+  };
+
+  struct FdWatches {
+    uint32_t events = 0;       //< events currently registered with epoll
+    bool registered = false;
+    std::vector<Watch> watches;
+  };
+
+  int _epollFd = -1;
+  int _timerFd = -1;
+  int _wakeFd  = -1;
+
+  uint64_t _armedExpiry = 0;  //< absolute ms the timerfd is armed for, 0 if disarmed
+  bool _idlePending = false;
+  std::atomic<bool> _quit { false };
+
+  std::unordered_map<int, FdWatches> _fds;
+  std::unordered_map<AbstractEventSource *, std::vector<int>> _sourceFds;
+  std::vector<Timer *> _runningTimers;
+};
+
+}
+
+#endif
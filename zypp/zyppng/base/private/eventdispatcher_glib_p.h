@@ -1,15 +1,13 @@
 #ifndef ZYPP_BASE_EVENTDISPATCHER_GLIB_P_DEFINED
 #define ZYPP_BASE_EVENTDISPATCHER_GLIB_P_DEFINED
 
-#include "base_p.h"
-#include <zypp/zyppng/base/eventdispatcher.h>
+#include "eventdispatcher_p.h"
 #include <glib.h>
-#include <thread>
-#include <unordered_map>
-#include <queue>
 
 namespace zyppng {
 
+class GlibEventDispatcherPrivate;
+
 struct GUnixPollFD
 {
   GIOCondition reqEvents;
@@ -27,14 +25,14 @@ struct GAbstractEventSource
 {
   GSource source;
   AbstractEventSource *eventSource;
-  EventDispatcherPrivate *_ev;
+  GlibEventDispatcherPrivate *_ev;
   std::vector<GUnixPollFD> pollfds;
 
   static gboolean prepare(GSource *, gint *timeout);
   static gboolean check(GSource *source);
   static gboolean dispatch(GSource *source, GSourceFunc, gpointer);
 
-  static GAbstractEventSource *create (EventDispatcherPrivate *ev);
+  static GAbstractEventSource *create (GlibEventDispatcherPrivate *ev);
   static void destruct ( GAbstractEventSource *src );
 };
 
@@ -57,17 +55,28 @@ struct GLibTimerSource
   static void destruct ( GLibTimerSource *src );
 };
 
-class EventDispatcherPrivate : public BasePrivate
+/*!
+ * \internal EventDispatcher backend attaching to a glib GMainContext
+ */
+class GlibEventDispatcherPrivate : public EventDispatcherPrivate
 {
 public:
-  ZYPP_DECLARE_PUBLIC(EventDispatcher)
-  EventDispatcherPrivate( GMainContext *ctx );
-  virtual ~EventDispatcherPrivate();
+  GlibEventDispatcherPrivate( GMainContext *ctx );
+  virtual ~GlibEventDispatcherPrivate();
 
-  bool runIdleTasks();
-  void enableIdleSource ();
+  EventDispatcher::Backend backend () const override;
+  void enableIdleSource () override;
+
+  void updateEventSource ( AbstractEventSource *notifier, int fd, int mode ) override;
+  void removeEventSource ( AbstractEventSource *notifier, int fd ) override;
+  void registerTimer ( Timer *timer ) override;
+  void removeTimer ( Timer *timer ) override;
+  ulong runningTimers () const override;
+
+  bool runOnce () override;
+  void run () override;
+  void quit () override;
 
-  std::thread::id _myThreadId;
   GMainLoop *_loop = nullptr;
   GMainContext *_ctx = nullptr;
 
@@ -75,10 +84,7 @@ public:
 
   std::vector<GLibTimerSource *> _runningTimers;
   std::vector<GAbstractEventSource *> _eventSources;
-  std::vector< std::shared_ptr<void> > _unrefLater;
-  std::queue< EventDispatcher::IdleFunction > _idleFuncs;
 };
-
 }
 
 
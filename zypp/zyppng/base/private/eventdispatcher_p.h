@@ -0,0 +1,70 @@
+/*---------------------------------------------------------------------\
+|                          ____ _   __ __ ___                          |
+|                         |__  / \ / / . \ . \                         |
+|                           / / \ V /|  _/  _/                         |
+|                          / /__ | | | | | |                           |
+|                         /_____||_| |_| |_|                           |
+|                                                                      |
+----------------------------------------------------------------------/
+*
+* This file contains private API, this might break at any time between releases.
+* You have been warned!
+*
+*/
+#ifndef ZYPP_BASE_EVENTDISPATCHER_P_DEFINED
+#define ZYPP_BASE_EVENTDISPATCHER_P_DEFINED
+
+#include "base_p.h"
+#include <zypp/zyppng/base/eventdispatcher.h>
+#include <thread>
+#include <vector>
+#include <queue>
+
+namespace zyppng {
+
+/*!
+ * \internal Backend independent part of the \ref EventDispatcher.
+ *
+ * The backends ( glib, epoll ) derive from this class and implement the
+ * event source and timer bookkeeping as well as the loop itself. The idle
+ * queue and the objects to unref later are shared, a backend only needs to
+ * call \ref runIdleTasks once \ref enableIdleSource was called and no other
+ * events are pending.
+ */
+class EventDispatcherPrivate : public BasePrivate
+{
+public:
+  ZYPP_DECLARE_PUBLIC(EventDispatcher)
+  EventDispatcherPrivate();
+  virtual ~EventDispatcherPrivate();
+
+  /*!
+   * Creates the private for \a backend. \a ctx is the GMainContext to
+   * use for the glib backend, it is ignored by the others.
+   */
+  static EventDispatcherPrivate *create( EventDispatcher::Backend backend, void *ctx );
+
+  bool runIdleTasks();
+
+  virtual EventDispatcher::Backend backend () const = 0;
+
+  virtual void enableIdleSource () = 0;
+
+  virtual void updateEventSource ( AbstractEventSource *notifier, int fd, int mode ) = 0;
+  virtual void removeEventSource ( AbstractEventSource *notifier, int fd ) = 0;
+  virtual void registerTimer ( Timer *timer ) = 0;
+  virtual void removeTimer ( Timer *timer ) = 0;
+  virtual ulong runningTimers () const = 0;
+
+  virtual bool runOnce () = 0;
+  virtual void run () = 0;
+  virtual void quit () = 0;
+
+  std::thread::id _myThreadId;
+  std::vector< std::shared_ptr<void> > _unrefLater;
+  std::queue< EventDispatcher::IdleFunction > _idleFuncs;
+};
+
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include <zypp/Pathname.h>
 #include <zypp/media/TransferSettings.h>
 #include <zypp/media/MetaLinkParser.h>
+#include <zypp/media/TransferValidators_p.h>
 #include <zypp/ByteCount.h>
 #include <zypp/base/String.h>
 #include <zypp/PathInfo.h>
@@ -117,6 +118,14 @@ namespace zyppng {
 
     if ( _checkExistsOnly )
       initialRequest->setOptions( initialRequest->options() | NetworkRequest::HeadRequest );
+    else if ( !_deltaFilePath.empty() && zypp::media::TransferValidators::enabled() ) {
+      // the delta file may be our last download of this URL, then we only need it if it changed
+      zypp::media::TransferValidators::Entry validators { zypp::media::TransferValidators::instance().lookup( initialRequest->url(), _deltaFilePath ) };
+      if ( !validators.empty() ) {
+        DBG << "Conditional request for " << initialRequest->url() << ": " << validators << std::endl;
+        initialRequest->setConditions( validators.etag, validators.lastModified );
+      }
+    }
 
     addNewRequest( initialRequest );
   }
@@ -293,7 +302,7 @@ namespace zyppng {
       //if rety is true we just enqueue the request again, usually this means authentication was updated
       if ( retry ) {
         //make sure this request will run asap
-        reqLocked->setPriority( NetworkRequest::High );
+        reqLocked->setPriority( blockPriority() );
 
         //this is not a new request, only add to queues but do not connect signals again
         _runningRequests.push_back( reqLocked );
@@ -329,9 +338,21 @@ namespace zyppng {
     }
 
     if ( _state == Download::Initializing || _state == Download::Running ) {
+      if ( req.notModified() ) {
+        DBG << req.url() << " not modified, using " << _deltaFilePath << std::endl;
+        if ( zypp::filesystem::copy( _deltaFilePath, _targetPath ) != 0 ) {
+          setFailed( zypp::str::Format("Failed to copy %1% to %2%" ) % _deltaFilePath % _targetPath );
+          return;
+        }
+        rememberValidators( req );
+        setFinished();
+        return;
+      }
+
       if ( _isMultiPartEnabled && !_isMultiDownload )
         _isMultiDownload = looks_like_metalink_file( req.targetFilePath() );
       if ( !_isMultiDownload ) {
+        rememberValidators( req );
         setFinished();
         return;
       }
@@ -570,10 +591,18 @@ namespace zyppng {
   {
     auto slot = _sigStarted.slots().front();
     req->connectSignals( *this );
+    if ( req->_myBlock == size_t(-1) )
+      req->setPriority( _priority );
     _runningRequests.push_back( req );
     _requestDispatcher->enqueue( req );
   }
 
+  NetworkRequest::Priority DownloadPrivate::blockPriority() const
+  {
+    //the blocks of a started download go first, unless it runs in the background
+    return ( _priority == NetworkRequest::Low ? NetworkRequest::Low : NetworkRequest::High );
+  }
+
   std::shared_ptr<DownloadPrivate::Request> DownloadPrivate::initMultiRequest( size_t block, NetworkRequestError &err )
   {
     zypp::media::MediaBlock blk = _blockList.getBlock( block );
@@ -588,7 +617,7 @@ namespace zyppng {
     std::shared_ptr<Request> req = std::make_shared<Request>( internal::clearQueryString( myUrl ), _targetPath, blk.off, blk.size, NetworkRequest::WriteShared );
     req->_originalUrl = myUrl;
     req->_myBlock = block;
-    req->setPriority( NetworkRequest::High );
+    req->setPriority( blockPriority() );
     req->transferSettings() = settings;
 
     if ( _blockList.haveChecksum( block ) ) {
@@ -645,6 +674,15 @@ namespace zyppng {
     setFinished( false );
   }
 
+  void DownloadPrivate::rememberValidators( NetworkRequest &req )
+  {
+    if ( _deltaFilePath.empty() || _checkExistsOnly || !zypp::media::TransferValidators::enabled() )
+      return;
+    zypp::media::TransferValidators &validators { zypp::media::TransferValidators::instance() };
+    validators.remember( req.url(), req.etag(), req.lastModified(), _targetPath );
+    validators.save();
+  }
+
   void DownloadPrivate::setFinished(bool success)
   {
     setState( success ? Download::Success : Download::Failed );
@@ -759,6 +797,19 @@ namespace zyppng {
     d_func()->_deltaFilePath = file;
   }
 
+  void Download::setPriority( NetworkRequest::Priority prio )
+  {
+    Z_D();
+    d->_priority = prio;
+    for ( const auto &req : d->_runningRequests )
+      req->setPriority( req->_myBlock == size_t(-1) ? prio : d->blockPriority() );
+  }
+
+  NetworkRequest::Priority Download::priority() const
+  {
+    return d_func()->_priority;
+  }
+
   zyppng::NetworkRequestDispatcher &Download::dispatcher() const
   {
     return *d_func()->_requestDispatcher;
@@ -6,6 +6,7 @@
 #include <zypp/zyppng/base/signals.h>
 #include <zypp/zyppng/core/Url>
 #include <zypp/zyppng/media/network/networkrequesterror.h>
+#include <zypp/zyppng/media/network/request.h>
 #include <zypp/zyppng/media/network/AuthData>
 
 #include <zypp/ByteCount.h>
@@ -209,6 +210,19 @@ namespace zyppng {
      */
     void setDeltaFile ( const zypp::Pathname &file );
 
+    /*!
+     * Sets the priority of all requests of the Download, \sa NetworkRequest::setPriority.
+     * Downloads with \ref NetworkRequest::Low priority run in the background, they get the
+     * smallest share of a limited bandwidth and leave a connection free for the others.
+     * \note this can be changed while the Download is running
+     */
+    void setPriority ( NetworkRequest::Priority prio );
+
+    /*!
+     * Returns the priority of the Download, \ref NetworkRequest::Normal by default
+     */
+    NetworkRequest::Priority priority () const;
+
     /*!
      * Returns a reference to the internally used \sa zyppng::NetworkRequestDispatcher
      */
@@ -6,6 +6,7 @@
 #include <zypp/zyppng/base/EventDispatcher>
 #include <zypp/media/CurlHelper.h>
 #include <zypp/media/MediaUserAuth.h>
+#include <zypp/ZConfig.h>
 #include <assert.h>
 
 #include <zypp/base/Logger.h>
@@ -15,8 +16,28 @@ using namespace boost;
 
 namespace zyppng {
 
+namespace {
+  /*!
+   * The weight of a request when sharing a limited bandwidth
+   */
+  inline double priorityWeight( NetworkRequest::Priority prio )
+  {
+    switch ( prio ) {
+      case NetworkRequest::High:
+        return 4.0;
+      case NetworkRequest::Normal:
+        return 2.0;
+      case NetworkRequest::Low:
+        return 1.0;
+    }
+    return 2.0;
+  }
+}
+
 NetworkRequestDispatcherPrivate::NetworkRequestDispatcherPrivate( )
-  : _timer( Timer::create() )
+  : _maxDownloadSpeed( std::max( zypp::ZConfig::instance().download_max_download_speed(), 0L ) )
+  , _sliceTimer( Timer::create() )
+  , _timer( Timer::create() )
   , _multi ( curl_multi_init() )
 {
   internal::globalInitCurlOnce();
@@ -25,8 +46,14 @@ NetworkRequestDispatcherPrivate::NetworkRequestDispatcherPrivate( )
   curl_multi_setopt( _multi, CURLMOPT_TIMERDATA, reinterpret_cast<void *>( this ) );
   curl_multi_setopt( _multi, CURLMOPT_SOCKETFUNCTION, NetworkRequestDispatcherPrivate::static_socket_callback );
   curl_multi_setopt( _multi, CURLMOPT_SOCKETDATA, reinterpret_cast<void *>( this ) );
+#if CURLVERSION_AT_LEAST(7,43,0)
+  //run requests to the same host as streams of one HTTP/2 connection where possible
+  curl_multi_setopt( _multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX );
+#endif
+  applyConnectionLimits();
 
   _timer->sigExpired().connect( sigc::mem_fun( *this, &NetworkRequestDispatcherPrivate::multiTimerTimout ) );
+  _sliceTimer->sigExpired().connect( sigc::mem_fun( *this, &NetworkRequestDispatcherPrivate::sliceTimerTimeout ) );
 }
 
 NetworkRequestDispatcherPrivate::~NetworkRequestDispatcherPrivate()
@@ -175,6 +202,15 @@ void NetworkRequestDispatcherPrivate::handleMultiSocketAction(curl_socket_t nati
 
       NetworkRequestPrivate *request = reinterpret_cast<NetworkRequestPrivate *>( privatePtr );
 
+#if CURLVERSION_AT_LEAST(7,50,0)
+      //remember the hosts talking HTTP/2, further requests to them can share a connection
+      long httpVersion = 0;
+      if ( res == CURLE_OK
+           && curl_easy_getinfo( easy, CURLINFO_HTTP_VERSION, &httpVersion ) == CURLE_OK
+           && httpVersion >= CURL_HTTP_VERSION_2_0 )
+        setMultiplexing( request->z_func()->url().getHost() );
+#endif
+
       //trigger notification about file downloaded
       NetworkRequestError e = NetworkRequestErrorPrivate::fromCurlError( *request->z_func(), res, request->_errorBuf.data() );
       setFinished( *request->z_func(), e );
@@ -193,8 +229,8 @@ void NetworkRequestDispatcherPrivate::cancelAll( NetworkRequestError result )
     std::shared_ptr<NetworkRequest> &req = _runningDownloads.back();
     setFinished(*req, result );
   }
-  while ( _pendingDownloads.size() ) {
-    std::shared_ptr<NetworkRequest> &req = _pendingDownloads.back();
+  while ( _pendingCount ) {
+    std::shared_ptr<NetworkRequest> req = _pendingDownloads.begin()->second.begin()->second.front().second;
     setFinished(*req, result );
   }
 
@@ -210,11 +246,15 @@ void NetworkRequestDispatcherPrivate::setFinished( NetworkRequest &req, NetworkR
     if ( it != list.end() ) {
       EventDispatcher::unrefLater( *it );
       list.erase( it );
+      return true;
     }
+    return false;
   };
 
-  delReq( _runningDownloads, req );
-  delReq( _pendingDownloads, req );
+  if ( delReq( _runningDownloads, req ) )
+    runningChanged( req.url().getHost(), false );
+  if ( std::shared_ptr<NetworkRequest> pending = takePending( req ) )
+    EventDispatcher::unrefLater( pending );
 
   void *easyHandle = req.d_func()->_easyHandle;
   if ( easyHandle ) {
@@ -237,12 +277,23 @@ void NetworkRequestDispatcherPrivate::dequeuePending()
   if ( !_isRunning || _locked )
     return;
 
-  while ( _maxConnections > _runningDownloads.size() ) {
-    if ( !_pendingDownloads.size() )
+  while ( _pendingCount ) {
+    //first pending request with the highest priority to a host with free capacity,
+    //all requests queued for a host at the same priority need the same capacity
+    PendingQueue *queue = nullptr;
+    for ( auto &prioQueues : _pendingDownloads ) {
+      for ( auto &hostQueue : prioQueues.second ) {
+        PendingQueue &candidate = hostQueue.second;
+        if ( ( !queue || candidate.front().first < queue->front().first ) && hasCapacity( *candidate.front().second ) )
+          queue = &candidate;
+      }
+      if ( queue )
+        break;
+    }
+    if ( !queue )
       break;
 
-    std::shared_ptr<NetworkRequest> req = std::move( _pendingDownloads.front() );
-    _pendingDownloads.pop_front();
+    std::shared_ptr<NetworkRequest> req = takePending( *queue->front().second );
 
     std::string errBuf = "Failed to initialize easy handle";
     if ( !req->d_func()->initialize( errBuf ) ) {
@@ -262,17 +313,265 @@ void NetworkRequestDispatcherPrivate::dequeuePending()
     req->d_func()->aboutToStart();
     _sigDownloadStarted.emit( *z_func(), *req );
 
+    runningChanged( req->url().getHost(), true );
     _runningDownloads.push_back( std::move(req) );
   }
 
+  updateSliceTimer();
+
   //check for empty queues
-  if ( _pendingDownloads.size() == 0 && _runningDownloads.size() == 0 ) {
+  if ( _pendingCount == 0 && _runningDownloads.size() == 0 ) {
     //once we finished all requests, cancel the timer too, so curl is not called without requests
     _timer->stop();
     _sigQueueFinished.emit( *z_func() );
   }
 }
 
+size_t NetworkRequestDispatcherPrivate::connectionsFor( const std::string &host, size_t running ) const
+{
+  if ( _multiplexHosts.count( host ) )
+    return ( running + _maxStreamsPerConnection - 1 ) / _maxStreamsPerConnection;
+  return running;
+}
+
+void NetworkRequestDispatcherPrivate::runningChanged( const std::string &host, bool started )
+{
+  size_t &running = _runningPerHost[ host ];
+  _runningConnections -= connectionsFor( host, running );
+  if ( started )
+    running++;
+  else if ( running )
+    running--;
+  _runningConnections += connectionsFor( host, running );
+
+  if ( !running )
+    _runningPerHost.erase( host );
+}
+
+void NetworkRequestDispatcherPrivate::setMultiplexing( const std::string &host )
+{
+  if ( _multiplexHosts.count( host ) )
+    return;
+
+  auto it = _runningPerHost.find( host );
+  size_t running = ( it != _runningPerHost.end() ? it->second : 0 );
+  _runningConnections -= connectionsFor( host, running );
+  _multiplexHosts.insert( host );
+  _runningConnections += connectionsFor( host, running );
+}
+
+bool NetworkRequestDispatcherPrivate::hasCapacity( const NetworkRequest &req ) const
+{
+  const std::string &host = req.url().getHost();
+  auto it = _runningPerHost.find( host );
+  size_t running = ( it != _runningPerHost.end() ? it->second : 0 );
+
+  //a multiplexing connection to the host has a free stream left
+  if ( _multiplexHosts.count( host ) && running % _maxStreamsPerConnection != 0 )
+    return true;
+
+  //otherwise the request needs a new connection
+  if ( _maxConnectionsPerHost && connectionsFor( host, running ) >= _maxConnectionsPerHost )
+    return false;
+
+  //keep the last connection free for requests that are not in the background
+  if ( req.priority() == NetworkRequest::Low && _maxConnections > 1 )
+    return _runningConnections + 1 < _maxConnections;
+  return _runningConnections < _maxConnections;
+}
+
+bool NetworkRequestDispatcherPrivate::mayReceive( NetworkRequestPrivate &req, size_t bytes )
+{
+  if ( !_maxDownloadSpeed )
+    return true;
+
+  bool allowed = req._sliceReceived < req._sliceAllowance;
+  if ( !allowed ) {
+    //take what is left of the budget, if the other requests that are busy can still receive their part
+    size_t reserved = _sliceReceived;
+    for ( const auto &running : _runningDownloads ) {
+      const NetworkRequestPrivate *other = running->d_func();
+      if ( other != &req && other->_sliceActive && other->_sliceReceived < other->_sliceAllowance )
+        reserved += other->_sliceAllowance - other->_sliceReceived;
+    }
+    allowed = reserved < _sliceBudget;
+  }
+
+  if ( !allowed ) {
+    req._paused = true;
+    return false;
+  }
+
+  //a chunk exceeding the allowance is taken from the next slice
+  req._sliceReceived += bytes;
+  _sliceReceived += bytes;
+  return true;
+}
+
+void NetworkRequestDispatcherPrivate::addPending( std::shared_ptr<NetworkRequest> req, uint64_t seq )
+{
+  PendingQueue &queue = _pendingDownloads[ req->priority() ][ req->url().getHost() ];
+  auto it = std::find_if( queue.rbegin(), queue.rend(), [ seq ]( const PendingQueue::value_type &entry ) {
+    return entry.first < seq;
+  } );
+  queue.emplace( it.base(), seq, std::move(req) );
+  _pendingCount++;
+}
+
+std::shared_ptr<NetworkRequest> NetworkRequestDispatcherPrivate::takePending( NetworkRequest &req, uint64_t *seq )
+{
+  auto take = [ & ]( auto prioIt, auto hostIt ) -> std::shared_ptr<NetworkRequest> {
+    PendingQueue &queue = hostIt->second;
+    auto it = std::find_if( queue.begin(), queue.end(), [ &req ]( const PendingQueue::value_type &entry ) {
+      return req.d_func() == entry.second->d_func();
+    } );
+    if ( it == queue.end() )
+      return nullptr;
+
+    std::shared_ptr<NetworkRequest> taken = std::move( it->second );
+    if ( seq )
+      *seq = it->first;
+    queue.erase( it );
+    if ( queue.empty() ) {
+      prioIt->second.erase( hostIt );
+      if ( prioIt->second.empty() )
+        _pendingDownloads.erase( prioIt );
+    }
+    _pendingCount--;
+    return taken;
+  };
+
+  //the request is queued by its host, unless the url changed while it was pending
+  for ( auto prioIt = _pendingDownloads.begin(); prioIt != _pendingDownloads.end(); ++prioIt ) {
+    auto hostIt = prioIt->second.find( req.url().getHost() );
+    if ( hostIt != prioIt->second.end() ) {
+      if ( std::shared_ptr<NetworkRequest> taken = take( prioIt, hostIt ) )
+        return taken;
+    }
+  }
+  for ( auto prioIt = _pendingDownloads.begin(); prioIt != _pendingDownloads.end(); ++prioIt ) {
+    for ( auto hostIt = prioIt->second.begin(); hostIt != prioIt->second.end(); ++hostIt ) {
+      if ( std::shared_ptr<NetworkRequest> taken = take( prioIt, hostIt ) )
+        return taken;
+    }
+  }
+  return nullptr;
+}
+
+void NetworkRequestDispatcherPrivate::priorityChanged( NetworkRequest &req )
+{
+  auto it = std::find_if( _runningDownloads.begin(), _runningDownloads.end(), [ &req ]( const std::shared_ptr<NetworkRequest> &r ) {
+    return req.d_func() == r->d_func();
+  } );
+  if ( it != _runningDownloads.end() ) {
+    if ( _maxDownloadSpeed )
+      updateAllowances();
+    return;
+  }
+
+  //requeue the request by its new priority, keeping its place in the order of arrival
+  uint64_t seq = 0;
+  if ( std::shared_ptr<NetworkRequest> pending = takePending( req, &seq ) )
+    addPending( std::move(pending), seq );
+
+  //a request that is no longer in the background might find a free connection now
+  dequeuePending();
+}
+
+void NetworkRequestDispatcherPrivate::sliceTimerTimeout( const Timer & )
+{
+  if ( !_maxDownloadSpeed || _runningDownloads.empty() ) {
+    updateSliceTimer();
+    return;
+  }
+  startSlice();
+}
+
+void NetworkRequestDispatcherPrivate::startSlice()
+{
+  _sliceBudget = std::max<size_t>( _maxDownloadSpeed * _sliceMs / 1000, 1 );
+  _sliceReceived = 0;
+
+  for ( const auto &running : _runningDownloads ) {
+    NetworkRequestPrivate *req = running->d_func();
+    //requests waiting for the server do not hold back the others
+    req->_sliceActive = req->_sliceReceived > 0 || req->_paused;
+    req->_sliceReceived = ( req->_sliceReceived > req->_sliceAllowance ? req->_sliceReceived - req->_sliceAllowance : 0 );
+    _sliceReceived += req->_sliceReceived;
+  }
+  updateAllowances();
+
+  //resume the paused requests, higher priorities first, they might pause again right away
+  std::vector< std::shared_ptr<NetworkRequest> > paused;
+  std::copy_if( _runningDownloads.begin(), _runningDownloads.end(), std::back_inserter( paused ), []( const auto &req ){
+    return req->d_func()->_paused;
+  });
+  std::stable_sort( paused.begin(), paused.end(), []( const auto &a, const auto &b ){
+    return a->priority() > b->priority();
+  });
+  for ( const auto &req : paused )
+    unpause( *req->d_func() );
+}
+
+void NetworkRequestDispatcherPrivate::updateAllowances()
+{
+  //each host gets a part of the budget per priority, shared by all its requests of that priority,
+  //so the bandwidth is shared fairly between mirrors no matter how many requests run on each of them
+  std::map< std::pair< std::string, NetworkRequest::Priority >, size_t > groups;
+  for ( const auto &req : _runningDownloads )
+    groups[ std::make_pair( req->url().getHost(), req->priority() ) ]++;
+
+  double totalWeight = 0.0;
+  for ( const auto &group : groups )
+    totalWeight += priorityWeight( group.first.second );
+
+  for ( const auto &req : _runningDownloads ) {
+    size_t groupSize = groups[ std::make_pair( req->url().getHost(), req->priority() ) ];
+    double share = priorityWeight( req->priority() ) / totalWeight / groupSize;
+    req->d_func()->_sliceAllowance = static_cast<size_t>( _sliceBudget * share );
+  }
+}
+
+void NetworkRequestDispatcherPrivate::updateSliceTimer()
+{
+  if ( _maxDownloadSpeed && _runningDownloads.size() ) {
+    if ( _sliceTimer->isRunning() )
+      updateAllowances();
+    else {
+      startSlice();
+      _sliceTimer->start( _sliceMs );
+    }
+    return;
+  }
+
+  _sliceTimer->stop();
+
+  //without a limit no request may stay paused
+  std::vector< std::shared_ptr<NetworkRequest> > running( _runningDownloads );
+  for ( const auto &req : running ) {
+    if ( req->d_func()->_paused )
+      unpause( *req->d_func() );
+  }
+}
+
+void NetworkRequestDispatcherPrivate::unpause( NetworkRequestPrivate &req )
+{
+  req._paused = false;
+  if ( req._easyHandle )
+    curl_easy_pause( req._easyHandle, CURLPAUSE_CONT );
+}
+
+void NetworkRequestDispatcherPrivate::applyConnectionLimits()
+{
+#if CURLVERSION_AT_LEAST(7,30,0)
+  curl_multi_setopt( _multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, static_cast<long>( _maxConnections ) );
+  curl_multi_setopt( _multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>( _maxConnectionsPerHost ) );
+#endif
+#if CURLVERSION_AT_LEAST(7,67,0)
+  curl_multi_setopt( _multi, CURLMOPT_MAX_CONCURRENT_STREAMS, static_cast<long>( _maxStreamsPerConnection ) );
+#endif
+}
+
 NetworkRequestDispatcher::NetworkRequestDispatcher( )
   : Base( * new NetworkRequestDispatcherPrivate ( ) )
 {
@@ -300,7 +599,31 @@ bool NetworkRequestDispatcher::supportsProtocol( const Url &url )
 
 void NetworkRequestDispatcher::setMaximumConcurrentConnections( size_t maxConn )
 {
-  d_func()->_maxConnections = maxConn;
+  Z_D();
+  d->_maxConnections = maxConn;
+  d->applyConnectionLimits();
+}
+
+void NetworkRequestDispatcher::setMaximumConnectionsPerHost( size_t maxConn )
+{
+  Z_D();
+  d->_maxConnectionsPerHost = maxConn;
+  d->applyConnectionLimits();
+}
+
+void NetworkRequestDispatcher::setMaximumDownloadSpeed( size_t bytesPerSec )
+{
+  Z_D();
+  if ( d->_maxDownloadSpeed == bytesPerSec )
+    return;
+  d->_maxDownloadSpeed = bytesPerSec;
+  d->_sliceTimer->stop();
+  d->updateSliceTimer();
+}
+
+size_t NetworkRequestDispatcher::maximumDownloadSpeed() const
+{
+  return d_func()->_maxDownloadSpeed;
 }
 
 void NetworkRequestDispatcher::enqueue(const std::shared_ptr<NetworkRequest> &req )
@@ -314,24 +637,14 @@ void NetworkRequestDispatcher::enqueue(const std::shared_ptr<NetworkRequest> &re
     return;
   }
 
-  if ( std::find( d->_pendingDownloads.begin(), d->_pendingDownloads.end(), req ) != d->_pendingDownloads.end() ) {
+  if ( req->d_func()->_dispatcher == this ) {
     WAR << "Ignoring request to enqueue download " << req->url().asString() << " request is already enqueued " << std::endl;
     return;
   }
 
+  //dequeuePending picks the requests by priority, then in order of arrival
   req->d_func()->_dispatcher = this;
-  if ( req->priority() == NetworkRequest::Normal )
-    d->_pendingDownloads.push_back( req );
-  else {
-    auto it = std::find_if( d->_pendingDownloads.begin(), d->_pendingDownloads.end(), []( const auto &req ){
-      return req->priority() ==  NetworkRequest::Normal;
-    });
-
-    //if we have a valid iterator, decrement we found a Normal pending download request, insert before that
-    if ( it != d->_pendingDownloads.end() && it != d->_pendingDownloads.begin() )
-      it--;
-    d->_pendingDownloads.insert( it, req );
-  }
+  d->addPending( req, d->_pendingSeq++ );
 
   //dequeue if running and we have capacity
   d->dequeuePending();
@@ -359,7 +672,7 @@ void NetworkRequestDispatcher::run()
   Z_D();
   d->_isRunning = true;
 
-  if ( d->_pendingDownloads.size() )
+  if ( d->_pendingCount )
     d->dequeuePending();
 }
 
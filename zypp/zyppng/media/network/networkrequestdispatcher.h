@@ -23,6 +23,11 @@ namespace zyppng {
    * right away. Its possible to change the maximum number of concurrent connections to control
    * the load on the network.
    *
+   * If a maximum download speed is set, it is enforced for all running requests together.
+   * The bandwidth is handed out in slices of 100ms, weighted by the \ref NetworkRequest::Priority
+   * of the requests, requests of the same priority to the same host share their part. A request
+   * exceeding its part is paused until the next slice, unless bandwidth is left unused by others.
+   *
    * \code
    * zyppng::EventDispatcher::Ptr loop = zyppng::EventDispatcher::createMain();
    * zyppng::NetworkRequestDispatcher downloader;
@@ -76,6 +81,8 @@ namespace zyppng {
   class LIBZYPP_NG_EXPORT NetworkRequestDispatcher : public Base
   {
     ZYPP_DECLARE_PRIVATE(NetworkRequestDispatcher)
+    friend class NetworkRequest;
+    friend class NetworkRequestPrivate;
     public:
 
       using Ptr = std::shared_ptr<NetworkRequestDispatcher>;
@@ -90,10 +97,31 @@ namespace zyppng {
       static bool supportsProtocol ( const Url &url );
 
       /*!
-       * Change the number of the concurrently started requests, the default is 10.
+       * Change the number of concurrently open connections, the default is 10.
+       * Requests to hosts that are known to support HTTP/2 share connections, so
+       * more requests than connections may be running.
        */
       void setMaximumConcurrentConnections (size_t maxConn );
 
+      /*!
+       * Limit the number of concurrently open connections to the same host, the default
+       * is 0 (no limit). Pending requests to other hosts are started first, so requests spread
+       * across mirrors use the available connections.
+       */
+      void setMaximumConnectionsPerHost ( size_t maxConn );
+
+      /*!
+       * Limit the download speed of all running requests together to \a bytesPerSec,
+       * 0 means no limit. The default is \ref zypp::ZConfig::download_max_download_speed.
+       * \note The per request limits of the \ref TransferSettings still apply.
+       */
+      void setMaximumDownloadSpeed ( size_t bytesPerSec );
+
+      /*!
+       * Returns the global download speed limit in bytes per second, 0 if there is none.
+       */
+      size_t maximumDownloadSpeed ( ) const;
+
       /*!
        * Enqueues a new \a request and puts it into the waiting queue. If the dispatcher
        * is already running and has free capacatly the request might be started right away
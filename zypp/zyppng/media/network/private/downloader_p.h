@@ -69,6 +69,7 @@ namespace zyppng {
 
     Downloader *_parent = nullptr;
     Download::State _state = Download::InitialState;
+    NetworkRequest::Priority _priority = NetworkRequest::Normal;
 
     bool _isMultiDownload = false;   //< State flag, shows if we are currently downloading a multi part file
     bool _isMultiPartEnabled = true; //< Enables/Disables automatic multipart downloads
@@ -89,9 +90,11 @@ namespace zyppng {
     void onRequestFinished ( NetworkRequest &req , const NetworkRequestError &err );
     void addNewRequest     (std::shared_ptr<Request> req );
     std::shared_ptr<Request> initMultiRequest(size_t block , NetworkRequestError &err);
+    NetworkRequest::Priority blockPriority () const;
     bool findNextMirror( Url &url, TransferSettings &set, NetworkRequestError &err );
     void setFailed         ( std::string && reason );
     void setFinished       ( bool success = true );
+    void rememberValidators ( NetworkRequest &req );
     NetworkRequestError safeFillSettingsFromURL ( const Url &url, TransferSettings &set );
   };
 
@@ -2,15 +2,19 @@
 #define ZYPP_NG_MEDIA_CURL_PRIVATE_CURL_P_H_INCLUDED
 
 #include <zypp/zyppng/media/network/networkrequestdispatcher.h>
+#include <zypp/zyppng/media/network/request.h>
 #include <zypp/zyppng/base/private/base_p.h>
 #include <curl/curl.h>
 #include <deque>
+#include <functional>
+#include <map>
 #include <set>
 
 namespace zyppng {
 
 class Timer;
 class SocketNotifier;
+class NetworkRequestPrivate;
 
 class NetworkRequestDispatcherPrivate : public BasePrivate
 {
@@ -20,8 +24,68 @@ public:
   virtual ~NetworkRequestDispatcherPrivate();
 
   size_t _maxConnections = 10;
-
-  std::deque< std::shared_ptr<NetworkRequest> > _pendingDownloads;
+  size_t _maxConnectionsPerHost = 0; //< 0: no limit
+  size_t _maxStreamsPerConnection = 100; //< concurrent requests on one multiplexing (HTTP/2) connection
+
+  /*!
+   * Returns true if \a req can be started without exceeding the connection limits.
+   * Requests to hosts known to multiplex share connections, each other request
+   * needs its own one.
+   */
+  bool hasCapacity ( const NetworkRequest &req ) const;
+  size_t connectionsFor ( const std::string &host, size_t running ) const;
+
+  /*!
+   * A request to \a host was started ( \a started is true ) or finished,
+   * keeps the per host and the total connection counts up to date.
+   */
+  void runningChanged ( const std::string &host, bool started );
+
+  /*!
+   * \a host was found to multiplex, its running requests share connections from now on.
+   */
+  void setMultiplexing ( const std::string &host );
+  void applyConnectionLimits ();
+
+  /*!
+   * Called from the write callback of the running request \a req before \a bytes are received.
+   * Returns false if the request exceeded its share of the current bandwidth slice and no
+   * bandwidth is left unused by others, the request is marked as paused then.
+   */
+  bool mayReceive ( NetworkRequestPrivate &req, size_t bytes );
+
+  /*!
+   * Queues \a req as pending, \a seq is its position in the order of arrival.
+   */
+  void addPending ( std::shared_ptr<NetworkRequest> req, uint64_t seq );
+
+  /*!
+   * Removes \a req from the pending requests and returns it, or a nullptr if it is not pending.
+   * If \a seq is given, it is set to the position of \a req in the order of arrival.
+   */
+  std::shared_ptr<NetworkRequest> takePending ( NetworkRequest &req, uint64_t *seq = nullptr );
+
+  /*!
+   * The priority of \a req changed, if it is running the bandwidth is shared again.
+   */
+  void priorityChanged ( NetworkRequest &req );
+
+  static constexpr uint64_t _sliceMs = 100; //< the download speed limit is enforced in slices of this many ms
+
+  size_t _maxDownloadSpeed = 0; //< bytes per second, 0: no limit
+  size_t _sliceBudget = 0;      //< bytes all requests may receive in the current slice
+  size_t _sliceReceived = 0;    //< bytes received by all requests in the current slice
+  std::shared_ptr<Timer> _sliceTimer;
+
+  std::map< std::string, size_t > _runningPerHost;
+  size_t _runningConnections = 0; //< connections used by all running requests
+  std::set< std::string > _multiplexHosts; //< hosts a request was transferred from using HTTP/2
+
+  //pending requests by priority (highest first) and host, each queue in order of arrival
+  using PendingQueue = std::deque< std::pair< uint64_t, std::shared_ptr<NetworkRequest> > >;
+  std::map< NetworkRequest::Priority, std::map< std::string, PendingQueue >, std::greater<NetworkRequest::Priority> > _pendingDownloads;
+  size_t _pendingCount = 0;
+  uint64_t _pendingSeq = 0; //< the next position in the order of arrival
   std::vector< std::shared_ptr<NetworkRequest> > _runningDownloads;
 
   std::shared_ptr<Timer> _timer;
@@ -53,6 +117,12 @@ private:
 
   void handleMultiSocketAction ( curl_socket_t nativeSocket, int evBitmask );
   void dequeuePending ();
+
+  void sliceTimerTimeout ( const Timer &t );
+  void startSlice ();
+  void updateAllowances ();
+  void updateSliceTimer ();
+  void unpause ( NetworkRequestPrivate &req );
 };
 }
 
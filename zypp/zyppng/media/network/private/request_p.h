@@ -44,6 +44,12 @@ namespace zyppng {
     std::string _lastRedirect;	///< to log/report redirections
     std::string _currentCookieFile = "/var/lib/YaST2/cookies";
 
+    std::string _ifNoneMatch;         //< ETag to send, \sa NetworkRequest::setConditions
+    time_t _ifModifiedSince = 0;      //< Last-Modified to send
+    std::string _etag;                //< ETag of the last response
+    time_t _lastModified = 0;         //< Last-Modified of the last response
+    bool _notModified = false;        //< the server sent 304
+
     off_t _start = -1;  //start offset of block to request
     off_t _len   = 0;  //len of block to request ( 0 if full length
     off_t _downloaded = -1; //downloaded bytes
@@ -52,6 +58,12 @@ namespace zyppng {
     NetworkRequest::FileMode _fMode = NetworkRequest::WriteExclusive;
     NetworkRequest::Priority _priority = NetworkRequest::Normal;
 
+    //bandwidth scheduling, \sa NetworkRequestDispatcher::setMaximumDownloadSpeed
+    size_t _sliceAllowance = 0; //< bytes the request may receive in the current slice
+    size_t _sliceReceived  = 0; //< bytes received in the current slice
+    bool   _paused = false;     //< the transfer is paused until the next slice
+    bool   _sliceActive = true; //< received data in the last slice, its allowance is kept free for it
+
     std::shared_ptr<zypp::Digest> _digest; //digest to be used to calculate checksum
     std::vector<unsigned char> _expectedChecksum; //checksum to be expected after download is finished
 
@@ -72,6 +84,7 @@ namespace zyppng {
 
     static int curlProgressCallback ( void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow );
     static size_t writeCallback ( char *ptr, size_t size, size_t nmemb, void *userdata );
+    static size_t headerCallback ( char *ptr, size_t size, size_t nmemb, void *userdata );
 
     std::unique_ptr< curl_slist, decltype (&curl_slist_free_all) > _headers;
   };
@@ -1,6 +1,6 @@
 #include <zypp/zyppng/media/network/private/request_p.h>
 #include <zypp/zyppng/media/network/private/networkrequesterror_p.h>
-#include <zypp/zyppng/media/network/networkrequestdispatcher.h>
+#include <zypp/zyppng/media/network/private/networkrequestdispatcher_p.h>
 #include <zypp/media/CurlHelper.h>
 #include <zypp/media/CurlConfig.h>
 #include <zypp/media/MediaUserAuth.h>
@@ -75,6 +75,12 @@ namespace zyppng {
       setCurlOption( CURLOPT_XFERINFODATA, this  );
       setCurlOption( CURLOPT_NOPROGRESS, 0L);
       setCurlOption( CURLOPT_FAILONERROR, 1L);
+      // resolve hosts and do full TLS handshakes only once, see internal::curlShare
+      setCurlOption( CURLOPT_SHARE, internal::curlShare() );
+#if CURLVERSION_AT_LEAST(7,43,0)
+      // wait for a pending connection to the host that might multiplex rather than opening a new one
+      setCurlOption( CURLOPT_PIPEWAIT, 1L );
+#endif
       setCurlOption( CURLOPT_NOSIGNAL, 1L);
 
       std::string urlBuffer( _url.asString() );
@@ -147,8 +153,16 @@ namespace zyppng {
         default: break;
       }
 
-      setCurlOption( CURLOPT_HEADERFUNCTION, internal::log_redirects_curl );
-      setCurlOption( CURLOPT_HEADERDATA, &_lastRedirect );
+      setCurlOption( CURLOPT_HEADERFUNCTION, NetworkRequestPrivate::headerCallback );
+      setCurlOption( CURLOPT_HEADERDATA, this );
+
+      // conditional request, see NetworkRequest::setConditions
+      if ( !_ifNoneMatch.empty() )
+        locSet.addHeader( "If-None-Match: " + _ifNoneMatch );
+      if ( _ifModifiedSince ) {
+        setCurlOption( CURLOPT_TIMECONDITION, CURL_TIMECOND_IFMODSINCE );
+        setCurlOption( CURLOPT_TIMEVALUE, static_cast<long>( _ifModifiedSince ) );
+      }
 
       /**
         * Connect timeout
@@ -282,7 +296,9 @@ namespace zyppng {
       }
 
       /** Speed limits */
-      if ( locSet.minDownloadSpeed() != 0 )
+      //a request throttled by the global limit of the dispatcher would be aborted by
+      //the low speed limit, a stalled transfer is still caught by the activity timer
+      if ( locSet.minDownloadSpeed() != 0 && !( _dispatcher && _dispatcher->maximumDownloadSpeed() ) )
       {
         setCurlOption(CURLOPT_LOW_SPEED_LIMIT, locSet.minDownloadSpeed());
         // default to 10 seconds at low speed
@@ -348,7 +364,15 @@ namespace zyppng {
     if ( _result.type() == NetworkRequestError::NoError ) {
       //we have a successful download, lets see if the checksum is fine IF we have one
       _state = NetworkRequest::Finished;
-      if ( _expectedChecksum.size() && _digest ) {
+
+      long statuscode = 0;
+      if ( _easyHandle && ( !_ifNoneMatch.empty() || _ifModifiedSince ) )
+        (void)curl_easy_getinfo( _easyHandle, CURLINFO_RESPONSE_CODE, &statuscode );
+      _notModified = ( statuscode == 304 );
+
+      if ( _notModified ) {
+        //nothing was written, so there is nothing to check
+      } else if ( _expectedChecksum.size() && _digest ) {
         if ( _digest->digestVector() != _expectedChecksum ) {
           _state = NetworkRequest::Error;
 
@@ -382,6 +406,13 @@ namespace zyppng {
     _state = NetworkRequest::Pending;
     _downloaded = -1;
     _reportedSize = 0;
+    _etag.clear();
+    _lastModified = 0;
+    _notModified = false;
+    _sliceAllowance = 0;
+    _sliceReceived = 0;
+    _paused = false;
+    _sliceActive = true;
     _errorBuf.fill( 0 );
     _headers.reset( nullptr );
   }
@@ -436,6 +467,10 @@ namespace zyppng {
       return ( size * nmemb );
     }
 
+    //the dispatcher unpauses the transfer once bandwidth is available, curl delivers the data again then
+    if ( that->_dispatcher && !that->_dispatcher->d_func()->mayReceive( *that, size * nmemb ) )
+      return CURL_WRITEFUNC_PAUSE;
+
     //If we expect a file range we better double check that we got the status code for it
     if ( that->_expectRangeStatus ) {
       char *effurl;
@@ -483,6 +518,16 @@ namespace zyppng {
      return written;
   }
 
+  size_t NetworkRequestPrivate::headerCallback( char *ptr, size_t size, size_t nmemb, void *userdata )
+  {
+    if ( !userdata )
+      return internal::log_redirects_curl( ptr, size, nmemb, nullptr );
+
+    NetworkRequestPrivate *that = reinterpret_cast<NetworkRequestPrivate *>( userdata );
+    internal::track_validators_curl( ptr, size * nmemb, that->_etag, that->_lastModified );
+    return internal::log_redirects_curl( ptr, size, nmemb, &that->_lastRedirect );
+  }
+
   NetworkRequest::NetworkRequest(zyppng::Url url, zypp::filesystem::Pathname targetFile, off_t start, off_t len, zyppng::NetworkRequest::FileMode fMode)
     : Base ( *new NetworkRequestPrivate( std::move(url), std::move(targetFile), std::move(start), std::move(len), std::move(fMode) ) )
   {
@@ -501,7 +546,12 @@ namespace zyppng {
 
   void NetworkRequest::setPriority(NetworkRequest::Priority prio)
   {
-    d_func()->_priority = prio;
+    Z_D();
+    if ( d->_priority == prio )
+      return;
+    d->_priority = prio;
+    if ( d->_dispatcher )
+      d->_dispatcher->d_func()->priorityChanged( *this );
   }
 
   NetworkRequest::Priority NetworkRequest::priority() const
@@ -652,6 +702,30 @@ namespace zyppng {
     return true;
   }
 
+  void NetworkRequest::setConditions( const std::string &etag, time_t lastModified )
+  {
+    Z_D();
+    if ( d->_state == Running )
+      return;
+    d->_ifNoneMatch = etag;
+    d->_ifModifiedSince = lastModified;
+  }
+
+  bool NetworkRequest::notModified() const
+  {
+    return d_func()->_notModified;
+  }
+
+  const std::string &NetworkRequest::etag() const
+  {
+    return d_func()->_etag;
+  }
+
+  time_t NetworkRequest::lastModified() const
+  {
+    return d_func()->_lastModified;
+  }
+
   SignalProxy<void (NetworkRequest &req)> NetworkRequest::sigStarted()
   {
     return d_func()->_sigStarted;
@@ -47,8 +47,9 @@ namespace zyppng {
     };
 
     enum Priority {
-      Normal, //< Requests with normal priority will be enqueued at the end
-      High    //< Request with high priority will be moved to the front of the queue
+      Low = -1, //< Background requests, started after all others and never on the last free connection
+      Normal,   //< Requests with normal priority will be enqueued at the end
+      High      //< Request with high priority will be moved to the front of the queue
     };
 
     enum FileMode {
@@ -73,8 +74,9 @@ namespace zyppng {
 
     /*!
      * Sets the priority of the NetworkRequest, this will affect where
-     * the \sa NetworkRequestDispatcher puts the Request in the Queue.
-     * \note changing this makes only sense before enqueueing the request
+     * the \sa NetworkRequestDispatcher puts the Request in the Queue and
+     * which share of a limited bandwidth it gets while running.
+     * \note changing this while the request is enqueued or running takes effect immediately
      */
     void setPriority ( Priority prio );
 
@@ -219,6 +221,29 @@ namespace zyppng {
      */
     bool addRequestHeader(const std::string &header );
 
+    /*!
+     * Makes this a conditional request. The server only sends the file if it changed since the
+     * response that carried \a etag and \a lastModified ( If-None-Match, If-Modified-Since ).
+     * Otherwise the request finishes without error, but does not write the target file, \sa notModified.
+     * \note changing this makes only sense before the request was started
+     */
+    void setConditions ( const std::string &etag, time_t lastModified );
+
+    /*!
+     * Returns true if the server reported the file as not modified, \sa setConditions
+     */
+    bool notModified () const;
+
+    /*!
+     * Returns the ETag of the last response, empty if the server sent none
+     */
+    const std::string &etag () const;
+
+    /*!
+     * Returns the Last-Modified time of the last response, 0 if the server sent none
+     */
+    time_t lastModified () const;
+
     /**
      * Signals that the dispatcher dequeued the request and actually starts downloading data
      */